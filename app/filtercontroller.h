@@ -34,6 +34,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 
 // Local
 #include <lib/datewidget.h>
+#include <lib/namesearchindex.h>
 #include <lib/semanticinfo/sorteddirmodel.h>
 #include <lib/timeutils.h>
 
@@ -69,9 +70,13 @@ public:
     };
     NameFilter(SortedDirModel* model)
     : AbstractSortedDirModelFilter(model)
-    , mText()
     , mMode(Contains)
-    {}
+    {
+        // The index is per folder
+        connect(model, &QAbstractItemModel::modelReset, this, [this]() {
+            mIndex.clear();
+        });
+    }
 
     bool needsSemanticInfo() const override
     {
@@ -80,20 +85,20 @@ public:
 
     bool acceptsIndex(const QModelIndex& index) const override
     {
-        if (mText.isEmpty()) {
+        if (mIndex.text().isEmpty()) {
             return true;
         }
         switch (mMode) {
             case Contains:
-                return index.data().toString().contains(mText, Qt::CaseInsensitive);
+                return mIndex.contains(index.data().toString());
             default: /*DoesNotContain:*/
-                return !index.data().toString().contains(mText, Qt::CaseInsensitive);
+                return !mIndex.contains(index.data().toString());
         }
     }
 
     void setText(const QString& text)
     {
-        mText = text;
+        mIndex.setText(text);
         model()->applyFilters();
     }
 
@@ -104,7 +109,8 @@ public:
     }
 
 private:
-    QString mText;
+    // Mutable because names are added to the index as they are looked up
+    mutable NameSearchIndex mIndex;
     Mode mMode;
 };
 
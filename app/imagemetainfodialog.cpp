@@ -95,6 +95,18 @@ protected:
         }
     }
 
+    void dataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight, const QVector<int>& roles) override
+    {
+        QTreeView::dataChanged(topLeft, bottomRight, roles);
+        // Groups can become fetchable when the meta info arrives after the
+        // model has been set
+        if (!topLeft.parent().isValid()) {
+            for (int row = topLeft.row(); row <= bottomRight.row(); ++row) {
+                setUpRootIndex(row);
+            }
+        }
+    }
+
     void reset() override
     {
         QTreeView::reset();
@@ -108,7 +120,13 @@ protected:
 private:
     void setUpRootIndex(int row)
     {
-        expand(model()->index(row, 0));
+        const QModelIndex index = model()->index(row, 0);
+        // Groups are filled on demand, make sure they are before expanding
+        // them
+        if (model()->canFetchMore(index)) {
+            model()->fetchMore(index);
+        }
+        expand(index);
         setFirstColumnSpanned(row, QModelIndex(), true);
     }
 };
@@ -32,12 +32,16 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 #include <KMessageBox>
 #include <KActionCollection>
 #include <KActionCategory>
+#include <KIO/JobTracker>
+#include <KJobTrackerInterface>
+#include <KJobWidgets>
 
 // Local
 #include "viewmainpage.h"
 #include "gvcore.h"
 #include "mainwindow.h"
 #include "sidebar.h"
+#include <lib/batchtransformjob.h>
 #include <lib/contextmanager.h>
 #include <lib/crop/croptool.h>
 #include <lib/document/documentfactory.h>
@@ -142,6 +146,82 @@ struct ImageOpsContextManagerItem::Private
         );
         return false;
     }
+
+    /**
+     * Returns true if several local JPEG files are selected in browse mode.
+     * Those can be transformed losslessly and directly on disk, without
+     * loading them as documents.
+     */
+    bool canBatchTransform() const
+    {
+        if (mMainWindow->viewMainPage()->isVisible()) {
+            return false;
+        }
+        const KFileItemList list = q->contextManager()->selectedFileItemList();
+        if (list.count() < 2) {
+            return false;
+        }
+        Q_FOREACH(const KFileItem& item, list) {
+            if (!item.isLocalFile() || item.mimetype() != QLatin1String("image/jpeg")) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void applyTransformation(Orientation orientation)
+    {
+        if (canBatchTransform()) {
+            startBatchTransform(orientation);
+        } else {
+            q->applyImageOperation(new TransformImageOperation(orientation));
+        }
+    }
+
+    void startBatchTransform(Orientation orientation)
+    {
+        QList<QUrl> urls;
+        Q_FOREACH(const KFileItem& item, q->contextManager()->selectedFileItemList()) {
+            const QUrl url = item.url();
+            Document::Ptr doc = DocumentFactory::instance()->getCachedDocument(url);
+            if (doc && doc->isModified()) {
+                // Do not overwrite pending changes: transform the document
+                // itself, the user will save it with the rest of the changes
+                TransformImageOperation* op = new TransformImageOperation(orientation);
+                op->applyToDocument(doc);
+            } else {
+                urls << url;
+            }
+        }
+        if (urls.isEmpty()) {
+            return;
+        }
+
+        BatchTransformJob* job = new BatchTransformJob(urls, orientation);
+        KJobWidgets::setWindow(job, mMainWindow);
+        KIO::getJobTracker()->registerJob(job);
+        QObject::connect(job, &BatchTransformJob::urlTransformed, q, [](const QUrl& url) {
+            // Make sure we do not keep showing the old version
+            Document::Ptr doc = DocumentFactory::instance()->getCachedDocument(url);
+            if (doc) {
+                doc->reload();
+            }
+        });
+        QObject::connect(job, &KJob::result, q, [this](KJob* job) {
+            const QStringList errorList = static_cast<BatchTransformJob*>(job)->errorList();
+            if (errorList.isEmpty()) {
+                return;
+            }
+            QString msg = i18ncp("@info", "One image could not be transformed:", "%1 images could not be transformed:", errorList.count());
+            msg += "<ul>";
+            Q_FOREACH(const QString & item, errorList) {
+                msg += "<li>" + item + "</li>";
+            }
+            msg += "</ul>";
+            KMessageBox::sorry(mMainWindow, msg);
+        });
+        job->start();
+    }
 };
 
 ImageOpsContextManagerItem::ImageOpsContextManagerItem(ContextManager* manager, MainWindow* mainWindow)
@@ -194,11 +274,14 @@ void ImageOpsContextManagerItem::updateActions()
             canModify = false;
         }
     }
-
-    d->mRotateLeftAction->setEnabled(canModify);
-    d->mRotateRightAction->setEnabled(canModify);
-    d->mMirrorAction->setEnabled(canModify);
-    d->mFlipAction->setEnabled(canModify);
+    // Lossless transformations are an exception: they can be applied to
+    // several JPEG files at once
+    const bool canTransform = canModify || d->canBatchTransform();
+
+    d->mRotateLeftAction->setEnabled(canTransform);
+    d->mRotateRightAction->setEnabled(canTransform);
+    d->mMirrorAction->setEnabled(canTransform);
+    d->mFlipAction->setEnabled(canTransform);
     d->mResizeAction->setEnabled(canModify);
     d->mCropAction->setEnabled(canModify && viewMainPageIsVisible);
     d->mRedEyeReductionAction->setEnabled(canModify && viewMainPageIsVisible);
@@ -208,26 +291,22 @@ void ImageOpsContextManagerItem::updateActions()
 
 void ImageOpsContextManagerItem::rotateLeft()
 {
-    TransformImageOperation* op = new TransformImageOperation(ROT_270);
-    applyImageOperation(op);
+    d->applyTransformation(ROT_270);
 }
 
 void ImageOpsContextManagerItem::rotateRight()
 {
-    TransformImageOperation* op = new TransformImageOperation(ROT_90);
-    applyImageOperation(op);
+    d->applyTransformation(ROT_90);
 }
 
 void ImageOpsContextManagerItem::mirror()
 {
-    TransformImageOperation* op = new TransformImageOperation(HFLIP);
-    applyImageOperation(op);
+    d->applyTransformation(HFLIP);
 }
 
 void ImageOpsContextManagerItem::flip()
 {
-    TransformImageOperation* op = new TransformImageOperation(VFLIP);
-    applyImageOperation(op);
+    d->applyTransformation(VFLIP);
 }
 
 void ImageOpsContextManagerItem::resizeImage()
@@ -38,6 +38,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <lib/eventwatcher.h>
 #include <lib/gvdebug.h>
 #include <lib/gwenviewconfig.h>
+#include <lib/metainfoprobe.h>
 #include <lib/preferredimagemetainfomodel.h>
 #include <lib/document/document.h>
 #include <lib/document/documentfactory.h>
@@ -199,7 +200,10 @@ struct InfoContextManagerItemPrivate
     // One selection fields
     QScrollArea* mOneFileWidget;
     KeyValueWidget* mKeyValueWidget;
+    // Only one of these is set: the probe is used for local files which are
+    // not already loaded, to avoid loading the whole document
     Document::Ptr mDocument;
+    MetaInfoProbe::Ptr mProbe;
 
     // Multiple selection fields
     QLabel* mMultipleFilesLabel;
@@ -211,8 +215,18 @@ struct InfoContextManagerItemPrivate
         if (!mImageMetaInfoDialog) {
             return;
         }
-        ImageMetaInfoModel* model = mDocument ? mDocument->metaInfo() : nullptr;
-        mImageMetaInfoDialog->setMetaInfo(model, GwenviewConfig::preferredMetaInfoKeyList());
+        mImageMetaInfoDialog->setMetaInfo(currentMetaInfo(), GwenviewConfig::preferredMetaInfoKeyList());
+    }
+
+    ImageMetaInfoModel* currentMetaInfo() const
+    {
+        if (mDocument) {
+            return mDocument->metaInfo();
+        }
+        if (mProbe) {
+            return mProbe->metaInfo();
+        }
+        return nullptr;
     }
 
     void setupGroup()
@@ -255,6 +269,10 @@ struct InfoContextManagerItemPrivate
             // "Garbage collect" document
             mDocument = nullptr;
         }
+        if (mProbe) {
+            QObject::disconnect(mProbe.data(), nullptr, q, nullptr);
+            mProbe.clear();
+        }
     }
 };
 
@@ -308,9 +326,22 @@ void InfoContextManagerItem::fillOneFileGroup(const KFileItem& item)
     d->mMultipleFilesLabel->hide();
 
     d->forgetCurrentDocument();
-    d->mDocument = DocumentFactory::instance()->load(item.url());
-    connect(d->mDocument.data(), &Document::metaInfoUpdated,
-            this, &InfoContextManagerItem::updateOneFileInfo);
+    const QUrl url = item.url();
+    if (!DocumentFactory::instance()->hasUrl(url)) {
+        d->mProbe = MetaInfoProbe::probe(item);
+    }
+    if (d->mProbe) {
+        if (!d->mProbe->isFinished()) {
+            connect(d->mProbe.data(), &MetaInfoProbe::finished,
+                    this, &InfoContextManagerItem::updateOneFileInfo);
+        }
+    } else {
+        // Remote file, or a document which has already been loaded and may
+        // have been modified
+        d->mDocument = DocumentFactory::instance()->load(url);
+        connect(d->mDocument.data(), &Document::metaInfoUpdated,
+                this, &InfoContextManagerItem::updateOneFileInfo);
+    }
 
     d->updateMetaInfoDialog();
     updateOneFileInfo();
@@ -343,11 +374,11 @@ void InfoContextManagerItem::fillMultipleItemsGroup(const KFileItemList& itemLis
 
 void InfoContextManagerItem::updateOneFileInfo()
 {
-    if (!d->mDocument) {
+    ImageMetaInfoModel* metaInfoModel = d->currentMetaInfo();
+    if (!metaInfoModel) {
         return;
     }
 
-    ImageMetaInfoModel* metaInfoModel = d->mDocument->metaInfo();
     d->mKeyValueWidget->clear();
     Q_FOREACH(const QString & key, GwenviewConfig::preferredMetaInfoKeyList()) {
         QString label;
@@ -369,7 +400,7 @@ void InfoContextManagerItem::showMetaInfoDialog()
         connect(d->mImageMetaInfoDialog.data(), &ImageMetaInfoDialog::preferredMetaInfoKeyListChanged,
                 this, &InfoContextManagerItem::slotPreferredMetaInfoKeyListChanged);
     }
-    d->mImageMetaInfoDialog->setMetaInfo(d->mDocument ? d->mDocument->metaInfo() : nullptr, GwenviewConfig::preferredMetaInfoKeyList());
+    d->mImageMetaInfoDialog->setMetaInfo(d->currentMetaInfo(), GwenviewConfig::preferredMetaInfoKeyList());
     d->mImageMetaInfoDialog->show();
 }
 
@@ -27,6 +27,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <QApplication>
 #include <QStringList>
 #include <QCommandLineParser>
+#include <QTimer>
 
 // KDE
 #include <KAboutData>
@@ -37,6 +38,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 // Local
 #include <lib/about.h>
 #include <lib/gwenviewconfig.h>
+#include <lib/startuptimer.h>
 #include "mainwindow.h"
 
 #ifdef HAVE_FITS
@@ -98,6 +100,7 @@ public:
         }
 
         mMainWindow->show();
+        Gwenview::StartupTimer::mark("MainWindow shown");
         if (mFullScreen) {
             mMainWindow->actionCollection()->action("fullscreen")->trigger();
         } else {
@@ -119,6 +122,7 @@ private:
 
 int main(int argc, char *argv[])
 {
+    Gwenview::StartupTimer::start();
     QApplication app(argc, argv);
     KLocalizedString::setApplicationDomain("gwenview");
     QScopedPointer<KAboutData> aboutData(
@@ -142,6 +146,7 @@ int main(int argc, char *argv[])
     parser.addPositionalArgument("url", i18n("A starting file or folders"));
     parser.process(app);
     aboutData.data()->processCommandLine(&parser);
+    Gwenview::StartupTimer::mark("Command line parsed");
 
     // startHelper must live for the whole life of the application
     StartHelper startHelper(parser.positionalArguments(),
@@ -151,6 +156,9 @@ int main(int argc, char *argv[])
                             parser.isSet(QStringLiteral("s")));
     if (app.isSessionRestored()) {
         kRestoreMainWindows<Gwenview::MainWindow>();
+        QTimer::singleShot(0, []() {
+            Gwenview::StartupTimer::finish("Session restored");
+        });
     } else {
         startHelper.createMainWindow();
     }
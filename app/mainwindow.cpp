@@ -98,9 +98,11 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <lib/slideshow.h>
 #include <lib/signalblocker.h>
 #include <lib/semanticinfo/sorteddirmodel.h>
+#include <lib/startuptimer.h>
 #include <lib/thumbnailprovider/thumbnailprovider.h>
 #include <lib/thumbnailview/thumbnailbarview.h>
 #include <lib/thumbnailview/thumbnailview.h>
+#include <lib/trace.h>
 #include <lib/urlutils.h>
 
 namespace Gwenview
@@ -224,6 +226,7 @@ struct MainWindow::Private
 
     void setupWidgets()
     {
+        GV_TRACE_SPAN("MainWindow::setupWidgets");
         mFullScreenContent = new FullScreenContent(q, mGvCore);
         connect(mContextManager, &ContextManager::currentUrlChanged, mFullScreenContent, &FullScreenContent::setCurrentUrl);
 
@@ -252,10 +255,10 @@ struct MainWindow::Private
 
         setupThumbnailView(mViewStackedWidget);
         setupViewMainPage(mViewStackedWidget);
-        setupStartMainPage(mViewStackedWidget);
+        // The start page is created on demand by startMainPage()
+        mStartMainPage = nullptr;
         mViewStackedWidget->addWidget(mBrowseMainPage);
         mViewStackedWidget->addWidget(mViewMainPage);
-        mViewStackedWidget->addWidget(mStartMainPage);
         mViewStackedWidget->setCurrentWidget(mBrowseMainPage);
 
         mCentralSplitter->setStretchFactor(0, 0);
@@ -346,9 +349,13 @@ struct MainWindow::Private
         bar->setThumbnailViewHelper(mThumbnailViewHelper);
     }
 
-    void setupStartMainPage(QWidget* parent)
+    StartMainPage* startMainPage()
     {
-        mStartMainPage = new StartMainPage(parent, mGvCore);
+        if (mStartMainPage) {
+            return mStartMainPage;
+        }
+        GV_TRACE_SPAN("MainWindow::startMainPage");
+        mStartMainPage = new StartMainPage(mViewStackedWidget, mGvCore);
         connect(mStartMainPage, &StartMainPage::urlSelected,
                 q, &MainWindow::slotStartMainPageUrlSelected);
         connect(mStartMainPage, &StartMainPage::recentFileRemoved, [this](const QUrl& url) {
@@ -357,6 +364,17 @@ struct MainWindow::Private
         connect(mStartMainPage, &StartMainPage::recentFilesCleared, [this]() {
             mFileOpenRecentAction->clear();
         });
+        mViewStackedWidget->addWidget(mStartMainPage);
+        mStartMainPage->loadConfig();
+        return mStartMainPage;
+    }
+
+    ThumbnailProvider* thumbnailProvider()
+    {
+        if (!mThumbnailProvider) {
+            mThumbnailProvider = new ThumbnailProvider();
+        }
+        return mThumbnailProvider;
     }
 
     void installDisabledActionShortcutMonitor(QAction* action, const char* slot)
@@ -367,6 +385,7 @@ struct MainWindow::Private
 
     void setupActions()
     {
+        GV_TRACE_SPAN("MainWindow::setupActions");
         KActionCollection* actionCollection = q->actionCollection();
         KActionCategory* file = new KActionCategory(i18nc("@title actions category", "File"), actionCollection);
         KActionCategory* view = new KActionCategory(i18nc("@title actions category - means actions changing smth in interface", "View"), actionCollection);
@@ -535,6 +554,7 @@ struct MainWindow::Private
 
     void setupContextManagerItems()
     {
+        GV_TRACE_SPAN("MainWindow::setupContextManagerItems");
         Q_ASSERT(mContextManager);
         KActionCollection* actionCollection = q->actionCollection();
 
@@ -808,7 +828,7 @@ struct MainWindow::Private
         if (mActiveThumbnailView) {
             mActiveThumbnailView->setThumbnailProvider(nullptr);
         }
-        thumbnailView->setThumbnailProvider(mThumbnailProvider);
+        thumbnailView->setThumbnailProvider(thumbnailProvider());
         mActiveThumbnailView = thumbnailView;
         if (mActiveThumbnailView->isVisible()) {
             mThumbnailProvider->stop();
@@ -826,16 +846,30 @@ struct MainWindow::Private
             }
         } else if (mCurrentMainPageId == BrowseMainPageId) {
             assignThumbnailProviderToThumbnailView(mThumbnailView);
-        } else if (mCurrentMainPageId == StartMainPageId) {
+        } else if (mCurrentMainPageId == StartMainPageId && mStartMainPage) {
             assignThumbnailProviderToThumbnailView(mStartMainPage->recentFoldersView());
         }
     }
+
+    /**
+     * Initializes parts which are not needed to show the first document
+     */
+    void deferredInit()
+    {
+        GV_TRACE_SPAN("MainWindow::deferredInit");
+#ifdef KIPI_FOUND
+        mKIPIInterface = new KIPIInterface(q);
+        mKIPIExportAction->setKIPIInterface(mKIPIInterface);
+#endif
+        StartupTimer::mark("MainWindow deferred init done");
+    }
 };
 
 MainWindow::MainWindow()
 : KXmlGuiWindow(),
       d(new MainWindow::Private)
 {
+    GV_TRACE_SPAN("MainWindow::MainWindow");
     d->q = this;
     d->mCurrentMainPageId = StartMainPageId;
     d->mDirModel = new SortedDirModel(this);
@@ -844,7 +878,8 @@ MainWindow::MainWindow()
     d->mGvCore = new GvCore(this, d->mDirModel);
     d->mPreloader = new Preloader(this);
     d->mNotificationRestrictions = nullptr;
-    d->mThumbnailProvider = new ThumbnailProvider();
+    // Created on demand by thumbnailProvider()
+    d->mThumbnailProvider = nullptr;
     d->mActiveThumbnailView = nullptr;
     d->initDirModel();
     d->setupWidgets();
@@ -857,7 +892,10 @@ MainWindow::MainWindow()
     updatePreviousNextActions();
     d->mSaveBar->initActionDependentWidgets();
 
-    createGUI();
+    {
+        GV_TRACE_SPAN("MainWindow::createGUI");
+        createGUI();
+    }
     loadConfig();
 
     connect(DocumentFactory::instance(), &DocumentFactory::modifiedDocumentListChanged,
@@ -877,8 +915,8 @@ MainWindow::MainWindow()
 #endif
 
 #ifdef KIPI_FOUND
-    d->mKIPIInterface = new KIPIInterface(this);
-    d->mKIPIExportAction->setKIPIInterface(d->mKIPIInterface);
+    // Created by deferredInit()
+    d->mKIPIInterface = nullptr;
 #else
     auto* pluginsMenu = static_cast<QMenu*>(guiFactory()->container("plugins", this));
     if (pluginsMenu) {
@@ -889,6 +927,11 @@ MainWindow::MainWindow()
 #ifdef Q_OS_OSX
     qApp->installEventFilter(this);
 #endif
+
+    QTimer::singleShot(0, this, [this]() {
+        d->deferredInit();
+    });
+    StartupTimer::mark("MainWindow created");
 }
 
 MainWindow::~MainWindow()
@@ -946,6 +989,11 @@ void MainWindow::setInitialUrl(const QUrl &_url)
     if (UrlUtils::urlIsDirectory(url)) {
         d->mBrowseAction->trigger();
         openDirUrl(url);
+        // There is no document to show, consider startup done once the
+        // browse page has had a chance to be painted
+        QTimer::singleShot(0, []() {
+            StartupTimer::finish("Browse page shown");
+        });
     } else {
         openUrl(url);
     }
@@ -1071,7 +1119,10 @@ void MainWindow::showStartMainPage()
 
     d->saveSplitterConfig();
     d->mSideBar->hide();
-    d->mViewStackedWidget->setCurrentWidget(d->mStartMainPage);
+    d->mViewStackedWidget->setCurrentWidget(d->startMainPage());
+    QTimer::singleShot(0, []() {
+        StartupTimer::finish("Start page shown");
+    });
 
     d->updateActions();
     updatePreviousNextActions();
@@ -1120,7 +1171,9 @@ void MainWindow::openDirUrl(const QUrl &url)
         urlToSelect.setPath(pathToSelect);
         d->mContextManager->setUrlToSelect(urlToSelect);
     }
-    d->mThumbnailProvider->stop();
+    if (d->mThumbnailProvider) {
+        d->mThumbnailProvider->stop();
+    }
     d->mContextManager->setCurrentDirUrl(url);
     d->mGvCore->addUrlToRecentFolders(url);
     d->mViewMainPage->reset();
@@ -1547,6 +1600,7 @@ void MainWindow::toggleMenuBar()
 
 void MainWindow::loadConfig()
 {
+    GV_TRACE_SPAN("MainWindow::loadConfig");
     d->mDirModel->setBlackListedExtensions(GwenviewConfig::blackListedExtensions());
     d->mDirModel->adjustKindFilter(MimeTypeUtils::KIND_VIDEO, GwenviewConfig::listVideos());
 
@@ -1560,7 +1614,9 @@ void MainWindow::loadConfig()
     }
     d->mFileOpenRecentAction->setVisible(GwenviewConfig::historyEnabled());
 
-    d->mStartMainPage->loadConfig();
+    if (d->mStartMainPage) {
+        d->mStartMainPage->loadConfig();
+    }
     d->mViewMainPage->loadConfig();
     d->mBrowseMainPage->loadConfig();
     d->mContextManager->loadConfig();
@@ -1596,6 +1652,10 @@ void MainWindow::preloadNextUrl()
         qDebug() << "Preloading disabled";
         return;
     }
+    if (d->mSlideShow->isRunning()) {
+        // The slideshow renders its upcoming slides itself
+        return;
+    }
     QItemSelection selection = d->mContextManager->selectionModel()->selection();
     if (selection.size() != 1) {
         return;
@@ -22,10 +22,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #include "saveallhelper.h"
 
 // Qt
-#include <QFuture>
-#include <QFutureWatcher>
-#include <QSet>
+#include <QHash>
 #include <QStringList>
+#include <QThread>
 #include <QUrl>
 #include <QProgressDialog>
 
@@ -37,6 +36,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #include <lib/document/document.h>
 #include <lib/document/documentfactory.h>
 #include <lib/document/documentjob.h>
+#include <lib/gwenviewconfig.h>
 
 namespace Gwenview
 {
@@ -45,8 +45,34 @@ struct SaveAllHelperPrivate
 {
     QWidget* mParent;
     QProgressDialog* mProgressDialog;
-    QSet<DocumentJob*> mJobSet;
+    QList<QUrl> mPendingUrlList;
+    // Running jobs, associated with the amount of memory they are estimated
+    // to use
+    QHash<DocumentJob*, qint64> mJobHash;
+    qint64 mMemoryUsage;
+    int mMaxJobCount;
+    qint64 mMaxMemoryUsage;
+    int mDoneCount;
+    bool mCanceled;
     QStringList mErrorList;
+
+    void addError(const QUrl& url, const QString& errorString)
+    {
+        QString name = url.fileName().isEmpty() ? url.toDisplayString() : url.fileName();
+        mErrorList << xi18nc("@info %1 is the name of the document which failed to save, %2 is the reason for the failure",
+                             "<filename>%1</filename>: %2", name, kxi18n(qPrintable(errorString)));
+    }
+
+    static qint64 estimatedMemoryUsage(const Document::Ptr& doc)
+    {
+        // Encoders usually need a converted copy of the image
+        return qint64(doc->image().byteCount()) * 2;
+    }
+
+    bool isDone() const
+    {
+        return mJobHash.isEmpty() && (mPendingUrlList.isEmpty() || mCanceled);
+    }
 };
 
 SaveAllHelper::SaveAllHelper(QWidget* parent)
@@ -58,6 +84,14 @@ SaveAllHelper::SaveAllHelper(QWidget* parent)
     d->mProgressDialog->setLabelText(i18nc("@info:progress saving all image changes", "Saving..."));
     d->mProgressDialog->setCancelButtonText(i18n("&Stop"));
     d->mProgressDialog->setMinimum(0);
+    d->mMemoryUsage = 0;
+    d->mMaxJobCount = GwenviewConfig::saveAllMaxJobCount();
+    if (d->mMaxJobCount <= 0) {
+        d->mMaxJobCount = qMax(1, QThread::idealThreadCount());
+    }
+    d->mMaxMemoryUsage = qint64(qMax(1, GwenviewConfig::saveAllMaxMemoryUsage())) * 1024 * 1024;
+    d->mDoneCount = 0;
+    d->mCanceled = false;
 }
 
 SaveAllHelper::~SaveAllHelper()
@@ -67,17 +101,14 @@ SaveAllHelper::~SaveAllHelper()
 
 void SaveAllHelper::save()
 {
-    QList<QUrl> list = DocumentFactory::instance()->modifiedDocumentList();
-    d->mProgressDialog->setRange(0, list.size());
+    d->mPendingUrlList = DocumentFactory::instance()->modifiedDocumentList();
+    d->mProgressDialog->setRange(0, d->mPendingUrlList.size());
     d->mProgressDialog->setValue(0);
-    Q_FOREACH(const QUrl &url, list) {
-        Document::Ptr doc = DocumentFactory::instance()->load(url);
-        DocumentJob* job = doc->save(url, doc->format());
-        connect(job, &DocumentJob::result, this, &SaveAllHelper::slotResult);
-        d->mJobSet << job;
-    }
+    startJobs();
 
-    d->mProgressDialog->exec();
+    if (!d->isDone()) {
+        d->mProgressDialog->exec();
+    }
 
     // Done, show message if necessary
     if (d->mErrorList.count() > 0) {
@@ -91,24 +122,52 @@ void SaveAllHelper::save()
     }
 }
 
+void SaveAllHelper::startJobs()
+{
+    while (!d->mCanceled && !d->mPendingUrlList.isEmpty() && d->mJobHash.count() < d->mMaxJobCount) {
+        const QUrl url = d->mPendingUrlList.first();
+        Document::Ptr doc = DocumentFactory::instance()->load(url);
+        const qint64 memoryUsage = SaveAllHelperPrivate::estimatedMemoryUsage(doc);
+        if (!d->mJobHash.isEmpty() && d->mMemoryUsage + memoryUsage > d->mMaxMemoryUsage) {
+            // Wait for a running job to finish
+            break;
+        }
+        d->mPendingUrlList.removeFirst();
+
+        DocumentJob* job = doc->save(url, doc->format());
+        if (!job) {
+            d->addError(url, doc->errorString());
+            ++d->mDoneCount;
+            d->mProgressDialog->setValue(d->mDoneCount);
+            continue;
+        }
+        connect(job, &DocumentJob::result, this, &SaveAllHelper::slotResult);
+        d->mJobHash.insert(job, memoryUsage);
+        d->mMemoryUsage += memoryUsage;
+    }
+}
+
 void SaveAllHelper::slotCanceled()
 {
-    Q_FOREACH(DocumentJob * job, d->mJobSet) {
+    d->mCanceled = true;
+    d->mPendingUrlList.clear();
+    Q_FOREACH(DocumentJob * job, d->mJobHash.keys()) {
         job->kill();
     }
+    d->mJobHash.clear();
+    d->mMemoryUsage = 0;
 }
 
 void SaveAllHelper::slotResult(KJob* _job)
 {
     DocumentJob* job = static_cast<DocumentJob*>(_job);
     if (job->error()) {
-        QUrl url = job->document()->url();
-        QString name = url.fileName().isEmpty() ? url.toDisplayString() : url.fileName();
-        d->mErrorList << xi18nc("@info %1 is the name of the document which failed to save, %2 is the reason for the failure",
-                                "<filename>%1</filename>: %2", name, kxi18n(qPrintable(job->errorString())));
+        d->addError(job->document()->url(), job->errorString());
     }
-    d->mJobSet.remove(job);
-    d->mProgressDialog->setValue(d->mProgressDialog->value() + 1);
+    d->mMemoryUsage -= d->mJobHash.take(job);
+    ++d->mDoneCount;
+    d->mProgressDialog->setValue(d->mDoneCount);
+    startJobs();
 }
 
 } // namespace
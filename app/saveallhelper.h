@@ -49,6 +49,12 @@ private Q_SLOTS:
 
 private:
     SaveAllHelperPrivate* const d;
+
+    /**
+     * Starts saving pending documents, as long as the number of running jobs
+     * and the memory they use stay below the configured limits
+     */
+    void startJobs();
 };
 
 } // namespace
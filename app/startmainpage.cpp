@@ -45,6 +45,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #include <lib/flowlayout.h>
 #include <lib/gvdebug.h>
 #include <lib/gwenviewconfig.h>
+#include <lib/historymodel.h>
 #include <lib/thumbnailview/abstractthumbnailviewhelper.h>
 #include <lib/thumbnailview/previewitemdelegate.h>
 #include <lib/thumbnailprovider/thumbnailprovider.h>
@@ -247,7 +248,12 @@ void StartMainPage::showEvent(QShowEvent* event)
 {
     if (GwenviewConfig::historyEnabled()) {
         if (!d->mRecentFoldersView->model()) {
-            d->mRecentFoldersView->setModel(d->mGvCore->recentFoldersModel());
+            QAbstractItemModel* model = d->mGvCore->recentFoldersModel();
+            HistoryModel* historyModel = qobject_cast<HistoryModel*>(model);
+            if (historyModel) {
+                historyModel->removeMissingUrls();
+            }
+            d->mRecentFoldersView->setModel(model);
             d->setupHistoryView(d->mRecentFoldersView);
         }
         if (!d->mRecentFilesView->model()) {
@@ -233,9 +233,17 @@ struct ViewMainPagePrivate
         mSynchronizer = new DocumentViewSynchronizer(&mDocumentViews, q);
     }
 
-    DocumentView* createDocumentView()
+    /**
+     * Creates a view for @p url, or reuses a recently deleted one if it is
+     * still available. In the latter case @p recycled is set to true.
+     */
+    DocumentView* createDocumentView(const QUrl& url, bool* recycled)
     {
-        DocumentView* view = mDocumentViewContainer->createView();
+        DocumentView* view = mDocumentViewContainer->takeRecycledView(url);
+        *recycled = view;
+        if (!view) {
+            view = mDocumentViewContainer->createView();
+        }
 
         // Connect context menu
         // If you need to connect another view signal, make sure it is disconnected in deleteDocumentView
@@ -262,6 +270,36 @@ struct ViewMainPagePrivate
         return view;
     }
 
+    /**
+     * Tells the slideshow the size slides are shown at, so that it can
+     * render them in advance
+     */
+    void updateSlideShowViewSize()
+    {
+        DocumentView* view = currentView();
+        if (view && !mCompareMode && mSlideShow->isRunning()) {
+            mSlideShow->setViewSize(view->boundingRect().size());
+        }
+    }
+
+    /**
+     * Applies @p setup to a view which already shows its document
+     */
+    void applySetup(DocumentView* view, const DocumentView::Setup& setup)
+    {
+        if (!setup.valid || !view->canZoom()) {
+            return;
+        }
+        if (setup.zoomToFit) {
+            view->setZoomToFit(true);
+        } else if (setup.zoomToFill) {
+            view->setZoomToFill(true);
+        } else {
+            view->setZoom(setup.zoom);
+            view->setPosition(setup.position.toPoint());
+        }
+    }
+
     void deleteDocumentView(DocumentView* view)
     {
         if (mDocumentViewController->view() == view) {
@@ -439,6 +477,12 @@ ViewMainPage::ViewMainPage(QWidget* parent, SlideShow* slideShow, KActionCollect
 
     d->setupDocumentViewController();
 
+    connect(slideShow, &SlideShow::stateChanged, this, [this](bool running) {
+        if (running) {
+            d->updateSlideShowViewSize();
+        }
+    });
+
     KActionCategory* view = new KActionCategory(i18nc("@title actions category - means actions changing smth in interface", "View"), actionCollection);
 
     d->mToggleThumbnailBarAction = view->add<KToggleAction>(QStringLiteral("toggle_thumbnailbar"));
@@ -660,6 +704,7 @@ void ViewMainPage::openUrls(const QList<QUrl>& allUrls, const QUrl &currentUrl)
 
     typedef QMap<QUrl, DocumentView*> ViewForUrlMap;
     ViewForUrlMap viewForUrlMap;
+    QSet<DocumentView*> recycledViews;
 
     if (!d->mDocumentViews.isEmpty()) {
         d->mDocumentViewContainer->updateSetup(d->mDocumentViews.last());
@@ -690,7 +735,11 @@ void ViewMainPage::openUrls(const QList<QUrl>& allUrls, const QUrl &currentUrl)
             qWarning() << "Too many documents to show";
             break;
         }
-        DocumentView* view = d->createDocumentView();
+        bool recycled;
+        DocumentView* view = d->createDocumentView(url, &recycled);
+        if (recycled) {
+            recycledViews << view;
+        }
         viewForUrlMap.insert(url, view);
     }
 
@@ -712,8 +761,19 @@ void ViewMainPage::openUrls(const QList<QUrl>& allUrls, const QUrl &currentUrl)
     for (; it != end; ++it) {
         QUrl url = it.key();
         DocumentView* view = it.value();
-        DocumentView::Setup savedSetup = d->mDocumentViewContainer->savedSetup(url);
-        view->openUrl(url, d->mZoomMode == ZoomMode::Individual && savedSetup.valid ? savedSetup : setup);
+        if (recycledViews.contains(view)) {
+            // The view still shows url with its own setup, which is what
+            // ZoomMode::Individual wants
+            if (d->mZoomMode != ZoomMode::Individual) {
+                d->applySetup(view, setup);
+            }
+        } else {
+            if (d->mSlideShow->isRunning()) {
+                view->setPreRenderedImage(d->mSlideShow->takePreRenderedFrame(url));
+            }
+            DocumentView::Setup savedSetup = d->mDocumentViewContainer->savedSetup(url);
+            view->openUrl(url, d->mZoomMode == ZoomMode::Individual && savedSetup.valid ? savedSetup : setup);
+        }
 #ifdef KF5Activities_FOUND
         d->mActivityResources.value(view)->setUri(url);
 #endif
@@ -738,6 +798,7 @@ void ViewMainPage::openUrls(const QList<QUrl>& allUrls, const QUrl &currentUrl)
 
     d->updateDocumentCountLabel();
     d->mDocumentCountLabel->setVisible(!d->mCompareMode);
+    d->updateSlideShowViewSize();
 }
 
 void ViewMainPage::reload()
@@ -249,6 +249,7 @@ void ImportDialog::startImport()
         ImporterConfig::autoRename()
         ? ImporterConfig::autoRenameFormat()
         : QString());
+    d->mImporter->setParallelCopyCount(ImporterConfig::parallelCopyCount());
     d->mImporter->start(d->mThumbnailPage->urlList(), url);
 }
 
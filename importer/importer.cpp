@@ -22,9 +22,19 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #include "importer.h"
 
 // Qt
+#include <QAtomicInt>
+#include <QCryptographicHash>
 #include <QDateTime>
 #include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QFutureWatcher>
+#include <QSharedPointer>
+#include <QThreadPool>
+#include <QTimer>
 #include <QUrl>
+#include <QVector>
+#include <QtConcurrentRun>
 
 // KDE
 #include <KFileItem>
@@ -38,34 +48,166 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 // stdc++
 #include <memory>
 
+// libc
+#include <utime.h>
+
 // Local
 #include <fileutils.h>
 #include <filenameformater.h>
+#include <importhashindex.h>
 #include <lib/timeutils.h>
 #include <QDir>
 
 namespace Gwenview
 {
 
+static const int DEFAULT_PARALLEL_COPY_COUNT = 4;
+
+static const qint64 COPY_CHUNK_SIZE = 1024 * 1024;
+
+// How much of the beginning of a file is kept to read its Exif date. This is
+// always enough for JPEG files, whose Exif data must fit in a 64 KB segment
+static const int HEADER_SIZE = 256 * 1024;
+
+static const int PROGRESS_INTERVAL = 200;
+
+struct CopyResult
+{
+    CopyResult()
+    : mOk(false)
+    {}
+
+    bool mOk;
+    QByteArray mHash;
+    QByteArray mHeader;
+    QString mErrorString;
+};
+
+/**
+ * Copies srcPath to dstPath, computing the content hash of the data as it
+ * goes through. Runs in a worker thread.
+ */
+static CopyResult copyAndHash(const QString& srcPath, const QString& dstPath, QSharedPointer<QAtomicInt> percent)
+{
+    CopyResult result;
+    QFile src(srcPath);
+    if (!src.open(QIODevice::ReadOnly)) {
+        result.mErrorString = src.errorString();
+        return result;
+    }
+    QFile dst(dstPath);
+    if (!dst.open(QIODevice::WriteOnly)) {
+        result.mErrorString = dst.errorString();
+        return result;
+    }
+
+    QCryptographicHash hash(ImportHashIndex::hashAlgorithm());
+    const qint64 size = src.size();
+    qint64 copied = 0;
+    for (;;) {
+        const QByteArray buffer = src.read(COPY_CHUNK_SIZE);
+        if (buffer.isEmpty()) {
+            break;
+        }
+        hash.addData(buffer);
+        if (result.mHeader.size() < HEADER_SIZE) {
+            result.mHeader.append(buffer.left(HEADER_SIZE - result.mHeader.size()));
+        }
+        if (dst.write(buffer) != buffer.size()) {
+            result.mErrorString = dst.errorString();
+            return result;
+        }
+        copied += buffer.size();
+        if (size > 0) {
+            percent->store(int(copied * 100 / size));
+        }
+    }
+    if (src.error() != QFileDevice::NoError) {
+        result.mErrorString = src.errorString();
+        return result;
+    }
+    dst.close();
+    if (dst.error() != QFileDevice::NoError) {
+        result.mErrorString = dst.errorString();
+        return result;
+    }
+
+    // Keep the same attributes as KIO::copy() would: the modification time is
+    // used when there is no Exif date
+    const QFileInfo srcInfo(src);
+    dst.setPermissions(src.permissions());
+    struct utimbuf times;
+    times.actime = srcInfo.lastRead().toSecsSinceEpoch();
+    times.modtime = srcInfo.lastModified().toSecsSinceEpoch();
+    ::utime(QFile::encodeName(dstPath).constData(), &times);
+
+    result.mHash = hash.result();
+    result.mOk = true;
+    return result;
+}
+
+/**
+ * Used when the file has been copied by KIO: computes the content hash of the
+ * local copy. Runs in a worker thread.
+ */
+static CopyResult hashCopiedFile(const QString& path)
+{
+    CopyResult result;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        result.mErrorString = file.errorString();
+        return result;
+    }
+    result.mHeader = file.read(HEADER_SIZE);
+    file.seek(0);
+    QCryptographicHash hash(ImportHashIndex::hashAlgorithm());
+    if (!hash.addData(&file)) {
+        result.mErrorString = file.errorString();
+        return result;
+    }
+    result.mHash = hash.result();
+    result.mOk = true;
+    return result;
+}
+
+struct ImportItem
+{
+    ImportItem()
+    : mPercent(new QAtomicInt(0))
+    , mCopied(false)
+    {}
+
+    QUrl mSrcUrl;
+    QUrl mTempUrl;
+    QSharedPointer<QAtomicInt> mPercent;
+    bool mCopied;
+    CopyResult mResult;
+};
+
 struct ImporterPrivate
 {
     Importer* q;
     QWidget* mAuthWindow;
     std::unique_ptr<FileNameFormater> mFileNameFormater;
     QUrl mTempImportDirUrl;
+    int mParallelCopyCount;
+    QThreadPool mThreadPool;
+    QTimer* mProgressTimer;
 
     /* @defgroup reset Should be reset in start()
      * @{ */
-    QList<QUrl> mUrlList;
+    QVector<ImportItem> mItems;
     QList<QUrl> mImportedUrlList;
     QList<QUrl> mSkippedUrlList;
     int mRenamedCount;
     int mProgress;
-    int mJobProgress;
+    int mNextItemToCopy;
+    int mNextItemToRename;
+    int mRunningCopyCount;
+    QHash<KJob*, int> mItemForJob;
+    std::unique_ptr<ImportHashIndex> mHashIndex;
     /* @} */
 
-    QUrl mCurrentUrl;
-
     bool createImportDir(const QUrl& url)
     {
         Q_ASSERT(url.isLocalFile());
@@ -85,58 +227,132 @@ struct ImporterPrivate
         return true;
     }
 
-    void importNext()
+    void startCopies()
     {
-        if (mUrlList.empty()) {
-            q->finalizeImport();
+        while (mRunningCopyCount < mParallelCopyCount && mNextItemToCopy < mItems.count()) {
+            startCopy(mNextItemToCopy);
+            ++mNextItemToCopy;
+        }
+    }
+
+    void startCopy(int index)
+    {
+        ImportItem& item = mItems[index];
+        // Prefix the name with the item index, so that "foo/image.jpg" and
+        // "bar/image.jpg" can be copied at the same time
+        item.mTempUrl = mTempImportDirUrl;
+        item.mTempUrl.setPath(item.mTempUrl.path() + QString::number(index) + '-' + item.mSrcUrl.fileName());
+        ++mRunningCopyCount;
+
+        if (item.mSrcUrl.isLocalFile()) {
+            runWorker(index, QtConcurrent::run(&mThreadPool, copyAndHash,
+                item.mSrcUrl.toLocalFile(), item.mTempUrl.toLocalFile(), item.mPercent));
             return;
         }
-        mCurrentUrl = mUrlList.takeFirst();
-        QUrl dst = mTempImportDirUrl;
-        dst.setPath(dst.path() + mCurrentUrl.fileName());
-        KIO::Job* job = KIO::copy(mCurrentUrl, dst, KIO::HideProgressInfo);
+        KIO::Job* job = KIO::copy(item.mSrcUrl, item.mTempUrl, KIO::HideProgressInfo);
         KJobWidgets::setWindow(job, mAuthWindow);
+        mItemForJob.insert(job, index);
         QObject::connect(job, &KJob::result,
                          q, &Importer::slotCopyDone);
         QObject::connect(job, SIGNAL(percent(KJob*,ulong)),
                          q, SLOT(slotPercent(KJob*,ulong)));
     }
 
-    void renameImportedUrl(const QUrl& src)
+    void runWorker(int index, const QFuture<CopyResult>& future)
     {
-        QUrl dst = src.resolved(QUrl(".."));
+        QFutureWatcher<CopyResult>* watcher = new QFutureWatcher<CopyResult>(q);
+        QObject::connect(watcher, &QFutureWatcherBase::finished, q, [this, watcher, index]() {
+            watcher->deleteLater();
+            copyFinished(index, watcher->result());
+        });
+        watcher->setFuture(future);
+    }
+
+    void copyFinished(int index, const CopyResult& result)
+    {
+        ImportItem& item = mItems[index];
+        item.mResult = result;
+        item.mCopied = true;
+        item.mPercent->store(100);
+        --mRunningCopyCount;
+
+        renameCopiedItems();
+        startCopies();
+    }
+
+    /**
+     * Items are renamed in the order they were given, so that the outcome of
+     * an import does not depend on which copy finishes first
+     */
+    void renameCopiedItems()
+    {
+        while (mNextItemToRename < mItems.count() && mItems.at(mNextItemToRename).mCopied) {
+            renameImportedItem(mItems.at(mNextItemToRename));
+            ++mNextItemToRename;
+            q->advance();
+        }
+        if (mNextItemToRename == mItems.count()) {
+            q->finalizeImport();
+        }
+    }
+
+    void renameImportedItem(const ImportItem& item)
+    {
+        const QString tempPath = item.mTempUrl.toLocalFile();
+        if (!item.mResult.mOk) {
+            qWarning() << "Could not copy" << item.mSrcUrl << ":" << item.mResult.mErrorString;
+            QFile::remove(tempPath);
+            return;
+        }
+        if (!mHashIndex->find(item.mResult.mHash).isEmpty()) {
+            // Already imported, maybe under another name
+            QFile::remove(tempPath);
+            mSkippedUrlList << item.mSrcUrl;
+            return;
+        }
+
         QString fileName;
         if (mFileNameFormater.get()) {
-            KFileItem item(src);
-            item.setDelayedMimeTypes(true);
-            // Get the document time, but do not cache the result because the
-            // 'src' url is temporary: if we import "foo/image.jpg" and
-            // "bar/image.jpg", both images will be temporarily saved in the
-            // 'src' url.
-            QDateTime dateTime = TimeUtils::dateTimeForFileItem(item, TimeUtils::SkipCache);
-            fileName = mFileNameFormater->format(src, dateTime);
+            QDateTime dateTime = TimeUtils::dateTimeFromExifData(item.mResult.mHeader);
+            if (!dateTime.isValid()) {
+                KFileItem fileItem(item.mTempUrl);
+                fileItem.setDelayedMimeTypes(true);
+                // Do not cache the result because the url is temporary
+                dateTime = TimeUtils::dateTimeForFileItem(fileItem, TimeUtils::SkipCache);
+            }
+            fileName = mFileNameFormater->format(item.mSrcUrl, dateTime);
         } else {
-            fileName = src.fileName();
+            fileName = item.mSrcUrl.fileName();
         }
-        dst.setPath(dst.path() + fileName);
 
-        FileUtils::RenameResult result = FileUtils::rename(src, dst, mAuthWindow);
-        switch (result) {
-        case FileUtils::RenamedOK:
-            mImportedUrlList << mCurrentUrl;
-            break;
-        case FileUtils::RenamedUnderNewName:
+        // Find unique name
+        const QFileInfo fileInfo(fileName);
+        const QString prefix = mHashIndex->dirPath() + '/' + fileInfo.completeBaseName() + '_';
+        const QString suffix = '.' + fileInfo.suffix();
+        QString dstPath = mHashIndex->dirPath() + '/' + fileName;
+        bool renamed = false;
+        for (int count = 1; QFileInfo::exists(dstPath); ++count) {
+            // The index did not know about a file with the same content, but
+            // this one may not have been indexed yet
+            if (mHashIndex->hashForFile(dstPath) == item.mResult.mHash) {
+                QFile::remove(tempPath);
+                mSkippedUrlList << item.mSrcUrl;
+                return;
+            }
+            dstPath = prefix + QString::number(count) + suffix;
+            renamed = true;
+        }
+
+        if (!QFile::rename(tempPath, dstPath)) {
+            qWarning() << "Rename failed for" << item.mSrcUrl;
+            QFile::remove(tempPath);
+            return;
+        }
+        mHashIndex->insert(item.mResult.mHash, dstPath);
+        if (renamed) {
             mRenamedCount++;
-            mImportedUrlList << mCurrentUrl;
-            break;
-        case FileUtils::Skipped:
-            mSkippedUrlList << mCurrentUrl;
-            break;
-        case FileUtils::RenameFailed:
-            qWarning() << "Rename failed for" << mCurrentUrl;
         }
-        q->advance();
-        importNext();
+        mImportedUrlList << item.mSrcUrl;
     }
 };
 
@@ -146,10 +362,19 @@ Importer::Importer(QWidget* parent)
 {
     d->q = this;
     d->mAuthWindow = parent;
+    d->mParallelCopyCount = DEFAULT_PARALLEL_COPY_COUNT;
+    d->mProgress = 0;
+    d->mNextItemToCopy = 0;
+    d->mNextItemToRename = 0;
+    d->mProgressTimer = new QTimer(this);
+    d->mProgressTimer->setInterval(PROGRESS_INTERVAL);
+    connect(d->mProgressTimer, &QTimer::timeout, this, &Importer::emitProgressChanged);
 }
 
 Importer::~Importer()
 {
+    // Wait for the running copies, they write to the temporary folder
+    d->mThreadPool.waitForDone();
     delete d;
 }
 
@@ -162,41 +387,65 @@ void Importer::setAutoRenameFormat(const QString& format)
     }
 }
 
+void Importer::setParallelCopyCount(int count)
+{
+    d->mParallelCopyCount = qMax(1, count);
+}
+
 void Importer::start(const QList<QUrl>& list, const QUrl& destination)
 {
-    d->mUrlList = list;
+    d->mItems.clear();
+    d->mItems.reserve(list.count());
+    for (const QUrl& url : list) {
+        ImportItem item;
+        item.mSrcUrl = url;
+        d->mItems << item;
+    }
     d->mImportedUrlList.clear();
     d->mSkippedUrlList.clear();
     d->mRenamedCount = 0;
     d->mProgress = 0;
-    d->mJobProgress = 0;
+    d->mNextItemToCopy = 0;
+    d->mNextItemToRename = 0;
+    d->mRunningCopyCount = 0;
+    d->mItemForJob.clear();
+    d->mThreadPool.setMaxThreadCount(d->mParallelCopyCount);
 
     emitProgressChanged();
-    emit maximumChanged(d->mUrlList.count() * 100);
+    emit maximumChanged(d->mItems.count() * 100);
 
     if (!d->createImportDir(destination)) {
         qWarning() << "Could not create import dir";
         return;
     }
-    d->importNext();
+    d->mHashIndex.reset(new ImportHashIndex(destination.toLocalFile()));
+    d->mHashIndex->load();
+
+    if (d->mItems.isEmpty()) {
+        finalizeImport();
+        return;
+    }
+    d->mProgressTimer->start();
+    d->startCopies();
 }
 
-void Importer::slotCopyDone(KJob* _job)
+void Importer::slotCopyDone(KJob* job)
 {
-    KIO::CopyJob* job = static_cast<KIO::CopyJob*>(_job);
-    QUrl url = job->destUrl();
+    const int index = d->mItemForJob.take(job);
     if (job->error()) {
-        qWarning() << "FIXME: What do we do with failed urls?";
-        advance();
-        d->importNext();
+        CopyResult result;
+        result.mErrorString = job->errorString();
+        d->copyFinished(index, result);
         return;
     }
-
-    d->renameImportedUrl(url);
+    // The data did not go through us, so hash the local copy instead
+    d->runWorker(index, QtConcurrent::run(&d->mThreadPool, hashCopiedFile, d->mItems.at(index).mTempUrl.toLocalFile()));
 }
 
 void Importer::finalizeImport()
 {
+    d->mProgressTimer->stop();
+    d->mHashIndex->save();
     KIO::Job* job = KIO::del(d->mTempImportDirUrl, KIO::HideProgressInfo);
     KJobWidgets::setWindow(job, d->mAuthWindow);
     emit importFinished();
@@ -205,19 +454,28 @@ void Importer::finalizeImport()
 void Importer::advance()
 {
     ++d->mProgress;
-    d->mJobProgress = 0;
     emitProgressChanged();
 }
 
-void Importer::slotPercent(KJob*, unsigned long percent)
+void Importer::slotPercent(KJob* job, unsigned long percent)
 {
-    d->mJobProgress = percent;
+    const auto it = d->mItemForJob.constFind(job);
+    if (it == d->mItemForJob.constEnd()) {
+        return;
+    }
+    d->mItems.at(it.value()).mPercent->store(int(percent));
     emitProgressChanged();
 }
 
 void Importer::emitProgressChanged()
 {
-    emit progressChanged(d->mProgress * 100 + d->mJobProgress);
+    // Items between mNextItemToRename and mNextItemToCopy are being copied, or
+    // are waiting for a previous item to be renamed
+    int jobProgress = 0;
+    for (int index = d->mNextItemToRename; index < d->mNextItemToCopy; ++index) {
+        jobProgress += d->mItems.at(index).mPercent->load();
+    }
+    emit progressChanged(d->mProgress * 100 + jobProgress);
 }
 
 QList<QUrl> Importer::importedUrlList() const
@@ -48,6 +48,11 @@ public:
      */
     void setAutoRenameFormat(const QString&);
 
+    /**
+     * Defines how many documents can be copied at the same time
+     */
+    void setParallelCopyCount(int);
+
     void start(const QList<QUrl>& list, const QUrl& destUrl);
 
     QList<QUrl> importedUrlList() const;
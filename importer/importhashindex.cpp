@@ -0,0 +1,238 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2019 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "importhashindex.h"
+
+// Qt
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMultiHash>
+#include <QSaveFile>
+
+// KDE
+
+// Local
+
+#undef ENABLE_LOG
+#undef LOG
+//#define ENABLE_LOG
+#ifdef ENABLE_LOG
+#define LOG(x) qDebug() << x
+#else
+#define LOG(x) ;
+#endif
+
+namespace Gwenview
+{
+
+static const char INDEX_HEADER[] = "# Gwenview importer hash index 1";
+
+struct IndexEntry
+{
+    IndexEntry()
+    : mSize(0)
+    , mModificationTime(0)
+    {}
+
+    QByteArray mHash;
+    qint64 mSize;
+    qint64 mModificationTime;
+
+    bool matches(const QFileInfo& info) const
+    {
+        return info.exists()
+            && info.size() == mSize
+            && info.lastModified().toMSecsSinceEpoch() == mModificationTime;
+    }
+};
+
+struct ImportHashIndexPrivate
+{
+    QDir mDir;
+    // Keys are paths relative to mDir
+    QHash<QString, IndexEntry> mEntries;
+    QMultiHash<QByteArray, QString> mPathsForHash;
+
+    void remove(const QString& relativePath)
+    {
+        auto it = mEntries.find(relativePath);
+        if (it == mEntries.end()) {
+            return;
+        }
+        mPathsForHash.remove(it.value().mHash, relativePath);
+        mEntries.erase(it);
+    }
+
+    void insert(const QString& relativePath, const IndexEntry& entry)
+    {
+        remove(relativePath);
+        mEntries.insert(relativePath, entry);
+        mPathsForHash.insert(entry.mHash, relativePath);
+    }
+};
+
+ImportHashIndex::ImportHashIndex(const QString& dirPath)
+: d(new ImportHashIndexPrivate)
+{
+    d->mDir = QDir(dirPath);
+}
+
+ImportHashIndex::~ImportHashIndex()
+{
+    delete d;
+}
+
+QString ImportHashIndex::dirPath() const
+{
+    return d->mDir.path();
+}
+
+QString ImportHashIndex::fileName()
+{
+    return QStringLiteral(".gwenview_importer_index");
+}
+
+QCryptographicHash::Algorithm ImportHashIndex::hashAlgorithm()
+{
+    return QCryptographicHash::Sha1;
+}
+
+void ImportHashIndex::load()
+{
+    d->mEntries.clear();
+    d->mPathsForHash.clear();
+
+    QFile file(d->mDir.filePath(fileName()));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    if (file.readLine().trimmed() != INDEX_HEADER) {
+        qWarning() << "Ignoring unknown hash index format in" << file.fileName();
+        return;
+    }
+    // Each line is: <hex hash> <size> <modification time> <relative path>
+    while (!file.atEnd()) {
+        QByteArray line = file.readLine();
+        if (line.endsWith('\n')) {
+            line.chop(1);
+        }
+        const int sizePos = line.indexOf(' ') + 1;
+        const int timePos = sizePos > 0 ? line.indexOf(' ', sizePos) + 1 : 0;
+        const int pathPos = timePos > 0 ? line.indexOf(' ', timePos) + 1 : 0;
+        if (pathPos <= 0) {
+            continue;
+        }
+        const QString relativePath = QString::fromUtf8(line.mid(pathPos));
+        IndexEntry entry;
+        bool sizeOk, timeOk;
+        entry.mHash = QByteArray::fromHex(line.left(sizePos - 1));
+        entry.mSize = line.mid(sizePos, timePos - sizePos - 1).toLongLong(&sizeOk);
+        entry.mModificationTime = line.mid(timePos, pathPos - timePos - 1).toLongLong(&timeOk);
+        if (entry.mHash.isEmpty() || !sizeOk || !timeOk || relativePath.isEmpty()) {
+            continue;
+        }
+        d->insert(relativePath, entry);
+    }
+    LOG("Loaded" << d->mEntries.count() << "entries from" << file.fileName());
+}
+
+bool ImportHashIndex::save() const
+{
+    QSaveFile file(d->mDir.filePath(fileName()));
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Could not save hash index" << file.fileName() << ":" << file.errorString();
+        return false;
+    }
+    file.write(INDEX_HEADER);
+    file.write("\n");
+    for (auto it = d->mEntries.constBegin(), end = d->mEntries.constEnd(); it != end; ++it) {
+        const IndexEntry& entry = it.value();
+        file.write(entry.mHash.toHex());
+        file.write(" ");
+        file.write(QByteArray::number(entry.mSize));
+        file.write(" ");
+        file.write(QByteArray::number(entry.mModificationTime));
+        file.write(" ");
+        file.write(it.key().toUtf8());
+        file.write("\n");
+    }
+    return file.commit();
+}
+
+QString ImportHashIndex::find(const QByteArray& hash)
+{
+    const QStringList paths = d->mPathsForHash.values(hash);
+    for (const QString& relativePath : paths) {
+        const QString path = d->mDir.filePath(relativePath);
+        if (d->mEntries.value(relativePath).matches(QFileInfo(path))) {
+            return path;
+        }
+        LOG("Dropping stale entry" << relativePath);
+        d->remove(relativePath);
+    }
+    return QString();
+}
+
+QByteArray ImportHashIndex::hashForFile(const QString& filePath)
+{
+    const QString relativePath = d->mDir.relativeFilePath(filePath);
+    auto it = d->mEntries.constFind(relativePath);
+    if (it != d->mEntries.constEnd() && it.value().matches(QFileInfo(filePath))) {
+        return it.value().mHash;
+    }
+    const QByteArray hash = hashFile(filePath);
+    if (hash.isEmpty()) {
+        d->remove(relativePath);
+    } else {
+        insert(hash, filePath);
+    }
+    return hash;
+}
+
+void ImportHashIndex::insert(const QByteArray& hash, const QString& filePath)
+{
+    const QFileInfo info(filePath);
+    IndexEntry entry;
+    entry.mHash = hash;
+    entry.mSize = info.size();
+    entry.mModificationTime = info.lastModified().toMSecsSinceEpoch();
+    d->insert(d->mDir.relativeFilePath(filePath), entry);
+}
+
+QByteArray ImportHashIndex::hashFile(const QString& filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Can't read" << filePath;
+        return QByteArray();
+    }
+    QCryptographicHash hash(hashAlgorithm());
+    if (!hash.addData(&file)) {
+        return QByteArray();
+    }
+    return hash.result();
+}
+
+} // namespace
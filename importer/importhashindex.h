@@ -0,0 +1,102 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2019 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef IMPORTHASHINDEX_H
+#define IMPORTHASHINDEX_H
+
+// Qt
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QString>
+
+// KDE
+
+// Local
+
+namespace Gwenview
+{
+
+struct ImportHashIndexPrivate;
+/**
+ * Remembers the content hash of the files stored in an import destination
+ * folder, so that duplicates can be detected without reading the files again.
+ *
+ * The index is stored in a hidden file at the root of the folder. Each entry
+ * also records the size and modification time of its file: entries whose file
+ * has been removed or modified are silently dropped.
+ */
+class ImportHashIndex
+{
+public:
+    explicit ImportHashIndex(const QString& dirPath);
+    ~ImportHashIndex();
+
+    QString dirPath() const;
+
+    /**
+     * Loads the index from disk. A missing or unreadable index is not an
+     * error: the index just starts empty.
+     */
+    void load();
+
+    bool save() const;
+
+    /**
+     * Returns the path of a file of the folder whose content hash is @p hash,
+     * or an empty string if there is none
+     */
+    QString find(const QByteArray& hash);
+
+    /**
+     * Returns the content hash of @p filePath. The file is only read if it is
+     * not indexed yet, in which case it gets added to the index.
+     */
+    QByteArray hashForFile(const QString& filePath);
+
+    /**
+     * Records that @p filePath, which must be inside the folder, has @p hash
+     * as content hash
+     */
+    void insert(const QByteArray& hash, const QString& filePath);
+
+    /**
+     * Name of the index file, relative to the folder
+     */
+    static QString fileName();
+
+    /**
+     * Reads @p filePath and returns its content hash, or an empty array if it
+     * cannot be read
+     */
+    static QByteArray hashFile(const QString& filePath);
+
+    /**
+     * Hash algorithm used by the index, so that callers can compute hashes
+     * while they copy data
+     */
+    static QCryptographicHash::Algorithm hashAlgorithm();
+
+private:
+    ImportHashIndexPrivate* const d;
+};
+
+} // namespace
+
+#endif /* IMPORTHASHINDEX_H */
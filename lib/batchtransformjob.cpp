@@ -0,0 +1,218 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2019 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "batchtransformjob.h"
+
+// Qt
+#include <QFile>
+#include <QFuture>
+#include <QFutureWatcher>
+#include <QImage>
+#include <QMimeDatabase>
+#include <QSaveFile>
+#include <QtConcurrentMap>
+#include <QDebug>
+
+// KDE
+#include <KLocalizedString>
+
+// Local
+#include "imageutils.h"
+#include "jpegcontent.h"
+#include "thumbnailprovider/thumbnailprovider.h"
+
+#undef ENABLE_LOG
+#undef LOG
+//#define ENABLE_LOG
+#ifdef ENABLE_LOG
+#define LOG(x) qDebug() << x
+#else
+#define LOG(x) ;
+#endif
+
+namespace Gwenview
+{
+
+struct BatchTransformResult
+{
+    QUrl mUrl;
+    QString mErrorString;
+};
+
+/**
+ * Transforms one file. Called from the thread pool.
+ */
+struct FileTransformer
+{
+    typedef BatchTransformResult result_type;
+
+    explicit FileTransformer(Orientation orientation)
+    : mOrientation(orientation)
+    {}
+
+    BatchTransformResult operator()(const QUrl& url) const
+    {
+        BatchTransformResult result;
+        result.mUrl = url;
+        if (!url.isLocalFile()) {
+            result.mErrorString = i18nc("@info", "Only local files can be transformed this way.");
+            return result;
+        }
+        const QString path = url.toLocalFile();
+
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            result.mErrorString = file.errorString();
+            return result;
+        }
+        const QByteArray data = file.readAll();
+        file.close();
+
+        QMimeDatabase db;
+        if (db.mimeTypeForFileNameAndData(path, data).name() != QLatin1String("image/jpeg")) {
+            result.mErrorString = i18nc("@info", "Not a JPEG image.");
+            return result;
+        }
+
+        JpegContent content;
+        if (!content.loadFromData(data)) {
+            result.mErrorString = i18nc("@info", "Could not read the image.");
+            return result;
+        }
+
+        // Apply Exif transformation first to normalize image, like
+        // JpegDocumentLoadedImpl does. The embedded thumbnail is stored with
+        // the same orientation as the image, so it goes through the same
+        // transformations.
+        const Orientation exifOrientation = content.orientation();
+        QImage thumbnail = content.thumbnail();
+        content.transform(exifOrientation);
+        content.resetOrientation();
+        content.transform(mOrientation);
+        if (!thumbnail.isNull()) {
+            thumbnail = thumbnail
+                .transformed(ImageUtils::transformMatrix(exifOrientation))
+                .transformed(ImageUtils::transformMatrix(mOrientation));
+            content.setThumbnail(thumbnail);
+        }
+
+        QSaveFile saveFile(path);
+        if (!saveFile.open(QIODevice::WriteOnly)) {
+            result.mErrorString = saveFile.errorString();
+            return result;
+        }
+        if (!content.save(&saveFile)) {
+            saveFile.cancelWriting();
+            result.mErrorString = content.errorString();
+            return result;
+        }
+        if (!saveFile.commit()) {
+            result.mErrorString = saveFile.errorString();
+            return result;
+        }
+        ThumbnailProvider::deleteImageThumbnail(url);
+        LOG("Transformed" << path);
+        return result;
+    }
+
+    Orientation mOrientation;
+};
+
+struct BatchTransformJobPrivate
+{
+    QList<QUrl> mUrls;
+    Orientation mOrientation;
+    QFutureWatcher<BatchTransformResult> mWatcher;
+    QStringList mErrorList;
+    int mProcessedCount;
+};
+
+BatchTransformJob::BatchTransformJob(const QList<QUrl>& urls, Orientation orientation, QObject* parent)
+: KJob(parent)
+, d(new BatchTransformJobPrivate)
+{
+    d->mUrls = urls;
+    d->mOrientation = orientation;
+    d->mProcessedCount = 0;
+    setCapabilities(Killable);
+    connect(&d->mWatcher, &QFutureWatcherBase::resultReadyAt, this, &BatchTransformJob::slotResultReadyAt);
+    connect(&d->mWatcher, &QFutureWatcherBase::finished, this, &BatchTransformJob::slotFinished);
+}
+
+BatchTransformJob::~BatchTransformJob()
+{
+    d->mWatcher.cancel();
+    d->mWatcher.waitForFinished();
+    delete d;
+}
+
+void BatchTransformJob::start()
+{
+    setTotalAmount(KJob::Files, d->mUrls.count());
+    if (d->mUrls.isEmpty()) {
+        emitResult();
+        return;
+    }
+    d->mWatcher.setFuture(QtConcurrent::mapped(d->mUrls, FileTransformer(d->mOrientation)));
+}
+
+void BatchTransformJob::slotResultReadyAt(int index)
+{
+    const BatchTransformResult result = d->mWatcher.resultAt(index);
+    if (result.mErrorString.isEmpty()) {
+        emit urlTransformed(result.mUrl);
+    } else {
+        const QUrl& url = result.mUrl;
+        const QString name = url.fileName().isEmpty() ? url.toDisplayString() : url.fileName();
+        d->mErrorList << xi18nc("@info %1 is the name of the file which could not be transformed, %2 is the reason for the failure",
+                                "<filename>%1</filename>: %2", name, result.mErrorString);
+    }
+    ++d->mProcessedCount;
+    setProcessedAmount(KJob::Files, d->mProcessedCount);
+    emitPercent(d->mProcessedCount, d->mUrls.count());
+}
+
+void BatchTransformJob::slotFinished()
+{
+    if (d->mWatcher.isCanceled()) {
+        // doKill() takes care of the result
+        return;
+    }
+    if (!d->mErrorList.isEmpty()) {
+        setError(UserDefinedError);
+        setErrorText(i18ncp("@info", "One file could not be transformed.", "%1 files could not be transformed.", d->mErrorList.count()));
+    }
+    emitResult();
+}
+
+QStringList BatchTransformJob::errorList() const
+{
+    return d->mErrorList;
+}
+
+bool BatchTransformJob::doKill()
+{
+    d->mWatcher.cancel();
+    d->mWatcher.waitForFinished();
+    return true;
+}
+
+} // namespace
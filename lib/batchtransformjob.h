@@ -0,0 +1,88 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2019 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef BATCHTRANSFORMJOB_H
+#define BATCHTRANSFORMJOB_H
+
+#include <lib/gwenviewlib_export.h>
+
+// Qt
+#include <QList>
+#include <QStringList>
+#include <QUrl>
+
+// KDE
+#include <KJob>
+
+// Local
+#include <lib/orientation.h>
+
+namespace Gwenview
+{
+
+struct BatchTransformJobPrivate;
+
+/**
+ * Losslessly applies a transformation to a list of JPEG files, directly on
+ * disk.
+ *
+ * Unlike TransformImageOperation, no Document is created and no pixel is
+ * decoded: each file is read, transformed at the DCT coefficient level, its
+ * Exif orientation and thumbnail are updated and it is atomically written
+ * back. Files are processed in parallel on the global thread pool.
+ *
+ * Only local JPEG files are supported, other urls are reported in
+ * errorList().
+ */
+class GWENVIEWLIB_EXPORT BatchTransformJob : public KJob
+{
+    Q_OBJECT
+public:
+    BatchTransformJob(const QList<QUrl>& urls, Orientation orientation, QObject* parent = nullptr);
+    ~BatchTransformJob() override;
+
+    void start() override;
+
+    /**
+     * Human readable list of the files which could not be transformed, with
+     * the reason why
+     */
+    QStringList errorList() const;
+
+Q_SIGNALS:
+    /**
+     * Emitted every time a file has been successfully transformed
+     */
+    void urlTransformed(const QUrl&);
+
+protected:
+    bool doKill() override;
+
+private Q_SLOTS:
+    void slotResultReadyAt(int index);
+    void slotFinished();
+
+private:
+    BatchTransformJobPrivate* const d;
+};
+
+} // namespace
+
+#endif /* BATCHTRANSFORMJOB_H */
@@ -25,6 +25,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <QImage>
 #include <QUndoStack>
 #include <QUrl>
+#include <QtConcurrent>
 #include <QDebug>
 
 // KDE
@@ -42,6 +43,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "loadingdocumentimpl.h"
 #include "loadingjob.h"
 #include "savejob.h"
+#include "trace.h"
 
 namespace Gwenview
 {
@@ -125,20 +127,204 @@ void DocumentPrivate::scheduleImageDownSampling(int invertedZoom)
     q->enqueueJob(new DownSamplingJob(invertedZoom));
 }
 
-void DocumentPrivate::downSampleImage(int invertedZoom)
+void DocumentPrivate::cancelImageDownSampling()
 {
-    mDownSampledImageMap[invertedZoom] = mImage.scaled(mImage.size() / invertedZoom, Qt::KeepAspectRatio, Qt::FastTransformation);
-    if (mDownSampledImageMap[invertedZoom].size().isEmpty()) {
-        mDownSampledImageMap[invertedZoom] = mImage;
+    DownSamplingJob* job = qobject_cast<DownSamplingJob*>(mCurrentJob.data());
+    if (job) {
+        job->cancel();
     }
-    emit q->downSampledImageReady();
 }
 
 //- DownSamplingJob ---------------------------------------
+
+// Levels smaller than this are only built if they have been asked for
+static const int MIN_EXTRA_LEVEL_SIZE = 256;
+
+/**
+ * Returns the format in which down sampled images of @p image are stored:
+ * the format of the image if the box filter can work on it directly, the
+ * cheapest 32 bit format otherwise.
+ */
+static QImage::Format downSampledFormat(const QImage& image)
+{
+    switch (image.format()) {
+    case QImage::Format_RGB32:
+    case QImage::Format_ARGB32_Premultiplied:
+    case QImage::Format_RGBX8888:
+    case QImage::Format_RGBA8888_Premultiplied:
+    case QImage::Format_RGB888:
+    case QImage::Format_Grayscale8:
+        return image.format();
+    case QImage::Format_Indexed8:
+        if (image.isGrayscale() && !image.hasAlphaChannel()) {
+            return QImage::Format_Grayscale8;
+        }
+        return image.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32;
+    default:
+        return image.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32;
+    }
+}
+
+/**
+ * Averages 2x2 blocks of the two source lines into @p dst. Works on any
+ * format whose pixels are made of BytesPerPixel independent 8 bit channels,
+ * including premultiplied ones. If the source width is odd, the last
+ * destination pixel is made of the last column only.
+ */
+template <int BytesPerPixel>
+static void boxFilterLine(const uchar* line1, const uchar* line2, int sourceWidth, uchar* dst, int width)
+{
+    for (int x = 0; x < width; ++x) {
+        const int x1 = 2 * x * BytesPerPixel;
+        const int x2 = qMin(2 * x + 1, sourceWidth - 1) * BytesPerPixel;
+        for (int channel = 0; channel < BytesPerPixel; ++channel) {
+            dst[channel] = (line1[x1 + channel] + line1[x2 + channel] + line2[x1 + channel] + line2[x2 + channel] + 2) >> 2;
+        }
+        dst += BytesPerPixel;
+    }
+}
+
+static void boxFilterLine(int bytesPerPixel, const uchar* line1, const uchar* line2, int sourceWidth, uchar* dst, int width)
+{
+    switch (bytesPerPixel) {
+    case 1:
+        boxFilterLine<1>(line1, line2, sourceWidth, dst, width);
+        break;
+    case 3:
+        boxFilterLine<3>(line1, line2, sourceWidth, dst, width);
+        break;
+    case 4:
+        boxFilterLine<4>(line1, line2, sourceWidth, dst, width);
+        break;
+    default:
+        Q_UNREACHABLE();
+    }
+}
+
+/**
+ * Runs in a worker thread. Returns at least @p minLevelCount levels, each
+ * one half the size of the previous one, rounded up, the first one being half
+ * the size of @p image. Returns an empty vector if it has been cancelled.
+ *
+ * Levels are built in a single pass over @p image: as soon as two lines of
+ * a level are ready, the corresponding line of the next level is built, so
+ * the lines are still in the CPU cache.
+ */
+static QVector<QImage> buildDownSampledLevels(const QImage& image, int minLevelCount, QSharedPointer<QAtomicInt> cancelled)
+{
+    GV_TRACE_SPAN("DownSamplingJob::buildDownSampledLevels");
+    if (image.isNull()) {
+        return QVector<QImage>();
+    }
+    const QImage::Format format = downSampledFormat(image);
+    QVector<QImage> levels;
+    QSize size = image.size();
+    while (levels.count() < minLevelCount || qMax(size.width(), size.height()) / 2 >= MIN_EXTRA_LEVEL_SIZE) {
+        size = QSize((size.width() + 1) / 2, (size.height() + 1) / 2);
+        QImage level(size, format);
+        if (level.isNull()) {
+            qWarning() << "Not enough memory to down sample image to" << size;
+            return QVector<QImage>();
+        }
+        levels << level;
+    }
+    if (levels.isEmpty()) {
+        return levels;
+    }
+    const int bytesPerPixel = levels.first().depth() / 8;
+    const bool convert = image.format() != format;
+
+    QImage strip;
+    for (int y = 0; y < levels.first().height(); ++y) {
+        if ((y % 64) == 0 && cancelled->load()) {
+            return QVector<QImage>();
+        }
+        const int y1 = 2 * y;
+        const int y2 = qMin(2 * y + 1, image.height() - 1);
+        const uchar* line1;
+        const uchar* line2;
+        if (convert) {
+            strip = image.copy(0, y1, image.width(), y2 - y1 + 1).convertToFormat(format);
+            line1 = strip.constScanLine(0);
+            line2 = strip.constScanLine(strip.height() - 1);
+        } else {
+            line1 = image.constScanLine(y1);
+            line2 = image.constScanLine(y2);
+        }
+        boxFilterLine(bytesPerPixel, line1, line2, image.width(), levels[0].scanLine(y), levels[0].width());
+
+        // Propagate to smaller levels while their lines can be completed
+        int row = y;
+        for (int idx = 1; idx < levels.count(); ++idx) {
+            const QImage& source = levels.at(idx - 1);
+            QImage& level = levels[idx];
+            // Wait for the second line of the pair, unless this is the last
+            // line of a source with an odd height
+            if (row % 2 == 0 && row < source.height() - 1) {
+                break;
+            }
+            row = row / 2;
+            const int row1 = 2 * row;
+            const int row2 = qMin(2 * row + 1, source.height() - 1);
+            boxFilterLine(bytesPerPixel, source.constScanLine(row1), source.constScanLine(row2), source.width(),
+                          level.scanLine(row), level.width());
+        }
+    }
+    return levels;
+}
+
 void DownSamplingJob::doStart()
 {
     DocumentPrivate* d = document()->d;
-    d->downSampleImage(mInvertedZoom);
+    if (d->mDownSampledImageMap.contains(mInvertedZoom)) {
+        // Already built by a previous job, along with the level it was
+        // asked for
+        setError(NoError);
+        emitResult();
+        return;
+    }
+    // Start from the smallest image we already have which is still bigger
+    // than the one we want
+    QImage source = d->mImage;
+    mSourceInvertedZoom = 1;
+    QMap<int, QImage>::ConstIterator it = d->mDownSampledImageMap.constBegin(), end = d->mDownSampledImageMap.constEnd();
+    for (; it != end; ++it) {
+        if (it.key() > mSourceInvertedZoom && it.key() < mInvertedZoom && !it.value().isNull()) {
+            source = it.value();
+            mSourceInvertedZoom = it.key();
+        }
+    }
+    int levelCount = 0;
+    for (int invertedZoom = mSourceInvertedZoom; invertedZoom < mInvertedZoom; invertedZoom *= 2) {
+        ++levelCount;
+    }
+    LOG("invertedZoom=" << mInvertedZoom << "from" << mSourceInvertedZoom << "levelCount=" << levelCount);
+
+    connect(&mWatcher, &QFutureWatcherBase::finished, this, &DownSamplingJob::slotLevelsReady);
+    mWatcher.setFuture(QtConcurrent::run(buildDownSampledLevels, source, levelCount, mCancelled));
+}
+
+void DownSamplingJob::cancel()
+{
+    mCancelled->storeRelease(1);
+}
+
+void DownSamplingJob::slotLevelsReady()
+{
+    const QVector<QImage> levels = mWatcher.result();
+    if (!mCancelled->loadAcquire()) {
+        DocumentPrivate* d = document()->d;
+        int invertedZoom = mSourceInvertedZoom;
+        for (const QImage& level : levels) {
+            invertedZoom *= 2;
+            d->mDownSampledImageMap[invertedZoom] = level;
+        }
+        if (!d->mDownSampledImageMap.contains(mInvertedZoom)) {
+            // Could not down sample, do not ask again
+            d->mDownSampledImageMap[mInvertedZoom] = d->mImage;
+        }
+        emit document()->downSampledImageReady();
+    }
     setError(NoError);
     emitResult();
 }
@@ -173,6 +359,7 @@ Document::~Document()
 
 void Document::reload()
 {
+    d->cancelImageDownSampling();
     d->mSize = QSize();
     d->mImage = QImage();
     d->mDownSampledImageMap.clear();
@@ -258,6 +445,7 @@ void Document::switchToImpl(AbstractDocumentImpl* impl)
 
 void Document::setImageInternal(const QImage& image)
 {
+    d->cancelImageDownSampling();
     d->mImage = image;
     d->mDownSampledImageMap.clear();
 
@@ -368,6 +556,12 @@ int Document::memoryUsage() const
     // FIXME: Take undo stack into account
     int usage = d->mImage.byteCount();
     usage += rawData().length();
+    Q_FOREACH(const QImage& image, d->mDownSampledImageMap) {
+        // Levels which could not be down sampled share the full image data
+        if (image.cacheKey() != d->mImage.cacheKey()) {
+            usage += image.byteCount();
+        }
+    }
     return usage;
 }
 
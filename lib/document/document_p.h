@@ -32,10 +32,14 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #include <QUrl>
 
 // Qt
+#include <QAtomicInt>
+#include <QFutureWatcher>
 #include <QImage>
 #include <QQueue>
+#include <QSharedPointer>
 #include <QUndoStack>
 #include <QPointer>
+#include <QVector>
 
 namespace Exiv2
 {
@@ -73,21 +77,45 @@ struct DocumentPrivate
 
     void scheduleImageLoading(int invertedZoom);
     void scheduleImageDownSampling(int invertedZoom);
-    void downSampleImage(int invertedZoom);
+    void cancelImageDownSampling();
 };
 
 
+/**
+ * Builds the down sampled images of a document in a worker thread.
+ *
+ * All the levels between the biggest image already available and
+ * mInvertedZoom are built in one pass, each level from the previous one
+ * with a 2x2 box filter. A few smaller levels are built as well, so that
+ * zooming out further does not need another job.
+ */
 class DownSamplingJob : public DocumentJob
 {
     Q_OBJECT
 public:
     DownSamplingJob(int invertedZoom)
     : mInvertedZoom(invertedZoom)
+    , mSourceInvertedZoom(1)
+    , mCancelled(new QAtomicInt(0))
     {}
 
     void doStart() override;
 
+    /**
+     * Stops the worker thread as soon as possible. The job still emits its
+     * result, but does not change the document.
+     */
+    void cancel();
+
     int mInvertedZoom;
+
+private Q_SLOTS:
+    void slotLevelsReady();
+
+private:
+    int mSourceInvertedZoom;
+    QSharedPointer<QAtomicInt> mCancelled;
+    QFutureWatcher<QVector<QImage>> mWatcher;
 };
 
 
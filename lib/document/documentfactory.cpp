@@ -31,6 +31,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 // Local
 #include <gvdebug.h>
+#include <trace.h>
 
 namespace Gwenview
 {
@@ -162,6 +163,7 @@ Document::Ptr DocumentFactory::getCachedDocument(const QUrl &url) const
 
 Document::Ptr DocumentFactory::load(const QUrl &url)
 {
+    GV_TRACE_SPAN("DocumentFactory::load");
     GV_RETURN_VALUE_IF_FAIL(!url.isEmpty(), Document::Ptr());
     DocumentInfo* info = nullptr;
 
@@ -194,6 +196,7 @@ Document::Ptr DocumentFactory::load(const QUrl &url)
     d->mDocumentMap[url] = info;
 
     d->garbageCollect(d->mDocumentMap);
+    GV_TRACE_COUNTER("DocumentFactory documents", d->mDocumentMap.count());
 
     return docPtr;
 }
@@ -25,7 +25,6 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 #include <QByteArray>
 #include <QImage>
 #include <QImageWriter>
-#include <QTransform>
 #include <QDebug>
 #include <QUrl>
 
@@ -33,7 +32,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 
 // Local
 #include "documentjob.h"
-#include "imageutils.h"
+#include "orthogonaltransform.h"
+#include "parallelimageencoder.h"
 #include "savejob.h"
 
 namespace Gwenview
@@ -80,12 +80,19 @@ Document::LoadingState DocumentLoadedImpl::loadingState() const
 
 bool DocumentLoadedImpl::saveInternal(QIODevice* device, const QByteArray& format)
 {
-    QImageWriter writer(device, format);
-    bool ok = writer.write(document()->image());
+    bool ok;
+    QString errorString;
+    if (ParallelImageEncoder::canWrite(format)) {
+        ok = ParallelImageEncoder::write(device, document()->image(), format, &errorString);
+    } else {
+        QImageWriter writer(device, format);
+        ok = writer.write(document()->image());
+        errorString = writer.errorString();
+    }
     if (ok) {
         setDocumentFormat(format);
     } else {
-        setDocumentErrorString(writer.errorString());
+        setDocumentErrorString(errorString);
     }
     return ok;
 }
@@ -108,9 +115,7 @@ void DocumentLoadedImpl::setImage(const QImage& image)
 
 void DocumentLoadedImpl::applyTransformation(Orientation orientation)
 {
-    QImage image = document()->image();
-    QTransform matrix = ImageUtils::transformMatrix(orientation);
-    image = image.transformed(matrix);
+    QImage image = OrthogonalTransform::transformed(document()->image(), orientation);
     setDocumentImage(image);
     emit imageRectUpdated(image.rect());
 }
@@ -62,7 +62,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 #include "jpegcontent.h"
 #include "jpegdocumentloadedimpl.h"
 #include "orientation.h"
+#include "orthogonaltransform.h"
 #include "svgdocumentloadedimpl.h"
+#include "trace.h"
 #include "urlutils.h"
 #include "videodocumentloadedimpl.h"
 #include "gwenviewconfig.h"
@@ -115,6 +117,7 @@ struct LoadingDocumentImplPrivate
      */
     bool determineKind()
     {
+        GV_TRACE_SPAN("LoadingDocumentImpl::determineKind");
         QString mimeType;
         const QUrl &url = q->document()->url();
         QMimeDatabase db;
@@ -191,6 +194,7 @@ struct LoadingDocumentImplPrivate
 
     bool loadMetaInfo()
     {
+        GV_TRACE_SPAN("LoadingDocumentImpl::loadMetaInfo");
         LOG("mFormatHint" << mFormatHint);
         QBuffer buffer;
         buffer.setBuffer(&mData);
@@ -294,6 +298,7 @@ struct LoadingDocumentImplPrivate
 
     void loadImageData()
     {
+        GV_TRACE_SPAN("LoadingDocumentImpl::loadImageData");
         QBuffer buffer;
         buffer.setBuffer(&mData);
         buffer.open(QIODevice::ReadOnly);
@@ -315,8 +320,13 @@ struct LoadingDocumentImplPrivate
             }
         }
 
+        // Do not let QImageReader rotate the image, it would allocate a
+        // second buffer. Auto transform must be disabled explicitly: image
+        // plugins can turn it on by default.
+        reader.setAutoTransform(false);
+        Orientation orientation = NORMAL;
         if (GwenviewConfig::applyExifOrientation()) {
-            reader.setAutoTransform(true);
+            orientation = OrthogonalTransform::orientationFromTransformations(reader.transformation());
         }
 
         bool ok = reader.read(&mImage);
@@ -324,6 +334,7 @@ struct LoadingDocumentImplPrivate
             LOG("QImageReader::read() failed");
             return;
         }
+        mImage = OrthogonalTransform::transformed(std::move(mImage), orientation);
 
         if (reader.supportsAnimation()
                 && reader.nextImageDelay() > 0 // Assume delay == 0 <=> only one frame
@@ -39,6 +39,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 
 // Local
 #include "documentloadedimpl.h"
+#include "trace.h"
 
 namespace Gwenview
 {
@@ -74,6 +75,7 @@ SaveJob::~SaveJob()
 
 void SaveJob::saveInternal()
 {
+    GV_TRACE_SPAN("SaveJob::saveInternal");
     if (!d->mImpl->saveInternal(d->mSaveFile.data(), d->mFormat)) {
         d->mSaveFile->cancelWriting();
         setError(UserDefinedError + 2);
@@ -120,6 +122,7 @@ void SaveJob::doStart()
 
 void SaveJob::finishSave()
 {
+    GV_TRACE_SPAN("SaveJob::finishSave");
     d->mInternalSaveWatcher.reset(nullptr);
     if (d->mKillReceived) {
         return;
@@ -38,6 +38,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #include <QPointer>
 #include <QDebug>
 #include <QIcon>
+#include <QImage>
 #include <QUrl>
 #include <QDrag>
 #include <QMimeData>
@@ -109,6 +110,7 @@ struct DocumentViewPrivate
     DocumentView::Setup mSetup;
     bool mCurrent;
     bool mCompareMode;
+    QImage mPreRenderedImage;
     int controlWheelAccumulatedDelta;
 
     QPointF mDragStartPosition;
@@ -147,6 +149,9 @@ struct DocumentViewPrivate
                          q, &DocumentView::slotCompleted);
 
         adapter->loadConfig();
+        if (adapter->rasterImageView()) {
+            adapter->rasterImageView()->setBatchedScaling(mCompareMode);
+        }
 
         adapter->widget()->installSceneEventFilter(q);
         if (mCurrent) {
@@ -553,10 +558,19 @@ void DocumentView::finishOpenUrl()
 
     connect(d->mDocument.data(), &Document::loadingFailed,
             this, &DocumentView::slotLoadingFailed);
+    if (d->mAdapter->rasterImageView()) {
+        d->mAdapter->rasterImageView()->setPreRenderedImage(d->mPreRenderedImage);
+    }
+    d->mPreRenderedImage = QImage();
     d->mAdapter->setDocument(d->mDocument);
     d->updateCaption();
 }
 
+void DocumentView::setPreRenderedImage(const QImage& image)
+{
+    d->mPreRenderedImage = image;
+}
+
 void DocumentView::loadAdapterConfig()
 {
     d->mAdapter->loadConfig();
@@ -823,6 +837,10 @@ qreal DocumentView::minimumZoom() const
 void DocumentView::setCompareMode(bool compare)
 {
     d->mCompareMode = compare;
+    // Views being compared render together
+    if (d->mAdapter && d->mAdapter->rasterImageView()) {
+        d->mAdapter->rasterImageView()->setBatchedScaling(compare);
+    }
     if (compare) {
         d->mHud->show();
         d->mHud->setZValue(1);
@@ -976,6 +994,15 @@ void DocumentView::hideAndDeleteLater()
     deleteLater();
 }
 
+void DocumentView::reactivate()
+{
+    setZValue(0);
+    show();
+    // Queued so that the new owner of the view can connect to its signals
+    // first
+    QMetaObject::invokeMethod(this, "slotCompleted", Qt::QueuedConnection);
+}
+
 void DocumentView::setGraphicsEffectOpacity(qreal opacity)
 {
     d->mOpacityEffect->setOpacity(opacity);
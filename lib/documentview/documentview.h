@@ -31,6 +31,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 // Local
 #include <lib/document/document.h>
 
+class QImage;
 class QPropertyAnimation;
 class QUrl;
 
@@ -90,6 +91,12 @@ public:
 
     void openUrl(const QUrl&, const Setup&);
 
+    /**
+     * Defines an image of the next opened document already scaled to fit
+     * the view, see RasterImageView::setPreRenderedImage()
+     */
+    void setPreRenderedImage(const QImage& image);
+
     Setup setup() const;
 
     /**
@@ -155,6 +162,12 @@ public Q_SLOTS:
 
     void hideAndDeleteLater();
 
+    /**
+     * Shows again a view which DocumentViewContainer kept aside, and emits
+     * completed() as if its document had just been loaded
+     */
+    void reactivate();
+
 Q_SIGNALS:
     /**
      * Emitted when the part has finished loading
@@ -23,6 +23,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 
 // Local
 #include <lib/documentview/documentview.h>
+#include <lib/documentview/rasterimageview.h>
 #include <lib/graphicswidgetfloater.h>
 #include <lib/gvdebug.h>
 #include <lib/gwenviewconfig.h>
@@ -34,12 +35,22 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #include <QGraphicsScene>
 #include <QPropertyAnimation>
 #include <QTimer>
+#include <QVector>
 #include <QDebug>
 #include <QtMath>
 
 namespace Gwenview
 {
 
+// Maximum number of deleted views kept around to show recent documents again
+// without scaling them
+static const int MAX_RECYCLED_VIEWS = 3;
+
+// Maximum amount of memory used by these views, in bytes. This includes their
+// scaled images and their documents, since the views keep the documents
+// loaded.
+static const qint64 MAX_RECYCLED_VIEWS_MEMORY = 128 * 1024 * 1024;
+
 typedef QSet<DocumentView*> DocumentViewSet;
 typedef QHash<QUrl, DocumentView::Setup> SetupForUrl;
 
@@ -51,6 +62,9 @@ struct DocumentViewContainerPrivate
     DocumentViewSet mViews;
     DocumentViewSet mAddedViews;
     DocumentViewSet mRemovedViews;
+    // Hidden views which can be returned by takeRecycledView(), most recently
+    // deleted first
+    QList<DocumentView*> mRecycledViews;
     QTimer* mLayoutUpdateTimer;
 
     void scheduleLayoutUpdate()
@@ -79,6 +93,55 @@ struct DocumentViewContainerPrivate
         qDeleteAll(*set);
         set->clear();
     }
+
+    static bool canRecycle(DocumentView* view)
+    {
+        const Document::Ptr document = view->document();
+        if (!document || document->isAnimated()) {
+            return false;
+        }
+        RasterImageView* imageView = view->imageView();
+        return imageView && imageView->bufferMemoryUsage() > 0;
+    }
+
+    static qint64 recycledViewMemoryUsage(DocumentView* view)
+    {
+        return qint64(view->imageView()->bufferMemoryUsage()) + view->document()->memoryUsage();
+    }
+
+    /**
+     * Called once a removed view has been faded out: keeps it hidden in
+     * mRecycledViews if possible, deletes it otherwise
+     */
+    void recycleOrDeleteView(DocumentView* view)
+    {
+        if (!canRecycle(view)) {
+            view->hideAndDeleteLater();
+            return;
+        }
+        view->hide();
+        // There can already be a view for this url if the user came back to
+        // it before this one was faded out
+        const QUrl url = view->url();
+        QMutableListIterator<DocumentView*> it(mRecycledViews);
+        while (it.hasNext()) {
+            DocumentView* recycledView = it.next();
+            if (recycledView->url() == url) {
+                it.remove();
+                recycledView->deleteLater();
+            }
+        }
+        mRecycledViews.prepend(view);
+
+        QVector<qint64> memoryUsages;
+        Q_FOREACH(DocumentView* recycledView, mRecycledViews) {
+            memoryUsages << recycledViewMemoryUsage(recycledView);
+        }
+        const int keptCount = DocumentViewContainer::recycledViewCountToKeep(memoryUsages);
+        while (mRecycledViews.count() > keptCount) {
+            mRecycledViews.takeLast()->deleteLater();
+        }
+    }
 };
 
 DocumentViewContainer::DocumentViewContainer(QWidget* parent)
@@ -127,6 +190,36 @@ DocumentView* DocumentViewContainer::createView()
     return view;
 }
 
+DocumentView* DocumentViewContainer::takeRecycledView(const QUrl& url)
+{
+    for (int idx = 0; idx < d->mRecycledViews.count(); ++idx) {
+        DocumentView* view = d->mRecycledViews.at(idx);
+        if (view->url() != url) {
+            continue;
+        }
+        d->mRecycledViews.removeAt(idx);
+        view->setPalette(palette());
+        d->mAddedViews << view;
+        view->reactivate();
+        d->scheduleLayoutUpdate();
+        return view;
+    }
+    return nullptr;
+}
+
+int DocumentViewContainer::recycledViewCountToKeep(const QVector<qint64>& memoryUsages)
+{
+    qint64 memoryUsage = 0;
+    int count = 0;
+    for (; count < memoryUsages.count() && count < MAX_RECYCLED_VIEWS; ++count) {
+        memoryUsage += memoryUsages.at(count);
+        if (memoryUsage > MAX_RECYCLED_VIEWS_MEMORY) {
+            break;
+        }
+    }
+    return count;
+}
+
 void DocumentViewContainer::deleteView(DocumentView* view)
 {
     if (d->removeFromSet(view, &d->mViews)) {
@@ -150,6 +243,8 @@ void DocumentViewContainer::reset()
     d->resetSet(&d->mViews);
     d->resetSet(&d->mAddedViews);
     d->resetSet(&d->mRemovedViews);
+    qDeleteAll(d->mRecycledViews);
+    d->mRecycledViews.clear();
 }
 
 void DocumentViewContainer::showEvent(QShowEvent* event)
@@ -189,7 +284,9 @@ void DocumentViewContainer::updateLayout()
         QPropertyAnimation* anim = newView->fadeIn();
 
         oldView->setZValue(-1);
-        connect(anim, &QPropertyAnimation::finished, oldView, &DocumentView::hideAndDeleteLater);
+        connect(anim, &QPropertyAnimation::finished, oldView, [this, oldView]() {
+            d->recycleOrDeleteView(oldView);
+        });
         d->mRemovedViews.clear();
 
         return;
@@ -271,11 +368,13 @@ void DocumentViewContainer::updateLayout()
     if (animated) {
         Q_FOREACH(DocumentView* view, d->mRemovedViews) {
             view->fadeOut();
-            QTimer::singleShot(DocumentView::AnimDuration, view, &QObject::deleteLater);
+            QTimer::singleShot(DocumentView::AnimDuration, view, [this, view]() {
+                d->recycleOrDeleteView(view);
+            });
         }
     } else {
         Q_FOREACH(DocumentView* view, d->mRemovedViews) {
-            view->deleteLater();
+            d->recycleOrDeleteView(view);
         }
         QMetaObject::invokeMethod(this, "pretendFadeInFinished", Qt::QueuedConnection);
     }
@@ -31,6 +31,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 // Qt
 #include <QGraphicsView>
 #include <QUrl>
+#include <QVector>
 
 namespace Gwenview
 {
@@ -54,9 +55,25 @@ public:
      */
     DocumentView* createView();
 
+    /**
+     * Returns a view which was deleted recently and still shows @p url, or
+     * nullptr if there is none. The view is added back to the container and
+     * paints its previous rendering immediately.
+     */
+    DocumentView* takeRecycledView(const QUrl& url);
+
+    /**
+     * Returns how many recycled views can be kept. @p memoryUsages contains
+     * the memory used by each view, scaled image and document included, most
+     * recently deleted view first. Views are kept in this order as long as
+     * they fit in the count and memory limits.
+     */
+    static int recycledViewCountToKeep(const QVector<qint64>& memoryUsages);
+
     /**
      * Delete view. Note that the view will first be faded to black before
-     * being destroyed.
+     * being destroyed. Views showing raster images may be kept hidden
+     * instead, so that takeRecycledView() can return them.
      */
     void deleteView(DocumentView* view);
 
@@ -26,20 +26,89 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #include <lib/imagescaler.h>
 #include <lib/cms/cmsprofile.h>
 #include <lib/gvdebug.h>
+#include <lib/startuptimer.h>
+#include <lib/trace.h>
 
 // KDE
 
 // Qt
 #include <QGraphicsSceneMouseEvent>
+#include <QGuiApplication>
+#include <QHash>
 #include <QPainter>
 #include <QTimer>
 #include <QPointer>
+#include <QSharedPointer>
 #include <QDebug>
 
 
 namespace Gwenview
 {
 
+static const int TILE_SIZE = 256;
+
+typedef QHash<quint64, QImage> TileHash;
+
+static quint64 tileKey(int column, int row)
+{
+    return (quint64(quint32(row)) << 32) | quint32(column);
+}
+
+static QPoint tilePos(quint64 key)
+{
+    return QPoint(int(quint32(key)) * TILE_SIZE, int(quint32(key >> 32)) * TILE_SIZE);
+}
+
+/**
+ * Color transforms from the document profile to the monitor profile. Shared
+ * with the ImageScaler post-processing, which may run in worker threads.
+ */
+struct DisplayTransform
+{
+    DisplayTransform()
+    : mRgbTransform(nullptr)
+    , mGrayTransform(nullptr)
+    {}
+
+    ~DisplayTransform()
+    {
+        if (mRgbTransform) {
+            cmsDeleteTransform(mRgbTransform);
+        }
+        if (mGrayTransform) {
+            cmsDeleteTransform(mGrayTransform);
+        }
+    }
+
+    void apply(QImage& image) const
+    {
+        cmsHTRANSFORM transform;
+        switch (image.format()) {
+        case QImage::Format_RGB32:
+        case QImage::Format_ARGB32:
+            transform = mRgbTransform;
+            break;
+        case QImage::Format_Grayscale8:
+            transform = mGrayTransform;
+            break;
+        default:
+            // Gwenview can only apply color profile on RGB32, ARGB32 and
+            // Grayscale8 images
+            return;
+        }
+        if (!transform) {
+            return;
+        }
+        for (int y = 0; y < image.height(); ++y) {
+            uchar* line = image.scanLine(y);
+            cmsDoTransform(transform, line, line, image.width());
+        }
+    }
+
+    cmsHTRANSFORM mRgbTransform;
+    cmsHTRANSFORM mGrayTransform;
+};
+
 struct RasterImageViewPrivate
 {
     RasterImageView* q;
@@ -54,27 +123,53 @@ struct RasterImageViewPrivate
     // /Config
 
     bool mBufferIsEmpty;
-    QPixmap mCurrentBuffer;
-    // The alternate buffer is useful when scrolling: existing content is copied
-    // to mAlternateBuffer and buffers are swapped. This avoids allocating a new
-    // QPixmap every time the image is scrolled.
-    QPixmap mAlternateBuffer;
+    // The scaled image, split in tiles positioned in zoomed image
+    // coordinates. Tiles are in a format QPainter can blit without
+    // conversion and already contain the alpha background, so scrolling only
+    // changes where they are drawn.
+    TileHash mTiles;
+    // The parts of mTiles filled by the scaler
+    QRegion mValidRegion;
+    // The zoom and the size of the zoomed image when mTiles were created
+    qreal mTilesZoom;
+    QSize mTilesZoomedSize;
+
+    // Tiles rendered before the last zoom change. They are drawn scaled
+    // where the new tiles are not ready yet.
+    TileHash mPreviousTiles;
+    QRegion mPreviousValidRegion;
+    qreal mPreviousZoom;
+
+    // An image already scaled to fit the view, see setPreRenderedImage()
+    QImage mPreRenderedImage;
+    QSharedPointer<DisplayTransform> mDisplayTransform;
+    // Identifies the monitor profile mDisplayTransform has been created for
+    QByteArray mMonitorProfileId;
 
     QTimer* mUpdateTimer;
 
     QPointer<AbstractRasterImageViewTool> mTool;
 
-    bool mApplyDisplayTransform; // Defaults to true. Can be set to false if there is no need or no way to apply color profile
-    cmsHTRANSFORM mDisplayTransform;
-
-    void updateDisplayTransform(QImage::Format format)
+    static QByteArray profileId(const Cms::Profile::Ptr& profile)
     {
-        GV_RETURN_IF_FAIL(format != QImage::Format_Invalid);
-        mApplyDisplayTransform = false;
-        if (mDisplayTransform) {
-            cmsDeleteTransform(mDisplayTransform);
+        if (!profile) {
+            return QByteArray();
         }
-        mDisplayTransform = nullptr;
+        cmsUInt8Number id[16];
+        cmsMD5computeID(profile->handle());
+        cmsGetHeaderProfileID(profile->handle(), id);
+        return QByteArray(reinterpret_cast<const char*>(id), sizeof(id));
+    }
+
+    /**
+     * Creates the color transforms for the current document and makes the
+     * scaler apply them
+     */
+    void updateDisplayTransform()
+    {
+        mScaler->setPostProcess(ImageScaler::PostProcess(), QByteArray());
+        mDisplayTransform.reset();
+        mMonitorProfileId.clear();
 
         Cms::Profile::Ptr profile = q->document()->cmsProfile();
         if (!profile) {
@@ -87,25 +182,66 @@ struct RasterImageViewPrivate
             qWarning() << "Could not get monitor color profile";
             return;
         }
-
-        cmsUInt32Number cmsFormat = 0;
-        switch (format) {
-        case QImage::Format_RGB32:
-        case QImage::Format_ARGB32:
-            cmsFormat = TYPE_BGRA_8;
-            break;
-        case QImage::Format_Grayscale8:
-            cmsFormat = TYPE_GRAY_8;
-            break;
-        default:
-            qWarning() << "Gwenview can only apply color profile on RGB32 or ARGB32 images";
+        mMonitorProfileId = profileId(monitorProfile);
+
+        QSharedPointer<DisplayTransform> transform(new DisplayTransform);
+        if (cmsGetColorSpace(profile->handle()) == cmsSigGrayData) {
+            transform->mGrayTransform = cmsCreateTransform(profile->handle(), TYPE_GRAY_8,
+                                                           monitorProfile->handle(), TYPE_GRAY_8,
+                                                           mRenderingIntent, cmsFLAGS_BLACKPOINTCOMPENSATION);
+        } else {
+            transform->mRgbTransform = cmsCreateTransform(profile->handle(), TYPE_BGRA_8,
+                                                          monitorProfile->handle(), TYPE_BGRA_8,
+                                                          mRenderingIntent, cmsFLAGS_BLACKPOINTCOMPENSATION);
+        }
+        if (!transform->mRgbTransform && !transform->mGrayTransform) {
             return;
         }
+        mDisplayTransform = transform;
+
+        // Views of the same document share their transform parameters
+        const QByteArray key = QByteArray::number(quintptr(q->document().data()), 16)
+            + '-' + QByteArray::number(mRenderingIntent)
+            + '-' + mMonitorProfileId.toHex();
+        mScaler->setPostProcess([transform](QImage& image) {
+            transform->apply(image);
+        }, key);
+    }
+
+    /**
+     * Recreates the color transforms if the monitor profile changed since
+     * they have been created. Returns true if they have been recreated.
+     */
+    bool updateDisplayTransformIfNeeded()
+    {
+        if (!q->document()) {
+            return false;
+        }
+        if (profileId(Cms::Profile::getMonitorProfile()) == mMonitorProfileId) {
+            return false;
+        }
+        updateDisplayTransform();
+        return true;
+    }
 
-        mDisplayTransform = cmsCreateTransform(profile->handle(), cmsFormat,
-                                               monitorProfile->handle(), cmsFormat,
-                                               mRenderingIntent, cmsFLAGS_BLACKPOINTCOMPENSATION);
-        mApplyDisplayTransform = true;
+    /**
+     * Fills the tiles with mPreRenderedImage if it matches the current zoom
+     * and the whole image is visible. Returns false if the scaler is needed.
+     */
+    bool usePreRenderedImage(const QPixmap& texture)
+    {
+        QImage image = mPreRenderedImage;
+        mPreRenderedImage = QImage();
+        if (image.isNull() || image.size() != zoomedImageRect().size() || visibleZoomedRect() != zoomedImageRect()) {
+            return false;
+        }
+        GV_TRACE_SPAN("RasterImageView::usePreRenderedImage");
+        if (mDisplayTransform) {
+            mDisplayTransform->apply(image);
+        }
+        drawToTiles(QPoint(0, 0), image, texture);
+        mBufferIsEmpty = false;
+        return true;
     }
 
     void setupUpdateTimer()
@@ -137,27 +273,121 @@ struct RasterImageViewPrivate
         mScaler->setDestinationRegion(QRegion(rect.toRect()));
     }
 
-    void resizeBuffer()
+    QRect zoomedImageRect() const
+    {
+        return QRect(QPoint(0, 0), (q->documentSize() * q->zoom()).toSize());
+    }
+
+    QRect visibleZoomedRect() const
+    {
+        return mapViewportToZoomedImage(q->boundingRect()).toRect() & zoomedImageRect();
+    }
+
+    void clearTiles()
     {
-        QSize size = q->visibleImageSize().toSize();
-        if (size == mCurrentBuffer.size()) {
+        mTiles.clear();
+        mValidRegion = QRegion();
+        mTilesZoom = q->zoom();
+        mTilesZoomedSize = zoomedImageRect().size();
+    }
+
+    void clearPreviousTiles()
+    {
+        mPreviousTiles.clear();
+        mPreviousValidRegion = QRegion();
+        mPreviousZoom = 0;
+    }
+
+    /**
+     * Drops tiles created for another zoomed image size, as well as tiles
+     * which are not visible anymore
+     */
+    void updateTiles()
+    {
+        if (mTilesZoomedSize != zoomedImageRect().size()) {
+            clearTiles();
             return;
         }
-        if (!size.isValid()) {
-            mAlternateBuffer = QPixmap();
-            mCurrentBuffer = QPixmap();
+        const QRect visibleRect = visibleZoomedRect();
+        if (visibleRect.isEmpty()) {
+            clearTiles();
             return;
         }
+        const int firstColumn = visibleRect.left() / TILE_SIZE;
+        const int lastColumn = visibleRect.right() / TILE_SIZE;
+        const int firstRow = visibleRect.top() / TILE_SIZE;
+        const int lastRow = visibleRect.bottom() / TILE_SIZE;
+        TileHash::Iterator it = mTiles.begin();
+        while (it != mTiles.end()) {
+            const int column = int(quint32(it.key()));
+            const int row = int(quint32(it.key() >> 32));
+            if (column < firstColumn || column > lastColumn || row < firstRow || row > lastRow) {
+                it = mTiles.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        mValidRegion &= QRect(
+            firstColumn * TILE_SIZE, firstRow * TILE_SIZE,
+            (lastColumn - firstColumn + 1) * TILE_SIZE, (lastRow - firstRow + 1) * TILE_SIZE);
+    }
 
-        mAlternateBuffer = QPixmap(size);
-        mAlternateBuffer.fill(Qt::transparent);
-        {
-            QPainter painter(&mAlternateBuffer);
-            painter.drawPixmap(0, 0, mCurrentBuffer);
+    QImage::Format tileFormat() const
+    {
+        if (mAlphaBackgroundMode == AbstractImageView::AlphaBackgroundNone && q->document()->hasAlphaChannel()) {
+            return QImage::Format_ARGB32_Premultiplied;
         }
-        qSwap(mAlternateBuffer, mCurrentBuffer);
+        // The alpha background makes tiles opaque
+        return QImage::Format_RGB32;
+    }
 
-        mAlternateBuffer = QPixmap();
+    QImage& tile(int column, int row)
+    {
+        const quint64 key = tileKey(column, row);
+        TileHash::Iterator it = mTiles.find(key);
+        if (it == mTiles.end()) {
+            const QRect rect = QRect(tilePos(key), QSize(TILE_SIZE, TILE_SIZE)) & zoomedImageRect();
+            QImage image(rect.size(), tileFormat());
+            image.fill(Qt::transparent);
+            it = mTiles.insert(key, image);
+        }
+        return it.value();
+    }
+
+    /**
+     * Copies @p image, whose top-left corner is at @p pos in zoomed image
+     * coordinates, to the tiles it covers
+     */
+    void drawToTiles(const QPoint& pos, const QImage& image, const QPixmap& texture)
+    {
+        const QRect rect = QRect(pos, image.size()) & zoomedImageRect();
+        if (rect.isEmpty()) {
+            return;
+        }
+        const bool hasAlphaChannel = q->document()->hasAlphaChannel();
+        for (int row = rect.top() / TILE_SIZE; row <= rect.bottom() / TILE_SIZE; ++row) {
+            for (int column = rect.left() / TILE_SIZE; column <= rect.right() / TILE_SIZE; ++column) {
+                QImage& tileImage = tile(column, row);
+                const QPoint tileOrigin = tilePos(tileKey(column, row));
+                const QRect tileRect = rect & QRect(tileOrigin, tileImage.size());
+
+                QPainter painter(&tileImage);
+                painter.translate(-tileOrigin);
+                painter.setClipRect(tileRect);
+                painter.setCompositionMode(QPainter::CompositionMode_Source);
+                if (hasAlphaChannel) {
+                    drawAlphaBackground(&painter, tileRect, tileRect.topLeft(), texture);
+                    // This is required so transparent pixels don't replace our background
+                    painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+                }
+                painter.drawImage(pos, image);
+            }
+        }
+        mValidRegion += rect;
+
+        if (!mPreviousTiles.isEmpty() && (QRegion(visibleZoomedRect()) - mValidRegion).isEmpty()) {
+            clearPreviousTiles();
+        }
     }
 
     void drawAlphaBackground(QPainter* painter, const QRect& viewportRect, const QPoint& zoomedImageTopLeft, const QPixmap &texture)
@@ -192,8 +422,6 @@ RasterImageView::RasterImageView(QGraphicsItem* parent)
 {
     d->q = this;
     d->mEmittedCompleted = false;
-    d->mApplyDisplayTransform = true;
-    d->mDisplayTransform = nullptr;
 
     d->mAlphaBackgroundMode = AlphaBackgroundNone;
     d->mAlphaBackgroundColor = Qt::black;
@@ -201,8 +429,16 @@ RasterImageView::RasterImageView(QGraphicsItem* parent)
     d->mEnlargeSmallerImages = false;
 
     d->mBufferIsEmpty = true;
+    d->mTilesZoom = 0;
+    d->mPreviousZoom = 0;
     d->mScaler = new ImageScaler(this);
     connect(d->mScaler, &ImageScaler::scaledRect, this, &RasterImageView::updateFromScaler);
+    // The monitor profile may be different on the new primary screen
+    connect(qApp, &QGuiApplication::primaryScreenChanged, this, [this]() {
+        if (document()) {
+            updateBuffer();
+        }
+    });
 
     d->setupUpdateTimer();
 }
@@ -212,9 +448,6 @@ RasterImageView::~RasterImageView()
     if (d->mTool) {
         d->mTool.data()->toolDeactivated();
     }
-    if (d->mDisplayTransform) {
-        cmsDeleteTransform(d->mDisplayTransform);
-    }
     delete d;
 }
 
@@ -222,7 +455,7 @@ void RasterImageView::setAlphaBackgroundMode(AlphaBackgroundMode mode)
 {
     d->mAlphaBackgroundMode = mode;
     if (document() && document()->hasAlphaChannel()) {
-        d->mCurrentBuffer = QPixmap();
+        d->clearTiles();
         updateBuffer();
     }
 }
@@ -231,7 +464,7 @@ void RasterImageView::setAlphaBackgroundColor(const QColor& color)
 {
     d->mAlphaBackgroundColor = color;
     if (document() && document()->hasAlphaChannel()) {
-        d->mCurrentBuffer = QPixmap();
+        d->clearTiles();
         updateBuffer();
     }
 }
@@ -240,10 +473,35 @@ void RasterImageView::setRenderingIntent(const RenderingIntent::Enum& renderingI
 {
     if (d->mRenderingIntent != renderingIntent) {
         d->mRenderingIntent = renderingIntent;
+        if (document()) {
+            d->updateDisplayTransform();
+        }
         updateBuffer();
     }
 }
 
+void RasterImageView::setPreRenderedImage(const QImage& image)
+{
+    d->mPreRenderedImage = image;
+}
+
+void RasterImageView::setBatchedScaling(bool batched)
+{
+    d->mScaler->setBatched(batched);
+}
+
+int RasterImageView::bufferMemoryUsage() const
+{
+    int usage = 0;
+    for (const QImage& image : qAsConst(d->mTiles)) {
+        usage += image.byteCount();
+    }
+    for (const QImage& image : qAsConst(d->mPreviousTiles)) {
+        usage += image.byteCount();
+    }
+    return usage;
+}
+
 void RasterImageView::loadFromDocument()
 {
     Document::Ptr doc = document();
@@ -280,7 +538,9 @@ void RasterImageView::finishSetDocument()
     GV_RETURN_IF_FAIL(document()->size().isValid());
 
     d->mScaler->setDocument(document());
-    d->resizeBuffer();
+    d->updateDisplayTransform();
+    d->clearTiles();
+    d->clearPreviousTiles();
     applyPendingScrollPos();
 
     connect(document().data(), &Document::imageRectUpdated,
@@ -297,6 +557,8 @@ void RasterImageView::finishSetDocument()
         // of the image scaler is set correctly when zoom is unchanged (see Bug 396736).
         onZoomChanged();
     }
+    // Only valid for the first rendering of the document
+    d->mPreRenderedImage = QImage();
 
     d->startAnimationIfNecessary();
     update();
@@ -329,32 +591,10 @@ void RasterImageView::slotDocumentIsAnimatedUpdated()
 
 void RasterImageView::updateFromScaler(int zoomedImageLeft, int zoomedImageTop, const QImage& image)
 {
-    if (d->mApplyDisplayTransform) {
-        d->updateDisplayTransform(image.format());
-        if (d->mDisplayTransform) {
-            quint8 *bytes = const_cast<quint8*>(image.bits());
-            cmsDoTransform(d->mDisplayTransform, bytes, bytes, image.width() * image.height());
-        }
-    }
-
-    d->resizeBuffer();
-    int viewportLeft = zoomedImageLeft - scrollPos().x();
-    int viewportTop = zoomedImageTop - scrollPos().y();
+    GV_TRACE_SPAN("RasterImageView::updateFromScaler");
+    d->updateTiles();
     d->mBufferIsEmpty = false;
-    {
-        QPainter painter(&d->mCurrentBuffer);
-        painter.setCompositionMode(QPainter::CompositionMode_Source);
-        if (document()->hasAlphaChannel()) {
-            d->drawAlphaBackground(
-                &painter, QRect(viewportLeft, viewportTop, image.width(), image.height()),
-                QPoint(zoomedImageLeft, zoomedImageTop),
-                alphaBackgroundTexture()
-            );
-            // This is required so transparent pixels don't replace our background
-            painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
-        }
-        painter.drawImage(viewportLeft, viewportTop, image);
-    }
+    d->drawToTiles(QPoint(zoomedImageLeft, zoomedImageTop), image, alphaBackgroundTexture());
     update();
 
     if (!d->mEmittedCompleted) {
@@ -365,7 +605,23 @@ void RasterImageView::updateFromScaler(int zoomedImageLeft, int zoomedImageTop,
 
 void RasterImageView::onZoomChanged()
 {
+    if (!d->mValidRegion.isEmpty()) {
+        // Keep current tiles so that they can be used as placeholders until
+        // tiles for the new zoom are ready
+        d->mPreviousZoom = d->mTilesZoom;
+        d->mPreviousTiles.swap(d->mTiles);
+        d->mPreviousValidRegion = d->mValidRegion;
+    }
+    d->clearTiles();
     d->mScaler->setZoom(zoom());
+    if (d->usePreRenderedImage(alphaBackgroundTexture())) {
+        update();
+        if (!d->mEmittedCompleted) {
+            d->mEmittedCompleted = true;
+            emit completed();
+        }
+        return;
+    }
     if (!d->mUpdateTimer->isActive()) {
         updateBuffer();
     }
@@ -376,40 +632,52 @@ void RasterImageView::onImageOffsetChanged()
     update();
 }
 
-void RasterImageView::onScrollPosChanged(const QPointF& oldPos)
+void RasterImageView::onScrollPosChanged(const QPointF& /*oldPos*/)
 {
-    QPointF delta = scrollPos() - oldPos;
-
-    // Scroll existing
-    {
-        if (d->mAlternateBuffer.size() != d->mCurrentBuffer.size()) {
-            d->mAlternateBuffer = QPixmap(d->mCurrentBuffer.size());
-        }
-        d->mAlternateBuffer.fill(Qt::transparent);
-        QPainter painter(&d->mAlternateBuffer);
-        painter.drawPixmap(-delta, d->mCurrentBuffer);
+    // Existing tiles do not move in zoomed image coordinates, only scale the
+    // parts which have just become visible
+    d->updateTiles();
+    const QRegion updateRegion = QRegion(d->visibleZoomedRect()) - d->mValidRegion;
+    if (!updateRegion.isEmpty()) {
+        updateBuffer(updateRegion);
     }
-    qSwap(d->mCurrentBuffer, d->mAlternateBuffer);
-
-    // Scale missing parts
-    QRegion bufferRegion = QRegion(d->mCurrentBuffer.rect().translated(scrollPos().toPoint()));
-    QRegion updateRegion = bufferRegion - bufferRegion.translated(-delta.toPoint());
-    updateBuffer(updateRegion);
     update();
 }
 
 void RasterImageView::paint(QPainter* painter, const QStyleOptionGraphicsItem* /*option*/, QWidget* /*widget*/)
 {
-    QPointF topLeft = imageOffset();
-    if (zoomToFit()) {
-        // In zoomToFit mode, scale crudely the buffer to fit the screen. This
-        // provide an approximate rendered which will be replaced when the scheduled
+    GV_TRACE_SPAN("RasterImageView::paint");
+    const QPoint topLeft = imageOffset().toPoint();
+    painter->save();
+    // Work in zoomed image coordinates
+    painter->translate(topLeft - scrollPos().toPoint());
+
+    const QRegion missingRegion = QRegion(d->visibleZoomedRect()) - d->mValidRegion;
+    if (!missingRegion.isEmpty() && !d->mPreviousTiles.isEmpty() && d->mPreviousZoom > 0) {
+        // Scale crudely the tiles of the previous zoom. This provides an
+        // approximate rendering which will be replaced when the scheduled
         // proper scale is ready.
-        // Round point and size independently, to keep consistency with the below (non zoomToFit) painting
-        const QRect rect = QRect(topLeft.toPoint(), (documentSize() * zoom()).toSize());
-        painter->drawPixmap(rect, d->mCurrentBuffer);
-    } else {
-        painter->drawPixmap(topLeft.toPoint(), d->mCurrentBuffer);
+        painter->save();
+        painter->setClipRegion(missingRegion, Qt::IntersectClip);
+        const qreal ratio = zoom() / d->mPreviousZoom;
+        painter->scale(ratio, ratio);
+        painter->setClipRegion(d->mPreviousValidRegion, Qt::IntersectClip);
+        for (TileHash::ConstIterator it = d->mPreviousTiles.constBegin(); it != d->mPreviousTiles.constEnd(); ++it) {
+            painter->drawImage(tilePos(it.key()), it.value());
+        }
+        painter->restore();
+    }
+
+    if (!missingRegion.isEmpty()) {
+        painter->setClipRegion(d->mValidRegion, Qt::IntersectClip);
+    }
+    for (TileHash::ConstIterator it = d->mTiles.constBegin(); it != d->mTiles.constEnd(); ++it) {
+        painter->drawImage(tilePos(it.key()), it.value());
+    }
+    painter->restore();
+
+    if (!d->mBufferIsEmpty) {
+        StartupTimer::firstPixel();
     }
 
     if (d->mTool) {
@@ -423,7 +691,9 @@ void RasterImageView::paint(QPainter* painter, const QStyleOptionGraphicsItem* /
     painter->drawRect(topLeft.x(), topLeft.y(), visibleSize.width() - 1, visibleSize.height() - 1);
 
     painter->setPen(Qt::blue);
-    painter->drawRect(topLeft.x(), topLeft.y(), d->mCurrentBuffer.width() - 1, d->mCurrentBuffer.height() - 1);
+    for (TileHash::ConstIterator it = d->mTiles.constBegin(); it != d->mTiles.constEnd(); ++it) {
+        painter->drawRect(QRect(topLeft - scrollPos().toPoint() + tilePos(it.key()), it.value().size()).adjusted(0, 0, -1, -1));
+    }
 #endif
 }
 
@@ -450,7 +720,13 @@ void RasterImageView::resizeEvent(QGraphicsSceneResizeEvent* event)
 void RasterImageView::updateBuffer(const QRegion& region)
 {
     d->mUpdateTimer->stop();
+    d->updateTiles();
     if (region.isEmpty()) {
+        // Check the monitor profile on full updates only: it is an X
+        // roundtrip
+        if (d->updateDisplayTransformIfNeeded()) {
+            d->clearTiles();
+        }
         d->setScalerRegionToVisibleRect();
     } else {
         d->mScaler->setDestinationRegion(region);
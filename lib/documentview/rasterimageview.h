@@ -30,6 +30,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 // KDE
 
 class QGraphicsSceneHoverEvent;
+class QImage;
 
 namespace Gwenview
 {
@@ -53,6 +54,24 @@ public:
     void setAlphaBackgroundColor(const QColor& color) override;
     void setRenderingIntent(const RenderingIntent::Enum& renderingIntent);
 
+    /**
+     * Defines an image of the document already scaled to fit the view. It is
+     * used instead of the scaler when the document is first shown, if its
+     * size matches the zoomed document.
+     */
+    void setPreRenderedImage(const QImage& image);
+
+    /**
+     * Makes the scaler batch its work with the other batched views, see
+     * ImageScaler::setBatched()
+     */
+    void setBatchedScaling(bool batched);
+
+    /**
+     * Returns the amount of memory used by the scaled image, in bytes
+     */
+    int bufferMemoryUsage() const;
+
 Q_SIGNALS:
     void currentToolChanged(AbstractRasterImageViewTool*);
     void imageRectUpdated();
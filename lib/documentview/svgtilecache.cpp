@@ -0,0 +1,282 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2019 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "svgtilecache.h"
+
+// Qt
+#include <QAtomicInt>
+#include <QCache>
+#include <QFuture>
+#include <QFutureWatcher>
+#include <QImage>
+#include <QPainter>
+#include <QSet>
+#include <QSharedPointer>
+#include <QSvgRenderer>
+#include <QThread>
+#include <QThreadPool>
+#include <QThreadStorage>
+#include <QtConcurrentRun>
+#include <QtMath>
+#include <QDebug>
+
+// KDE
+
+// Local
+
+#undef ENABLE_LOG
+#undef LOG
+//#define ENABLE_LOG
+#ifdef ENABLE_LOG
+#define LOG(x) qDebug() << x
+#else
+#define LOG(x) ;
+#endif
+
+namespace Gwenview
+{
+
+static const int TILE_SIZE = 256;
+
+// Maximum amount of memory used by the tiles of one zoom level, in KB
+static const int MAX_CACHE_COST = 64 * 1024;
+
+typedef QCache<quint64, QImage> TileCache;
+
+static quint64 tileKey(int column, int row)
+{
+    return (quint64(quint32(row)) << 32) | quint32(column);
+}
+
+/**
+ * The QSvgRenderer used by a worker thread. It is reloaded only when the
+ * thread is asked to render a different SVG document.
+ */
+struct ThreadSvgRenderer
+{
+    ThreadSvgRenderer()
+    : mDataId(0)
+    {}
+
+    int mDataId;
+    QSvgRenderer mRenderer;
+};
+
+static QThreadStorage<ThreadSvgRenderer*> sThreadSvgRenderers;
+
+// Each call to setSvgData() gets a new id, this is what worker threads use to
+// know whether their renderer must be reloaded
+static QAtomicInt sNextDataId(1);
+
+struct SvgTileJob
+{
+    QSharedPointer<QAtomicInt> mCurrentGeneration;
+    int mGeneration;
+    int mDataId;
+    QByteArray mData;
+    QSizeF mDefaultSize;
+    qreal mZoom;
+    int mColumn;
+    int mRow;
+};
+
+static QImage renderTile(const SvgTileJob& job)
+{
+    // Zoom or document changed since this job was queued, don't bother
+    if (job.mCurrentGeneration->load() != job.mGeneration) {
+        return QImage();
+    }
+
+    if (!sThreadSvgRenderers.hasLocalData()) {
+        sThreadSvgRenderers.setLocalData(new ThreadSvgRenderer);
+    }
+    ThreadSvgRenderer* threadRenderer = sThreadSvgRenderers.localData();
+    if (threadRenderer->mDataId != job.mDataId) {
+        LOG("Loading SVG data in thread" << QThread::currentThread());
+        threadRenderer->mRenderer.load(job.mData);
+        threadRenderer->mDataId = job.mDataId;
+    }
+
+    const QRectF zoomedImageRect(QPointF(0, 0), job.mDefaultSize * job.mZoom);
+    const QRectF tileRect = QRectF(job.mColumn * TILE_SIZE, job.mRow * TILE_SIZE, TILE_SIZE, TILE_SIZE)
+        .intersected(zoomedImageRect);
+    if (tileRect.isEmpty()) {
+        return QImage();
+    }
+
+    QImage image(qCeil(tileRect.width()), qCeil(tileRect.height()), QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    QPainter painter(&image);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.translate(-tileRect.topLeft());
+    threadRenderer->mRenderer.render(&painter, zoomedImageRect);
+    return image;
+}
+
+struct SvgTileCachePrivate
+{
+    SvgTileCache* q;
+    QThreadPool mThreadPool;
+    QSharedPointer<QAtomicInt> mGeneration;
+    int mDataId;
+    QByteArray mData;
+    QSizeF mDefaultSize;
+    qreal mZoom;
+    qreal mPreviousZoom;
+    TileCache* mTiles;
+    TileCache* mPreviousTiles;
+    QSet<quint64> mPendingTiles;
+
+    void invalidatePendingTiles()
+    {
+        mGeneration->ref();
+        mPendingTiles.clear();
+    }
+
+    void scheduleTile(int column, int row)
+    {
+        const quint64 key = tileKey(column, row);
+        if (mPendingTiles.contains(key)) {
+            return;
+        }
+        mPendingTiles.insert(key);
+
+        SvgTileJob job;
+        job.mCurrentGeneration = mGeneration;
+        job.mGeneration = mGeneration->load();
+        job.mDataId = mDataId;
+        job.mData = mData;
+        job.mDefaultSize = mDefaultSize;
+        job.mZoom = mZoom;
+        job.mColumn = column;
+        job.mRow = row;
+
+        QFutureWatcher<QImage>* watcher = new QFutureWatcher<QImage>(q);
+        QObject::connect(watcher, &QFutureWatcherBase::finished, q, [this, watcher, job]() {
+            watcher->deleteLater();
+            if (mGeneration->load() != job.mGeneration) {
+                return;
+            }
+            const quint64 key = tileKey(job.mColumn, job.mRow);
+            mPendingTiles.remove(key);
+            const QImage image = watcher->result();
+            if (image.isNull()) {
+                return;
+            }
+            mTiles->insert(key, new QImage(image), qMax(1, image.byteCount() / 1024));
+            emit q->tileReady(QRect(job.mColumn * TILE_SIZE, job.mRow * TILE_SIZE, image.width(), image.height()));
+        });
+        watcher->setFuture(QtConcurrent::run(&mThreadPool, renderTile, job));
+    }
+};
+
+SvgTileCache::SvgTileCache(QObject* parent)
+: QObject(parent)
+, d(new SvgTileCachePrivate)
+{
+    d->q = this;
+    d->mGeneration.reset(new QAtomicInt(0));
+    d->mDataId = 0;
+    d->mZoom = 0;
+    d->mPreviousZoom = 0;
+    d->mTiles = new TileCache(MAX_CACHE_COST);
+    d->mPreviousTiles = new TileCache(MAX_CACHE_COST);
+    d->mThreadPool.setMaxThreadCount(qMax(1, QThread::idealThreadCount()));
+}
+
+SvgTileCache::~SvgTileCache()
+{
+    // Make queued jobs return immediately, then wait for the running ones
+    d->invalidatePendingTiles();
+    d->mThreadPool.waitForDone();
+    delete d->mTiles;
+    delete d->mPreviousTiles;
+    delete d;
+}
+
+int SvgTileCache::tileSize()
+{
+    return TILE_SIZE;
+}
+
+void SvgTileCache::setSvgData(const QByteArray& data, const QSizeF& defaultSize)
+{
+    d->mData = data;
+    d->mDefaultSize = defaultSize;
+    d->mDataId = sNextDataId.fetchAndAddOrdered(1);
+    clear();
+}
+
+void SvgTileCache::setZoom(qreal zoom)
+{
+    if (qFuzzyCompare(zoom, d->mZoom)) {
+        return;
+    }
+    LOG(d->mZoom << "=>" << zoom);
+    d->invalidatePendingTiles();
+    if (!d->mTiles->isEmpty()) {
+        // Keep current tiles so that they can be used as placeholders until
+        // tiles for the new zoom are ready
+        std::swap(d->mTiles, d->mPreviousTiles);
+        d->mPreviousZoom = d->mZoom;
+    }
+    d->mTiles->clear();
+    d->mZoom = zoom;
+}
+
+qreal SvgTileCache::zoom() const
+{
+    return d->mZoom;
+}
+
+QImage SvgTileCache::tile(int column, int row)
+{
+    if (d->mData.isEmpty() || d->mZoom <= 0) {
+        return QImage();
+    }
+    QImage* image = d->mTiles->object(tileKey(column, row));
+    if (image) {
+        return *image;
+    }
+    d->scheduleTile(column, row);
+    return QImage();
+}
+
+qreal SvgTileCache::previousZoom() const
+{
+    return d->mPreviousTiles->isEmpty() ? 0 : d->mPreviousZoom;
+}
+
+QImage SvgTileCache::previousTile(int column, int row) const
+{
+    QImage* image = d->mPreviousTiles->object(tileKey(column, row));
+    return image ? *image : QImage();
+}
+
+void SvgTileCache::clear()
+{
+    d->invalidatePendingTiles();
+    d->mTiles->clear();
+    d->mPreviousTiles->clear();
+    d->mPreviousZoom = 0;
+}
+
+} // namespace
@@ -0,0 +1,103 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2019 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef SVGTILECACHE_H
+#define SVGTILECACHE_H
+
+// Qt
+#include <QObject>
+
+// KDE
+
+// Local
+
+class QImage;
+class QRect;
+class QSizeF;
+
+namespace Gwenview
+{
+
+struct SvgTileCachePrivate;
+/**
+ * Keeps a raster version of an SVG document at the current zoom, split in
+ * square tiles.
+ *
+ * Tiles are rendered in worker threads. QSvgRenderer is not thread-safe, so
+ * each worker thread uses its own renderer, loaded from the raw SVG data.
+ * Tiles are reused as long as the zoom does not change. When the zoom
+ * changes, tiles of the previous zoom are kept around so that they can be
+ * drawn scaled while the new ones are being rendered.
+ */
+class SvgTileCache : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SvgTileCache(QObject* parent = nullptr);
+    ~SvgTileCache() override;
+
+    static int tileSize();
+
+    /**
+     * Defines the SVG document to render. Drops all cached tiles.
+     */
+    void setSvgData(const QByteArray& data, const QSizeF& defaultSize);
+
+    void setZoom(qreal zoom);
+    qreal zoom() const;
+
+    /**
+     * Returns the tile at @p column, @p row for the current zoom. If the tile
+     * is not available yet, returns a null image and schedules its rendering:
+     * tileReady() will be emitted once it is done.
+     */
+    QImage tile(int column, int row);
+
+    /**
+     * Returns the zoom of the tiles rendered before the last zoom change, or
+     * 0 if there are none
+     */
+    qreal previousZoom() const;
+
+    /**
+     * Returns the tile at @p column, @p row rendered at previousZoom(), or a
+     * null image if there is none. Never schedules any rendering.
+     */
+    QImage previousTile(int column, int row) const;
+
+    /**
+     * Drops all cached tiles and ignores pending renderings
+     */
+    void clear();
+
+Q_SIGNALS:
+    /**
+     * Emitted when a tile has been rendered. @p rect is in zoomed image
+     * coordinates.
+     */
+    void tileReady(const QRect& rect);
+
+private:
+    SvgTileCachePrivate* const d;
+};
+
+} // namespace
+
+#endif /* SVGTILECACHE_H */
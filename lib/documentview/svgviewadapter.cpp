@@ -23,7 +23,6 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 
 // Qt
 #include <QCursor>
-#include <QGraphicsSvgItem>
 #include <QGraphicsTextItem>
 #include <QGraphicsWidget>
 #include <QPainter>
@@ -34,6 +33,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 
 // Local
 #include "document/documentfactory.h"
+#include <lib/documentview/svgtilecache.h>
 #include <qgraphicssceneevent.h>
 #include <lib/gvdebug.h>
 #include <lib/gwenviewconfig.h>
@@ -44,17 +44,14 @@ namespace Gwenview
 /// SvgImageView ////
 SvgImageView::SvgImageView(QGraphicsItem* parent)
 : AbstractImageView(parent)
-, mSvgItem(new QGraphicsSvgItem(this))
+, mTileCache(new SvgTileCache(this))
 , mAlphaBackgroundMode(AbstractImageView::AlphaBackgroundCheckBoard)
 , mAlphaBackgroundColor(Qt::black)
 , mImageFullyLoaded(false)
 {
-    // At certain scales, the SVG can render outside its own bounds up to 1 pixel
-    // This clips it so it isn't drawn outside the background or over the selection rect
-    mSvgItem->setFlag(ItemClipsToShape);
-
-    // So we aren't unnecessarily drawing the background for every paint()
-    setCacheMode(QGraphicsItem::DeviceCoordinateCache);
+    // No item cache: the SVG is painted from the tiles of mTileCache, which is
+    // cheap enough and avoids keeping another full-view copy around
+    connect(mTileCache, &SvgTileCache::tileReady, this, &SvgImageView::onTileReady);
 }
 
 void SvgImageView::loadFromDocument()
@@ -76,39 +73,45 @@ void SvgImageView::finishLoadFromDocument()
 {
     QSvgRenderer* renderer = document()->svgRenderer();
     GV_RETURN_IF_FAIL(renderer);
-    mSvgItem->setSharedRenderer(renderer);
+    mTileCache->setSvgData(document()->rawData(), renderer->defaultSize());
     if (zoomToFit()) {
         setZoom(computeZoomToFit(), QPointF(-1, -1), ForceUpdate);
     } else if (zoomToFill()) {
         setZoom(computeZoomToFill(), QPointF(-1, -1), ForceUpdate);
     } else {
-        mSvgItem->setScale(zoom());
+        mTileCache->setZoom(zoom());
     }
     applyPendingScrollPos();
     emit completed();
     mImageFullyLoaded = true;
+    update();
 }
 
 void SvgImageView::onZoomChanged()
 {
-    mSvgItem->setScale(zoom());
-    adjustItemPos();
+    mTileCache->setZoom(zoom());
+    update();
 }
 
 void SvgImageView::onImageOffsetChanged()
 {
-    adjustItemPos();
+    update();
 }
 
 void SvgImageView::onScrollPosChanged(const QPointF& /* oldPos */)
 {
-    adjustItemPos();
+    // Tiles are kept between scroll steps, so this only blits cached images
+    update();
 }
 
-void SvgImageView::adjustItemPos()
+void SvgImageView::onTileReady(const QRect& rect)
 {
-    mSvgItem->setPos((imageOffset() - scrollPos()).toPoint());
-    update();
+    update(QRectF(rect.translated(imageOrigin())));
+}
+
+QPoint SvgImageView::imageOrigin() const
+{
+    return (imageOffset() - scrollPos()).toPoint();
 }
 
 void SvgImageView::setAlphaBackgroundMode(AbstractImageView::AlphaBackgroundMode mode)
@@ -144,10 +147,59 @@ void SvgImageView::drawAlphaBackground(QPainter* painter)
     }
 }
 
+void SvgImageView::drawPlaceholder(QPainter* painter, const QRect& tileRect)
+{
+    // Draw tiles rendered at the previous zoom, scaled, while the tile for the
+    // current zoom is being rendered
+    const qreal previousZoom = mTileCache->previousZoom();
+    if (previousZoom <= 0) {
+        return;
+    }
+    const qreal ratio = previousZoom / zoom();
+    const QRectF previousRect(QPointF(tileRect.topLeft()) * ratio, QSizeF(tileRect.size()) * ratio);
+    const int tileSize = SvgTileCache::tileSize();
+
+    painter->save();
+    painter->setClipRect(tileRect.translated(imageOrigin()));
+    painter->translate(imageOrigin());
+    painter->scale(1 / ratio, 1 / ratio);
+    for (int row = int(previousRect.top()) / tileSize; row <= int(previousRect.bottom()) / tileSize; ++row) {
+        for (int column = int(previousRect.left()) / tileSize; column <= int(previousRect.right()) / tileSize; ++column) {
+            const QImage tile = mTileCache->previousTile(column, row);
+            if (!tile.isNull()) {
+                painter->drawImage(QPoint(column * tileSize, row * tileSize), tile);
+            }
+        }
+    }
+    painter->restore();
+}
+
 void SvgImageView::paint(QPainter* painter, const QStyleOptionGraphicsItem* /*option*/, QWidget* /*widget*/)
 {
-    if (mImageFullyLoaded) {
-        drawAlphaBackground(painter);
+    if (!mImageFullyLoaded) {
+        return;
+    }
+    drawAlphaBackground(painter);
+
+    // Visible part of the image, in zoomed image coordinates
+    const QPoint origin = imageOrigin();
+    const QRect imageRect(QPoint(0, 0), (documentSize() * zoom()).toSize());
+    const QRect visibleRect = boundingRect().toAlignedRect().translated(-origin).intersected(imageRect);
+    if (visibleRect.isEmpty()) {
+        return;
+    }
+
+    const int tileSize = SvgTileCache::tileSize();
+    for (int row = visibleRect.top() / tileSize; row <= visibleRect.bottom() / tileSize; ++row) {
+        for (int column = visibleRect.left() / tileSize; column <= visibleRect.right() / tileSize; ++column) {
+            const QImage tile = mTileCache->tile(column, row);
+            const QPoint tilePos(column * tileSize, row * tileSize);
+            if (tile.isNull()) {
+                drawPlaceholder(painter, QRect(tilePos, QSize(tileSize, tileSize)).intersected(imageRect));
+            } else {
+                painter->drawImage(origin + tilePos, tile);
+            }
+        }
     }
 }
 
@@ -32,11 +32,11 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #include <lib/documentview/abstractimageview.h>
 #include <lib/documentview/abstractdocumentviewadapter.h>
 
-class QGraphicsSvgItem;
-
 namespace Gwenview
 {
 
+class SvgTileCache;
+
 class SvgImageView : public AbstractImageView
 {
     Q_OBJECT
@@ -53,15 +53,17 @@ protected:
 
 private Q_SLOTS:
     void finishLoadFromDocument();
+    void onTileReady(const QRect& rect);
 
 private:
-    QGraphicsSvgItem* mSvgItem;
+    SvgTileCache* mTileCache;
     AbstractImageView::AlphaBackgroundMode mAlphaBackgroundMode;
     QColor mAlphaBackgroundColor;
     bool mImageFullyLoaded;
 
-    void adjustItemPos();
+    QPoint imageOrigin() const;
     void drawAlphaBackground(QPainter* painter);
+    void drawPlaceholder(QPainter* painter, const QRect& tileRect);
     void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget) override;
 };
 
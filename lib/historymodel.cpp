@@ -25,10 +25,12 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #include <QDir>
 #include <QFile>
 #include <QDebug>
+#include <QLockFile>
 #include <QUrl>
 #include <QMimeDatabase>
-#include <QTemporaryFile>
 #include <QRegularExpression>
+#include <QSaveFile>
+#include <QTimer>
 
 // KDE
 #include <KConfig>
@@ -45,36 +47,38 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 namespace Gwenview
 {
 
+static const char JOURNAL_FILE_NAME[] = "history";
+
+// How long to wait for more changes before writing them to the journal
+static const int FLUSH_DELAY = 1000;
+
+// The journal is compacted at load time when it contains more than this
+// number of obsolete lines
+static const int MAX_OBSOLETE_LINE_COUNT = 64;
+
 struct HistoryItem : public QStandardItem
 {
-    void save() const
-    {
-        KConfig config(mConfigPath, KConfig::SimpleConfig);
-        KConfigGroup group(&config, "general");
-        group.writeEntry("url", mUrl.toString());
-        group.writeEntry("dateTime", mDateTime.toString(Qt::ISODate));
-        config.sync();
-    }
+    HistoryItem(const QUrl &url, const QDateTime& dateTime)
+        : mUrl(url)
+        , mDateTime(dateTime)
+        , mDetailsLoaded(false) {
 
-    static HistoryItem* create(const QUrl &url, const QDateTime& dateTime, const QString& storageDir)
-    {
-        if (!QDir().mkpath(storageDir)) {
-            qCritical() << "Could not create history dir" << storageDir;
-            return nullptr;
-        }
-        QTemporaryFile file(storageDir + QStringLiteral("/gvhistoryXXXXXXrc"));
-        file.setAutoRemove(false);
-        if (!file.open()) {
-            qCritical() << "Could not create history file";
-            return nullptr;
+        QString text(mUrl.toDisplayString(QUrl::PreferLocalFile));
+#ifdef Q_OS_UNIX
+        // shorten home directory, but avoid showing a cryptic "~/"
+        if (text.length() > QDir::homePath().length() + 1) {
+            text.replace(QRegularExpression('^' + QDir::homePath()), QStringLiteral("~"));
         }
-
-        HistoryItem* item = new HistoryItem(url, dateTime, file.fileName());
-        item->save();
-        return item;
+#endif
+        setText(text);
+        setData(mUrl, KFilePlacesModel::UrlRole);
     }
 
-    static HistoryItem* load(const QString& fileName)
+    /**
+     * Reads an item stored in its own KConfig file, as done by previous
+     * versions
+     */
+    static HistoryItem* loadLegacy(const QString& fileName)
     {
         KConfig config(fileName, KConfig::SimpleConfig);
         KConfigGroup group(&config, "general");
@@ -90,7 +94,7 @@ struct HistoryItem : public QStandardItem
             return nullptr;
         }
 
-        return new HistoryItem(url, dateTime, fileName);
+        return new HistoryItem(url, dateTime);
     }
 
     QUrl url() const
@@ -105,47 +109,51 @@ struct HistoryItem : public QStandardItem
 
     void setDateTime(const QDateTime& dateTime)
     {
-        if (mDateTime != dateTime) {
-            mDateTime = dateTime;
-            save();
-        }
+        mDateTime = dateTime;
+        emitDataChanged();
     }
 
-    void unlink()
+    QByteArray journalLine() const
     {
-        QFile::remove(mConfigPath);
+        return "+ " + mDateTime.toString(Qt::ISODate).toLatin1() + ' ' + mUrl.toEncoded();
+    }
+
+    // Icon and file item are only resolved when a view asks for them: this
+    // requires a mime type lookup and a stat() per item
+    QVariant data(int role) const override
+    {
+        switch (role) {
+        case Qt::DecorationRole:
+            loadDetails();
+            return mIcon;
+        case KDirModel::FileItemRole:
+            loadDetails();
+            return QVariant(mFileItem);
+        case Qt::ToolTipRole: {
+            const QString date = KFormat().formatRelativeDateTime(mDateTime, QLocale::LongFormat);
+            return i18n("Last visited: %1", date);
+        }
+        default:
+            return QStandardItem::data(role);
+        }
     }
 
 private:
     QUrl mUrl;
     QDateTime mDateTime;
-    QString mConfigPath;
-
-    HistoryItem(const QUrl &url, const QDateTime& dateTime, const QString& configPath)
-        : mUrl(url)
-        , mDateTime(dateTime)
-        , mConfigPath(configPath) {
+    mutable bool mDetailsLoaded;
+    mutable QIcon mIcon;
+    mutable KFileItem mFileItem;
 
-        QString text(mUrl.toDisplayString(QUrl::PreferLocalFile));
-#ifdef Q_OS_UNIX
-        // shorten home directory, but avoid showing a cryptic "~/"
-        if (text.length() > QDir::homePath().length() + 1) {
-            text.replace(QRegularExpression('^' + QDir::homePath()), QStringLiteral("~"));
+    void loadDetails() const
+    {
+        if (mDetailsLoaded) {
+            return;
         }
-#endif
-        setText(text);
-
+        mDetailsLoaded = true;
         QMimeDatabase db;
-        const QString iconName = db.mimeTypeForUrl(mUrl).iconName();
-        setIcon(QIcon::fromTheme(iconName));
-
-        setData(mUrl, KFilePlacesModel::UrlRole);
-
-        KFileItem fileItem(mUrl);
-        setData(QVariant(fileItem), KDirModel::FileItemRole);
-
-        const QString date = KFormat().formatRelativeDateTime(mDateTime, QLocale::LongFormat);
-        setData(i18n("Last visited: %1", date), Qt::ToolTipRole);
+        mIcon = QIcon::fromTheme(db.mimeTypeForUrl(mUrl).iconName());
+        mFileItem = KFileItem(mUrl);
     }
 
     bool operator<(const QStandardItem& other) const override {
@@ -153,6 +161,19 @@ private:
     }
 };
 
+/**
+ * History is stored in a single journal file. Each line either adds or
+ * updates a url:
+ *
+ *     + <ISO date time> <encoded url>
+ *
+ * or removes it:
+ *
+ *     - <encoded url>
+ *
+ * Changes are appended in batches. The journal is rewritten at load time
+ * when it contains too many obsolete lines.
+ */
 struct HistoryModelPrivate
 {
     HistoryModel* q;
@@ -161,51 +182,160 @@ struct HistoryModelPrivate
 
     QMap<QUrl, HistoryItem*> mHistoryItemForUrl;
 
+    QList<QByteArray> mPendingLines;
+    QTimer mFlushTimer;
+
+    QString journalPath() const
+    {
+        return QDir(mStorageDir).filePath(QLatin1String(JOURNAL_FILE_NAME));
+    }
+
+    QString lockPath() const
+    {
+        return journalPath() + QStringLiteral(".lock");
+    }
+
+    void addItem(HistoryItem* item)
+    {
+        HistoryItem* existingItem = mHistoryItemForUrl.value(item->url());
+        if (existingItem) {
+            // We already know this url(!) update existing item dateTime
+            // and get rid of duplicate
+            if (existingItem->dateTime() < item->dateTime()) {
+                existingItem->setDateTime(item->dateTime());
+            }
+            delete item;
+        } else {
+            mHistoryItemForUrl.insert(item->url(), item);
+            q->appendRow(item);
+        }
+    }
+
     void load()
     {
         QDir dir(mStorageDir);
         if (!dir.exists()) {
             return;
         }
-        Q_FOREACH(const QString & name, dir.entryList(QStringList() << QStringLiteral("*rc"))) {
-            HistoryItem* item = HistoryItem::load(dir.filePath(name));
-            if (!item) {
-                continue;
-            }
-
-            QUrl itemUrl = item->url();
-            if (UrlUtils::urlIsFastLocalFile(itemUrl)) {
-                if (!QFile::exists(itemUrl.path())) {
-                    qDebug() << "Removing" << itemUrl.path() << "from recent folders. It does not exist anymore";
-                    item->unlink();
-                    delete item;
+        QLockFile lock(lockPath());
+        lock.lock();
+
+        QMap<QUrl, QDateTime> dateTimeForUrl;
+        int lineCount = 0;
+        QFile file(journalPath());
+        if (file.open(QIODevice::ReadOnly)) {
+            while (!file.atEnd()) {
+                const QByteArray line = file.readLine().trimmed();
+                if (line.isEmpty()) {
                     continue;
                 }
+                ++lineCount;
+                if (line.startsWith("+ ")) {
+                    const int urlPos = line.indexOf(' ', 2);
+                    if (urlPos == -1) {
+                        qWarning() << "Invalid history line" << line;
+                        continue;
+                    }
+                    const QDateTime dateTime = QDateTime::fromString(QString::fromLatin1(line.mid(2, urlPos - 2)), Qt::ISODate);
+                    const QUrl url = QUrl::fromEncoded(line.mid(urlPos + 1));
+                    if (!dateTime.isValid() || !url.isValid()) {
+                        qWarning() << "Invalid history line" << line;
+                        continue;
+                    }
+                    dateTimeForUrl[url] = dateTime;
+                } else if (line.startsWith("- ")) {
+                    dateTimeForUrl.remove(QUrl::fromEncoded(line.mid(2)));
+                } else {
+                    qWarning() << "Invalid history line" << line;
+                }
             }
+            file.close();
+        }
+        for (auto it = dateTimeForUrl.constBegin(); it != dateTimeForUrl.constEnd(); ++it) {
+            addItem(new HistoryItem(it.key(), it.value()));
+        }
 
-            HistoryItem* existingItem = mHistoryItemForUrl.value(item->url());
-            if (existingItem) {
-                // We already know this url(!) update existing item dateTime
-                // and get rid of duplicate
-                if (existingItem->dateTime() < item->dateTime()) {
-                    existingItem->setDateTime(item->dateTime());
-                }
-                item->unlink();
-                delete item;
-            } else {
-                mHistoryItemForUrl.insert(item->url(), item);
-                q->appendRow(item);
+        // Import files written by previous versions
+        bool needsRewrite = lineCount - dateTimeForUrl.count() > MAX_OBSOLETE_LINE_COUNT;
+        Q_FOREACH(const QString & name, dir.entryList(QStringList() << QStringLiteral("gvhistory*rc"))) {
+            const QString path = dir.filePath(name);
+            HistoryItem* item = HistoryItem::loadLegacy(path);
+            if (item) {
+                addItem(item);
             }
+            QFile::remove(path);
+            needsRewrite = true;
         }
         q->sort(0);
+
+        if (needsRewrite) {
+            rewriteJournal();
+        }
+    }
+
+    /**
+     * Replaces the journal with one line per item. Must be called with the
+     * lock held.
+     */
+    void rewriteJournal()
+    {
+        QSaveFile file(journalPath());
+        if (!file.open(QIODevice::WriteOnly)) {
+            qCritical() << "Could not write history to" << file.fileName();
+            return;
+        }
+        for (int row = 0; row < q->rowCount(); ++row) {
+            const HistoryItem* item = static_cast<const HistoryItem*>(q->item(row, 0));
+            file.write(item->journalLine() + '\n');
+        }
+        if (!file.commit()) {
+            qCritical() << "Could not write history to" << file.fileName();
+        }
+    }
+
+    void appendLine(const QByteArray& line)
+    {
+        mPendingLines << line;
+        if (!mFlushTimer.isActive()) {
+            mFlushTimer.start();
+        }
+    }
+
+    void flush()
+    {
+        mFlushTimer.stop();
+        if (mPendingLines.isEmpty()) {
+            return;
+        }
+        if (!QDir().mkpath(mStorageDir)) {
+            qCritical() << "Could not create history dir" << mStorageDir;
+            return;
+        }
+        QByteArray data;
+        for (const QByteArray& line : mPendingLines) {
+            data += line + '\n';
+        }
+        mPendingLines.clear();
+
+        QLockFile lock(lockPath());
+        lock.lock();
+        QFile file(journalPath());
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Append) || file.write(data) != data.size()) {
+            qCritical() << "Could not write history to" << file.fileName();
+        }
+    }
+
+    void removeItem(HistoryItem* item)
+    {
+        mHistoryItemForUrl.remove(item->url());
+        appendLine("- " + item->url().toEncoded());
     }
 
     void garbageCollect()
     {
         while (q->rowCount() > mMaxCount) {
             HistoryItem* item = static_cast<HistoryItem*>(q->takeRow(q->rowCount() - 1).at(0));
-            mHistoryItemForUrl.remove(item->url());
-            item->unlink();
+            removeItem(item);
             delete item;
         }
     }
@@ -218,11 +348,17 @@ HistoryModel::HistoryModel(QObject* parent, const QString& storageDir, int maxCo
     d->q = this;
     d->mStorageDir = storageDir;
     d->mMaxCount = maxCount;
+    d->mFlushTimer.setInterval(FLUSH_DELAY);
+    d->mFlushTimer.setSingleShot(true);
+    connect(&d->mFlushTimer, &QTimer::timeout, this, [this]() {
+        d->flush();
+    });
     d->load();
 }
 
 HistoryModel::~HistoryModel()
 {
+    d->flush();
     delete d;
 }
 
@@ -231,29 +367,40 @@ void HistoryModel::addUrl(const QUrl &url, const QDateTime& _dateTime)
     QDateTime dateTime = _dateTime.isValid() ? _dateTime : QDateTime::currentDateTime();
     HistoryItem* historyItem = d->mHistoryItemForUrl.value(url);
     if (historyItem) {
+        if (historyItem->dateTime() == dateTime) {
+            return;
+        }
         historyItem->setDateTime(dateTime);
+        d->appendLine(historyItem->journalLine());
         sort(0);
     } else {
-        historyItem = HistoryItem::create(url, dateTime, d->mStorageDir);
-        if (!historyItem) {
-            qCritical() << "Could not save history for url" << url;
-            return;
-        }
+        historyItem = new HistoryItem(url, dateTime);
         d->mHistoryItemForUrl.insert(url, historyItem);
+        d->appendLine(historyItem->journalLine());
         appendRow(historyItem);
         sort(0);
         d->garbageCollect();
     }
 }
 
+void HistoryModel::removeMissingUrls()
+{
+    for (int row = rowCount() - 1; row >= 0; --row) {
+        const QUrl url = static_cast<HistoryItem*>(item(row, 0))->url();
+        if (UrlUtils::urlIsFastLocalFile(url) && !QFile::exists(url.path())) {
+            qDebug() << "Removing" << url.path() << "from recent folders. It does not exist anymore";
+            removeRow(row);
+        }
+    }
+}
+
 bool HistoryModel::removeRows(int start, int count, const QModelIndex& parent)
 {
     Q_ASSERT(!parent.isValid());
     for (int row = start + count - 1; row >= start ; --row) {
         HistoryItem* historyItem = static_cast<HistoryItem*>(item(row, 0));
         Q_ASSERT(historyItem);
-        d->mHistoryItemForUrl.remove(historyItem->url());
-        historyItem->unlink();
+        d->removeItem(historyItem);
     }
     return QStandardItemModel::removeRows(start, count, parent);
 }
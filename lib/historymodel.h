@@ -39,7 +39,8 @@ struct HistoryModelPrivate;
 /**
  * A model which maintains a list of urls in the dir specified by the
  * storageDir parameter of its ctor.
- * Each url is stored in a separate KConfig file to avoid concurrency issues.
+ * Urls are stored in a single journal file. Changes are appended to it in
+ * batches, under a lock file to avoid concurrency issues.
  */
 class GWENVIEWLIB_EXPORT HistoryModel : public QStandardItemModel
 {
@@ -50,6 +51,12 @@ public:
 
     void addUrl(const QUrl&, const QDateTime& dateTime = QDateTime());
 
+    /**
+     * Removes local urls which do not exist anymore. This is not done at
+     * load time, to avoid stat'ing all urls until the model is shown.
+     */
+    void removeMissingUrls();
+
     bool removeRows(int row, int count, const QModelIndex& parent = QModelIndex()) override;
 
 private:
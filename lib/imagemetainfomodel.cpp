@@ -23,9 +23,11 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 #include "config-gwenview.h"
 
 // Qt
+#include <QSet>
 #include <QSize>
 #include <QDebug>
 #include <QLocale>
+#include <QVector>
 
 // KDE
 #include <KFileItem>
@@ -68,6 +70,9 @@ public:
     class Entry
     {
     public:
+        Entry()
+        {}
+
         Entry(const QString& key, const QString& label, const QString& value)
             : mKey(key), mLabel(label.trimmed()), mValue(value.trimmed())
         {}
@@ -203,6 +208,17 @@ struct ImageMetaInfoModelPrivate
     QVector<MetaInfoGroup*> mMetaInfoGroupVector;
     ImageMetaInfoModel* q;
 
+    // Exiv2 groups are only filled when a view asks for their rows through
+    // fetchMore(). Until then their data is kept here and the keys asked
+    // through getInfoForKey() are resolved one by one.
+    QSet<int> mPendingGroups;
+    Exiv2::ExifData mExifData;
+    Exiv2::IptcData mIptcData;
+    Exiv2::XmpData mXmpData;
+    typedef QHash<QString, QVector<const Exiv2::Metadatum*> > DatumHash;
+    mutable QHash<int, DatumHash> mDatumHashForGroup;
+    mutable QHash<QString, MetaInfoGroup::Entry> mResolvedEntries;
+
     void clearGroup(MetaInfoGroup* group, const QModelIndex& parent)
     {
         if (group->size() > 0) {
@@ -258,6 +274,27 @@ struct ImageMetaInfoModelPrivate
         group->addEntry(QStringLiteral("General.Comment"), i18nc("@item:intable", "Comment"), QString());
     }
 
+    // Returns false if the datum must not be shown
+    template <class Datum>
+    static bool readDatum(const Datum& datum, QString* key, QString* label, QString* value)
+    {
+        try {
+            // Skip metadatum if its tag is an hex number
+            if (datum.tagName().substr(0, 2) == "0x") {
+                return false;
+            }
+            *key = QString::fromUtf8(datum.key().c_str());
+            *label = QString::fromLocal8Bit(datum.tagLabel().c_str());
+            std::ostringstream stream;
+            stream << datum;
+            *value = QString::fromLocal8Bit(stream.str().c_str());
+        } catch (const Exiv2::Error& error) {
+            qWarning() << "Failed to read some meta info:" << error.what();
+            return false;
+        }
+        return true;
+    }
+
     template <class Container, class Iterator>
     void fillExivGroup(const QModelIndex& parent, MetaInfoGroup* group, const Container& container)
     {
@@ -273,25 +310,15 @@ struct ImageMetaInfoModelPrivate
         end = container.end();
 
         for (; it != end; ++it) {
-            try {
-                // Skip metadatum if its tag is an hex number
-                if (it->tagName().substr(0, 2) == "0x") {
-                    continue;
-                }
-                QString key = QString::fromUtf8(it->key().c_str());
-                QString label = QString::fromLocal8Bit(it->tagLabel().c_str());
-                std::ostringstream stream;
-                stream << *it;
-                QString value = QString::fromLocal8Bit(stream.str().c_str());
-
-                EntryHash::iterator hashIt = hash.find(key);
-                if (hashIt != hash.end()) {
-                    hashIt.value()->appendValue(value);
-                } else {
-                    hash.insert(key, new MetaInfoGroup::Entry(key, label, value));
-                }
-            } catch (const Exiv2::Error& error) {
-                qWarning() << "Failed to read some meta info:" << error.what();
+            QString key, label, value;
+            if (!readDatum(*it, &key, &label, &value)) {
+                continue;
+            }
+            EntryHash::iterator hashIt = hash.find(key);
+            if (hashIt != hash.end()) {
+                hashIt.value()->appendValue(value);
+            } else {
+                hash.insert(key, new MetaInfoGroup::Entry(key, label, value));
             }
         }
 
@@ -304,6 +331,107 @@ struct ImageMetaInfoModelPrivate
         }
         q->endInsertRows();
     }
+
+    /**
+     * Returns the data of the pending group @p groupRow, by key. The hash is
+     * built the first time a key of the group is asked for, without
+     * formatting any value.
+     */
+    const DatumHash& datumHashForGroup(int groupRow) const
+    {
+        QHash<int, DatumHash>::const_iterator it = mDatumHashForGroup.constFind(groupRow);
+        if (it != mDatumHashForGroup.constEnd()) {
+            return it.value();
+        }
+        DatumHash hash;
+        switch (groupRow) {
+        case ExifGroup:
+            hash = createDatumHash(mExifData);
+            break;
+        case IptcGroup:
+            hash = createDatumHash(mIptcData);
+            break;
+        case XmpGroup:
+            hash = createDatumHash(mXmpData);
+            break;
+        default:
+            break;
+        }
+        return mDatumHashForGroup.insert(groupRow, hash).value();
+    }
+
+    template <class Container>
+    static DatumHash createDatumHash(const Container& container)
+    {
+        DatumHash hash;
+        for (const Exiv2::Metadatum& datum : container) {
+            hash[QString::fromUtf8(datum.key().c_str())] << &datum;
+        }
+        return hash;
+    }
+
+    /**
+     * Returns the entry for @p key, built from the data of a group which has
+     * not been filled yet, or an entry with an empty key if there is none
+     */
+    const MetaInfoGroup::Entry& pendingEntryForKey(int groupRow, const QString& key) const
+    {
+        QHash<QString, MetaInfoGroup::Entry>::const_iterator it = mResolvedEntries.constFind(key);
+        if (it != mResolvedEntries.constEnd()) {
+            return it.value();
+        }
+        MetaInfoGroup::Entry entry;
+        Q_FOREACH(const Exiv2::Metadatum* datum, datumHashForGroup(groupRow).value(key)) {
+            QString datumKey, label, value;
+            if (!readDatum(*datum, &datumKey, &label, &value)) {
+                continue;
+            }
+            if (entry.key().isEmpty()) {
+                entry = MetaInfoGroup::Entry(key, label, value);
+            } else {
+                entry.appendValue(value);
+            }
+        }
+        // Also store missing keys, so that they are not looked up again
+        return mResolvedEntries.insert(key, entry).value();
+    }
+
+    void fillPendingGroup(int groupRow)
+    {
+        if (!mPendingGroups.remove(groupRow)) {
+            return;
+        }
+        // It points to the data cleared below
+        mDatumHashForGroup.remove(groupRow);
+        const QModelIndex parent = q->index(groupRow, 0);
+        MetaInfoGroup* group = mMetaInfoGroupVector[groupRow];
+        switch (groupRow) {
+        case ExifGroup:
+            fillExivGroup<Exiv2::ExifData, Exiv2::ExifData::const_iterator>(parent, group, mExifData);
+            mExifData.clear();
+            break;
+        case IptcGroup:
+            fillExivGroup<Exiv2::IptcData, Exiv2::IptcData::const_iterator>(parent, group, mIptcData);
+            mIptcData.clear();
+            break;
+        case XmpGroup:
+            fillExivGroup<Exiv2::XmpData, Exiv2::XmpData::const_iterator>(parent, group, mXmpData);
+            mXmpData.clear();
+            break;
+        default:
+            break;
+        }
+    }
+
+    void clearPendingGroups()
+    {
+        mPendingGroups.clear();
+        mExifData.clear();
+        mIptcData.clear();
+        mXmpData.clear();
+        mDatumHashForGroup.clear();
+        mResolvedEntries.clear();
+    }
 };
 
 ImageMetaInfoModel::ImageMetaInfoModel()
@@ -432,6 +560,7 @@ void ImageMetaInfoModel::setExiv2Image(const Exiv2::Image* image)
     d->clearGroup(exifGroup, exifIndex);
     d->clearGroup(iptcGroup, iptcIndex);
     d->clearGroup(xmpGroup,  xmpIndex);
+    d->clearPendingGroups();
 
     if (!image) {
         return;
@@ -439,42 +568,61 @@ void ImageMetaInfoModel::setExiv2Image(const Exiv2::Image* image)
 
     d->setGroupEntryValue(GeneralGroup, QStringLiteral("General.Comment"), QString::fromUtf8(image->comment().c_str()));
 
-    if (image->checkMode(Exiv2::mdExif) & Exiv2::amRead) {
-        const Exiv2::ExifData& exifData = image->exifData();
-        d->fillExivGroup<Exiv2::ExifData, Exiv2::ExifData::const_iterator>(exifIndex, exifGroup, exifData);
+    // Formatting all the values is expensive, especially for images with
+    // large maker notes, so groups are only filled when requested, see
+    // fetchMore()
+    if ((image->checkMode(Exiv2::mdExif) & Exiv2::amRead) && !image->exifData().empty()) {
+        d->mExifData = image->exifData();
+        d->mPendingGroups.insert(ExifGroup);
+    }
+
+    if ((image->checkMode(Exiv2::mdIptc) & Exiv2::amRead) && !image->iptcData().empty()) {
+        d->mIptcData = image->iptcData();
+        d->mPendingGroups.insert(IptcGroup);
     }
 
-    if (image->checkMode(Exiv2::mdIptc) & Exiv2::amRead) {
-        const Exiv2::IptcData& iptcData = image->iptcData();
-        d->fillExivGroup<Exiv2::IptcData, Exiv2::IptcData::const_iterator>(iptcIndex, iptcGroup, iptcData);
+    if ((image->checkMode(Exiv2::mdXmp) & Exiv2::amRead) && !image->xmpData().empty()) {
+        d->mXmpData = image->xmpData();
+        d->mPendingGroups.insert(XmpGroup);
     }
 
-    if (image->checkMode(Exiv2::mdXmp) & Exiv2::amRead) {
-        const Exiv2::XmpData& xmpData = image->xmpData();
-        d->fillExivGroup<Exiv2::XmpData, Exiv2::XmpData::const_iterator>(xmpIndex, xmpGroup, xmpData);
+    // No rows are inserted, but views must know the groups can now be
+    // fetched: the Exiv2 image may be set after they have been populated
+    Q_FOREACH(int groupRow, d->mPendingGroups) {
+        const QModelIndex groupIndex = index(groupRow, 0);
+        emit dataChanged(groupIndex, groupIndex);
     }
 }
 
 void ImageMetaInfoModel::getInfoForKey(const QString& key, QString* label, QString* value) const
 {
-    MetaInfoGroup* group;
+    GroupRow groupRow;
     if (key.startsWith(QLatin1String("General"))) {
-        group = d->mMetaInfoGroupVector[GeneralGroup];
+        groupRow = GeneralGroup;
     } else if (key.startsWith(QLatin1String("Exif"))) {
-        group = d->mMetaInfoGroupVector[ExifGroup];
+        groupRow = ExifGroup;
 #ifdef HAVE_FITS
     } else if (key.startsWith(QLatin1String("Fits"))) {
-        group = d->mMetaInfoGroupVector[FitsGroup];
+        groupRow = FitsGroup;
 #endif
     } else if (key.startsWith(QLatin1String("Iptc"))) {
-        group = d->mMetaInfoGroupVector[IptcGroup];
+        groupRow = IptcGroup;
     } else if (key.startsWith(QLatin1String("Xmp"))) {
-        group = d->mMetaInfoGroupVector[XmpGroup];
+        groupRow = XmpGroup;
     } else {
         qWarning() << "Unknown metainfo key" << key;
         return;
     }
-    group->getInfoForKey(key, label, value);
+
+    if (d->mPendingGroups.contains(groupRow)) {
+        const MetaInfoGroup::Entry& entry = d->pendingEntryForKey(groupRow, key);
+        if (!entry.key().isEmpty()) {
+            *label = entry.label();
+            *value = entry.value();
+        }
+        return;
+    }
+    d->mMetaInfoGroupVector[groupRow]->getInfoForKey(key, label, value);
 }
 
 QString ImageMetaInfoModel::getValueForKey(const QString& key) const
@@ -537,6 +685,30 @@ int ImageMetaInfoModel::rowCount(const QModelIndex& parent) const
     }
 }
 
+bool ImageMetaInfoModel::hasChildren(const QModelIndex& parent) const
+{
+    if (!parent.isValid()) {
+        return true;
+    } else if (parent.internalId() == NoGroup) {
+        return d->mMetaInfoGroupVector[parent.row()]->size() > 0 || d->mPendingGroups.contains(parent.row());
+    } else {
+        return false;
+    }
+}
+
+bool ImageMetaInfoModel::canFetchMore(const QModelIndex& parent) const
+{
+    return parent.isValid() && parent.internalId() == NoGroup && d->mPendingGroups.contains(parent.row());
+}
+
+void ImageMetaInfoModel::fetchMore(const QModelIndex& parent)
+{
+    if (!canFetchMore(parent)) {
+        return;
+    }
+    d->fillPendingGroup(parent.row());
+}
+
 int ImageMetaInfoModel::columnCount(const QModelIndex& /*parent*/) const
 {
     return 2;
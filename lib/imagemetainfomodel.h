@@ -41,6 +41,16 @@ namespace Gwenview
 {
 
 struct ImageMetaInfoModelPrivate;
+/**
+ * A model of the meta information of an image, grouped in General, Exif,
+ * IPTC and XMP groups.
+ *
+ * Exif, IPTC and XMP groups are filled lazily: their rows are only created
+ * when a view calls fetchMore() on them. getInfoForKey() does not need the
+ * rows, it resolves the requested key directly.
+ *
+ * setExiv2Image() emits dataChanged() for the groups which can be fetched.
+ */
 class GWENVIEWLIB_EXPORT ImageMetaInfoModel : public QAbstractItemModel
 {
     Q_OBJECT
@@ -59,6 +69,9 @@ public:
     QModelIndex index(int row, int col, const QModelIndex& parent = QModelIndex()) const override;
     QModelIndex parent(const QModelIndex&) const override;
     int rowCount(const QModelIndex& = QModelIndex()) const override;
+    bool hasChildren(const QModelIndex& parent = QModelIndex()) const override;
+    bool canFetchMore(const QModelIndex& parent) const override;
+    void fetchMore(const QModelIndex& parent) override;
     int columnCount(const QModelIndex& = QModelIndex()) const override;
     QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
     QVariant data(const QModelIndex&, int role = Qt::DisplayRole) const override;
@@ -20,8 +20,14 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "imagescaler.h"
 
 // Qt
+#include <QCoreApplication>
+#include <QEvent>
+#include <QHash>
 #include <QImage>
+#include <QPointer>
 #include <QRegion>
+#include <QVector>
+#include <QtConcurrentMap>
 #include <QDebug>
 
 // KDE
@@ -29,6 +35,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 // Local
 #include <lib/document/document.h>
 #include <lib/paintutils.h>
+#include <lib/trace.h>
 
 #undef ENABLE_LOG
 #undef LOG
@@ -45,12 +52,236 @@ namespace Gwenview
 // Amount of pixels to keep so that smooth scale is correct
 static const int SMOOTH_MARGIN = 3;
 
+/**
+ * Everything needed to scale one rect. Filled in the GUI thread, run() can
+ * then be called from any thread.
+ */
+struct ScalingTask
+{
+    ScalingTask()
+    : mZoom(1)
+    , mCopyOnly(false)
+    , mTransformationMode(Qt::FastTransformation)
+    , mDone(false)
+    {}
+
+    QImage mSource;
+    // Zoom to apply to mSource
+    qreal mZoom;
+    bool mCopyOnly;
+    Qt::TransformationMode mTransformationMode;
+    QRect mRect;
+    ImageScaler::PostProcess mPostProcess;
+    QByteArray mPostProcessKey;
+
+    // Results
+    bool mDone;
+    QPoint mPos;
+    QImage mResult;
+
+    QByteArray key() const
+    {
+        return QByteArray::number(mSource.cacheKey())
+            + ' ' + QByteArray::number(mZoom, 'g', 17)
+            + ' ' + QByteArray::number(int(mCopyOnly))
+            + ' ' + QByteArray::number(int(mTransformationMode))
+            + ' ' + QByteArray::number(mRect.x()) + ',' + QByteArray::number(mRect.y())
+            + ' ' + QByteArray::number(mRect.width()) + 'x' + QByteArray::number(mRect.height())
+            + ' ' + mPostProcessKey;
+    }
+
+    void run()
+    {
+        GV_TRACE_SPAN("ImageScaler::scaleRect");
+        if (mCopyOnly) {
+            mResult = mSource.copy(mRect);
+            mPos = mRect.topLeft();
+        } else if (!scale()) {
+            return;
+        }
+        if (mPostProcess) {
+            mPostProcess(mResult);
+        }
+        mDone = true;
+    }
+
+    bool scale()
+    {
+        const QImage& image = mSource;
+        const qreal zoom = mZoom;
+        const QRect& rect = mRect;
+        // If rect contains "half" pixels, make sure sourceRect includes them
+        QRectF sourceRectF(
+            rect.left() / zoom,
+            rect.top() / zoom,
+            rect.width() / zoom,
+            rect.height() / zoom);
+
+        sourceRectF = sourceRectF.intersected(image.rect());
+        QRect sourceRect = PaintUtils::containingRect(sourceRectF);
+        if (sourceRect.isEmpty()) {
+            return false;
+        }
+
+        // Compute smooth margin
+        bool needsSmoothMargins = mTransformationMode == Qt::SmoothTransformation;
+
+        int sourceLeftMargin, sourceRightMargin, sourceTopMargin, sourceBottomMargin;
+        int destLeftMargin, destRightMargin, destTopMargin, destBottomMargin;
+        if (needsSmoothMargins) {
+            sourceLeftMargin = qMin(sourceRect.left(), SMOOTH_MARGIN);
+            sourceTopMargin = qMin(sourceRect.top(), SMOOTH_MARGIN);
+            sourceRightMargin = qMin(image.rect().right() - sourceRect.right(), SMOOTH_MARGIN);
+            sourceBottomMargin = qMin(image.rect().bottom() - sourceRect.bottom(), SMOOTH_MARGIN);
+            sourceRect.adjust(
+                -sourceLeftMargin,
+                -sourceTopMargin,
+                sourceRightMargin,
+                sourceBottomMargin);
+            destLeftMargin = int(sourceLeftMargin * zoom);
+            destTopMargin = int(sourceTopMargin * zoom);
+            destRightMargin = int(sourceRightMargin * zoom);
+            destBottomMargin = int(sourceBottomMargin * zoom);
+        } else {
+            sourceLeftMargin = sourceRightMargin = sourceTopMargin = sourceBottomMargin = 0;
+            destLeftMargin = destRightMargin = destTopMargin = destBottomMargin = 0;
+        }
+
+        // destRect is almost like rect, but it contains only "full" pixels
+        QRectF destRectF = QRectF(
+                               sourceRect.left() * zoom,
+                               sourceRect.top() * zoom,
+                               sourceRect.width() * zoom,
+                               sourceRect.height() * zoom
+                           );
+        QRect destRect = PaintUtils::containingRect(destRectF);
+
+        QImage tmp;
+        tmp = image.copy(sourceRect);
+        tmp = tmp.scaled(
+                  destRect.width(),
+                  destRect.height(),
+                  Qt::IgnoreAspectRatio, // Do not use KeepAspectRatio, it can lead to skipped rows or columns
+                  mTransformationMode);
+
+        if (needsSmoothMargins) {
+            tmp = tmp.copy(
+                      destLeftMargin, destTopMargin,
+                      destRect.width() - (destLeftMargin + destRightMargin),
+                      destRect.height() - (destTopMargin + destBottomMargin)
+                  );
+        }
+
+        mResult = tmp;
+        mPos = QPoint(destRect.left() + destLeftMargin, destRect.top() + destTopMargin);
+        return true;
+    }
+};
+
+struct ScalingTaskRunner
+{
+    void operator()(ScalingTask& task) const
+    {
+        task.run();
+    }
+};
+
+/**
+ * Collects the tasks of all batched scalers until control goes back to the
+ * event loop, then runs them in parallel and delivers all the results in a
+ * row, so that views get updated in the same frame.
+ */
+class ScalingBatch : public QObject
+{
+public:
+    static ScalingBatch* instance()
+    {
+        static ScalingBatch batch;
+        return &batch;
+    }
+
+    void addTasks(ImageScaler* scaler, const QVector<ScalingTask>& tasks)
+    {
+        for (const ScalingTask& task : tasks) {
+            mPendingTasks << qMakePair(QPointer<ImageScaler>(scaler), task);
+        }
+        if (!mFlushScheduled) {
+            mFlushScheduled = true;
+            // Posted events are processed before the low priority update
+            // requests, so the results are ready when views are painted
+            QCoreApplication::postEvent(this, new QEvent(QEvent::User));
+        }
+    }
+
+    void removeTasks(ImageScaler* scaler)
+    {
+        QMutableVectorIterator<PendingTask> it(mPendingTasks);
+        while (it.hasNext()) {
+            if (it.next().first == scaler) {
+                it.remove();
+            }
+        }
+    }
+
+protected:
+    void customEvent(QEvent*) override
+    {
+        flush();
+    }
+
+private:
+    typedef QPair<QPointer<ImageScaler>, ScalingTask> PendingTask;
+
+    ScalingBatch()
+    : mFlushScheduled(false)
+    {}
+
+    void flush()
+    {
+        GV_TRACE_SPAN("ScalingBatch::flush");
+        mFlushScheduled = false;
+        const QVector<PendingTask> pendingTasks = mPendingTasks;
+        mPendingTasks.clear();
+
+        // Scalers showing the same image at the same zoom share results
+        QVector<ScalingTask> tasks;
+        QVector<int> taskIndexes;
+        QHash<QByteArray, int> indexForKey;
+        for (const PendingTask& pendingTask : pendingTasks) {
+            const QByteArray key = pendingTask.second.key();
+            int index = indexForKey.value(key, -1);
+            if (index == -1) {
+                index = tasks.count();
+                tasks << pendingTask.second;
+                indexForKey.insert(key, index);
+            }
+            taskIndexes << index;
+        }
+        LOG("Running" << tasks.count() << "tasks for" << pendingTasks.count() << "requests");
+        QtConcurrent::blockingMap(tasks, ScalingTaskRunner());
+
+        for (int idx = 0; idx < pendingTasks.count(); ++idx) {
+            ImageScaler* scaler = pendingTasks.at(idx).first.data();
+            const ScalingTask& task = tasks.at(taskIndexes.at(idx));
+            if (scaler && task.mDone) {
+                emit scaler->scaledRect(task.mPos.x(), task.mPos.y(), task.mResult);
+            }
+        }
+    }
+
+    QVector<PendingTask> mPendingTasks;
+    bool mFlushScheduled;
+};
+
 struct ImageScalerPrivate
 {
     Qt::TransformationMode mTransformationMode;
     Document::Ptr mDocument;
     qreal mZoom;
     QRegion mRegion;
+    bool mBatched;
+    ImageScaler::PostProcess mPostProcess;
+    QByteArray mPostProcessKey;
 };
 
 ImageScaler::ImageScaler(QObject* parent)
@@ -59,10 +290,12 @@ ImageScaler::ImageScaler(QObject* parent)
 {
     d->mTransformationMode = Qt::FastTransformation;
     d->mZoom = 0;
+    d->mBatched = false;
 }
 
 ImageScaler::~ImageScaler()
 {
+    ScalingBatch::instance()->removeTasks(this);
     delete d;
 }
 
@@ -71,6 +304,7 @@ void ImageScaler::setDocument(const Document::Ptr &document)
     if (d->mDocument) {
         disconnect(d->mDocument.data(), nullptr, this, nullptr);
     }
+    ScalingBatch::instance()->removeTasks(this);
     d->mDocument = document;
     // Used when scaler asked for a down-sampled image
     connect(d->mDocument.data(), &Document::downSampledImageReady,
@@ -88,6 +322,20 @@ void ImageScaler::setZoom(qreal zoom)
                                        : Qt::FastTransformation;
 
     d->mZoom = zoom;
+    // Results of pending tasks would be at the wrong zoom
+    ScalingBatch::instance()->removeTasks(this);
+}
+
+void ImageScaler::setBatched(bool batched)
+{
+    d->mBatched = batched;
+}
+
+void ImageScaler::setPostProcess(const PostProcess& postProcess, const QByteArray& key)
+{
+    d->mPostProcess = postProcess;
+    d->mPostProcessKey = key;
+    ScalingBatch::instance()->removeTasks(this);
 }
 
 void ImageScaler::setDestinationRegion(const QRegion& region)
@@ -105,6 +353,7 @@ void ImageScaler::setDestinationRegion(const QRegion& region)
 
 void ImageScaler::doScale()
 {
+    GV_TRACE_SPAN("ImageScaler::doScale");
     if (d->mZoom < Document::maxDownSampledZoom()) {
         if (!d->mDocument->prepareDownSampledImageForZoom(d->mZoom)) {
             LOG("Asked for a down sampled image");
@@ -117,96 +366,49 @@ void ImageScaler::doScale()
     }
 
     LOG("Starting");
+    QVector<ScalingTask> tasks;
     Q_FOREACH(const QRect & rect, d->mRegion.rects()) {
         LOG(rect);
-        scaleRect(rect);
+        tasks << createTask(rect);
+    }
+    if (d->mBatched) {
+        ScalingBatch::instance()->addTasks(this, tasks);
+        return;
+    }
+    for (ScalingTask& task : tasks) {
+        task.run();
+        if (task.mDone) {
+            emit scaledRect(task.mPos.x(), task.mPos.y(), task.mResult);
+        }
     }
     LOG("Done");
 }
 
-void ImageScaler::scaleRect(const QRect& rect)
+ScalingTask ImageScaler::createTask(const QRect& rect) const
 {
+    ScalingTask task;
+    task.mRect = rect;
+    task.mTransformationMode = d->mTransformationMode;
+    task.mPostProcess = d->mPostProcess;
+    task.mPostProcessKey = d->mPostProcessKey;
+
     const qreal REAL_DELTA = 0.001;
     if (qAbs(d->mZoom - 1.0) < REAL_DELTA) {
-        QImage tmp = d->mDocument->image().copy(rect);
-        emit scaledRect(rect.left(), rect.top(), tmp);
-        return;
+        task.mSource = d->mDocument->image();
+        task.mCopyOnly = true;
+        return task;
     }
 
-    QImage image;
-    qreal zoom;
     if (d->mZoom < Document::maxDownSampledZoom()) {
-        image = d->mDocument->downSampledImageForZoom(d->mZoom);
-        Q_ASSERT(!image.isNull());
-        qreal zoom1 = qreal(image.width()) / d->mDocument->width();
-        zoom = d->mZoom / zoom1;
+        task.mSource = d->mDocument->downSampledImageForZoom(d->mZoom);
+        Q_ASSERT(!task.mSource.isNull());
+        qreal zoom1 = qreal(task.mSource.width()) / d->mDocument->width();
+        task.mZoom = d->mZoom / zoom1;
     } else {
-        image = d->mDocument->image();
-        zoom = d->mZoom;
-    }
-    // If rect contains "half" pixels, make sure sourceRect includes them
-    QRectF sourceRectF(
-        rect.left() / zoom,
-        rect.top() / zoom,
-        rect.width() / zoom,
-        rect.height() / zoom);
-
-    sourceRectF = sourceRectF.intersected(image.rect());
-    QRect sourceRect = PaintUtils::containingRect(sourceRectF);
-    if (sourceRect.isEmpty()) {
-        return;
+        task.mSource = d->mDocument->image();
+        task.mZoom = d->mZoom;
     }
-
-    // Compute smooth margin
-    bool needsSmoothMargins = d->mTransformationMode == Qt::SmoothTransformation;
-
-    int sourceLeftMargin, sourceRightMargin, sourceTopMargin, sourceBottomMargin;
-    int destLeftMargin, destRightMargin, destTopMargin, destBottomMargin;
-    if (needsSmoothMargins) {
-        sourceLeftMargin = qMin(sourceRect.left(), SMOOTH_MARGIN);
-        sourceTopMargin = qMin(sourceRect.top(), SMOOTH_MARGIN);
-        sourceRightMargin = qMin(image.rect().right() - sourceRect.right(), SMOOTH_MARGIN);
-        sourceBottomMargin = qMin(image.rect().bottom() - sourceRect.bottom(), SMOOTH_MARGIN);
-        sourceRect.adjust(
-            -sourceLeftMargin,
-            -sourceTopMargin,
-            sourceRightMargin,
-            sourceBottomMargin);
-        destLeftMargin = int(sourceLeftMargin * zoom);
-        destTopMargin = int(sourceTopMargin * zoom);
-        destRightMargin = int(sourceRightMargin * zoom);
-        destBottomMargin = int(sourceBottomMargin * zoom);
-    } else {
-        sourceLeftMargin = sourceRightMargin = sourceTopMargin = sourceBottomMargin = 0;
-        destLeftMargin = destRightMargin = destTopMargin = destBottomMargin = 0;
-    }
-
-    // destRect is almost like rect, but it contains only "full" pixels
-    QRectF destRectF = QRectF(
-                           sourceRect.left() * zoom,
-                           sourceRect.top() * zoom,
-                           sourceRect.width() * zoom,
-                           sourceRect.height() * zoom
-                       );
-    QRect destRect = PaintUtils::containingRect(destRectF);
-
-    QImage tmp;
-    tmp = image.copy(sourceRect);
-    tmp = tmp.scaled(
-              destRect.width(),
-              destRect.height(),
-              Qt::IgnoreAspectRatio, // Do not use KeepAspectRatio, it can lead to skipped rows or columns
-              d->mTransformationMode);
-
-    if (needsSmoothMargins) {
-        tmp = tmp.copy(
-                  destLeftMargin, destTopMargin,
-                  destRect.width() - (destLeftMargin + destRightMargin),
-                  destRect.height() - (destTopMargin + destBottomMargin)
-              );
-    }
-
-    emit scaledRect(destRect.left() + destLeftMargin, destRect.top() + destTopMargin, tmp);
+    return task;
 }
 
 } // namespace
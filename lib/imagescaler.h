@@ -20,6 +20,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #ifndef IMAGESCALER_H
 #define IMAGESCALER_H
 
+// STL
+#include <functional>
+
 // Qt
 #include <QObject>
 
@@ -39,6 +42,7 @@ namespace Gwenview
 class Document;
 
 struct ImageScalerPrivate;
+struct ScalingTask;
 class GWENVIEWLIB_EXPORT ImageScaler : public QObject
 {
     Q_OBJECT
@@ -49,12 +53,34 @@ public:
     void setZoom(qreal);
     void setDestinationRegion(const QRegion&);
 
+    /**
+     * Function applied to each scaled image before scaledRect() is emitted.
+     * In batched mode it is called from worker threads.
+     */
+    typedef std::function<void(QImage&)> PostProcess;
+
+    /**
+     * Defines the post-processing of scaled images. @p key identifies it:
+     * batched scalers showing the same image at the same zoom with the same
+     * key share their results.
+     */
+    void setPostProcess(const PostProcess& postProcess, const QByteArray& key);
+
+    /**
+     * When batched, the scaler does not scale anything in
+     * setDestinationRegion(). Requests of all batched scalers are collected
+     * until control goes back to the event loop, then scaled in parallel.
+     * scaledRect() is then emitted for all of them in a row, so that their
+     * views are updated in the same frame. Used in compare mode.
+     */
+    void setBatched(bool batched);
+
 Q_SIGNALS:
     void scaledRect(int left, int top, const QImage&);
 
 private:
     ImageScalerPrivate * const d;
-    void scaleRect(const QRect&);
+    ScalingTask createTask(const QRect&) const;
 
 private Q_SLOTS:
     void doScale();
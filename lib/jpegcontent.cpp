@@ -49,6 +49,7 @@ extern "C" {
 #include "iodevicejpegsourcemanager.h"
 #include "exiv2imageloader.h"
 #include "gwenviewconfig.h"
+#include "parallelimageencoder.h"
 
 namespace Gwenview
 {
@@ -114,6 +115,9 @@ struct JpegContent::Private
     // pixels are kept in mImage until updateRawDataFromImage() is called.
     QImage mImage;
     QByteArray mRawData;
+    // ICC profile of the original JPEG data, kept so that it can be embedded
+    // again when mImage is encoded
+    QByteArray mIccProfile;
     QSize mSize;
     QString mComment;
     bool mPendingTransformation;
@@ -177,9 +181,8 @@ struct JpegContent::Private
     bool updateRawDataFromImage()
     {
         QBuffer buffer;
-        QImageWriter writer(&buffer, "jpeg");
-        if (!writer.write(mImage)) {
-            mErrorString = writer.errorString();
+        buffer.open(QIODevice::WriteOnly);
+        if (!ParallelImageEncoder::writeJpeg(&buffer, mImage, ParallelImageEncoder::DEFAULT_JPEG_QUALITY, mIccProfile, &mErrorString)) {
             return false;
         }
         mRawData = buffer.data();
@@ -231,6 +234,7 @@ bool JpegContent::loadFromData(const QByteArray& data, Exiv2::Image* exiv2Image)
     d->mTransformMatrix.reset();
 
     d->mRawData = data;
+    d->mIccProfile.clear();
     if (d->mRawData.size() == 0) {
         qCritical() << "No data\n";
         return false;
@@ -630,6 +634,9 @@ QString JpegContent::errorString() const
 
 void JpegContent::setImage(const QImage& image)
 {
+    if (!d->mRawData.isEmpty()) {
+        d->mIccProfile = ParallelImageEncoder::iccProfileFromJpegData(d->mRawData);
+    }
     d->mRawData.clear();
     d->mImage = image;
     d->mSize = image.size();
@@ -0,0 +1,315 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2019 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "metainfoprobe.h"
+
+// Exiv2
+#include <exiv2/exiv2.hpp>
+
+// Qt
+#include <QDateTime>
+#include <QFileInfo>
+#include <QFutureWatcher>
+#include <QImageReader>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <QUrl>
+#include <QDebug>
+
+// KDE
+#include <KFileItem>
+#ifdef KDCRAW_FOUND
+#include <kdcraw/kdcraw.h>
+#endif
+
+// Local
+#include "exiv2imageloader.h"
+#include "gwenviewconfig.h"
+#include "imagemetainfomodel.h"
+#include "orientation.h"
+#include "trace.h"
+
+namespace Gwenview
+{
+
+#undef ENABLE_LOG
+#undef LOG
+//#define ENABLE_LOG
+#ifdef ENABLE_LOG
+#define LOG(x) qDebug() << x
+#else
+#define LOG(x) ;
+#endif
+
+// Enough to go back and forth between a few images in the sidebar
+static const int MAX_CACHED_PROBES = 16;
+
+struct ProbeResult
+{
+    ProbeResult()
+    : mHasIccProfile(false)
+    {}
+
+    QByteArray mFormat;
+    QSize mSize;
+    QSharedPointer<Exiv2::Image> mExiv2Image;
+    bool mHasIccProfile;
+};
+
+static Orientation exifOrientation(const Exiv2::ExifData& exifData)
+{
+    // Same checks as JpegContent::orientation()
+    Exiv2::ExifData::const_iterator it = exifData.findKey(Exiv2::ExifKey("Exif.Image.Orientation"));
+    if (it == exifData.end() || it->count() == 0 || it->typeId() != Exiv2::unsignedShort) {
+        return NOT_AVAILABLE;
+    }
+    return Orientation(it->toLong());
+}
+
+/**
+ * Runs in a worker thread. Only reads the headers of the file.
+ */
+static ProbeResult probeFile(const QString& path, bool applyExifOrientation)
+{
+    GV_TRACE_SPAN("MetaInfoProbe::probeFile");
+    ProbeResult result;
+    // See LoadingDocumentImplPrivate::startLoading() for the reasons behind
+    // the format hint
+    const QByteArray formatHint = QFileInfo(path).suffix().toLocal8Bit().toLower();
+
+    Exiv2ImageLoader loader;
+    if (loader.load(path)) {
+        result.mExiv2Image.reset(loader.popImage().release());
+    } else {
+        LOG("Exiv2 could not read" << path << ":" << loader.errorMessage());
+    }
+
+#ifdef KDCRAW_FOUND
+    if (KDcrawIface::KDcraw::rawFilesList().contains(QString::fromLatin1(formatHint))) {
+        // Do not let QImageReader decode the raw data, Exiv2 knows the size
+        result.mFormat = formatHint;
+    } else
+#endif
+    {
+        QImageReader reader(path, formatHint);
+        if (!reader.canRead()) {
+            reader.setFormat(QByteArray());
+            reader.setFileName(path);
+        }
+        if (reader.canRead()) {
+            result.mFormat = reader.format();
+            result.mSize = reader.size();
+        }
+        if (result.mFormat == "jpg") {
+            result.mFormat = "jpeg";
+        }
+    }
+
+    Exiv2::Image* image = result.mExiv2Image.data();
+    if (!image) {
+        return result;
+    }
+    if (!result.mSize.isValid() && image->pixelWidth() > 0 && image->pixelHeight() > 0) {
+        result.mSize = QSize(image->pixelWidth(), image->pixelHeight());
+    }
+    try {
+        const Exiv2::ExifData& exifData = image->exifData();
+        result.mHasIccProfile = exifData.findKey(Exiv2::ExifKey("Exif.Image.InterColorProfile")) != exifData.end();
+#if EXIV2_TEST_VERSION(0,26,0)
+        result.mHasIccProfile = result.mHasIccProfile || image->iccProfileDefined();
+#endif
+        if (result.mFormat == "jpeg" && applyExifOrientation) {
+            switch (exifOrientation(exifData)) {
+            case TRANSPOSE:
+            case ROT_90:
+            case TRANSVERSE:
+            case ROT_270:
+                result.mSize.transpose();
+                break;
+            default:
+                break;
+            }
+        }
+    } catch (const Exiv2::Error& error) {
+        qWarning() << "Failed to read Exif data of" << path << ":" << error.what();
+    }
+    return result;
+}
+
+struct ProbeThreadPool : public QThreadPool
+{
+    ProbeThreadPool()
+    {
+        // Probing is mostly waiting for the disk, more threads would only
+        // make the disk seek more
+        setMaxThreadCount(2);
+    }
+};
+
+Q_GLOBAL_STATIC(ProbeThreadPool, probeThreadPool)
+
+// Most recently used first. Only accessed from the GUI thread.
+typedef QList<MetaInfoProbe::Ptr> ProbeList;
+Q_GLOBAL_STATIC(ProbeList, probeCache)
+
+struct MetaInfoProbePrivate
+{
+    QUrl mUrl;
+    QDateTime mModificationTime;
+    KIO::filesize_t mFileSize;
+    bool mFinished;
+    QByteArray mFormat;
+    QSize mSize;
+    bool mHasExif;
+    bool mHasIptc;
+    bool mHasXmp;
+    bool mHasIccProfile;
+    ImageMetaInfoModel* mMetaInfo;
+    QFutureWatcher<ProbeResult> mWatcher;
+};
+
+MetaInfoProbe::Ptr MetaInfoProbe::probe(const KFileItem& item)
+{
+    const QUrl url = item.targetUrl();
+    if (!url.isLocalFile()) {
+        return Ptr();
+    }
+    ProbeList* cache = probeCache();
+    const QDateTime modificationTime = item.time(KFileItem::ModificationTime);
+    for (int idx = 0; idx < cache->count(); ++idx) {
+        Ptr probe = cache->at(idx);
+        if (probe->d->mUrl != url) {
+            continue;
+        }
+        if (probe->d->mModificationTime == modificationTime && probe->d->mFileSize == item.size()) {
+            cache->move(idx, 0);
+            return probe;
+        }
+        // File changed since it was probed
+        cache->removeAt(idx);
+        break;
+    }
+
+    Ptr probe(new MetaInfoProbe(item));
+    cache->prepend(probe);
+    while (cache->count() > MAX_CACHED_PROBES) {
+        cache->removeLast();
+    }
+    return probe;
+}
+
+void MetaInfoProbe::clearCache()
+{
+    probeCache()->clear();
+}
+
+MetaInfoProbe::MetaInfoProbe(const KFileItem& item)
+: d(new MetaInfoProbePrivate)
+{
+    LOG(item.url());
+    d->mUrl = item.targetUrl();
+    d->mModificationTime = item.time(KFileItem::ModificationTime);
+    d->mFileSize = item.size();
+    d->mFinished = false;
+    d->mHasExif = false;
+    d->mHasIptc = false;
+    d->mHasXmp = false;
+    d->mHasIccProfile = false;
+    d->mMetaInfo = new ImageMetaInfoModel;
+    d->mMetaInfo->setUrl(d->mUrl);
+
+    connect(&d->mWatcher, &QFutureWatcherBase::finished, this, &MetaInfoProbe::slotFinished);
+    d->mWatcher.setFuture(QtConcurrent::run(probeThreadPool(), probeFile,
+        d->mUrl.toLocalFile(), GwenviewConfig::applyExifOrientation()));
+}
+
+MetaInfoProbe::~MetaInfoProbe()
+{
+    // probeFile() does not access the probe, no need to wait for it
+    delete d->mMetaInfo;
+    delete d;
+}
+
+void MetaInfoProbe::slotFinished()
+{
+    const ProbeResult result = d->mWatcher.result();
+    LOG(d->mUrl << result.mFormat << result.mSize);
+    d->mFormat = result.mFormat;
+    d->mSize = result.mSize;
+    d->mHasIccProfile = result.mHasIccProfile;
+    const Exiv2::Image* image = result.mExiv2Image.data();
+    if (image) {
+        d->mHasExif = !image->exifData().empty();
+        d->mHasIptc = !image->iptcData().empty();
+        d->mHasXmp = !image->xmpData().empty();
+    }
+    d->mMetaInfo->setImageSize(d->mSize);
+    d->mMetaInfo->setExiv2Image(image);
+    d->mFinished = true;
+    emit finished();
+}
+
+QUrl MetaInfoProbe::url() const
+{
+    return d->mUrl;
+}
+
+bool MetaInfoProbe::isFinished() const
+{
+    return d->mFinished;
+}
+
+QByteArray MetaInfoProbe::format() const
+{
+    return d->mFormat;
+}
+
+QSize MetaInfoProbe::size() const
+{
+    return d->mSize;
+}
+
+bool MetaInfoProbe::hasExif() const
+{
+    return d->mHasExif;
+}
+
+bool MetaInfoProbe::hasIptc() const
+{
+    return d->mHasIptc;
+}
+
+bool MetaInfoProbe::hasXmp() const
+{
+    return d->mHasXmp;
+}
+
+bool MetaInfoProbe::hasIccProfile() const
+{
+    return d->mHasIccProfile;
+}
+
+ImageMetaInfoModel* MetaInfoProbe::metaInfo() const
+{
+    return d->mMetaInfo;
+}
+
+} // namespace
@@ -0,0 +1,122 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2019 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef METAINFOPROBE_H
+#define METAINFOPROBE_H
+
+#include <lib/gwenviewlib_export.h>
+
+// Qt
+#include <QObject>
+#include <QSharedPointer>
+
+// KDE
+
+// Local
+
+class KFileItem;
+class QSize;
+class QUrl;
+
+namespace Gwenview
+{
+
+class ImageMetaInfoModel;
+
+struct MetaInfoProbePrivate;
+/**
+ * Reads the meta information of an image file without loading its image
+ * data: only the headers needed to get the format, the size and the
+ * Exif/IPTC/XMP data are read.
+ *
+ * This is much lighter than loading a Document when only the meta
+ * information is needed, for example to fill the sidebar while browsing.
+ * Probes are kept in their own small cache and do not use any
+ * DocumentFactory slot.
+ */
+class GWENVIEWLIB_EXPORT MetaInfoProbe : public QObject
+{
+    Q_OBJECT
+public:
+    typedef QSharedPointer<MetaInfoProbe> Ptr;
+
+    /**
+     * Returns a probe for @p item. A cached probe is returned if there is
+     * one and the file has not been modified since it was created, otherwise
+     * a new probe is created and starts reading the file in a worker thread.
+     *
+     * Only local files can be probed: returns a null pointer for other urls.
+     */
+    static Ptr probe(const KFileItem& item);
+
+    /**
+     * Drops all cached probes
+     */
+    static void clearCache();
+
+    ~MetaInfoProbe() override;
+
+    QUrl url() const;
+
+    /**
+     * Returns true once the file has been read. finished() is emitted at
+     * this moment.
+     */
+    bool isFinished() const;
+
+    /**
+     * Returns the format, as returned by QImageReader, or an empty array if
+     * the file could not be read as an image
+     */
+    QByteArray format() const;
+
+    /**
+     * Returns the image size, taking Exif orientation into account for JPEG
+     * images like Document does
+     */
+    QSize size() const;
+
+    bool hasExif() const;
+    bool hasIptc() const;
+    bool hasXmp() const;
+    bool hasIccProfile() const;
+
+    /**
+     * Returns a model filled with the same information as
+     * Document::metaInfo(). It is filled progressively: the general
+     * information is available immediately, the rest when the probe is
+     * finished.
+     */
+    ImageMetaInfoModel* metaInfo() const;
+
+Q_SIGNALS:
+    void finished();
+
+private Q_SLOTS:
+    void slotFinished();
+
+private:
+    explicit MetaInfoProbe(const KFileItem& item);
+    MetaInfoProbePrivate* const d;
+};
+
+} // namespace
+
+#endif /* METAINFOPROBE_H */
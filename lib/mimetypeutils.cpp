@@ -30,6 +30,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <QMimeData>
 #include <QMimeDatabase>
 #include <QImageReader>
+#include <QReadWriteLock>
 
 // KDE
 #include <KFileItem>
@@ -133,7 +134,7 @@ QString urlMimeType(const QUrl &url)
     return db.mimeTypeForUrl(url).name();
 }
 
-Kind mimeTypeKind(const QString& mimeType)
+static Kind computeMimeTypeKind(const QString& mimeType)
 {
     if (rasterImageMimeTypes().contains(mimeType)) {
         return KIND_RASTER_IMAGE;
@@ -154,12 +155,52 @@ Kind mimeTypeKind(const QString& mimeType)
     return KIND_FILE;
 }
 
+Kind mimeTypeKind(const QString& mimeType)
+{
+    static QHash<QString, Kind> cache;
+    static QReadWriteLock lock;
+    {
+        QReadLocker locker(&lock);
+        QHash<QString, Kind>::ConstIterator it = cache.constFind(mimeType);
+        if (it != cache.constEnd()) {
+            return it.value();
+        }
+    }
+
+    QWriteLocker locker(&lock);
+    const Kind kind = computeMimeTypeKind(mimeType);
+    cache.insert(mimeType, kind);
+    return kind;
+}
+
 Kind fileItemKind(const KFileItem& item)
 {
     GV_RETURN_VALUE_IF_FAIL(!item.isNull(), KIND_UNKNOWN);
     return mimeTypeKind(item.mimetype());
 }
 
+Kind KindCache::kind(const KFileItem& item)
+{
+    GV_RETURN_VALUE_IF_FAIL(!item.isNull(), KIND_UNKNOWN);
+    QHash<QUrl, Kind>::ConstIterator it = mKindForUrl.constFind(item.url());
+    if (it != mKindForUrl.constEnd()) {
+        return it.value();
+    }
+    const Kind kind = fileItemKind(item);
+    mKindForUrl.insert(item.url(), kind);
+    return kind;
+}
+
+void KindCache::invalidate(const QUrl& url)
+{
+    mKindForUrl.remove(url);
+}
+
+void KindCache::clear()
+{
+    mKindForUrl.clear();
+}
+
 Kind urlKind(const QUrl &url)
 {
     return mimeTypeKind(urlMimeType(url));
@@ -22,7 +22,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #define MIMETYPEUTILS_H
 
 #include <lib/gwenviewlib_export.h>
+#include <QHash>
 #include <QString>
+#include <QUrl>
 // Local
 class QStringList;
 
@@ -57,8 +59,27 @@ Q_DECLARE_FLAGS(Kinds, Kind)
 
 GWENVIEWLIB_EXPORT Kind fileItemKind(const KFileItem&);
 GWENVIEWLIB_EXPORT Kind urlKind(const QUrl&);
+/**
+ * Kinds are computed once per mime type, then looked up in a hash table
+ */
 GWENVIEWLIB_EXPORT Kind mimeTypeKind(const QString& mimeType);
 
+/**
+ * Remembers the kind of file items, for views which need it each time an
+ * item is painted or filtered. Users must call invalidate() when an item
+ * changes and clear() when the whole model changes.
+ */
+class GWENVIEWLIB_EXPORT KindCache
+{
+public:
+    Kind kind(const KFileItem& item);
+    void invalidate(const QUrl& url);
+    void clear();
+
+private:
+    QHash<QUrl, Kind> mKindForUrl;
+};
+
 enum MimeTarget {
     ClipboardTarget,
     DropTarget
@@ -0,0 +1,165 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2019 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "namesearchindex.h"
+
+// Qt
+#include <QHash>
+#include <QString>
+#include <QVector>
+#include <QtConcurrentMap>
+#include <QDebug>
+
+// KDE
+
+// Local
+
+#undef ENABLE_LOG
+#undef LOG
+//#define ENABLE_LOG
+#ifdef ENABLE_LOG
+#define LOG(x) qDebug() << x
+#else
+#define LOG(x) ;
+#endif
+
+namespace Gwenview
+{
+
+// Below this number of names to check, starting worker threads costs more
+// than it saves
+static const int PARALLEL_THRESHOLD = 4096;
+
+struct NameEntry
+{
+    QString mFoldedName;
+    bool mMatches;
+};
+
+typedef QHash<QString, NameEntry> NameEntryHash;
+
+struct EntryMatcher
+{
+    explicit EntryMatcher(const QString& foldedText)
+    : mFoldedText(foldedText)
+    {}
+
+    void operator()(NameEntry* entry) const
+    {
+        entry->mMatches = entry->mFoldedName.contains(mFoldedText);
+    }
+
+    QString mFoldedText;
+};
+
+enum CheckMode {
+    CheckAll,
+    CheckMatching,
+    CheckNotMatching
+};
+
+struct NameSearchIndexPrivate
+{
+    NameEntryHash mEntries;
+    QString mText;
+    QString mFoldedText;
+
+    void updateMatches(CheckMode mode)
+    {
+        QVector<NameEntry*> entries;
+        entries.reserve(mEntries.count());
+        for (NameEntryHash::Iterator it = mEntries.begin(), end = mEntries.end(); it != end; ++it) {
+            if (mode == CheckAll || (mode == CheckMatching) == it->mMatches) {
+                entries << &it.value();
+            }
+        }
+        LOG("Checking" << entries.count() << "names out of" << mEntries.count());
+
+        const EntryMatcher matcher(mFoldedText);
+        if (entries.count() < PARALLEL_THRESHOLD) {
+            Q_FOREACH(NameEntry* entry, entries) {
+                matcher(entry);
+            }
+        } else {
+            QtConcurrent::blockingMap(entries, matcher);
+        }
+    }
+};
+
+NameSearchIndex::NameSearchIndex()
+: d(new NameSearchIndexPrivate)
+{
+}
+
+NameSearchIndex::~NameSearchIndex()
+{
+    delete d;
+}
+
+void NameSearchIndex::setText(const QString& text)
+{
+    const QString foldedText = text.toCaseFolded();
+    if (foldedText == d->mFoldedText) {
+        d->mText = text;
+        return;
+    }
+    // When a character is typed, names which did not contain the previous
+    // text cannot contain the new one. When a character is removed, names
+    // which contained the previous text still contain the new one.
+    CheckMode mode = CheckAll;
+    if (foldedText.contains(d->mFoldedText)) {
+        mode = CheckMatching;
+    } else if (d->mFoldedText.contains(foldedText)) {
+        mode = CheckNotMatching;
+    }
+    d->mText = text;
+    d->mFoldedText = foldedText;
+    d->updateMatches(mode);
+}
+
+QString NameSearchIndex::text() const
+{
+    return d->mText;
+}
+
+bool NameSearchIndex::contains(const QString& name)
+{
+    NameEntryHash::ConstIterator it = d->mEntries.constFind(name);
+    if (it == d->mEntries.constEnd()) {
+        NameEntry entry;
+        entry.mFoldedName = name.toCaseFolded();
+        entry.mMatches = entry.mFoldedName.contains(d->mFoldedText);
+        it = d->mEntries.insert(name, entry);
+    }
+    return it->mMatches;
+}
+
+void NameSearchIndex::clear()
+{
+    d->mEntries.clear();
+}
+
+int NameSearchIndex::count() const
+{
+    return d->mEntries.count();
+}
+
+} // namespace
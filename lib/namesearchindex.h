@@ -0,0 +1,83 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2019 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef NAMESEARCHINDEX_H
+#define NAMESEARCHINDEX_H
+
+#include <lib/gwenviewlib_export.h>
+
+// Qt
+
+// KDE
+
+// Local
+
+class QString;
+
+namespace Gwenview
+{
+
+struct NameSearchIndexPrivate;
+/**
+ * Answers "does this name contain the search text?" for the names of a
+ * folder, ignoring case.
+ *
+ * Case-folded names and the result of the last search are kept in a hash
+ * keyed by name, so filtering a row is a hash lookup instead of a
+ * case-insensitive substring search. When the search text changes, the known
+ * names are checked again, in parallel for large folders. If the new text
+ * extends the previous one, only the names which matched are checked again.
+ * If it is a part of the previous one, only the names which did not match
+ * are checked again.
+ *
+ * Names which are not known yet are added when they are first looked up.
+ */
+class GWENVIEWLIB_EXPORT NameSearchIndex
+{
+public:
+    NameSearchIndex();
+    ~NameSearchIndex();
+
+    void setText(const QString& text);
+    QString text() const;
+
+    /**
+     * Returns true if name contains text(), ignoring case
+     */
+    bool contains(const QString& name);
+
+    /**
+     * Forgets all names, to be called when switching to another folder
+     */
+    void clear();
+
+    /**
+     * Number of names in the index
+     */
+    int count() const;
+
+private:
+    Q_DISABLE_COPY(NameSearchIndex)
+    NameSearchIndexPrivate* const d;
+};
+
+} // namespace
+
+#endif /* NAMESEARCHINDEX_H */
@@ -0,0 +1,435 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2019 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "orthogonaltransform.h"
+
+// STL
+#include <algorithm>
+
+// Qt
+#include <QStringList>
+#include <QThread>
+#include <QVector>
+#include <QtConcurrentMap>
+#include <QDebug>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// KDE
+
+// Local
+#include "imageutils.h"
+#include "trace.h"
+
+#undef ENABLE_LOG
+#undef LOG
+//#define ENABLE_LOG
+#ifdef ENABLE_LOG
+#define LOG(x) qDebug() << x
+#else
+#define LOG(x) ;
+#endif
+
+namespace Gwenview
+{
+
+namespace OrthogonalTransform
+{
+
+// Side of the tiles used to transpose images, in pixels. A source and a
+// destination tile of 32 bit pixels use 32 KB.
+static const int TILE_SIZE = 64;
+
+// Do not bother splitting images in bands smaller than this
+static const int MIN_PIXELS_PER_BAND = 256 * 256;
+
+struct Pixel24
+{
+    uchar mData[3];
+};
+static_assert(sizeof(Pixel24) == 3, "Pixel24 must not be padded");
+
+struct Params
+{
+    const uchar* mSrc;
+    int mSrcBytesPerLine;
+    uchar* mDst;
+    int mDstBytesPerLine;
+    // Size of the source image
+    int mWidth;
+    int mHeight;
+    // Transposing only: destination x is height - 1 - source y
+    bool mMirrorRows;
+    // Transposing only: destination y is width - 1 - source x
+    bool mMirrorColumns;
+};
+
+typedef void (*BandFunction)(const Params& params, int top, int bottom);
+
+struct Band
+{
+    int mTop;
+    int mBottom;
+};
+
+struct BandRunner
+{
+    BandRunner(BandFunction function, const Params& params)
+    : mFunction(function)
+    , mParams(params)
+    {}
+
+    void operator()(Band& band) const
+    {
+        mFunction(mParams, band.mTop, band.mBottom);
+    }
+
+    BandFunction mFunction;
+    Params mParams;
+};
+
+/**
+ * Calls @p function on bands of @p rowCount rows, in parallel if the image is
+ * large enough. Band tops are aligned on TILE_SIZE.
+ */
+static void runInBands(BandFunction function, const Params& params, int rowCount)
+{
+    // Use more bands than threads: the cost of a band is not always
+    // proportional to its height
+    const int maxBandCount = 4 * qMax(1, QThread::idealThreadCount());
+    const qint64 pixelCount = qint64(rowCount) * params.mWidth;
+    const int bandCount = int(qBound(qint64(1), pixelCount / MIN_PIXELS_PER_BAND, qint64(maxBandCount)));
+    if (bandCount == 1) {
+        function(params, 0, rowCount);
+        return;
+    }
+    int bandHeight = (rowCount + bandCount - 1) / bandCount;
+    bandHeight = ((bandHeight + TILE_SIZE - 1) / TILE_SIZE) * TILE_SIZE;
+
+    QVector<Band> bands;
+    for (int top = 0; top < rowCount; top += bandHeight) {
+        Band band;
+        band.mTop = top;
+        band.mBottom = qMin(top + bandHeight, rowCount);
+        bands << band;
+    }
+    LOG("Processing" << rowCount << "rows in" << bands.count() << "bands");
+    QtConcurrent::blockingMap(bands, BandRunner(function, params));
+}
+
+template<typename T>
+static void transposeTileScalar(const Params& p, int x0, int y0, int x1, int y1)
+{
+    for (int y = y0; y < y1; ++y) {
+        const T* src = reinterpret_cast<const T*>(p.mSrc + qptrdiff(y) * p.mSrcBytesPerLine);
+        const int dx = p.mMirrorRows ? p.mHeight - 1 - y : y;
+        for (int x = x0; x < x1; ++x) {
+            const int dy = p.mMirrorColumns ? p.mWidth - 1 - x : x;
+            reinterpret_cast<T*>(p.mDst + qptrdiff(dy) * p.mDstBytesPerLine)[dx] = src[x];
+        }
+    }
+}
+
+template<typename T>
+static void transposeTile(const Params& p, int x0, int y0, int x1, int y1)
+{
+    transposeTileScalar<T>(p, x0, y0, x1, y1);
+}
+
+#ifdef __SSE2__
+/**
+ * Transposes the 4x4 block of 32 bit pixels whose top-left corner is at
+ * @p x, @p y in the source image
+ */
+static inline void transposeBlock4x4(const Params& p, int x, int y)
+{
+    const uchar* src = p.mSrc + qptrdiff(y) * p.mSrcBytesPerLine + x * 4;
+    const __m128i r0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+    const __m128i r1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + p.mSrcBytesPerLine));
+    const __m128i r2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * p.mSrcBytesPerLine));
+    const __m128i r3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 3 * p.mSrcBytesPerLine));
+
+    const __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+    const __m128i t1 = _mm_unpacklo_epi32(r2, r3);
+    const __m128i t2 = _mm_unpackhi_epi32(r0, r1);
+    const __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+
+    // columns[i] contains the pixels of source column x + i
+    __m128i columns[4] = {
+        _mm_unpacklo_epi64(t0, t1),
+        _mm_unpackhi_epi64(t0, t1),
+        _mm_unpacklo_epi64(t2, t3),
+        _mm_unpackhi_epi64(t2, t3)
+    };
+
+    const int dx = p.mMirrorRows ? p.mHeight - 1 - (y + 3) : y;
+    for (int i = 0; i < 4; ++i) {
+        if (p.mMirrorRows) {
+            columns[i] = _mm_shuffle_epi32(columns[i], _MM_SHUFFLE(0, 1, 2, 3));
+        }
+        const int dy = p.mMirrorColumns ? p.mWidth - 1 - (x + i) : x + i;
+        uchar* dst = p.mDst + qptrdiff(dy) * p.mDstBytesPerLine + dx * 4;
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), columns[i]);
+    }
+}
+
+template<>
+void transposeTile<quint32>(const Params& p, int x0, int y0, int x1, int y1)
+{
+    int y = y0;
+    for (; y + 4 <= y1; y += 4) {
+        int x = x0;
+        for (; x + 4 <= x1; x += 4) {
+            transposeBlock4x4(p, x, y);
+        }
+        transposeTileScalar<quint32>(p, x, y, x1, y + 4);
+    }
+    transposeTileScalar<quint32>(p, x0, y, x1, y1);
+}
+#endif
+
+template<typename T>
+struct Kernels
+{
+    /**
+     * Transposes source rows [top, bottom) into the destination buffer
+     */
+    static void transpose(const Params& p, int top, int bottom)
+    {
+        for (int ty = top; ty < bottom; ty += TILE_SIZE) {
+            const int y1 = qMin(ty + TILE_SIZE, bottom);
+            for (int tx = 0; tx < p.mWidth; tx += TILE_SIZE) {
+                transposeTile<T>(p, tx, ty, qMin(tx + TILE_SIZE, p.mWidth), y1);
+            }
+        }
+    }
+
+    /**
+     * Transposes a square image in place. Each band swaps its tiles with
+     * the ones on the other side of the diagonal, so bands never touch the
+     * same pixels.
+     */
+    static void transposeInPlace(const Params& p, int top, int bottom)
+    {
+        for (int ty = top; ty < bottom; ty += TILE_SIZE) {
+            const int y1 = qMin(ty + TILE_SIZE, bottom);
+            for (int tx = ty; tx < p.mWidth; tx += TILE_SIZE) {
+                const int x1 = qMin(tx + TILE_SIZE, p.mWidth);
+                for (int y = ty; y < y1; ++y) {
+                    T* row = reinterpret_cast<T*>(p.mDst + qptrdiff(y) * p.mDstBytesPerLine);
+                    // On tiles crossing the diagonal, only swap the pixels
+                    // above it
+                    for (int x = qMax(tx, y + 1); x < x1; ++x) {
+                        std::swap(row[x], reinterpret_cast<T*>(p.mDst + qptrdiff(x) * p.mDstBytesPerLine)[y]);
+                    }
+                }
+            }
+        }
+    }
+
+    static void mirror(const Params& p, int top, int bottom)
+    {
+        for (int y = top; y < bottom; ++y) {
+            T* row = reinterpret_cast<T*>(p.mDst + qptrdiff(y) * p.mDstBytesPerLine);
+            std::reverse(row, row + p.mWidth);
+        }
+    }
+
+    /**
+     * Swaps rows [top, bottom) of the top half with the matching rows of the
+     * bottom half
+     */
+    static void flip(const Params& p, int top, int bottom)
+    {
+        const int length = p.mWidth * int(sizeof(T));
+        for (int y = top; y < bottom; ++y) {
+            uchar* row1 = p.mDst + qptrdiff(y) * p.mDstBytesPerLine;
+            uchar* row2 = p.mDst + qptrdiff(p.mHeight - 1 - y) * p.mDstBytesPerLine;
+            std::swap_ranges(row1, row1 + length, row2);
+        }
+    }
+
+    /**
+     * Same as flip(), but also mirrors the rows. The middle row of images
+     * with an odd height belongs to the top half.
+     */
+    static void rotate180(const Params& p, int top, int bottom)
+    {
+        for (int y = top; y < bottom; ++y) {
+            T* row1 = reinterpret_cast<T*>(p.mDst + qptrdiff(y) * p.mDstBytesPerLine);
+            T* row2 = reinterpret_cast<T*>(p.mDst + qptrdiff(p.mHeight - 1 - y) * p.mDstBytesPerLine);
+            if (row1 == row2) {
+                std::reverse(row1, row1 + p.mWidth);
+                continue;
+            }
+            for (int x = 0; x < p.mWidth; ++x) {
+                std::swap(row1[x], row2[p.mWidth - 1 - x]);
+            }
+        }
+    }
+
+    /**
+     * Applies a transformation which does not change the image dimensions
+     */
+    static void applyInPlace(QImage* image, Orientation orientation)
+    {
+        Params p;
+        p.mDst = image->bits();
+        p.mDstBytesPerLine = image->bytesPerLine();
+        p.mSrc = p.mDst;
+        p.mSrcBytesPerLine = p.mDstBytesPerLine;
+        p.mWidth = image->width();
+        p.mHeight = image->height();
+        p.mMirrorRows = false;
+        p.mMirrorColumns = false;
+
+        switch (orientation) {
+        case HFLIP:
+            runInBands(mirror, p, p.mHeight);
+            break;
+        case VFLIP:
+            runInBands(flip, p, p.mHeight / 2);
+            break;
+        case ROT_180:
+            runInBands(rotate180, p, (p.mHeight + 1) / 2);
+            break;
+        case TRANSPOSE:
+        case ROT_90:
+        case TRANSVERSE:
+        case ROT_270:
+            Q_ASSERT(p.mWidth == p.mHeight);
+            runInBands(transposeInPlace, p, p.mHeight);
+            break;
+        case NOT_AVAILABLE:
+        case NORMAL:
+            break;
+        }
+    }
+
+    static QImage apply(QImage& image, Orientation orientation)
+    {
+        const bool transposing = orientation == TRANSPOSE || orientation == ROT_90
+            || orientation == TRANSVERSE || orientation == ROT_270;
+        if (!transposing) {
+            applyInPlace(&image, orientation);
+            return image;
+        }
+
+        const int dotsPerMeterX = image.dotsPerMeterX();
+        const int dotsPerMeterY = image.dotsPerMeterY();
+        if (image.width() == image.height()) {
+            // Transpose, then flip to get the requested rotation
+            applyInPlace(&image, TRANSPOSE);
+            switch (orientation) {
+            case ROT_90:
+                applyInPlace(&image, HFLIP);
+                break;
+            case TRANSVERSE:
+                applyInPlace(&image, ROT_180);
+                break;
+            case ROT_270:
+                applyInPlace(&image, VFLIP);
+                break;
+            default:
+                break;
+            }
+            image.setDotsPerMeterX(dotsPerMeterY);
+            image.setDotsPerMeterY(dotsPerMeterX);
+            return image;
+        }
+
+        QImage result(image.height(), image.width(), image.format());
+        if (result.isNull()) {
+            qWarning() << "Could not allocate a" << result.width() << "x" << result.height() << "image";
+            return QImage();
+        }
+        result.setColorTable(image.colorTable());
+        result.setDevicePixelRatio(image.devicePixelRatio());
+        result.setDotsPerMeterX(dotsPerMeterY);
+        result.setDotsPerMeterY(dotsPerMeterX);
+        const QStringList keys = image.textKeys();
+        for (const QString& key : keys) {
+            result.setText(key, image.text(key));
+        }
+
+        Params p;
+        p.mSrc = image.constBits();
+        p.mSrcBytesPerLine = image.bytesPerLine();
+        p.mDst = result.bits();
+        p.mDstBytesPerLine = result.bytesPerLine();
+        p.mWidth = image.width();
+        p.mHeight = image.height();
+        p.mMirrorRows = orientation == ROT_90 || orientation == TRANSVERSE;
+        p.mMirrorColumns = orientation == TRANSVERSE || orientation == ROT_270;
+        runInBands(transpose, p, p.mHeight);
+        return result;
+    }
+};
+
+QImage transformed(QImage image, Orientation orientation)
+{
+    if (image.isNull() || orientation == NORMAL || orientation == NOT_AVAILABLE) {
+        return image;
+    }
+    GV_TRACE_SPAN("OrthogonalTransform::transformed");
+    switch (image.depth()) {
+    case 8:
+        return Kernels<quint8>::apply(image, orientation);
+    case 16:
+        return Kernels<quint16>::apply(image, orientation);
+    case 24:
+        return Kernels<Pixel24>::apply(image, orientation);
+    case 32:
+        return Kernels<quint32>::apply(image, orientation);
+    case 64:
+        return Kernels<quint64>::apply(image, orientation);
+    default:
+        return image.transformed(ImageUtils::transformMatrix(orientation));
+    }
+}
+
+Orientation orientationFromTransformations(QImageIOHandler::Transformations transformations)
+{
+    switch (int(transformations)) {
+    case QImageIOHandler::TransformationMirror:
+        return HFLIP;
+    case QImageIOHandler::TransformationFlip:
+        return VFLIP;
+    case QImageIOHandler::TransformationRotate180:
+        return ROT_180;
+    case QImageIOHandler::TransformationRotate90:
+        return ROT_90;
+    case QImageIOHandler::TransformationMirrorAndRotate90:
+        return TRANSVERSE;
+    case QImageIOHandler::TransformationFlipAndRotate90:
+        return TRANSPOSE;
+    case QImageIOHandler::TransformationRotate270:
+        return ROT_270;
+    default:
+        return NORMAL;
+    }
+}
+
+} // namespace
+
+} // namespace
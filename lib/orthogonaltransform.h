@@ -0,0 +1,72 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2019 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef ORTHOGONALTRANSFORM_H
+#define ORTHOGONALTRANSFORM_H
+
+#include <lib/gwenviewlib_export.h>
+#include <lib/orientation.h>
+
+// Qt
+#include <QImage>
+#include <QImageIOHandler>
+
+// KDE
+
+// Local
+
+namespace Gwenview
+{
+
+/**
+ * Applies the eight EXIF orientations to images without going through the
+ * generic QImage::transformed() path.
+ *
+ * Rotations by 90 degrees are done by transposing square tiles, so that both
+ * the source and the destination tiles stay in the CPU cache. Work is split
+ * in bands of rows processed by several threads.
+ */
+namespace OrthogonalTransform
+{
+
+/**
+ * Returns @p image transformed according to @p orientation.
+ *
+ * Flips, 180 degree rotations and transformations of square images are done
+ * in place: if @p image is not shared, no other buffer is allocated. Call it
+ * as `image = transformed(std::move(image), orientation)` to benefit from
+ * this.
+ *
+ * Images with less than 8 bits per pixel are handled by
+ * QImage::transformed().
+ */
+GWENVIEWLIB_EXPORT QImage transformed(QImage image, Orientation orientation);
+
+/**
+ * Returns the orientation matching the transformations reported by
+ * QImageReader::transformation()
+ */
+GWENVIEWLIB_EXPORT Orientation orientationFromTransformations(QImageIOHandler::Transformations transformations);
+
+} // namespace
+
+} // namespace
+
+#endif /* ORTHOGONALTRANSFORM_H */
@@ -0,0 +1,718 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2019 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "parallelimageencoder.h"
+
+// System
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+// Qt
+#include <QImage>
+#include <QImageWriter>
+#include <QIODevice>
+#include <QMap>
+#include <QThread>
+#include <QVector>
+#include <QtConcurrentMap>
+#include <QDebug>
+
+// KDE
+#include <KLocalizedString>
+
+// Local
+#include "jpegerrormanager.h"
+extern "C" {
+#include <cms/iccjpeg.h>
+}
+
+#undef ENABLE_LOG
+#undef LOG
+//#define ENABLE_LOG
+#ifdef ENABLE_LOG
+#define LOG(x) qDebug() << x
+#else
+#define LOG(x) ;
+#endif
+
+namespace Gwenview
+{
+
+namespace ParallelImageEncoder
+{
+
+// Do not bother splitting images in strips smaller than this
+static const int MIN_ROWS_PER_STRIP = 256;
+
+// Height of a JPEG MCU with the sampling factors set by jpeg_set_defaults()
+static const int JPEG_MCU_HEIGHT_COLOR = 16;
+static const int JPEG_MCU_HEIGHT_GRAY = 8;
+
+// Largest height which can be stored in a JPEG SOF marker
+static const int JPEG_MAX_HEIGHT = 65500;
+
+// See setMaxStripCount()
+static int sMaxStripCount = 0;
+
+struct Strip
+{
+    Strip()
+    : mTop(0)
+    , mHeight(0)
+    , mAdler(0)
+    , mRawLength(0)
+    , mLast(false)
+    , mOk(false)
+    {}
+
+    int mTop;
+    int mHeight;
+    QByteArray mData;
+    // PNG only
+    uLong mAdler;
+    uLong mRawLength;
+    bool mLast;
+
+    bool mOk;
+};
+
+/**
+ * Splits @p height rows in strips whose height is a multiple of @p rowAlignment
+ */
+static QVector<Strip> createStrips(int height, int rowAlignment)
+{
+    const int maxStripCount = sMaxStripCount > 0 ? sMaxStripCount : qMax(1, QThread::idealThreadCount());
+    const int stripCount = qBound(1, height / MIN_ROWS_PER_STRIP, maxStripCount);
+    int stripHeight = (height + stripCount - 1) / stripCount;
+    stripHeight = ((stripHeight + rowAlignment - 1) / rowAlignment) * rowAlignment;
+
+    QVector<Strip> strips;
+    for (int top = 0; top < height; top += stripHeight) {
+        Strip strip;
+        strip.mTop = top;
+        strip.mHeight = qMin(stripHeight, height - top);
+        strips << strip;
+    }
+    strips.last().mLast = true;
+    return strips;
+}
+
+/**
+ * Returns a version of @p image which can be split in strips without losing
+ * its color table
+ */
+static QImage imageWithoutColorTable(const QImage& image)
+{
+    switch (image.format()) {
+    case QImage::Format_Mono:
+    case QImage::Format_MonoLSB:
+    case QImage::Format_Indexed8:
+        return image.convertToFormat(image.hasAlphaChannel() ? QImage::Format_ARGB32 : QImage::Format_RGB32);
+    default:
+        return image;
+    }
+}
+
+/**
+ * Returns rows [top, top + height[ of @p image, converted to @p format.
+ * Pixels are not copied if no conversion is needed.
+ */
+static QImage stripImage(const QImage& image, int top, int height, QImage::Format format)
+{
+    const QImage strip(image.constScanLine(top), image.width(), height, image.bytesPerLine(), image.format());
+    return strip.convertToFormat(format);
+}
+
+static bool writeData(QIODevice* device, const char* data, qint64 size, QString* errorString)
+{
+    if (device->write(data, size) != size) {
+        *errorString = device->errorString();
+        return false;
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------
+//
+// JPEG
+//
+//------------------------------------------------------------------------
+static const int JPEG_DEST_DELTA = 65536;
+
+struct ByteArrayDestinationManager : public jpeg_destination_mgr
+{
+    QByteArray* mOutput;
+
+    static void initDestination(j_compress_ptr cinfo)
+    {
+        ByteArrayDestinationManager* dest = static_cast<ByteArrayDestinationManager*>(cinfo->dest);
+        dest->mOutput->resize(JPEG_DEST_DELTA);
+        dest->next_output_byte = reinterpret_cast<JOCTET*>(dest->mOutput->data());
+        dest->free_in_buffer = dest->mOutput->size();
+    }
+
+    static boolean emptyOutputBuffer(j_compress_ptr cinfo)
+    {
+        ByteArrayDestinationManager* dest = static_cast<ByteArrayDestinationManager*>(cinfo->dest);
+        const int oldSize = dest->mOutput->size();
+        dest->mOutput->resize(oldSize * 2);
+        dest->next_output_byte = reinterpret_cast<JOCTET*>(dest->mOutput->data() + oldSize);
+        dest->free_in_buffer = dest->mOutput->size() - oldSize;
+        return true;
+    }
+
+    static void termDestination(j_compress_ptr cinfo)
+    {
+        ByteArrayDestinationManager* dest = static_cast<ByteArrayDestinationManager*>(cinfo->dest);
+        dest->mOutput->resize(dest->mOutput->size() - int(dest->free_in_buffer));
+    }
+};
+
+struct JpegStripEncoder
+{
+    JpegStripEncoder(const QImage& image, bool gray, int quality, const QByteArray& iccProfile)
+    : mImage(image)
+    , mGray(gray)
+    , mQuality(quality)
+    , mIccProfile(iccProfile)
+    {}
+
+    void operator()(Strip& strip) const
+    {
+        const QImage image = stripImage(mImage, strip.mTop, strip.mHeight,
+                                        mGray ? QImage::Format_Grayscale8 : QImage::Format_RGB888);
+
+        struct jpeg_compress_struct cinfo;
+        JPEGErrorManager errorManager;
+        cinfo.err = &errorManager;
+        jpeg_create_compress(&cinfo);
+        if (setjmp(errorManager.jmp_buffer)) {
+            jpeg_destroy_compress(&cinfo);
+            strip.mOk = false;
+            return;
+        }
+
+        ByteArrayDestinationManager dest;
+        dest.mOutput = &strip.mData;
+        dest.init_destination = ByteArrayDestinationManager::initDestination;
+        dest.empty_output_buffer = ByteArrayDestinationManager::emptyOutputBuffer;
+        dest.term_destination = ByteArrayDestinationManager::termDestination;
+        cinfo.dest = &dest;
+
+        cinfo.image_width = image.width();
+        cinfo.image_height = image.height();
+        cinfo.input_components = mGray ? 1 : 3;
+        cinfo.in_color_space = mGray ? JCS_GRAYSCALE : JCS_RGB;
+        jpeg_set_defaults(&cinfo);
+        jpeg_set_quality(&cinfo, mQuality, true);
+        // Restart markers at the end of each MCU row make it possible to
+        // concatenate the scans of all strips. Standard Huffman tables are
+        // required so that all strips share the same tables.
+        cinfo.restart_in_rows = 1;
+        cinfo.optimize_coding = false;
+        if (mImage.dotsPerMeterX() > 0 && mImage.dotsPerMeterY() > 0) {
+            cinfo.density_unit = 1;
+            cinfo.X_density = qRound(mImage.dotsPerMeterX() * 2.54 / 100.);
+            cinfo.Y_density = qRound(mImage.dotsPerMeterY() * 2.54 / 100.);
+        }
+
+        jpeg_start_compress(&cinfo, true);
+        // Only the headers of the first strip are kept
+        if (strip.mTop == 0 && !mIccProfile.isEmpty()) {
+            write_icc_profile(&cinfo, reinterpret_cast<const JOCTET*>(mIccProfile.constData()), mIccProfile.size());
+        }
+        while (cinfo.next_scanline < cinfo.image_height) {
+            JSAMPROW row = const_cast<JSAMPROW>(image.constScanLine(cinfo.next_scanline));
+            jpeg_write_scanlines(&cinfo, &row, 1);
+        }
+        jpeg_finish_compress(&cinfo);
+        jpeg_destroy_compress(&cinfo);
+        strip.mOk = true;
+    }
+
+    const QImage mImage;
+    const bool mGray;
+    const int mQuality;
+    const QByteArray mIccProfile;
+};
+
+static int readUInt16(const QByteArray& data, int pos)
+{
+    return (uchar(data.at(pos)) << 8) | uchar(data.at(pos + 1));
+}
+
+/**
+ * Finds the boundaries of the entropy-coded data of the single scan of
+ * @p data: it starts at @p scanStart and ends at @p scanEnd, right before the
+ * EOI marker. If @p sofPos is not null, it is set to the position of the SOF
+ * marker.
+ */
+static bool findScan(const QByteArray& data, int* scanStart, int* scanEnd, int* sofPos)
+{
+    if (data.size() < 4 || uchar(data.at(data.size() - 2)) != 0xFF || uchar(data.at(data.size() - 1)) != 0xD9) {
+        return false;
+    }
+    int pos = 2; // Skip SOI
+    while (pos + 4 <= data.size()) {
+        if (uchar(data.at(pos)) != 0xFF) {
+            return false;
+        }
+        const uchar marker = uchar(data.at(pos + 1));
+        const int length = readUInt16(data, pos + 2);
+        if (marker == 0xC0 && sofPos) {
+            *sofPos = pos;
+        }
+        if (marker == 0xDA) {
+            *scanStart = pos + 2 + length;
+            *scanEnd = data.size() - 2;
+            return *scanStart <= *scanEnd;
+        }
+        pos += 2 + length;
+    }
+    return false;
+}
+
+/**
+ * Renumbers the restart markers found in data[start, end[, starting with
+ * @p counter
+ */
+static void renumberRestartMarkers(QByteArray* data, int start, int end, int* counter)
+{
+    char* ptr = data->data();
+    for (int pos = start; pos < end - 1; ++pos) {
+        if (uchar(ptr[pos]) != 0xFF) {
+            continue;
+        }
+        const uchar marker = uchar(ptr[pos + 1]);
+        if (marker >= 0xD0 && marker <= 0xD7) {
+            ptr[pos + 1] = char(0xD0 + (*counter & 7));
+            ++*counter;
+        }
+        // Skip the byte following 0xFF: it is either a stuffed zero or the
+        // marker we just handled
+        ++pos;
+    }
+}
+
+bool writeJpeg(QIODevice* device, const QImage& image_, int quality, const QByteArray& iccProfile, QString* errorString)
+{
+    const QImage image = imageWithoutColorTable(image_);
+    if (image.isNull()) {
+        *errorString = i18nc("@info", "No image to save.");
+        return false;
+    }
+    if (image.height() > JPEG_MAX_HEIGHT || image.width() > JPEG_MAX_HEIGHT) {
+        *errorString = i18nc("@info", "Image is too large to be saved as JPEG.");
+        return false;
+    }
+    const bool gray = image.format() == QImage::Format_Grayscale8;
+    QVector<Strip> strips = createStrips(image.height(), gray ? JPEG_MCU_HEIGHT_GRAY : JPEG_MCU_HEIGHT_COLOR);
+    LOG("Encoding JPEG in" << strips.count() << "strips");
+    QtConcurrent::blockingMap(strips, JpegStripEncoder(image, gray, quality, iccProfile));
+
+    int restartCounter = 0;
+    for (int idx = 0; idx < strips.count(); ++idx) {
+        Strip& strip = strips[idx];
+        int scanStart, scanEnd, sofPos = -1;
+        if (!strip.mOk || !findScan(strip.mData, &scanStart, &scanEnd, &sofPos)) {
+            *errorString = i18nc("@info", "JPEG encoding failed.");
+            return false;
+        }
+        if (idx == 0) {
+            if (sofPos == -1) {
+                *errorString = i18nc("@info", "JPEG encoding failed.");
+                return false;
+            }
+            // Headers come from the first strip, fix the image height
+            strip.mData[sofPos + 5] = char(image.height() >> 8);
+            strip.mData[sofPos + 6] = char(image.height() & 0xFF);
+            if (!writeData(device, strip.mData.constData(), scanStart, errorString)) {
+                return false;
+            }
+        }
+        renumberRestartMarkers(&strip.mData, scanStart, scanEnd, &restartCounter);
+        if (!writeData(device, strip.mData.constData() + scanStart, scanEnd - scanStart, errorString)) {
+            return false;
+        }
+        if (strip.mLast) {
+            static const char eoi[] = { char(0xFF), char(0xD9) };
+            if (!writeData(device, eoi, 2, errorString)) {
+                return false;
+            }
+        } else {
+            const char rst[] = { char(0xFF), char(0xD0 + (restartCounter & 7)) };
+            ++restartCounter;
+            if (!writeData(device, rst, 2, errorString)) {
+                return false;
+            }
+        }
+        // Free memory as soon as possible
+        strip.mData = QByteArray();
+    }
+    return true;
+}
+
+QByteArray iccProfileFromJpegData(const QByteArray& data)
+{
+    static const char ICC_SIGNATURE[] = "ICC_PROFILE"; // Followed by a '\0'
+    static const int ICC_HEADER_LENGTH = 14; // Signature + sequence number + marker count
+
+    QMap<int, QByteArray> chunks;
+    int pos = 2; // Skip SOI
+    while (pos + 4 <= data.size()) {
+        if (uchar(data.at(pos)) != 0xFF) {
+            break;
+        }
+        const uchar marker = uchar(data.at(pos + 1));
+        if (marker == 0xDA || marker == 0xD9) {
+            break;
+        }
+        const int length = readUInt16(data, pos + 2);
+        const int payload = pos + 4;
+        if (marker == 0xE2 && length >= 2 + ICC_HEADER_LENGTH && pos + 2 + length <= data.size()
+            && memcmp(data.constData() + payload, ICC_SIGNATURE, sizeof(ICC_SIGNATURE)) == 0) {
+            const int sequenceNumber = uchar(data.at(payload + 12));
+            chunks.insert(sequenceNumber, data.mid(payload + ICC_HEADER_LENGTH, length - 2 - ICC_HEADER_LENGTH));
+        }
+        pos += 2 + length;
+    }
+
+    QByteArray profile;
+    Q_FOREACH(const QByteArray& chunk, chunks) {
+        profile += chunk;
+    }
+    return profile;
+}
+
+//------------------------------------------------------------------------
+//
+// PNG
+//
+//------------------------------------------------------------------------
+enum PngFilter {
+    PNG_FILTER_NONE = 0,
+    PNG_FILTER_SUB,
+    PNG_FILTER_UP,
+    PNG_FILTER_AVERAGE,
+    PNG_FILTER_PAETH,
+    PNG_FILTER_COUNT
+};
+
+static inline uchar paethPredictor(int a, int b, int c)
+{
+    const int p = a + b - c;
+    const int pa = abs(p - a);
+    const int pb = abs(p - b);
+    const int pc = abs(p - c);
+    if (pa <= pb && pa <= pc) {
+        return a;
+    }
+    return pb <= pc ? b : c;
+}
+
+/**
+ * Applies @p filter to @p row, storing the result in @p out. Returns the sum
+ * of the absolute values of the filtered bytes, which is the heuristic
+ * libpng uses to pick a filter.
+ */
+static uint filterRow(PngFilter filter, const uchar* row, const uchar* prev, int rowBytes, int bpp, uchar* out)
+{
+    uint sum = 0;
+    for (int x = 0; x < rowBytes; ++x) {
+        const int left = x >= bpp ? row[x - bpp] : 0;
+        const int up = prev[x];
+        const int upLeft = x >= bpp ? prev[x - bpp] : 0;
+        uchar value = row[x];
+        switch (filter) {
+        case PNG_FILTER_NONE:
+            break;
+        case PNG_FILTER_SUB:
+            value -= left;
+            break;
+        case PNG_FILTER_UP:
+            value -= up;
+            break;
+        case PNG_FILTER_AVERAGE:
+            value -= (left + up) / 2;
+            break;
+        case PNG_FILTER_PAETH:
+            value -= paethPredictor(left, up, upLeft);
+            break;
+        default:
+            break;
+        }
+        out[x] = value;
+        sum += value < 128 ? value : 256 - value;
+    }
+    return sum;
+}
+
+struct PngStripEncoder
+{
+    PngStripEncoder(const QImage& image, QImage::Format format, int bpp)
+    : mImage(image)
+    , mFormat(format)
+    , mBpp(bpp)
+    {}
+
+    void operator()(Strip& strip) const
+    {
+        // Include the row above the strip: it is needed to filter the first
+        // row of the strip
+        const int extraRow = strip.mTop > 0 ? 1 : 0;
+        const QImage image = stripImage(mImage, strip.mTop - extraRow, strip.mHeight + extraRow, mFormat);
+
+        const int rowBytes = image.width() * mBpp;
+        const QByteArray zeroRow(rowBytes, 0);
+        QByteArray raw(strip.mHeight * (rowBytes + 1), Qt::Uninitialized);
+        QByteArray candidate(rowBytes, Qt::Uninitialized);
+        uchar* out = reinterpret_cast<uchar*>(raw.data());
+        for (int y = 0; y < strip.mHeight; ++y) {
+            const uchar* row = image.constScanLine(y + extraRow);
+            const uchar* prev = (y + extraRow > 0)
+                ? image.constScanLine(y + extraRow - 1)
+                : reinterpret_cast<const uchar*>(zeroRow.constData());
+            uint bestSum = UINT_MAX;
+            for (int filter = PNG_FILTER_NONE; filter < PNG_FILTER_COUNT; ++filter) {
+                uchar* candidatePtr = reinterpret_cast<uchar*>(candidate.data());
+                const uint sum = filterRow(PngFilter(filter), row, prev, rowBytes, mBpp, candidatePtr);
+                if (sum < bestSum) {
+                    bestSum = sum;
+                    out[0] = uchar(filter);
+                    memcpy(out + 1, candidatePtr, rowBytes);
+                }
+            }
+            out += rowBytes + 1;
+        }
+
+        strip.mRawLength = raw.size();
+        strip.mAdler = adler32(adler32(0, Z_NULL, 0), reinterpret_cast<const Bytef*>(raw.constData()), raw.size());
+
+        // Raw deflate: the zlib header and trailer are written once for all
+        // strips. Intermediate strips end with a sync flush so that they end
+        // on a byte boundary and can be concatenated.
+        z_stream stream;
+        memset(&stream, 0, sizeof(stream));
+        if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            strip.mOk = false;
+            return;
+        }
+        strip.mData.resize(int(deflateBound(&stream, raw.size())) + 64);
+        stream.next_in = reinterpret_cast<Bytef*>(raw.data());
+        stream.avail_in = raw.size();
+        stream.next_out = reinterpret_cast<Bytef*>(strip.mData.data());
+        stream.avail_out = strip.mData.size();
+        const int flush = strip.mLast ? Z_FINISH : Z_SYNC_FLUSH;
+        int ret;
+        while (true) {
+            ret = deflate(&stream, flush);
+            if (ret == Z_STREAM_ERROR || ret == Z_STREAM_END || stream.avail_out > 0) {
+                break;
+            }
+            // Output buffer was too small
+            const int oldSize = strip.mData.size();
+            strip.mData.resize(oldSize * 2);
+            stream.next_out = reinterpret_cast<Bytef*>(strip.mData.data() + oldSize);
+            stream.avail_out = strip.mData.size() - oldSize;
+        }
+        strip.mData.resize(int(stream.total_out));
+        deflateEnd(&stream);
+        strip.mOk = strip.mLast ? ret == Z_STREAM_END : ret == Z_OK;
+    }
+
+    const QImage mImage;
+    const QImage::Format mFormat;
+    const int mBpp;
+};
+
+static void appendUInt32(QByteArray* array, quint32 value)
+{
+    array->append(char(value >> 24));
+    array->append(char((value >> 16) & 0xFF));
+    array->append(char((value >> 8) & 0xFF));
+    array->append(char(value & 0xFF));
+}
+
+static bool writePngChunk(QIODevice* device, const char* type, const QByteArray& data, QString* errorString)
+{
+    QByteArray header;
+    appendUInt32(&header, data.size());
+    header.append(type, 4);
+    uLong crc = crc32(0, Z_NULL, 0);
+    crc = crc32(crc, reinterpret_cast<const Bytef*>(type), 4);
+    crc = crc32(crc, reinterpret_cast<const Bytef*>(data.constData()), data.size());
+    QByteArray footer;
+    appendUInt32(&footer, crc);
+    return writeData(device, header.constData(), header.size(), errorString)
+        && writeData(device, data.constData(), data.size(), errorString)
+        && writeData(device, footer.constData(), footer.size(), errorString);
+}
+
+bool writePng(QIODevice* device, const QImage& image_, QString* errorString)
+{
+    if (image_.isNull()) {
+        *errorString = i18nc("@info", "No image to save.");
+        return false;
+    }
+    if (image_.depth() > 32) {
+        // Keep the extra precision of high bit depth images
+        QImageWriter writer(device, "png");
+        if (!writer.write(image_)) {
+            *errorString = writer.errorString();
+            return false;
+        }
+        return true;
+    }
+    const QImage image = imageWithoutColorTable(image_);
+
+    QImage::Format format;
+    int bpp;
+    uchar colorType;
+    if (image.format() == QImage::Format_Grayscale8) {
+        format = QImage::Format_Grayscale8;
+        bpp = 1;
+        colorType = 0;
+    } else if (image.hasAlphaChannel()) {
+        format = QImage::Format_RGBA8888;
+        bpp = 4;
+        colorType = 6;
+    } else {
+        format = QImage::Format_RGB888;
+        bpp = 3;
+        colorType = 2;
+    }
+
+    QVector<Strip> strips = createStrips(image.height(), 1);
+    LOG("Encoding PNG in" << strips.count() << "strips");
+    QtConcurrent::blockingMap(strips, PngStripEncoder(image, format, bpp));
+
+    static const char signature[] = { char(0x89), 'P', 'N', 'G', '\r', '\n', char(0x1A), '\n' };
+    if (!writeData(device, signature, sizeof(signature), errorString)) {
+        return false;
+    }
+
+    QByteArray ihdr;
+    appendUInt32(&ihdr, image.width());
+    appendUInt32(&ihdr, image.height());
+    ihdr.append(char(8)); // Bit depth
+    ihdr.append(char(colorType));
+    ihdr.append(char(0)); // Compression method
+    ihdr.append(char(0)); // Filter method
+    ihdr.append(char(0)); // Interlace method
+    if (!writePngChunk(device, "IHDR", ihdr, errorString)) {
+        return false;
+    }
+
+    if (image.dotsPerMeterX() > 0 && image.dotsPerMeterY() > 0) {
+        QByteArray phys;
+        appendUInt32(&phys, image.dotsPerMeterX());
+        appendUInt32(&phys, image.dotsPerMeterY());
+        phys.append(char(1)); // Unit is meter
+        if (!writePngChunk(device, "pHYs", phys, errorString)) {
+            return false;
+        }
+    }
+
+    Q_FOREACH(const QString& key, image.textKeys()) {
+        const QByteArray keyword = key.toLatin1().left(79);
+        if (keyword.isEmpty()) {
+            continue;
+        }
+        const QByteArray text = keyword + '\0' + image.text(key).toLatin1();
+        if (!writePngChunk(device, "tEXt", text, errorString)) {
+            return false;
+        }
+    }
+
+    uLong adler = adler32(0, Z_NULL, 0);
+    for (int idx = 0; idx < strips.count(); ++idx) {
+        Strip& strip = strips[idx];
+        if (!strip.mOk) {
+            *errorString = i18nc("@info", "PNG compression failed.");
+            return false;
+        }
+        adler = adler32_combine(adler, strip.mAdler, strip.mRawLength);
+        QByteArray idat;
+        if (idx == 0) {
+            // zlib header: deflate, 32K window, default compression
+            idat.append(char(0x78));
+            idat.append(char(0x9C));
+        }
+        idat.append(strip.mData);
+        strip.mData = QByteArray();
+        if (strip.mLast) {
+            appendUInt32(&idat, adler);
+        }
+        if (!writePngChunk(device, "IDAT", idat, errorString)) {
+            return false;
+        }
+    }
+
+    return writePngChunk(device, "IEND", QByteArray(), errorString);
+}
+
+//------------------------------------------------------------------------
+//
+// Generic entry points
+//
+//------------------------------------------------------------------------
+void setMaxStripCount(int count)
+{
+    sMaxStripCount = count;
+}
+
+int stripCount(const QImage& image, const QByteArray& format)
+{
+    const QByteArray lower = format.toLower();
+    if (lower == "jpeg" || lower == "jpg") {
+        // Same alignment as writeJpeg(): only grayscale images stay gray once
+        // their color table has been dropped
+        const bool gray = image.format() == QImage::Format_Grayscale8;
+        return createStrips(image.height(), gray ? JPEG_MCU_HEIGHT_GRAY : JPEG_MCU_HEIGHT_COLOR).count();
+    }
+    return createStrips(image.height(), 1).count();
+}
+
+bool canWrite(const QByteArray& format)
+{
+    const QByteArray lower = format.toLower();
+    return lower == "jpeg" || lower == "jpg" || lower == "png";
+}
+
+bool write(QIODevice* device, const QImage& image, const QByteArray& format, QString* errorString)
+{
+    const QByteArray lower = format.toLower();
+    if (lower == "png") {
+        return writePng(device, image, errorString);
+    }
+    if (lower == "jpeg" || lower == "jpg") {
+        return writeJpeg(device, image, DEFAULT_JPEG_QUALITY, QByteArray(), errorString);
+    }
+    qWarning() << "Unsupported format" << format;
+    return false;
+}
+
+} // namespace
+
+} // namespace
@@ -0,0 +1,97 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2019 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef PARALLELIMAGEENCODER_H
+#define PARALLELIMAGEENCODER_H
+
+#include <lib/gwenviewlib_export.h>
+
+// Qt
+#include <QByteArray>
+
+// KDE
+
+// Local
+
+class QImage;
+class QIODevice;
+class QString;
+
+namespace Gwenview
+{
+
+/**
+ * Encoders which split the image in horizontal strips and encode them in
+ * parallel.
+ *
+ * JPEG strips are encoded with a restart marker at the end of each MCU row,
+ * so that their entropy-coded data can be concatenated into a single scan.
+ * PNG strips are filtered and deflated independently, then concatenated into
+ * a single zlib stream.
+ *
+ * All functions expect @p device to be opened for writing.
+ */
+namespace ParallelImageEncoder
+{
+
+/**
+ * Quality used when none is specified, same as QImageWriter
+ */
+const int DEFAULT_JPEG_QUALITY = 75;
+
+/**
+ * Sets the maximum number of strips images are split in. 0, the default,
+ * means QThread::idealThreadCount(). Useful for unit-testing the stitching
+ * of strips on machines with a single core.
+ */
+GWENVIEWLIB_EXPORT void setMaxStripCount(int count);
+
+/**
+ * Returns the number of strips @p image is split in when written as
+ * @p format
+ */
+GWENVIEWLIB_EXPORT int stripCount(const QImage& image, const QByteArray& format);
+
+/**
+ * Returns true if @p format can be written by write()
+ */
+GWENVIEWLIB_EXPORT bool canWrite(const QByteArray& format);
+
+GWENVIEWLIB_EXPORT bool write(QIODevice* device, const QImage& image, const QByteArray& format, QString* errorString);
+
+/**
+ * Writes @p image as a baseline JPEG. If @p iccProfile is not empty, it is
+ * embedded as APP2 markers.
+ */
+GWENVIEWLIB_EXPORT bool writeJpeg(QIODevice* device, const QImage& image, int quality, const QByteArray& iccProfile, QString* errorString);
+
+GWENVIEWLIB_EXPORT bool writePng(QIODevice* device, const QImage& image, QString* errorString);
+
+/**
+ * Returns the ICC profile embedded in the APP2 markers of @p jpegData, or an
+ * empty array if there is none
+ */
+GWENVIEWLIB_EXPORT QByteArray iccProfileFromJpegData(const QByteArray& jpegData);
+
+} // namespace
+
+} // namespace
+
+#endif /* PARALLELIMAGEENCODER_H */
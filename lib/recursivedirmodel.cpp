@@ -27,45 +27,194 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 // KDE
 #include <KDirLister>
 #include <KDirModel>
+#include <KDirWatch>
+#include <KIO/UDSEntry>
 
 // Qt
 #include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFutureWatcher>
+#include <QSet>
+#include <QThread>
+#include <QThreadPool>
+#include <QTimer>
+#include <QtConcurrentRun>
+#include <qplatformdefs.h>
+
+// System
+#include <algorithm>
+#ifdef Q_OS_UNIX
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
 
 namespace Gwenview
 {
 
+// How long to accumulate listed items before inserting them as one batch
+static const int FLUSH_INTERVAL = 100;
+
+// How long to wait for more change notifications before rescanning dirs
+static const int RESCAN_DELAY = 200;
+
+/**
+ * Content of a local dir, as read by a worker thread
+ */
+struct LocalDirListing
+{
+    LocalDirListing()
+    : mOk(false)
+    {}
+
+    QString mPath;
+    bool mOk;
+    KFileItemList mFiles;
+    QSet<QString> mSubDirNames;
+};
+
+#ifdef Q_OS_UNIX
+static KFileItem createLocalFileItem(const QString& path, const QString& name, const QT_STATBUF& buf)
+{
+    KIO::UDSEntry entry;
+    entry.insert(KIO::UDSEntry::UDS_NAME, name);
+    entry.insert(KIO::UDSEntry::UDS_FILE_TYPE, buf.st_mode & S_IFMT);
+    entry.insert(KIO::UDSEntry::UDS_ACCESS, buf.st_mode & 07777);
+    entry.insert(KIO::UDSEntry::UDS_SIZE, buf.st_size);
+    entry.insert(KIO::UDSEntry::UDS_MODIFICATION_TIME, buf.st_mtime);
+    entry.insert(KIO::UDSEntry::UDS_ACCESS_TIME, buf.st_atime);
+    entry.insert(KIO::UDSEntry::UDS_LOCAL_PATH, path);
+    return KFileItem(entry, QUrl::fromLocalFile(path));
+}
+
+/**
+ * Lists @p path without going through KIO. Only one stat() per entry, and
+ * thread-safe, so several dirs can be listed at the same time.
+ */
+static LocalDirListing listLocalDir(const QString& path)
+{
+    LocalDirListing listing;
+    listing.mPath = path;
+
+    QByteArray encodedPrefix = QFile::encodeName(path);
+    DIR* dir = ::opendir(encodedPrefix.constData());
+    if (!dir) {
+        return listing;
+    }
+    listing.mOk = true;
+    if (!encodedPrefix.endsWith('/')) {
+        encodedPrefix += '/';
+    }
+    const QString prefix = QFile::decodeName(encodedPrefix);
+
+    while (struct dirent* ent = ::readdir(dir)) {
+        // Skips "." and "..", hidden files are not listed by KDirLister either
+        if (ent->d_name[0] == '.') {
+            continue;
+        }
+        const QByteArray encodedPath = encodedPrefix + ent->d_name;
+        QT_STATBUF buf;
+        if (QT_LSTAT(encodedPath.constData(), &buf) != 0) {
+            continue;
+        }
+        const bool isLink = S_ISLNK(buf.st_mode);
+        if (isLink && QT_STAT(encodedPath.constData(), &buf) != 0) {
+            // Dangling link
+            continue;
+        }
+        const QString name = QFile::decodeName(ent->d_name);
+        if (S_ISDIR(buf.st_mode)) {
+            // Do not follow links to dirs, they could create cycles
+            if (!isLink) {
+                listing.mSubDirNames << name;
+            }
+        } else if (S_ISREG(buf.st_mode)) {
+            listing.mFiles << createLocalFileItem(prefix + name, name, buf);
+        }
+    }
+    ::closedir(dir);
+    return listing;
+}
+#endif
+
 struct RecursiveDirModelPrivate {
+    RecursiveDirModel* q;
     KDirLister* mDirLister;
 
+    /* @defgroup local Local listing, used instead of mDirLister for local urls
+     * @{ */
+    struct DirInfo
+    {
+        QSet<QString> mFileNames;
+        QSet<QString> mSubDirNames;
+    };
+    bool mLocalListing;
+    KDirWatch* mDirWatch;
+    QThreadPool mThreadPool;
+    // Incremented by setUrl(), listings started for a previous url are ignored
+    int mGeneration;
+    int mPendingListingCount;
+    QHash<QString, DirInfo> mDirInfos;
+    KFileItemList mPendingItems;
+    QTimer mFlushTimer;
+    QSet<QString> mDirtyDirs;
+    QTimer mRescanTimer;
+    /* @} */
+
+    QUrl mUrl;
+
     int rowForUrl(const QUrl &url) const
     {
+        const int row = mRowForUrl.value(url, -1);
+        if (row < mIndexedRowCount) {
+            return row;
+        }
+        updateIndex();
         return mRowForUrl.value(url, -1);
     }
 
-    void removeAt(int row)
+    void addItems(const KFileItemList& items)
     {
-        KFileItem item = mList.takeAt(row);
-        mRowForUrl.remove(item.url());
-
-        // Decrease row value for all urls after the one we removed
-        // ("row" now points to the item after the one we removed since we used takeAt)
-        const int count = mList.count();
-        for (; row < count; ++row) {
-            QUrl url = mList.at(row).url();
-            mRowForUrl[url]--;
+        const int first = mList.count();
+        const bool upToDate = mIndexedRowCount == first;
+        for (int idx = 0; idx < items.count(); ++idx) {
+            mRowForUrl.insert(items.at(idx).url(), first + idx);
+        }
+        mList.append(items);
+        if (upToDate) {
+            mIndexedRowCount = mList.count();
         }
     }
 
-    void addItem(const KFileItem& item)
+    /**
+     * Removes @p rows, emitting one beginRemoveRows() per range of
+     * consecutive rows
+     */
+    void removeRows(QVector<int> rows)
     {
-        mRowForUrl.insert(item.url(), mList.count());
-        mList.append(item);
+        std::sort(rows.begin(), rows.end());
+        rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+
+        // Remove ranges starting from the end, so that rows of the remaining
+        // ranges are still valid
+        int idx = rows.count() - 1;
+        while (idx >= 0) {
+            const int last = rows.at(idx);
+            int first = last;
+            for (--idx; idx >= 0 && rows.at(idx) == first - 1; --idx) {
+                first = rows.at(idx);
+            }
+            q->beginRemoveRows(QModelIndex(), first, last);
+            removeRange(first, last);
+            q->endRemoveRows();
+        }
     }
 
     void clear()
     {
         mRowForUrl.clear();
         mList.clear();
+        mIndexedRowCount = 0;
     }
 
     // RecursiveDirModel can only access mList through this read-only getter.
@@ -75,39 +224,254 @@ struct RecursiveDirModelPrivate {
         return mList;
     }
 
+    void stopLocalListing()
+    {
+        ++mGeneration;
+        mPendingListingCount = 0;
+        mPendingItems.clear();
+        mFlushTimer.stop();
+        mDirtyDirs.clear();
+        mRescanTimer.stop();
+        for (auto it = mDirInfos.constBegin(); it != mDirInfos.constEnd(); ++it) {
+            mDirWatch->removeDir(it.key());
+        }
+        mDirInfos.clear();
+    }
+
+    void scheduleListing(const QString& path)
+    {
+#ifdef Q_OS_UNIX
+        if (!mDirInfos.contains(path)) {
+            // Watch before listing, so that no change is missed
+            mDirWatch->addDir(path);
+            mDirInfos.insert(path, DirInfo());
+        }
+        ++mPendingListingCount;
+        const int generation = mGeneration;
+        QFutureWatcher<LocalDirListing>* watcher = new QFutureWatcher<LocalDirListing>(q);
+        QObject::connect(watcher, &QFutureWatcherBase::finished, q, [this, watcher, generation]() {
+            watcher->deleteLater();
+            if (generation != mGeneration) {
+                return;
+            }
+            applyListing(watcher->result());
+        });
+        watcher->setFuture(QtConcurrent::run(&mThreadPool, listLocalDir, path));
+#else
+        Q_UNUSED(path);
+#endif
+    }
+
+    void applyListing(const LocalDirListing& listing)
+    {
+        --mPendingListingCount;
+        if (!mDirInfos.contains(listing.mPath)) {
+            // Removed while it was being listed
+            finishListingIfDone();
+            return;
+        }
+        if (!listing.mOk) {
+            QVector<int> rows;
+            collectRowsForDir(listing.mPath, &rows);
+            removeDirInfo(listing.mPath);
+            removeRows(rows);
+            finishListingIfDone();
+            return;
+        }
+
+        DirInfo& info = mDirInfos[listing.mPath];
+        QSet<QString> removedFileNames = info.mFileNames;
+        for (const KFileItem& item : listing.mFiles) {
+            const QString name = item.name();
+            if (!removedFileNames.remove(name)) {
+                info.mFileNames.insert(name);
+                mPendingItems << item;
+            }
+        }
+        info.mFileNames -= removedFileNames;
+        const QSet<QString> removedSubDirNames = info.mSubDirNames - listing.mSubDirNames;
+        const QSet<QString> addedSubDirNames = listing.mSubDirNames - info.mSubDirNames;
+        info.mSubDirNames = listing.mSubDirNames;
+
+        if (!removedFileNames.isEmpty() || !removedSubDirNames.isEmpty()) {
+            QVector<int> rows;
+            const QDir dir(listing.mPath);
+            for (const QString& name : removedFileNames) {
+                collectRow(dir.absoluteFilePath(name), &rows);
+            }
+            for (const QString& name : removedSubDirNames) {
+                collectRowsForDir(dir.absoluteFilePath(name), &rows);
+                removeDirInfo(dir.absoluteFilePath(name));
+            }
+            flushPendingItems();
+            removeRows(rows);
+        }
+
+        const QDir dir(listing.mPath);
+        for (const QString& name : addedSubDirNames) {
+            scheduleListing(dir.absoluteFilePath(name));
+        }
+
+        if (!mFlushTimer.isActive()) {
+            mFlushTimer.start();
+        }
+        finishListingIfDone();
+    }
+
+    void finishListingIfDone()
+    {
+        if (mPendingListingCount > 0) {
+            return;
+        }
+        flushPendingItems();
+        emit q->completed();
+    }
+
+    void flushPendingItems()
+    {
+        mFlushTimer.stop();
+        if (mPendingItems.isEmpty()) {
+            return;
+        }
+        const int first = mList.count();
+        q->beginInsertRows(QModelIndex(), first, first + mPendingItems.count() - 1);
+        addItems(mPendingItems);
+        q->endInsertRows();
+        mPendingItems.clear();
+    }
+
+    void collectRow(const QString& path, QVector<int>* rows)
+    {
+        const QUrl url = QUrl::fromLocalFile(path);
+        const int row = rowForUrl(url);
+        if (row != -1) {
+            *rows << row;
+            return;
+        }
+        // Not inserted yet
+        for (int idx = mPendingItems.count() - 1; idx >= 0; --idx) {
+            if (mPendingItems.at(idx).url() == url) {
+                mPendingItems.removeAt(idx);
+                return;
+            }
+        }
+    }
+
+    void collectRowsForDir(const QString& path, QVector<int>* rows)
+    {
+        const DirInfo info = mDirInfos.value(path);
+        const QDir dir(path);
+        for (const QString& name : info.mFileNames) {
+            collectRow(dir.absoluteFilePath(name), rows);
+        }
+        for (const QString& name : info.mSubDirNames) {
+            collectRowsForDir(dir.absoluteFilePath(name), rows);
+        }
+    }
+
+    void removeDirInfo(const QString& path)
+    {
+        const DirInfo info = mDirInfos.take(path);
+        mDirWatch->removeDir(path);
+        mDirtyDirs.remove(path);
+        const QDir dir(path);
+        for (const QString& name : info.mSubDirNames) {
+            removeDirInfo(dir.absoluteFilePath(name));
+        }
+    }
+
 private:
     KFileItemList mList;
-    QHash<QUrl, int> mRowForUrl;
+    // Rows below mIndexedRowCount are up to date in mRowForUrl. Removing rows
+    // only lowers mIndexedRowCount, the following rows get renumbered the next
+    // time one of them is looked up.
+    mutable QHash<QUrl, int> mRowForUrl;
+    mutable int mIndexedRowCount = 0;
+
+    void updateIndex() const
+    {
+        const int count = mList.count();
+        for (int row = mIndexedRowCount; row < count; ++row) {
+            mRowForUrl[mList.at(row).url()] = row;
+        }
+        mIndexedRowCount = count;
+    }
+
+    void removeRange(int first, int last)
+    {
+        for (int row = first; row <= last; ++row) {
+            mRowForUrl.remove(mList.at(row).url());
+        }
+        mList.erase(mList.begin() + first, mList.begin() + last + 1);
+        mIndexedRowCount = qMin(mIndexedRowCount, first);
+    }
 };
 
 RecursiveDirModel::RecursiveDirModel(QObject* parent)
 : QAbstractListModel(parent)
 , d(new RecursiveDirModelPrivate)
 {
+    d->q = this;
     d->mDirLister = new KDirLister(this);
     connect(d->mDirLister, &KDirLister::itemsAdded, this, &RecursiveDirModel::slotItemsAdded);
     connect(d->mDirLister, &KDirLister::itemsDeleted, this, &RecursiveDirModel::slotItemsDeleted);
     connect(d->mDirLister, QOverload<>::of(&KDirLister::completed), this, &RecursiveDirModel::completed);
     connect(d->mDirLister, QOverload<>::of(&KDirLister::clear), this, &RecursiveDirModel::slotCleared);
     connect(d->mDirLister, QOverload<const QUrl &>::of(&KDirLister::clear), this, &RecursiveDirModel::slotDirCleared);
+
+    d->mDirWatch = new KDirWatch(this);
+    connect(d->mDirWatch, &KDirWatch::dirty, this, &RecursiveDirModel::slotDirDirty);
+    d->mLocalListing = false;
+    d->mGeneration = 0;
+    d->mPendingListingCount = 0;
+    // Listing is mostly waiting for the disk, use more threads than cores
+    d->mThreadPool.setMaxThreadCount(qMax(4, 2 * QThread::idealThreadCount()));
+
+    d->mFlushTimer.setInterval(FLUSH_INTERVAL);
+    d->mFlushTimer.setSingleShot(true);
+    connect(&d->mFlushTimer, &QTimer::timeout, this, [this]() {
+        d->flushPendingItems();
+    });
+
+    d->mRescanTimer.setInterval(RESCAN_DELAY);
+    d->mRescanTimer.setSingleShot(true);
+    connect(&d->mRescanTimer, &QTimer::timeout, this, [this]() {
+        const QSet<QString> dirs = d->mDirtyDirs;
+        d->mDirtyDirs.clear();
+        for (const QString& path : dirs) {
+            d->scheduleListing(path);
+        }
+    });
 }
 
 RecursiveDirModel::~RecursiveDirModel()
 {
+    d->stopLocalListing();
+    d->mThreadPool.waitForDone();
     delete d;
 }
 
 QUrl RecursiveDirModel::url() const
 {
-    return d->mDirLister->url();
+    return d->mUrl;
 }
 
 void RecursiveDirModel::setUrl(const QUrl &url)
 {
+    d->stopLocalListing();
+    d->mDirLister->stop();
     beginResetModel();
     d->clear();
     endResetModel();
-    d->mDirLister->openUrl(url);
+    d->mUrl = url;
+#ifdef Q_OS_UNIX
+    d->mLocalListing = url.isLocalFile();
+#endif
+    if (d->mLocalListing) {
+        d->scheduleListing(url.toLocalFile());
+    } else {
+        d->mDirLister->openUrl(url);
+    }
 }
 
 int RecursiveDirModel::rowCount(const QModelIndex& parent) const
@@ -145,6 +509,9 @@ QVariant RecursiveDirModel::data(const QModelIndex& index, int role) const
 
 void RecursiveDirModel::slotItemsAdded(const QUrl&, const KFileItemList& newList)
 {
+    if (d->mLocalListing) {
+        return;
+    }
     QList<QUrl> dirUrls;
     KFileItemList fileList;
     Q_FOREACH(const KFileItem& item, newList) {
@@ -158,10 +525,8 @@ void RecursiveDirModel::slotItemsAdded(const QUrl&, const KFileItemList& newList
     }
 
     if (!fileList.isEmpty()) {
-        beginInsertRows(QModelIndex(), d->list().count(), d->list().count() + fileList.count());
-        Q_FOREACH(const KFileItem& item, fileList) {
-            d->addItem(item);
-        }
+        beginInsertRows(QModelIndex(), d->list().count(), d->list().count() + fileList.count() - 1);
+        d->addItems(fileList);
         endInsertRows();
     }
 
@@ -172,6 +537,10 @@ void RecursiveDirModel::slotItemsAdded(const QUrl&, const KFileItemList& newList
 
 void RecursiveDirModel::slotItemsDeleted(const KFileItemList& list)
 {
+    if (d->mLocalListing) {
+        return;
+    }
+    QVector<int> rows;
     Q_FOREACH(const KFileItem& item, list) {
         if (item.isDir()) {
             continue;
@@ -182,15 +551,14 @@ void RecursiveDirModel::slotItemsDeleted(const KFileItemList& list)
             GV_FATAL_FAILS;
             continue;
         }
-        beginRemoveRows(QModelIndex(), row, row);
-        d->removeAt(row);
-        endRemoveRows();
+        rows << row;
     }
+    d->removeRows(rows);
 }
 
 void RecursiveDirModel::slotCleared()
 {
-    if (d->list().isEmpty()) {
+    if (d->mLocalListing || d->list().isEmpty()) {
         return;
     }
     beginResetModel();
@@ -200,15 +568,28 @@ void RecursiveDirModel::slotCleared()
 
 void RecursiveDirModel::slotDirCleared(const QUrl &dirUrl)
 {
-    int row;
-    for (row = d->list().count() - 1; row >= 0; --row) {
+    if (d->mLocalListing) {
+        return;
+    }
+    QVector<int> rows;
+    for (int row = d->list().count() - 1; row >= 0; --row) {
         const QUrl url = d->list().at(row).url();
         if (dirUrl.isParentOf(url)) {
-            beginRemoveRows(QModelIndex(), row, row);
-            d->removeAt(row);
-            endRemoveRows();
+            rows << row;
         }
     }
+    d->removeRows(rows);
+}
+
+void RecursiveDirModel::slotDirDirty(const QString& path)
+{
+    if (!d->mDirInfos.contains(path)) {
+        return;
+    }
+    d->mDirtyDirs.insert(path);
+    if (!d->mRescanTimer.isActive()) {
+        d->mRescanTimer.start();
+    }
 }
 
 } // namespace
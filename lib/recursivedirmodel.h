@@ -38,6 +38,9 @@ namespace Gwenview
 struct RecursiveDirModelPrivate;
 /**
  * Recursively list content of a dir
+ *
+ * Local dirs are listed directly by worker threads and watched with
+ * KDirWatch, other urls go through KDirLister.
  */
 class GWENVIEWLIB_EXPORT RecursiveDirModel : public QAbstractListModel
 {
@@ -60,6 +63,7 @@ private Q_SLOTS:
     void slotItemsDeleted(const KFileItemList&);
     void slotDirCleared(const QUrl&);
     void slotCleared();
+    void slotDirDirty(const QString&);
 private:
     RecursiveDirModelPrivate* const d;
 };
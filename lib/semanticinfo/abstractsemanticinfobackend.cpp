@@ -22,8 +22,13 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #include "abstractsemanticinfobackend.h"
 
 // Qt
+#include <QAtomicInt>
+#include <QFutureWatcher>
 #include <QStringList>
+#include <QThread>
+#include <QThreadPool>
 #include <QVariant>
+#include <QtConcurrentRun>
 
 // KDE
 
@@ -50,10 +55,61 @@ TagSet TagSet::fromVariant(const QVariant& variant)
     return TagSet::fromList(lst);
 }
 
+struct AbstractSemanticInfoBackEndPrivate
+{
+    QThreadPool mThreadPool;
+    QAtomicInt mAborted;
+};
+
 AbstractSemanticInfoBackEnd::AbstractSemanticInfoBackEnd(QObject* parent)
 : QObject(parent)
+, d(new AbstractSemanticInfoBackEndPrivate)
 {
     qRegisterMetaType<SemanticInfo>("SemanticInfo");
+    qRegisterMetaType<SemanticInfoForUrl>("Gwenview::SemanticInfoForUrl");
+    // Reading semantic info is mostly waiting for the disk, so use more
+    // threads than there are cores
+    d->mThreadPool.setMaxThreadCount(qMax(4, QThread::idealThreadCount()));
+}
+
+AbstractSemanticInfoBackEnd::~AbstractSemanticInfoBackEnd()
+{
+    Q_ASSERT(d->mThreadPool.activeThreadCount() == 0);
+    delete d;
+}
+
+void AbstractSemanticInfoBackEnd::retrieveSemanticInfoList(const QList<QUrl>& urls)
+{
+    for (int pos = 0; pos < urls.count(); pos += RetrieveChunkSize) {
+        QFutureWatcher<SemanticInfoForUrl>* watcher = new QFutureWatcher<SemanticInfoForUrl>(this);
+        connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher]() {
+            watcher->deleteLater();
+            const SemanticInfoForUrl result = watcher->result();
+            if (!result.isEmpty()) {
+                emit semanticInfoListRetrieved(result);
+            }
+        });
+        watcher->setFuture(QtConcurrent::run(&d->mThreadPool, this, &AbstractSemanticInfoBackEnd::readSemanticInfoChunk, urls.mid(pos, RetrieveChunkSize)));
+    }
+}
+
+SemanticInfoForUrl AbstractSemanticInfoBackEnd::readSemanticInfoChunk(const QList<QUrl>& urls)
+{
+    SemanticInfoForUrl result;
+    Q_FOREACH(const QUrl& url, urls) {
+        if (d->mAborted.load()) {
+            return SemanticInfoForUrl();
+        }
+        result.insert(url, readSemanticInfo(url));
+    }
+    return result;
+}
+
+void AbstractSemanticInfoBackEnd::abortSemanticInfoRetrievals()
+{
+    d->mAborted.store(1);
+    d->mThreadPool.clear();
+    d->mThreadPool.waitForDone();
 }
 
 } // namespace
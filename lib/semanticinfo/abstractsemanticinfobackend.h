@@ -24,15 +24,15 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #include <lib/gwenviewlib_export.h>
 
 // Qt
+#include <QHash>
 #include <QObject>
 #include <QSet>
+#include <QUrl>
 
 // KDE
 
 // Local
 
-class QUrl;
-
 namespace Gwenview
 {
 
@@ -65,6 +65,10 @@ struct SemanticInfo
     TagSet mTags;
 };
 
+typedef QHash<QUrl, SemanticInfo> SemanticInfoForUrl;
+
+struct AbstractSemanticInfoBackEndPrivate;
+
 /**
  * An abstract class, used by SemanticInfoDirModel to store and retrieve metadata.
  */
@@ -72,7 +76,13 @@ class AbstractSemanticInfoBackEnd : public QObject
 {
     Q_OBJECT
 public:
+    enum {
+        /// How many urls are handled by each worker in retrieveSemanticInfoList()
+        RetrieveChunkSize = 256
+    };
+
     explicit AbstractSemanticInfoBackEnd(QObject* parent);
+    ~AbstractSemanticInfoBackEnd() override;
 
     virtual TagSet allTags() const = 0;
 
@@ -82,6 +92,13 @@ public:
 
     virtual void retrieveSemanticInfo(const QUrl&) = 0;
 
+    /**
+     * Retrieves the semantic info of all urls in worker threads. Results are
+     * delivered in chunks of at most RetrieveChunkSize urls through
+     * semanticInfoListRetrieved().
+     */
+    void retrieveSemanticInfoList(const QList<QUrl>&);
+
     virtual QString labelForTag(const SemanticInfoTag&) const = 0;
 
     /**
@@ -93,10 +110,31 @@ public:
 Q_SIGNALS:
     void semanticInfoRetrieved(const QUrl&, const SemanticInfo&);
 
+    void semanticInfoListRetrieved(const Gwenview::SemanticInfoForUrl&);
+
     /**
      * Emitted whenever a new tag is added to allTags()
      */
     void tagAdded(const SemanticInfoTag&, const QString& label);
+
+protected:
+    /**
+     * Reads the semantic info of an url. Called from worker threads by
+     * retrieveSemanticInfoList(), so it must be thread-safe.
+     */
+    virtual SemanticInfo readSemanticInfo(const QUrl&) = 0;
+
+    /**
+     * Waits for the workers started by retrieveSemanticInfoList() and drops
+     * their results. Must be called by the destructor of subclasses, since
+     * the workers call readSemanticInfo().
+     */
+    void abortSemanticInfoRetrievals();
+
+private:
+    SemanticInfoForUrl readSemanticInfoChunk(const QList<QUrl>&);
+
+    AbstractSemanticInfoBackEndPrivate* const d;
 };
 
 } // namespace
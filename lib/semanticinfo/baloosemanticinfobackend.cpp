@@ -51,6 +51,7 @@ BalooSemanticInfoBackend::BalooSemanticInfoBackend(QObject* parent)
 
 BalooSemanticInfoBackend::~BalooSemanticInfoBackend()
 {
+    abortSemanticInfoRetrievals();
     delete d;
 }
 
@@ -83,14 +84,20 @@ void BalooSemanticInfoBackend::storeSemanticInfo(const QUrl &url, const Semantic
 
 void BalooSemanticInfoBackend::retrieveSemanticInfo(const QUrl &url)
 {
+    emit semanticInfoRetrieved(url, readSemanticInfo(url));
+}
+
+SemanticInfo BalooSemanticInfoBackend::readSemanticInfo(const QUrl &url)
+{
+    // UserMetaData only reads extended attributes, it is safe to use it from
+    // several threads
     KFileMetaData::UserMetaData md(url.toLocalFile());
 
     SemanticInfo si;
     si.mRating = md.rating();
     si.mDescription = md.userComment();
     si.mTags = md.tags().toSet();
-
-    emit semanticInfoRetrieved(url, si);
+    return si;
 }
 
 QString BalooSemanticInfoBackend::labelForTag(const SemanticInfoTag& uriString) const
@@ -57,6 +57,9 @@ public:
 
     SemanticInfoTag tagForLabel(const QString&) override;
 
+protected:
+    SemanticInfo readSemanticInfo(const QUrl&) override;
+
 private:
     struct Private;
     Private* const d;
@@ -22,6 +22,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #include "fakesemanticinfobackend.h"
 
 // Qt
+#include <QMutexLocker>
 #include <QStringList>
 
 // KDE
@@ -43,8 +44,14 @@ FakeSemanticInfoBackEnd::FakeSemanticInfoBackEnd(QObject* parent, InitializeMode
             ;
 }
 
+FakeSemanticInfoBackEnd::~FakeSemanticInfoBackEnd()
+{
+    abortSemanticInfoRetrievals();
+}
+
 void FakeSemanticInfoBackEnd::storeSemanticInfo(const QUrl &url, const SemanticInfo& semanticInfo)
 {
+    QMutexLocker locker(&mMutex);
     mSemanticInfoForUrl[url] = semanticInfo;
     mergeTagsWithAllTags(semanticInfo.mTags);
 }
@@ -60,6 +67,7 @@ void FakeSemanticInfoBackEnd::mergeTagsWithAllTags(const TagSet& set)
 
 TagSet FakeSemanticInfoBackEnd::allTags() const
 {
+    QMutexLocker locker(&mMutex);
     return mAllTags;
 }
 
@@ -69,6 +77,12 @@ void FakeSemanticInfoBackEnd::refreshAllTags()
 
 void FakeSemanticInfoBackEnd::retrieveSemanticInfo(const QUrl &url)
 {
+    emit semanticInfoRetrieved(url, readSemanticInfo(url));
+}
+
+SemanticInfo FakeSemanticInfoBackEnd::readSemanticInfo(const QUrl &url)
+{
+    QMutexLocker locker(&mMutex);
     if (!mSemanticInfoForUrl.contains(url)) {
         QString urlString = url.url();
         SemanticInfo semanticInfo;
@@ -89,7 +103,7 @@ void FakeSemanticInfoBackEnd::retrieveSemanticInfo(const QUrl &url)
         }
         mSemanticInfoForUrl[url] = semanticInfo;
     }
-    emit semanticInfoRetrieved(url, mSemanticInfoForUrl.value(url));
+    return mSemanticInfoForUrl.value(url);
 }
 
 QString FakeSemanticInfoBackEnd::labelForTag(const SemanticInfoTag& tag) const
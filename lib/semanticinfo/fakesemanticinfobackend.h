@@ -25,6 +25,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 
 // Qt
 #include <QHash>
+#include <QMutex>
 
 // KDE
 #include <QUrl>
@@ -45,6 +46,7 @@ class GWENVIEWLIB_EXPORT FakeSemanticInfoBackEnd : public AbstractSemanticInfoBa
 public:
     enum InitializeMode { InitializeEmpty, InitializeRandom };
     FakeSemanticInfoBackEnd(QObject* parent, InitializeMode initializeMode);
+    ~FakeSemanticInfoBackEnd();
 
     virtual TagSet allTags() const;
 
@@ -58,9 +60,15 @@ public:
 
     virtual SemanticInfoTag tagForLabel(const QString&);
 
+protected:
+    virtual SemanticInfo readSemanticInfo(const QUrl&);
+
 private:
     void mergeTagsWithAllTags(const TagSet&);
 
+    // Protects mSemanticInfoForUrl and mAllTags, which are accessed by
+    // readSemanticInfo() from worker threads
+    mutable QMutex mMutex;
     QHash<QUrl, SemanticInfo> mSemanticInfoForUrl;
     InitializeMode mInitializeMode;
     TagSet mAllTags;
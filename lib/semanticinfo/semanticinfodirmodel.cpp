@@ -24,6 +24,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 
 // Qt
 #include <QHash>
+#include <QMap>
+#include <QTimer>
 #include <QDebug>
 
 // KDE
@@ -63,6 +65,8 @@ struct SemanticInfoDirModelPrivate
 {
     SemanticInfoCache mSemanticInfoCache;
     AbstractSemanticInfoBackEnd* mBackEnd;
+    QList<QUrl> mPendingUrls;
+    QTimer mRetrieveTimer;
 };
 
 SemanticInfoDirModel::SemanticInfoDirModel(QObject* parent)
@@ -76,6 +80,11 @@ SemanticInfoDirModel::SemanticInfoDirModel(QObject* parent)
 #endif
 
     connect(d->mBackEnd, &AbstractSemanticInfoBackEnd::semanticInfoRetrieved, this, &SemanticInfoDirModel::slotSemanticInfoRetrieved, Qt::QueuedConnection);
+    connect(d->mBackEnd, &AbstractSemanticInfoBackEnd::semanticInfoListRetrieved, this, &SemanticInfoDirModel::slotSemanticInfoListRetrieved);
+
+    d->mRetrieveTimer.setInterval(0);
+    d->mRetrieveTimer.setSingleShot(true);
+    connect(&d->mRetrieveTimer, &QTimer::timeout, this, &SemanticInfoDirModel::retrievePendingSemanticInfo);
 
     connect(this, &SemanticInfoDirModel::modelAboutToBeReset, this, &SemanticInfoDirModel::slotModelAboutToBeReset);
 
@@ -90,6 +99,7 @@ SemanticInfoDirModel::~SemanticInfoDirModel()
 void SemanticInfoDirModel::clearSemanticInfoCache()
 {
     d->mSemanticInfoCache.clear();
+    d->mPendingUrls.clear();
 }
 
 bool SemanticInfoDirModel::semanticInfoAvailableForIndex(const QModelIndex& index) const
@@ -135,10 +145,23 @@ void SemanticInfoDirModel::retrieveSemanticInfoForIndex(const QModelIndex& index
     if (ArchiveUtils::fileItemIsDirOrArchive(item)) {
         return;
     }
+    const QUrl url = item.targetUrl();
+    SemanticInfoCache::const_iterator it = d->mSemanticInfoCache.constFind(url);
+    if (it != d->mSemanticInfoCache.constEnd() && !it.value().mValid) {
+        // Already being retrieved
+        return;
+    }
     SemanticInfoCacheItem cacheItem;
     cacheItem.mIndex = QPersistentModelIndex(index);
-    d->mSemanticInfoCache[item.targetUrl()] = cacheItem;
-    d->mBackEnd->retrieveSemanticInfo(item.targetUrl());
+    d->mSemanticInfoCache[url] = cacheItem;
+    d->mPendingUrls << url;
+    d->mRetrieveTimer.start();
+}
+
+void SemanticInfoDirModel::retrievePendingSemanticInfo()
+{
+    d->mBackEnd->retrieveSemanticInfoList(d->mPendingUrls);
+    d->mPendingUrls.clear();
 }
 
 QVariant SemanticInfoDirModel::data(const QModelIndex& index, int role) const
@@ -229,6 +252,43 @@ void SemanticInfoDirModel::slotSemanticInfoRetrieved(const QUrl &url, const Sema
     emit dataChanged(cacheItem.mIndex, cacheItem.mIndex);
 }
 
+void SemanticInfoDirModel::slotSemanticInfoListRetrieved(const SemanticInfoForUrl& semanticInfoForUrl)
+{
+    // Emit one dataChanged() signal per parent, covering all the updated rows,
+    // so that proxy models refilter once per chunk instead of once per url
+    typedef QPair<int, int> RowRange;
+    QMap<QPersistentModelIndex, RowRange> rangeForParent;
+
+    for (auto it = semanticInfoForUrl.constBegin(), end = semanticInfoForUrl.constEnd(); it != end; ++it) {
+        SemanticInfoCache::iterator cacheIt = d->mSemanticInfoCache.find(it.key());
+        if (cacheIt == d->mSemanticInfoCache.end()) {
+            // Removed while it was being retrieved
+            continue;
+        }
+        SemanticInfoCacheItem& cacheItem = cacheIt.value();
+        if (!cacheItem.mIndex.isValid()) {
+            qWarning() << "Index for" << it.key() << "is invalid";
+            continue;
+        }
+        cacheItem.mInfo = it.value();
+        cacheItem.mValid = true;
+
+        const QPersistentModelIndex parent(cacheItem.mIndex.parent());
+        const int row = cacheItem.mIndex.row();
+        auto rangeIt = rangeForParent.find(parent);
+        if (rangeIt == rangeForParent.end()) {
+            rangeForParent.insert(parent, RowRange(row, row));
+        } else {
+            rangeIt->first = qMin(rangeIt->first, row);
+            rangeIt->second = qMax(rangeIt->second, row);
+        }
+    }
+
+    for (auto it = rangeForParent.constBegin(), end = rangeForParent.constEnd(); it != end; ++it) {
+        emit dataChanged(index(it->first, 0, it.key()), index(it->second, 0, it.key()));
+    }
+}
+
 void SemanticInfoDirModel::slotRowsAboutToBeRemoved(const QModelIndex& parent, int start, int end)
 {
     for (int pos = start; pos <= end; ++pos) {
@@ -244,6 +304,7 @@ void SemanticInfoDirModel::slotRowsAboutToBeRemoved(const QModelIndex& parent, i
 void SemanticInfoDirModel::slotModelAboutToBeReset()
 {
     d->mSemanticInfoCache.clear();
+    d->mPendingUrls.clear();
 }
 
 AbstractSemanticInfoBackEnd* SemanticInfoDirModel::semanticInfoBackEnd() const
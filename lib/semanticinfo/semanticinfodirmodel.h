@@ -27,14 +27,11 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #include <KDirModel>
 
 // Local
-
-class QUrl;
+#include <lib/semanticinfo/abstractsemanticinfobackend.h>
 
 namespace Gwenview
 {
 
-class AbstractSemanticInfoBackEnd;
-struct SemanticInfo;
 struct SemanticInfoDirModelPrivate;
 /**
  * Extends KDirModel by providing read/write access to image metadata such as
@@ -56,6 +53,11 @@ public:
 
     bool semanticInfoAvailableForIndex(const QModelIndex&) const;
 
+    /**
+     * Schedules the retrieval of the semantic info of index. Requests made
+     * during the same event loop iteration are grouped and handled by worker
+     * threads. dataChanged() is emitted once per chunk of results.
+     */
     void retrieveSemanticInfoForIndex(const QModelIndex&);
 
     SemanticInfo semanticInfoForIndex(const QModelIndex&) const;
@@ -74,6 +76,8 @@ private:
 
 private Q_SLOTS:
     void slotSemanticInfoRetrieved(const QUrl &url, const SemanticInfo&);
+    void slotSemanticInfoListRetrieved(const Gwenview::SemanticInfoForUrl&);
+    void retrievePendingSemanticInfo();
 
     void slotRowsAboutToBeRemoved(const QModelIndex&, int, int);
     void slotModelAboutToBeReset();
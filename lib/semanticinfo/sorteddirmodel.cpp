@@ -21,7 +21,12 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <config-gwenview.h>
 
 // Qt
+#include <QCollator>
+#include <QCollatorSortKey>
+#include <QSharedPointer>
 #include <QTimer>
+#include <QVector>
+#include <QtConcurrentMap>
 #include <QDebug>
 #include <QUrl>
 
@@ -43,6 +48,96 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 namespace Gwenview
 {
 
+// Below this number of keys to compute, starting worker threads costs more
+// than it saves
+static const int PARALLEL_SORT_KEY_THRESHOLD = 512;
+
+/**
+ * Everything lessThan() needs to know about a row of the source model
+ */
+struct SortKey
+{
+    SortKey()
+    : mValid(false)
+    , mIsDirOrArchive(false)
+    , mIsDir(false)
+    , mIsHidden(false)
+    , mSize(0)
+    , mTime(0)
+    , mRating(0)
+    {}
+
+    bool mValid;
+    bool mIsDirOrArchive;
+    bool mIsDir;
+    bool mIsHidden;
+    /// Null if names are not compared through collation keys
+    QSharedPointer<QCollatorSortKey> mCollationKey;
+    KIO::filesize_t mSize;
+    /// Only computed when sorting by date
+    qint64 mTime;
+    /// Only computed when sorting by rating
+    int mRating;
+};
+
+/**
+ * The part of SortKey which can be computed in worker threads: determining
+ * the mime type of an item and its collation key
+ */
+struct SortKeyJob
+{
+    KFileItem mItem;
+    SortKey mKey;
+};
+
+struct SortKeyJobRunner
+{
+    explicit SortKeyJobRunner(const QCollator* collator)
+    : mCollator(collator)
+    {}
+
+    void operator()(SortKeyJob& job) const
+    {
+        // Only fill the mime type cache of the item: the rest of the mime
+        // based checks use caches which are not thread-safe
+        job.mItem.mimetype();
+        job.mKey.mIsDir = job.mItem.isDir();
+        job.mKey.mIsHidden = job.mItem.isHidden();
+        job.mKey.mSize = job.mItem.size();
+        if (mCollator) {
+            job.mKey.mCollationKey.reset(new QCollatorSortKey(mCollator->sortKey(job.mItem.text())));
+        }
+    }
+
+    const QCollator* mCollator;
+};
+
+/**
+ * The sort settings the keys have been computed for
+ */
+struct SortKeyConfig
+{
+    SortKeyConfig()
+    : mColumn(-1)
+    , mRole(-1)
+    , mCaseSensitivity(Qt::CaseSensitive)
+    {}
+
+    bool operator==(const SortKeyConfig& other) const
+    {
+        return mColumn == other.mColumn && mRole == other.mRole && mCaseSensitivity == other.mCaseSensitivity;
+    }
+
+    bool operator!=(const SortKeyConfig& other) const
+    {
+        return !(*this == other);
+    }
+
+    int mColumn;
+    int mRole;
+    Qt::CaseSensitivity mCaseSensitivity;
+};
+
 AbstractSortedDirModelFilter::AbstractSortedDirModelFilter(SortedDirModel* model)
 : QObject(model)
 , mModel(model)
@@ -70,6 +165,165 @@ struct SortedDirModelPrivate
     QList<AbstractSortedDirModelFilter*> mFilters;
     QTimer mDelayedApplyFiltersTimer;
     MimeTypeUtils::Kinds mKindFilter;
+    MimeTypeUtils::KindCache mKindCache;
+
+    /* @defgroup sortkeys Sort key cache, indexed by top-level source rows
+     * @{ */
+    QVector<SortKey> mSortKeys;
+    int mInvalidSortKeyCount;
+    SortKeyConfig mSortKeyConfig;
+    QCollator mCollator;
+    bool mUseCollationKeys;
+    /* @} */
+
+    void invalidateSortKeys()
+    {
+        mSortKeys.clear();
+        mInvalidSortKeyCount = 0;
+    }
+
+    void invalidateKinds(const QModelIndex& parent, int first, int last)
+    {
+        for (int row = first; row <= last; ++row) {
+            const KFileItem item = mSourceModel->itemForIndex(mSourceModel->index(row, 0, parent));
+            if (!item.isNull()) {
+                mKindCache.invalidate(item.url());
+            }
+        }
+    }
+
+    void invalidateSortKeys(int first, int last)
+    {
+        last = qMin(last, mSortKeys.count() - 1);
+        for (int row = first; row <= last; ++row) {
+            SortKey& key = mSortKeys[row];
+            if (key.mValid) {
+                key.mValid = false;
+                ++mInvalidSortKeyCount;
+            }
+        }
+    }
+
+    void insertSortKeys(int first, int last)
+    {
+        if (first > mSortKeys.count()) {
+            // Not built yet
+            return;
+        }
+        const int count = last - first + 1;
+        mSortKeys.insert(first, count, SortKey());
+        mInvalidSortKeyCount += count;
+    }
+
+    void removeSortKeys(int first, int last)
+    {
+        last = qMin(last, mSortKeys.count() - 1);
+        for (int row = first; row <= last; ++row) {
+            if (!mSortKeys.at(row).mValid) {
+                --mInvalidSortKeyCount;
+            }
+        }
+        if (first <= last) {
+            mSortKeys.remove(first, last - first + 1);
+        }
+    }
+
+    /**
+     * Numeric collation keys are not supported by all QCollator backends. If
+     * they are not, names are compared by KDirSortFilterProxyModel.
+     */
+    void initCollator(Qt::CaseSensitivity caseSensitivity)
+    {
+        mCollator.setNumericMode(true);
+        mCollator.setCaseSensitivity(caseSensitivity);
+        mUseCollationKeys = mCollator.sortKey(QStringLiteral("a2")).compare(mCollator.sortKey(QStringLiteral("a10"))) < 0;
+    }
+
+    void fillSortKey(const QModelIndex& sourceIndex, const KFileItem& item, SortKey* key)
+    {
+        key->mIsDirOrArchive = ArchiveUtils::fileItemIsDirOrArchive(item);
+        if (mSortKeyConfig.mColumn == KDirModel::ModifiedTime) {
+            key->mTime = TimeUtils::dateTimeForFileItem(item).toMSecsSinceEpoch();
+        }
+#ifndef GWENVIEW_SEMANTICINFO_BACKEND_NONE
+        if (mSortKeyConfig.mRole == SemanticInfoDirModel::RatingRole) {
+            key->mRating = mSourceModel->data(sourceIndex, SemanticInfoDirModel::RatingRole).toInt();
+        }
+#else
+        Q_UNUSED(sourceIndex);
+#endif
+        key->mValid = true;
+    }
+
+    void updateSortKeys(const SortKeyConfig& config)
+    {
+        if (config != mSortKeyConfig) {
+            invalidateSortKeys();
+            mSortKeyConfig = config;
+            initCollator(config.mCaseSensitivity);
+        }
+        const int rowCount = mSourceModel->rowCount();
+        if (mSortKeys.count() != rowCount) {
+            mSortKeys.fill(SortKey(), rowCount);
+            mInvalidSortKeyCount = rowCount;
+        }
+        if (mInvalidSortKeyCount == 0) {
+            return;
+        }
+
+        QVector<int> rows;
+        QVector<SortKeyJob> jobs;
+        rows.reserve(mInvalidSortKeyCount);
+        jobs.reserve(mInvalidSortKeyCount);
+        for (int row = 0; row < rowCount; ++row) {
+            if (mSortKeys.at(row).mValid) {
+                continue;
+            }
+            SortKeyJob job;
+            job.mItem = mSourceModel->itemForIndex(mSourceModel->index(row, 0));
+            rows << row;
+            jobs << job;
+        }
+
+        const QCollator* collator = mUseCollationKeys ? &mCollator : nullptr;
+        if (collator) {
+            // Make sure the collator is fully initialized before using it
+            // from several threads
+            mCollator.compare(QString(), QString());
+        }
+        const SortKeyJobRunner runner(collator);
+        if (jobs.count() < PARALLEL_SORT_KEY_THRESHOLD) {
+            for (SortKeyJob& job : jobs) {
+                runner(job);
+            }
+        } else {
+            QtConcurrent::blockingMap(jobs, runner);
+        }
+
+        for (int idx = 0; idx < rows.count(); ++idx) {
+            const int row = rows.at(idx);
+            SortKeyJob& job = jobs[idx];
+            fillSortKey(mSourceModel->index(row, 0), job.mItem, &job.mKey);
+            mSortKeys[row] = job.mKey;
+        }
+        mInvalidSortKeyCount = 0;
+    }
+
+    /**
+     * Returns the key for sourceIndex, computing it if sourceIndex is not a
+     * top-level row
+     */
+    SortKey sortKey(const QModelIndex& sourceIndex)
+    {
+        if (!sourceIndex.parent().isValid() && sourceIndex.row() < mSortKeys.count()) {
+            return mSortKeys.at(sourceIndex.row());
+        }
+        SortKeyJob job;
+        job.mItem = mSourceModel->itemForIndex(sourceIndex);
+        SortKeyJobRunner(mUseCollationKeys ? &mCollator : nullptr)(job);
+        fillSortKey(sourceIndex, job.mItem, &job.mKey);
+        return job.mKey;
+    }
 };
 
 SortedDirModel::SortedDirModel(QObject* parent)
@@ -81,6 +335,40 @@ SortedDirModel::SortedDirModel(QObject* parent)
 #else
     d->mSourceModel = new SemanticInfoDirModel(this);
 #endif
+    d->mInvalidSortKeyCount = 0;
+    d->mUseCollationKeys = false;
+
+    // Connect before calling setSourceModel(), so that the sort key and kind
+    // caches are up to date when QSortFilterProxyModel reacts to the same
+    // signals
+    connect(d->mSourceModel, &QAbstractItemModel::rowsInserted, this, [this](const QModelIndex& parent, int first, int last) {
+        d->invalidateKinds(parent, first, last);
+        if (!parent.isValid()) {
+            d->insertSortKeys(first, last);
+        }
+    });
+    connect(d->mSourceModel, &QAbstractItemModel::rowsRemoved, this, [this](const QModelIndex& parent, int first, int last) {
+        if (!parent.isValid()) {
+            d->removeSortKeys(first, last);
+        }
+    });
+    connect(d->mSourceModel, &QAbstractItemModel::dataChanged, this, [this](const QModelIndex& topLeft, const QModelIndex& bottomRight) {
+        d->invalidateKinds(topLeft.parent(), topLeft.row(), bottomRight.row());
+        if (!topLeft.parent().isValid()) {
+            d->invalidateSortKeys(topLeft.row(), bottomRight.row());
+        }
+    });
+    connect(d->mSourceModel, &QAbstractItemModel::rowsMoved, this, [this]() {
+        d->invalidateSortKeys();
+    });
+    connect(d->mSourceModel, &QAbstractItemModel::layoutChanged, this, [this]() {
+        d->invalidateSortKeys();
+    });
+    connect(d->mSourceModel, &QAbstractItemModel::modelReset, this, [this]() {
+        d->mKindCache.clear();
+        d->invalidateSortKeys();
+    });
+
     setSourceModel(d->mSourceModel);
     d->mDelayedApplyFiltersTimer.setInterval(0);
     d->mDelayedApplyFiltersTimer.setSingleShot(true);
@@ -195,7 +483,7 @@ bool SortedDirModel::filterAcceptsRow(int row, const QModelIndex& parent) const
     QModelIndex index = d->mSourceModel->index(row, 0, parent);
     KFileItem fileItem = d->mSourceModel->itemForIndex(index);
 
-    MimeTypeUtils::Kinds kind = MimeTypeUtils::fileItemKind(fileItem);
+    MimeTypeUtils::Kinds kind = d->mKindCache.kind(fileItem);
     if (d->mKindFilter != MimeTypeUtils::Kinds() && !(d->mKindFilter & kind)) {
         return false;
     }
@@ -259,37 +547,47 @@ void SortedDirModel::doApplyFilters()
 
 bool SortedDirModel::lessThan(const QModelIndex& left, const QModelIndex& right) const
 {
-    const KFileItem leftItem = itemForSourceIndex(left);
-    const KFileItem rightItem = itemForSourceIndex(right);
+    SortKeyConfig config;
+    config.mColumn = sortColumn();
+    config.mRole = sortRole();
+    config.mCaseSensitivity = sortCaseSensitivity();
+    d->updateSortKeys(config);
 
-    const bool leftIsDirOrArchive = ArchiveUtils::fileItemIsDirOrArchive(leftItem);
-    const bool rightIsDirOrArchive = ArchiveUtils::fileItemIsDirOrArchive(rightItem);
+    const SortKey leftKey = d->sortKey(left);
+    const SortKey rightKey = d->sortKey(right);
 
-    if (leftIsDirOrArchive != rightIsDirOrArchive) {
-        return sortOrder() == Qt::AscendingOrder ? leftIsDirOrArchive : rightIsDirOrArchive;
+    if (leftKey.mIsDirOrArchive != rightKey.mIsDirOrArchive) {
+        return sortOrder() == Qt::AscendingOrder ? leftKey.mIsDirOrArchive : rightKey.mIsDirOrArchive;
     }
 
     // Apply special sort handling only to images. For folders/archives or when
     // a secondary criterion is needed, delegate sorting to the parent class.
-    if (!leftIsDirOrArchive) {
-        if (sortColumn() == KDirModel::ModifiedTime) {
-            const QDateTime leftDate = TimeUtils::dateTimeForFileItem(leftItem);
-            const QDateTime rightDate = TimeUtils::dateTimeForFileItem(rightItem);
-
-            if (leftDate != rightDate) {
-                return leftDate < rightDate;
+    if (!leftKey.mIsDirOrArchive) {
+        if (config.mColumn == KDirModel::ModifiedTime) {
+            if (leftKey.mTime != rightKey.mTime) {
+                return leftKey.mTime < rightKey.mTime;
             }
         }
 #ifndef GWENVIEW_SEMANTICINFO_BACKEND_NONE
-        if (sortRole() == SemanticInfoDirModel::RatingRole) {
-            const int leftRating = d->mSourceModel->data(left, SemanticInfoDirModel::RatingRole).toInt();
-            const int rightRating = d->mSourceModel->data(right, SemanticInfoDirModel::RatingRole).toInt();
-
-            if (leftRating != rightRating) {
-                return leftRating < rightRating;
+        if (config.mRole == SemanticInfoDirModel::RatingRole) {
+            if (leftKey.mRating != rightKey.mRating) {
+                return leftKey.mRating < rightKey.mRating;
             }
         }
 #endif
+        if (config.mColumn == KDirModel::Size && leftKey.mSize != rightKey.mSize) {
+            return leftKey.mSize < rightKey.mSize;
+        }
+    }
+
+    // Same checks as KDirSortFilterProxyModel, so that the collation keys are
+    // only compared when it would compare names
+    if (config.mColumn == KDirModel::Name && leftKey.mCollationKey && rightKey.mCollationKey
+        && leftKey.mIsDir == rightKey.mIsDir && leftKey.mIsHidden == rightKey.mIsHidden) {
+        const int result = leftKey.mCollationKey->compare(*rightKey.mCollationKey);
+        if (result != 0) {
+            return result < 0;
+        }
     }
 
     return KDirSortFilterProxyModel::lessThan(left, right);
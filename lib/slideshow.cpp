@@ -27,6 +27,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 // Qt
 #include <QAction>
+#include <QElapsedTimer>
 #include <QTimer>
 #include <QDebug>
 
@@ -35,6 +36,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 // Local
 #include <lib/gvdebug.h>
+#include <lib/slideshowrenderer.h>
 #include <gwenviewconfig.h>
 
 namespace Gwenview
@@ -49,6 +51,12 @@ namespace Gwenview
 #define LOG(x) ;
 #endif
 
+// Number of upcoming slides rendered in advance
+static const int PRERENDERED_SLIDE_COUNT = 3;
+
+// How long to wait for a late frame before showing the slide anyway, in ms
+static const int MAX_FRAME_WAIT = 2000;
+
 enum State {
     Paused,
     Started,
@@ -78,6 +86,7 @@ private:
 
 struct SlideShowPrivate
 {
+    SlideShow* q;
     QTimer* mTimer;
     State mState;
     QVector<QUrl> mUrls;
@@ -89,18 +98,92 @@ struct SlideShowPrivate
     QAction* mLoopAction;
     QAction* mRandomAction;
 
+    SlideShowRenderer* mRenderer;
+    // The url we switched to and its frame, until the view takes it
+    QUrl mShownUrl;
+    QImage mShownFrame;
+    // The url whose deadline has passed before its frame was ready
+    QUrl mLateUrl;
+    QElapsedTimer mLateTimer;
+    QTimer* mLateTimeoutTimer;
+
     QUrl findNextUrl()
     {
         if (GwenviewConfig::random()) {
             return findNextRandomUrl();
         } else {
-            return findNextOrderedUrl();
+            return findNextOrderedUrl(mCurrentUrl);
+        }
+    }
+
+    /**
+     * Returns the urls which will be shown after the current one, without
+     * moving forward
+     */
+    QVector<QUrl> upcomingUrls(int count)
+    {
+        QVector<QUrl> urls;
+        if (GwenviewConfig::random()) {
+            // mShuffledUrls is consumed from its end. When it is empty the
+            // next urls depend on a shuffle which has not been done yet.
+            for (int idx = mShuffledUrls.count() - 1; idx >= 0 && urls.count() < count; --idx) {
+                urls << mShuffledUrls.at(idx);
+            }
+            return urls;
         }
+        QUrl url = mCurrentUrl;
+        while (urls.count() < count) {
+            url = findNextOrderedUrl(url);
+            if (!url.isValid() || url == mCurrentUrl || urls.contains(url)) {
+                break;
+            }
+            urls << url;
+        }
+        return urls;
     }
 
-    QUrl findNextOrderedUrl()
+    void scheduleUpcomingSlides()
     {
-        QVector<QUrl>::ConstIterator it = qFind(mUrls.constBegin(), mUrls.constEnd(), mCurrentUrl);
+        QVector<QUrl> urls;
+        for (const QUrl& url : upcomingUrls(PRERENDERED_SLIDE_COUNT)) {
+            // Videos have no frame to render
+            if (MimeTypeUtils::urlKind(url) != MimeTypeUtils::KIND_VIDEO) {
+                urls << url;
+            }
+        }
+        mRenderer->setQueue(urls);
+    }
+
+    void showUrl(const QUrl& url)
+    {
+        mShownUrl = url;
+        mShownFrame = mRenderer->frame(url);
+        emit q->goToUrl(url);
+    }
+
+    void clearLateUrl()
+    {
+        mLateUrl.clear();
+        mLateTimeoutTimer->stop();
+    }
+
+    /**
+     * Shows mLateUrl, whether its frame is ready or not, and reports the
+     * missed deadline
+     */
+    void showLateUrl()
+    {
+        const QUrl url = mLateUrl;
+        const int lateness = int(mLateTimer.elapsed());
+        clearLateUrl();
+        qWarning() << "Slideshow missed the deadline of" << url << "by" << lateness << "ms";
+        emit q->deadlineMissed(url, lateness);
+        showUrl(url);
+    }
+
+    QUrl findNextOrderedUrl(const QUrl& fromUrl)
+    {
+        QVector<QUrl>::ConstIterator it = qFind(mUrls.constBegin(), mUrls.constEnd(), fromUrl);
         GV_RETURN_VALUE_IF_FAIL2(it != mUrls.constEnd(), QUrl(), "Current url not found in list.");
 
         ++it;
@@ -177,11 +260,28 @@ SlideShow::SlideShow(QObject* parent)
 : QObject(parent)
 , d(new SlideShowPrivate)
 {
+    d->q = this;
     d->mState = Paused;
 
+    d->mRenderer = new SlideShowRenderer(this);
+    connect(d->mRenderer, &SlideShowRenderer::frameReady,
+            this, &SlideShow::slotFrameReady);
+
     d->mTimer = new QTimer(this);
     connect(d->mTimer, &QTimer::timeout, this, &SlideShow::goToNextUrl);
 
+    // A frame may never come, for example if a remote image stalls: do not
+    // freeze the slideshow
+    d->mLateTimeoutTimer = new QTimer(this);
+    d->mLateTimeoutTimer->setSingleShot(true);
+    d->mLateTimeoutTimer->setInterval(MAX_FRAME_WAIT);
+    connect(d->mLateTimeoutTimer, &QTimer::timeout, this, [this]() {
+        if (d->mLateUrl.isValid()) {
+            LOG("Gave up waiting for" << d->mLateUrl);
+            d->showLateUrl();
+        }
+    });
+
     d->mLoopAction = new QAction(this);
     d->mLoopAction->setText(i18nc("@item:inmenu toggle loop in slideshow", "Loop"));
     d->mLoopAction->setCheckable(true);
@@ -231,6 +331,7 @@ void SlideShow::start(const QList<QUrl>& urls)
     d->updateTimerInterval();
     d->mTimer->setSingleShot(false);
     d->doStart();
+    d->scheduleUpcomingSlides();
     emit stateChanged(true);
 }
 
@@ -269,6 +370,8 @@ void SlideShow::pause()
     LOG("Stopping timer");
     d->mTimer->stop();
     d->mState = Paused;
+    d->clearLateUrl();
+    d->mRenderer->clear();
     emit stateChanged(false);
 }
 
@@ -289,7 +392,41 @@ void SlideShow::goToNextUrl()
         pause();
         return;
     }
-    emit goToUrl(url);
+    if (d->mRenderer->isPending(url)) {
+        // Showing the slide now would show it half-rendered, wait for its
+        // frame instead
+        LOG("Frame not ready for" << url);
+        d->mTimer->stop();
+        d->mLateUrl = url;
+        d->mLateTimer.start();
+        d->mLateTimeoutTimer->start();
+        return;
+    }
+    d->showUrl(url);
+}
+
+void SlideShow::slotFrameReady(const QUrl& url)
+{
+    if (url != d->mLateUrl || d->mState == Paused) {
+        return;
+    }
+    d->showLateUrl();
+}
+
+void SlideShow::setViewSize(const QSizeF& size)
+{
+    d->mRenderer->setViewSize(size);
+}
+
+QImage SlideShow::takePreRenderedFrame(const QUrl& url)
+{
+    if (url != d->mShownUrl) {
+        return QImage();
+    }
+    const QImage frame = d->mShownFrame;
+    d->mShownUrl.clear();
+    d->mShownFrame = QImage();
+    return frame;
 }
 
 void SlideShow::setCurrentUrl(const QUrl &url)
@@ -299,10 +436,14 @@ void SlideShow::setCurrentUrl(const QUrl &url)
         return;
     }
     d->mCurrentUrl = url;
+    // The user went to another url while we were waiting for a late frame:
+    // it is not the next slide anymore
+    d->clearLateUrl();
     // Restart timer to avoid showing new url for the remaining time of the old
     // url
     if (d->mState != Paused) {
         d->doStart();
+        d->scheduleUpcomingSlides();
     }
 }
 
@@ -319,8 +460,11 @@ void SlideShow::updateConfig()
 
 void SlideShow::slotRandomActionToggled(bool on)
 {
-    if (on && d->mState != Paused) {
-        d->initShuffledUrls();
+    if (d->mState != Paused) {
+        if (on) {
+            d->initShuffledUrls();
+        }
+        d->scheduleUpcomingSlides();
     }
 }
 
@@ -30,6 +30,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 #include <QUrl>
 
 class QAction;
+class QImage;
+class QSizeF;
 
 namespace Gwenview
 {
@@ -60,6 +62,18 @@ public:
      */
     int position() const;
 
+    /**
+     * Defines the size of the view slides are shown in. Upcoming slides are
+     * rendered in advance at this size.
+     */
+    void setViewSize(const QSizeF& size);
+
+    /**
+     * Returns the frame rendered in advance for @p url, if @p url is the url
+     * the slideshow just switched to. The frame is only returned once.
+     */
+    QImage takePreRenderedFrame(const QUrl& url);
+
 public Q_SLOTS:
     void setInterval(int);
     void setCurrentUrl(const QUrl &url);
@@ -81,10 +95,18 @@ Q_SIGNALS:
      */
     void intervalChanged(int interval);
 
+    /**
+     * Emitted when the slideshow had to wait for the frame of @p url, which
+     * was shown @p lateness milliseconds after its deadline. If the frame
+     * takes too long, the slide is shown without it.
+     */
+    void deadlineMissed(const QUrl& url, int lateness);
+
 private Q_SLOTS:
     void goToNextUrl();
     void updateConfig();
     void slotRandomActionToggled(bool on);
+    void slotFrameReady(const QUrl& url);
 
 private:
     SlideShowPrivate* const d;
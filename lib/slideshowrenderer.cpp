@@ -0,0 +1,292 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2019 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "slideshowrenderer.h"
+
+// Qt
+#include <QFutureWatcher>
+#include <QHash>
+#include <QImage>
+#include <QSizeF>
+#include <QUrl>
+#include <QtConcurrentRun>
+#include <QDebug>
+
+// KDE
+
+// Local
+#include <lib/document/documentfactory.h>
+#include <lib/mimetypeutils.h>
+#include <lib/trace.h>
+#include <gwenviewconfig.h>
+
+#undef ENABLE_LOG
+#undef LOG
+//#define ENABLE_LOG
+#ifdef ENABLE_LOG
+#define LOG(x) qDebug() << x
+#else
+#define LOG(x) ;
+#endif
+
+namespace Gwenview
+{
+
+struct RenderedSlide
+{
+    Document::Ptr mDocument;
+    QImage mFrame;
+};
+
+static QImage renderFrame(const QImage& image, const QSize& size)
+{
+    GV_TRACE_SPAN("SlideShowRenderer::renderFrame");
+    if (image.isNull() || size.isEmpty()) {
+        return QImage();
+    }
+    QImage frame = image.size() == size
+        ? image
+        : image.scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    // Use formats RasterImageView can apply color profiles on
+    if (image.format() == QImage::Format_Grayscale8) {
+        return frame.convertToFormat(QImage::Format_Grayscale8);
+    }
+    return frame.convertToFormat(frame.hasAlphaChannel() ? QImage::Format_ARGB32 : QImage::Format_RGB32);
+}
+
+struct SlideShowRendererPrivate
+{
+    SlideShowRenderer* q;
+    QSizeF mViewSize;
+    QVector<QUrl> mQueue;
+    QHash<QUrl, RenderedSlide> mSlides;
+
+    // The slide being rendered
+    QUrl mUrl;
+    Document::Ptr mDocument;
+    bool mImageRequested;
+    QFutureWatcher<QImage>* mWatcher;
+    // Incremented when the view size changes, so that frames rendered for
+    // the previous size are not stored
+    int mGeneration;
+    int mWatcherGeneration;
+
+    /**
+     * Returns the size of @p document once zoomed to fit the view, the same
+     * way AbstractImageView::computeZoomToFit() does
+     */
+    QSize computeFrameSize(const Document::Ptr& document, qreal* zoom) const
+    {
+        const QSizeF documentSize = document->size();
+        qreal fit = qMin(mViewSize.width() / documentSize.width(), mViewSize.height() / documentSize.height());
+        if (!GwenviewConfig::enlargeSmallerImages()) {
+            fit = qMin(fit, qreal(1.));
+        }
+        *zoom = fit;
+        return (documentSize * fit).toSize();
+    }
+
+    void forgetDocument()
+    {
+        if (mDocument) {
+            QObject::disconnect(mDocument.data(), nullptr, q, nullptr);
+        }
+        mDocument = nullptr;
+        mUrl = QUrl();
+    }
+
+    void finishSlide(const QImage& frame)
+    {
+        const QUrl url = mUrl;
+        RenderedSlide slide;
+        slide.mDocument = mDocument;
+        slide.mFrame = frame;
+        mSlides.insert(url, slide);
+        forgetDocument();
+        emit q->frameReady(url);
+    }
+
+    void scheduleNextSlide()
+    {
+        if (mDocument || mWatcher->isRunning() || mViewSize.isEmpty()) {
+            return;
+        }
+        for (const QUrl& url : qAsConst(mQueue)) {
+            if (mSlides.contains(url)) {
+                continue;
+            }
+            LOG("Rendering" << url);
+            mUrl = url;
+            mDocument = DocumentFactory::instance()->load(url);
+            mImageRequested = false;
+            QObject::connect(mDocument.data(), &Document::metaInfoUpdated, q, [this]() {
+                processDocument();
+            });
+            QObject::connect(mDocument.data(), &Document::downSampledImageReady, q, [this]() {
+                processDocument();
+            });
+            QObject::connect(mDocument.data(), &Document::loaded, q, [this]() {
+                processDocument();
+            });
+            QObject::connect(mDocument.data(), &Document::loadingFailed, q, [this]() {
+                processDocument();
+            });
+            processDocument();
+            return;
+        }
+    }
+
+    void processDocument()
+    {
+        if (!mDocument) {
+            return;
+        }
+        Document::Ptr document = mDocument;
+        if (document->loadingState() == Document::LoadingFailed) {
+            LOG("Loading failed");
+            finishSlide(QImage());
+            scheduleNextSlide();
+            return;
+        }
+        if (!document->size().isValid()) {
+            LOG("Size not available yet");
+            return;
+        }
+        if (document->kind() != MimeTypeUtils::KIND_RASTER_IMAGE) {
+            finishSlide(QImage());
+            scheduleNextSlide();
+            return;
+        }
+
+        qreal zoom;
+        const QSize frameSize = computeFrameSize(document, &zoom);
+        QImage image;
+        if (zoom < Document::maxDownSampledZoom()) {
+            if (!mImageRequested) {
+                mImageRequested = true;
+                if (!document->prepareDownSampledImageForZoom(zoom)) {
+                    return;
+                }
+            }
+            image = document->downSampledImageForZoom(zoom);
+            if (image.isNull()) {
+                return;
+            }
+        } else {
+            if (document->loadingState() != Document::Loaded) {
+                if (!mImageRequested) {
+                    mImageRequested = true;
+                    document->startLoadingFullImage();
+                }
+                return;
+            }
+            image = document->image();
+        }
+
+        // Keep mDocument and mUrl until the frame is ready, but do not listen to
+        // the document anymore
+        QObject::disconnect(document.data(), nullptr, q, nullptr);
+        mWatcherGeneration = mGeneration;
+        mWatcher->setFuture(QtConcurrent::run(renderFrame, image, frameSize));
+    }
+};
+
+SlideShowRenderer::SlideShowRenderer(QObject* parent)
+: QObject(parent)
+, d(new SlideShowRendererPrivate)
+{
+    d->q = this;
+    d->mImageRequested = false;
+    d->mGeneration = 0;
+    d->mWatcherGeneration = 0;
+    d->mWatcher = new QFutureWatcher<QImage>(this);
+    connect(d->mWatcher, &QFutureWatcherBase::finished,
+            this, &SlideShowRenderer::slotFrameRendered);
+}
+
+SlideShowRenderer::~SlideShowRenderer()
+{
+    d->forgetDocument();
+    d->mWatcher->waitForFinished();
+    delete d;
+}
+
+void SlideShowRenderer::setViewSize(const QSizeF& size)
+{
+    if (size == d->mViewSize) {
+        return;
+    }
+    LOG(size);
+    d->mViewSize = size;
+    ++d->mGeneration;
+    d->mSlides.clear();
+    d->forgetDocument();
+    d->scheduleNextSlide();
+}
+
+void SlideShowRenderer::setQueue(const QVector<QUrl>& urls)
+{
+    LOG(urls);
+    d->mQueue = urls;
+    QHash<QUrl, RenderedSlide>::Iterator it = d->mSlides.begin();
+    while (it != d->mSlides.end()) {
+        if (urls.contains(it.key())) {
+            ++it;
+        } else {
+            it = d->mSlides.erase(it);
+        }
+    }
+    if (d->mDocument && !urls.contains(d->mUrl)) {
+        d->forgetDocument();
+    }
+    d->scheduleNextSlide();
+}
+
+bool SlideShowRenderer::isPending(const QUrl& url) const
+{
+    return !d->mViewSize.isEmpty() && d->mQueue.contains(url) && !d->mSlides.contains(url);
+}
+
+QImage SlideShowRenderer::frame(const QUrl& url) const
+{
+    return d->mSlides.value(url).mFrame;
+}
+
+void SlideShowRenderer::clear()
+{
+    d->mQueue.clear();
+    d->mSlides.clear();
+    d->forgetDocument();
+}
+
+void SlideShowRenderer::slotFrameRendered()
+{
+    const QImage frame = d->mWatcher->result();
+    if (d->mDocument && d->mWatcherGeneration == d->mGeneration) {
+        d->finishSlide(frame);
+    } else {
+        // The view size or the queue changed while the frame was rendered
+        d->forgetDocument();
+    }
+    d->scheduleNextSlide();
+}
+
+} // namespace
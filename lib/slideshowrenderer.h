@@ -0,0 +1,102 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2019 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef SLIDESHOWRENDERER_H
+#define SLIDESHOWRENDERER_H
+
+#include <lib/gwenviewlib_export.h>
+
+// Qt
+#include <QObject>
+#include <QVector>
+
+// KDE
+
+// Local
+
+class QImage;
+class QSizeF;
+class QUrl;
+
+namespace Gwenview
+{
+
+struct SlideShowRendererPrivate;
+/**
+ * Prepares the frames of the next slides of a slideshow, so that switching
+ * to a slide does not have to wait for the image to be decoded and scaled.
+ *
+ * Slides are rendered one at a time, in the order of their deadline: the
+ * document is loaded at the resolution needed to fit the view, then scaled
+ * to the exact zoom-to-fit size in a worker thread. Rendered slides keep a
+ * reference to their document so that the view can show it right away.
+ */
+class GWENVIEWLIB_EXPORT SlideShowRenderer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SlideShowRenderer(QObject* parent = nullptr);
+    ~SlideShowRenderer() override;
+
+    /**
+     * Defines the size of the view slides are shown in. Drops the frames
+     * rendered for the previous size.
+     */
+    void setViewSize(const QSizeF& size);
+
+    /**
+     * Defines the slides to render, sorted by deadline. Frames of urls which
+     * are not in @p urls anymore are dropped.
+     */
+    void setQueue(const QVector<QUrl>& urls);
+
+    /**
+     * Returns true if @p url is queued but its frame is not ready yet
+     */
+    bool isPending(const QUrl& url) const;
+
+    /**
+     * Returns the rendered frame of @p url, or a null image if it is not
+     * ready or @p url could not be rendered
+     */
+    QImage frame(const QUrl& url) const;
+
+    /**
+     * Drops all frames and the queue
+     */
+    void clear();
+
+Q_SIGNALS:
+    /**
+     * Emitted when @p url is not pending anymore, whether a frame could be
+     * rendered for it or not
+     */
+    void frameReady(const QUrl& url);
+
+private Q_SLOTS:
+    void slotFrameRendered();
+
+private:
+    SlideShowRendererPrivate* const d;
+};
+
+} // namespace
+
+#endif /* SLIDESHOWRENDERER_H */
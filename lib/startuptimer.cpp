@@ -0,0 +1,81 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2019 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "startuptimer.h"
+
+// Qt
+#include <QElapsedTimer>
+#include <QDebug>
+
+// KDE
+
+// Local
+#include "trace.h"
+
+namespace Gwenview
+{
+
+namespace StartupTimer
+{
+
+static QElapsedTimer sTimer;
+static bool sVerbose = false;
+static qint64 sTarget = 0;
+
+namespace Private
+{
+
+bool sActive = false;
+
+void addMark(const char* name)
+{
+    GV_TRACE_INSTANT(name);
+    if (sVerbose) {
+        qInfo("Startup: %s after %lld ms", name, sTimer.elapsed());
+    }
+}
+
+void finish(const char* name)
+{
+    addMark(name);
+    sActive = false;
+    if (sTarget > 0 && sTimer.elapsed() > sTarget) {
+        qWarning("Startup: %s after %lld ms, target is %lld ms", name, sTimer.elapsed(), sTarget);
+    }
+}
+
+} // namespace
+
+void start()
+{
+    const QByteArray value = qgetenv("GV_STARTUP_TIMING");
+    sVerbose = !value.isEmpty();
+    sTarget = value.toLongLong();
+    Private::sActive = sVerbose || Trace::isEnabled();
+    if (Private::sActive) {
+        sTimer.start();
+        Private::addMark("Start");
+    }
+}
+
+} // namespace
+
+} // namespace
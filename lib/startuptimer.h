@@ -0,0 +1,98 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2019 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef STARTUPTIMER_H
+#define STARTUPTIMER_H
+
+#include <lib/gwenviewlib_export.h>
+
+// Qt
+#include <QtGlobal>
+
+// KDE
+
+// Local
+
+namespace Gwenview
+{
+
+/**
+ * Measures the time spent between the start of the application and the
+ * first pixel of a document on screen.
+ *
+ * Timing is enabled by setting the GV_STARTUP_TIMING environment variable.
+ * Milestones are then printed as they are reached, with the time elapsed
+ * since start() was called. If the variable contains a number, it is used as
+ * a target in milliseconds and a warning is printed if the first pixel comes
+ * later than that. Milestones are also recorded as instant events when
+ * tracing is enabled, see trace.h.
+ *
+ * Timing stops as soon as finish() is called, so marks are cheap to leave in
+ * code paths which are also used after startup.
+ */
+namespace StartupTimer
+{
+
+namespace Private
+{
+GWENVIEWLIB_EXPORT extern bool sActive;
+GWENVIEWLIB_EXPORT void addMark(const char* name);
+GWENVIEWLIB_EXPORT void finish(const char* name);
+} // namespace
+
+/**
+ * Starts the clock. Should be called as early as possible in main().
+ */
+GWENVIEWLIB_EXPORT void start();
+
+/**
+ * Records a startup milestone. @p name must be a string literal.
+ */
+inline void mark(const char* name)
+{
+    if (Private::sActive) {
+        Private::addMark(name);
+    }
+}
+
+/**
+ * Records the last startup milestone, compares it to the target and stops
+ * the clock. @p name must be a string literal.
+ */
+inline void finish(const char* name)
+{
+    if (Private::sActive) {
+        Private::finish(name);
+    }
+}
+
+/**
+ * Called by views when they have painted document pixels
+ */
+inline void firstPixel()
+{
+    finish("First pixel");
+}
+
+} // namespace
+
+} // namespace
+
+#endif /* STARTUPTIMER_H */
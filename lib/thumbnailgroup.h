@@ -32,12 +32,19 @@ namespace Gwenview
 
 namespace ThumbnailGroup
 {
+/**
+ * Thumbnail sizes. Each group is stored in the matching freedesktop.org
+ * thumbnail dir: normal/, large/ and x-large/.
+ */
 enum Enum {
     Normal,
     Large,
     Large2x
 };
 
+const Enum FirstGroup = Normal;
+const Enum LastGroup = Large2x;
+
 inline int pixelSize(const Enum value)
 {
     switch(value) {
@@ -0,0 +1,364 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2019 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "imagehead.h"
+
+// STL
+#include <memory>
+
+// Exiv2
+#include <exiv2/exiv2.hpp>
+
+// Qt
+#include <QBuffer>
+#include <QByteArray>
+#include <QImage>
+#include <QImageReader>
+#include <QSet>
+#include <QSize>
+#include <QDebug>
+
+// KDE
+
+// Local
+#include "exiv2imageloader.h"
+#include "gwenviewconfig.h"
+#include "jpegcontent.h"
+#include "orientation.h"
+#include "trace.h"
+
+namespace Gwenview
+{
+
+#undef ENABLE_LOG
+#undef LOG
+//#define ENABLE_LOG
+#ifdef ENABLE_LOG
+#define LOG(x) qDebug() << x
+#else
+#define LOG(x) ;
+#endif
+
+const int ImageHead::MAX_SIZE = 4 * 1024 * 1024;
+
+// Size of the head when previews are first looked for. It is multiplied by 4
+// for each new attempt, until MAX_SIZE is reached.
+static const int FIRST_PREVIEW_CHECK_SIZE = 256 * 1024;
+
+static bool isSofMarker(uchar marker)
+{
+    // DHT, JPG and DAC share the SOFn range
+    return marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC;
+}
+
+static bool isProgressiveSofMarker(uchar marker)
+{
+    return marker == 0xC2 || marker == 0xC6 || marker == 0xCA || marker == 0xCE;
+}
+
+static bool isStandaloneMarker(uchar marker)
+{
+    // TEM and RSTn
+    return marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7);
+}
+
+static Orientation exifOrientation(const Exiv2::ExifData& exifData)
+{
+    // Same checks as JpegContent::orientation()
+    Exiv2::ExifData::const_iterator it = exifData.findKey(Exiv2::ExifKey("Exif.Image.Orientation"));
+    if (it == exifData.end() || it->count() == 0 || it->typeId() != Exiv2::unsignedShort) {
+        return NOT_AVAILABLE;
+    }
+    return Orientation(it->toLong());
+}
+
+/**
+ * Returns @p jpegData with its Exif orientation set to @p orientation.
+ * Embedded previews usually have no Exif data, the orientation is only
+ * defined in the file containing them.
+ */
+static QByteArray setJpegOrientation(const QByteArray& jpegData, Orientation orientation)
+{
+    Exiv2ImageLoader loader;
+    if (!loader.load(jpegData)) {
+        return jpegData;
+    }
+    std::unique_ptr<Exiv2::Image> image = loader.popImage();
+    try {
+        image->exifData()["Exif.Image.Orientation"] = uint16_t(orientation);
+        image->writeMetadata();
+
+        Exiv2::BasicIo& io = image->io();
+        QByteArray data;
+        data.resize(io.size());
+        io.seek(0, Exiv2::BasicIo::beg);
+        io.read((unsigned char*)data.data(), io.size());
+        return data;
+    } catch (const Exiv2::Error& error) {
+        qWarning() << "Could not set the orientation of an embedded preview:" << error.what();
+        return jpegData;
+    }
+}
+
+struct ImageHeadPrivate
+{
+    int mPixelSize;
+    ImageHead::Status mStatus;
+    QByteArray mHead;
+    QByteArray mThumbnailSource;
+    QSize mImageSize;
+    int mNextPreviewCheckSize;
+    bool mExifThumbnailChecked;
+
+    /**
+     * Walks through the JPEG markers of the head. Stops at the first scan of
+     * baseline JPEGs, which need to be loaded entirely.
+     */
+    ImageHead::Status checkJpeg()
+    {
+        const uchar* data = reinterpret_cast<const uchar*>(mHead.constData());
+        const int size = mHead.size();
+        bool progressive = false;
+        int width = 0;
+        int height = 0;
+        int componentCount = 0;
+        QSet<int> componentsWithDc;
+
+        int pos = 2;
+        while (true) {
+            if (pos + 2 > size) {
+                return ImageHead::NeedMoreData;
+            }
+            if (data[pos] != 0xFF) {
+                LOG("Invalid marker at" << pos);
+                return ImageHead::Unusable;
+            }
+            const uchar marker = data[pos + 1];
+            if (marker == 0xFF) {
+                // Fill byte
+                ++pos;
+                continue;
+            }
+            if (marker == 0xD9) {
+                // EOI: we got the whole file
+                mThumbnailSource = mHead;
+                return ImageHead::Usable;
+            }
+            if (isStandaloneMarker(marker)) {
+                pos += 2;
+                continue;
+            }
+
+            if (pos + 4 > size) {
+                return ImageHead::NeedMoreData;
+            }
+            const int length = (data[pos + 2] << 8) | data[pos + 3];
+            const int segmentStart = pos + 4;
+            const int segmentEnd = pos + 2 + length;
+            if (length < 2) {
+                return ImageHead::Unusable;
+            }
+            if (segmentEnd > size) {
+                return ImageHead::NeedMoreData;
+            }
+
+            if (isSofMarker(marker)) {
+                if (length < 8) {
+                    return ImageHead::Unusable;
+                }
+                height = (data[segmentStart + 1] << 8) | data[segmentStart + 2];
+                width = (data[segmentStart + 3] << 8) | data[segmentStart + 4];
+                componentCount = data[segmentStart + 5];
+                mImageSize = QSize(width, height);
+                progressive = isProgressiveSofMarker(marker);
+            } else if (marker == 0xDA) {
+                if (!mExifThumbnailChecked) {
+                    mExifThumbnailChecked = true;
+                    // Same condition as ThumbnailContext::load()
+                    if (GwenviewConfig::applyExifOrientation()) {
+                        const QByteArray headers = mHead.left(segmentEnd);
+                        Exiv2ImageLoader loader;
+                        JpegContent content;
+                        if (loader.load(headers) && content.loadFromData(headers, loader.popImage().get())) {
+                            const QImage thumbnail = content.thumbnail();
+                            if (qMax(thumbnail.width(), thumbnail.height()) >= mPixelSize) {
+                                LOG("Exif thumbnail is big enough");
+                                mThumbnailSource = mHead;
+                                return ImageHead::Usable;
+                            }
+                        }
+                    }
+                }
+                if (!progressive || componentCount == 0 || qMax(width, height) / 8 < mPixelSize) {
+                    LOG("Baseline JPEG or DC scans too small");
+                    return ImageHead::Unusable;
+                }
+
+                const int scanComponentCount = data[segmentStart];
+                if (length < 6 + 2 * scanComponentCount) {
+                    return ImageHead::Unusable;
+                }
+                // Ss: start of spectral selection, 0 for DC scans
+                const int spectralStart = data[segmentStart + 1 + 2 * scanComponentCount];
+
+                // Look for the end of the entropy-coded data: the next marker
+                // which is neither a stuffed byte nor a restart marker
+                pos = segmentEnd;
+                while (true) {
+                    if (pos + 2 > size) {
+                        return ImageHead::NeedMoreData;
+                    }
+                    const uchar next = data[pos + 1];
+                    if (data[pos] == 0xFF && next != 0x00 && next != 0xFF && !isStandaloneMarker(next)) {
+                        break;
+                    }
+                    ++pos;
+                }
+
+                if (spectralStart == 0) {
+                    for (int idx = 0; idx < scanComponentCount; ++idx) {
+                        componentsWithDc << data[segmentStart + 1 + 2 * idx];
+                    }
+                }
+                if (componentsWithDc.count() >= componentCount) {
+                    LOG("DC scans are complete at" << pos);
+                    mThumbnailSource = mHead.left(pos);
+                    return ImageHead::Usable;
+                }
+                continue;
+            }
+            pos = segmentEnd;
+        }
+    }
+
+    /**
+     * Looks for an embedded JPEG preview big enough, which is entirely
+     * contained in the head
+     */
+    ImageHead::Status checkPreviews()
+    {
+        GV_TRACE_SPAN("ImageHead::checkPreviews");
+        Exiv2ImageLoader loader;
+        if (!loader.load(mHead)) {
+            LOG("Exiv2 could not load head:" << loader.errorMessage());
+            return ImageHead::NeedMoreData;
+        }
+        std::unique_ptr<Exiv2::Image> image = loader.popImage();
+        try {
+            Exiv2::PreviewManager manager(*image);
+            // Previews are sorted by size, smallest first. Exiv2 does not list
+            // previews which go past the end of the data.
+            const Exiv2::PreviewPropertiesList list = manager.getPreviewProperties();
+            for (const Exiv2::PreviewProperties& properties : list) {
+                if (properties.mimeType_ != "image/jpeg") {
+                    continue;
+                }
+                const Exiv2::PreviewImage preview = manager.getPreviewImage(properties);
+                QByteArray data(reinterpret_cast<const char*>(preview.pData()), preview.size());
+
+                QBuffer buffer(&data);
+                QImageReader reader(&buffer, "jpeg");
+                const QSize size = reader.size();
+                if (qMax(size.width(), size.height()) < mPixelSize) {
+                    continue;
+                }
+                LOG("Using preview of size" << size);
+                const Orientation orientation = exifOrientation(image->exifData());
+                if (GwenviewConfig::applyExifOrientation() && orientation != NOT_AVAILABLE && orientation != NORMAL) {
+                    data = setJpegOrientation(data, orientation);
+                }
+                mThumbnailSource = data;
+                // The preview is usually smaller than the image
+                const QSize imageSize(image->pixelWidth(), image->pixelHeight());
+                if (!imageSize.isEmpty()) {
+                    mImageSize = imageSize;
+                }
+                return ImageHead::Usable;
+            }
+        } catch (const Exiv2::Error& error) {
+            LOG("Could not read previews:" << error.what());
+        }
+        return ImageHead::NeedMoreData;
+    }
+
+    ImageHead::Status check(int previousSize)
+    {
+        if (mHead.size() < 2) {
+            return ImageHead::NeedMoreData;
+        }
+        if (uchar(mHead.at(0)) == 0xFF && uchar(mHead.at(1)) == 0xD8) {
+            return checkJpeg();
+        }
+        if (previousSize < mNextPreviewCheckSize && mHead.size() >= mNextPreviewCheckSize) {
+            mNextPreviewCheckSize *= 4;
+            return checkPreviews();
+        }
+        return ImageHead::NeedMoreData;
+    }
+};
+
+ImageHead::ImageHead(int pixelSize)
+: d(new ImageHeadPrivate)
+{
+    d->mPixelSize = pixelSize;
+    d->mStatus = NeedMoreData;
+    d->mNextPreviewCheckSize = FIRST_PREVIEW_CHECK_SIZE;
+    d->mExifThumbnailChecked = false;
+}
+
+ImageHead::~ImageHead()
+{
+    delete d;
+}
+
+ImageHead::Status ImageHead::append(const QByteArray& data)
+{
+    if (d->mStatus != NeedMoreData) {
+        return d->mStatus;
+    }
+    const int previousSize = d->mHead.size();
+    d->mHead += data;
+    d->mStatus = d->check(previousSize);
+    if (d->mStatus == NeedMoreData && d->mHead.size() >= MAX_SIZE) {
+        d->mStatus = Unusable;
+    }
+    if (d->mStatus != NeedMoreData) {
+        d->mHead.clear();
+    }
+    return d->mStatus;
+}
+
+ImageHead::Status ImageHead::status() const
+{
+    return d->mStatus;
+}
+
+QByteArray ImageHead::thumbnailSource() const
+{
+    return d->mThumbnailSource;
+}
+
+QSize ImageHead::imageSize() const
+{
+    return d->mImageSize;
+}
+
+} // namespace
@@ -0,0 +1,100 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2019 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef IMAGEHEAD_H
+#define IMAGEHEAD_H
+
+#include <lib/gwenviewlib_export.h>
+
+// Qt
+
+// KDE
+
+// Local
+
+class QByteArray;
+class QSize;
+
+namespace Gwenview
+{
+
+struct ImageHeadPrivate;
+/**
+ * Accumulates the first bytes of an image file and tells whether they are
+ * enough to generate a thumbnail, so that remote files do not need to be
+ * downloaded entirely.
+ *
+ * The head is usable if it contains:
+ * - for JPEG files, an Exif thumbnail big enough, or the scans of a
+ *   progressive JPEG which provide the DC coefficients of all components.
+ *   They define the image at 1/8 of its resolution.
+ * - for other files, such as RAW files, a JPEG preview extracted by Exiv2.
+ *   Previews are only looked for at a few head sizes, since it requires
+ *   parsing the whole head.
+ *
+ * Since append() may parse megabytes of data, it should not be called from
+ * the GUI thread.
+ */
+class GWENVIEWLIB_EXPORT ImageHead
+{
+public:
+    enum Status {
+        NeedMoreData, ///< The head is not usable yet, more data may change that
+        Usable,       ///< A thumbnail can be generated from thumbnailSource()
+        Unusable      ///< The whole file is needed
+    };
+
+    /**
+     * Heads never grow beyond this size, in bytes
+     */
+    static const int MAX_SIZE;
+
+    explicit ImageHead(int pixelSize);
+    ~ImageHead();
+
+    /**
+     * Appends @p data to the head and returns the new status. Once the
+     * status is not NeedMoreData, it does not change anymore.
+     */
+    Status append(const QByteArray& data);
+
+    Status status() const;
+
+    /**
+     * Returns the JPEG data to generate the thumbnail from when status() is
+     * Usable: the head itself for JPEG files, the extracted preview
+     * otherwise
+     */
+    QByteArray thumbnailSource() const;
+
+    /**
+     * Returns the size of the image, as stored in the file, when status() is
+     * Usable. It differs from the size of thumbnailSource() when it is an
+     * embedded preview. The size is invalid if the file does not define it.
+     */
+    QSize imageSize() const;
+
+private:
+    ImageHeadPrivate* const d;
+};
+
+} // namespace
+
+#endif /* IMAGEHEAD_H */
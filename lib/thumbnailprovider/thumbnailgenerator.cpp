@@ -22,10 +22,11 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #include "thumbnailgenerator.h"
 
 // Local
-#include "imageutils.h"
+#include "orthogonaltransform.h"
 #include "jpegcontent.h"
 #include "gwenviewconfig.h"
 #include "exiv2imageloader.h"
+#include "trace.h"
 
 // KDE
 #include <QDebug>
@@ -35,7 +36,6 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 
 // Qt
 #include <QImageReader>
-#include <QTransform>
 #include <QBuffer>
 
 namespace Gwenview
@@ -57,8 +57,9 @@ const int MIN_PREV_SIZE = 1000;
 // ThumbnailContext
 //
 //------------------------------------------------------------------------
-bool ThumbnailContext::load(const QString &pixPath, int pixelSize)
+bool ThumbnailContext::load(const QString &pixPath, int pixelSize, const QSize& originalSize_)
 {
+    GV_TRACE_SPAN("ThumbnailContext::load");
     mImage = QImage();
     mNeedCaching = true;
     Orientation orientation = NORMAL;
@@ -127,12 +128,10 @@ bool ThumbnailContext::load(const QString &pixPath, int pixelSize)
 
         if (qMax(thumbnail.width(), thumbnail.height()) >= pixelSize) {
             mImage = thumbnail;
-            if (orientation != NORMAL && orientation != NOT_AVAILABLE) {
-                QTransform matrix = ImageUtils::transformMatrix(orientation);
-                mImage = mImage.transformed(matrix);
-            }
-            mOriginalWidth = content.size().width();
-            mOriginalHeight = content.size().height();
+            mImage = OrthogonalTransform::transformed(std::move(mImage), orientation);
+            const QSize size = originalSize_.isValid() ? originalSize_ : content.size();
+            mOriginalWidth = size.width();
+            mOriginalHeight = size.height();
             return true;
         }
     }
@@ -149,9 +148,11 @@ bool ThumbnailContext::load(const QString &pixPath, int pixelSize)
         }
     }
 
-    // Rotate if necessary
+    // Rotate if necessary. This is done after scaling, on the smaller image,
+    // so QImageReader must not do it.
+    reader.setAutoTransform(false);
     if (GwenviewConfig::applyExifOrientation()) {
-        reader.setAutoTransform(true);
+        orientation = OrthogonalTransform::orientationFromTransformations(reader.transformation());
     }
 
     // format() is empty after QImageReader::read() is called
@@ -163,8 +164,14 @@ bool ThumbnailContext::load(const QString &pixPath, int pixelSize)
     if (!originalSize.isValid()) {
         originalSize = originalImage.size();
     }
-    mOriginalWidth = originalSize.width() * previewRatio;
-    mOriginalHeight = originalSize.height() * previewRatio;
+    if (originalSize_.isValid()) {
+        // pixPath is a preview, do not store its size in the thumbnail
+        mOriginalWidth = originalSize_.width();
+        mOriginalHeight = originalSize_.height();
+    } else {
+        mOriginalWidth = originalSize.width() * previewRatio;
+        mOriginalHeight = originalSize.height() * previewRatio;
+    }
 
     if (qMax(mOriginalWidth, mOriginalHeight) <= pixelSize) {
         mImage = originalImage;
@@ -172,8 +179,10 @@ bool ThumbnailContext::load(const QString &pixPath, int pixelSize)
     } else {
         mImage = originalImage.scaled(pixelSize, pixelSize, Qt::KeepAspectRatio);
     }
+    originalImage = QImage();
+    mImage = OrthogonalTransform::transformed(std::move(mImage), orientation);
 
-    if (reader.autoTransform() && (reader.transformation() & QImageIOHandler::TransformationRotate90)) {
+    if (orientation == TRANSPOSE || orientation == ROT_90 || orientation == TRANSVERSE || orientation == ROT_270) {
         qSwap(mOriginalWidth, mOriginalHeight);
     }
 
@@ -193,7 +202,8 @@ void ThumbnailGenerator::load(
     const QString& originalUri, time_t originalTime, KIO::filesize_t originalFileSize, const QString& originalMimeType,
     const QString& pixPath,
     const QString& thumbnailPath,
-    ThumbnailGroup::Enum group)
+    ThumbnailGroup::Enum group,
+    const QSize& originalSize)
 {
     QMutexLocker lock(&mMutex);
     Q_ASSERT(mPixPath.isNull());
@@ -205,6 +215,7 @@ void ThumbnailGenerator::load(
     mPixPath = pixPath;
     mThumbnailPath = thumbnailPath;
     mThumbnailGroup = group;
+    mOriginalSize = originalSize;
     if (!isRunning()) start();
     mCond.wakeOne();
 }
@@ -248,6 +259,7 @@ void ThumbnailGenerator::run()
     while (!testCancel()) {
         QString pixPath;
         int pixelSize;
+        QSize originalSize;
         {
             QMutexLocker lock(&mMutex);
             // empty mPixPath means nothing to do
@@ -264,12 +276,13 @@ void ThumbnailGenerator::run()
             QMutexLocker lock(&mMutex);
             pixPath = mPixPath;
             pixelSize = ThumbnailGroup::pixelSize(mThumbnailGroup);
+            originalSize = mOriginalSize;
         }
 
         Q_ASSERT(!pixPath.isNull());
         LOG("Loading" << pixPath);
         ThumbnailContext context;
-        bool ok = context.load(pixPath, pixelSize);
+        bool ok = context.load(pixPath, pixelSize, originalSize);
 
         {
             QMutexLocker lock(&mMutex);
@@ -277,7 +290,7 @@ void ThumbnailGenerator::run()
                 mImage = context.mImage;
                 mOriginalWidth = context.mOriginalWidth;
                 mOriginalHeight = context.mOriginalHeight;
-                if (context.mNeedCaching && mThumbnailGroup <= ThumbnailGroup::Large) {
+                if (context.mNeedCaching) {
                     cacheThumbnail();
                 }
             } else {
@@ -301,6 +314,7 @@ void ThumbnailGenerator::run()
 
 void ThumbnailGenerator::cacheThumbnail()
 {
+    GV_TRACE_SPAN("ThumbnailGenerator::cacheThumbnail");
     mImage.setText(QStringLiteral("Thumb::URI")          , mOriginalUri);
     mImage.setText(QStringLiteral("Thumb::MTime")        , QString::number(mOriginalTime));
     mImage.setText(QStringLiteral("Thumb::Size")         , QString::number(mOriginalFileSize));
@@ -22,6 +22,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #define THUMBNAILGENERATOR_H
 
 // Local
+#include <lib/gwenviewlib_export.h>
 #include <lib/thumbnailgroup.h>
 
 // KDE
@@ -36,13 +37,18 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 namespace Gwenview
 {
 
-struct ThumbnailContext {
+struct GWENVIEWLIB_EXPORT ThumbnailContext {
     QImage mImage;
     int mOriginalWidth;
     int mOriginalHeight;
     bool mNeedCaching;
 
-    bool load(const QString &pixPath, int pixelSize);
+    /**
+     * Generates the thumbnail of @p pixPath. If @p pixPath only contains a
+     * preview of the original image, @p originalSize is the size of the
+     * original.
+     */
+    bool load(const QString &pixPath, int pixelSize, const QSize& originalSize = QSize());
 };
 
 class ThumbnailGenerator : public QThread
@@ -58,7 +64,8 @@ public:
         const QString& originalMimeType,
         const QString& pixPath,
         const QString& thumbnailPath,
-        ThumbnailGroup::Enum group);
+        ThumbnailGroup::Enum group,
+        const QSize& originalSize = QSize());
 
     void cancel();
 
@@ -83,6 +90,7 @@ private:
     time_t mOriginalTime;
     KIO::filesize_t mOriginalFileSize;
     QString mOriginalMimeType;
+    QSize mOriginalSize;
     int mOriginalWidth;
     int mOriginalHeight;
     QMutex mMutex;
@@ -30,6 +30,8 @@
 // Qt
 #include <QDir>
 #include <QFile>
+#include <QFileInfo>
+#include <QFutureWatcher>
 #include <QImage>
 #include <QPixmap>
 #include <QCryptographicHash>
@@ -37,16 +39,21 @@
 #include <QTemporaryFile>
 #include <QApplication>
 #include <QStandardPaths>
+#include <QtConcurrentRun>
 
 // KDE
 #include <KIO/JobUiDelegate>
 #include <KIO/PreviewJob>
+#include <KIO/TransferJob>
 #include <KJobWidgets>
 
 // Local
+#include "gvdebug.h"
+#include "imagehead.h"
 #include "mimetypeutils.h"
 #include "thumbnailwriter.h"
 #include "thumbnailgenerator.h"
+#include "trace.h"
 #include "urlutils.h"
 
 namespace Gwenview
@@ -77,6 +84,25 @@ static QString generateThumbnailPath(const QString& uri, ThumbnailGroup::Enum gr
     return baseDir + QFile::encodeName(QString::fromLatin1(md5.result().toHex())) + QStringLiteral(".png");
 }
 
+/**
+ * Creates an empty temporary file, which is not removed automatically. The
+ * suffix is kept because ThumbnailContext uses it to recognize RAW files.
+ */
+static QFile* createTempFile(const QString& suffix)
+{
+    QString fileTemplate = QDir::tempPath() + QStringLiteral("/gwenview_XXXXXX");
+    if (!suffix.isEmpty()) {
+        fileTemplate += QLatin1Char('.') + suffix;
+    }
+    QTemporaryFile* file = new QTemporaryFile(fileTemplate);
+    file->setAutoRemove(false);
+    if (!file->open()) {
+        delete file;
+        return nullptr;
+    }
+    return file;
+}
+
 //------------------------------------------------------------------------
 //
 // ThumbnailProvider static methods
@@ -113,7 +139,7 @@ QString ThumbnailProvider::thumbnailBaseDir(ThumbnailGroup::Enum group)
         break;
     case ThumbnailGroup::Large2x:
     default:
-        dir += "x-gwenview/"; // Should never be hit, but just in case
+        dir += QStringLiteral("x-large/");
     }
     return dir;
 }
@@ -121,8 +147,9 @@ QString ThumbnailProvider::thumbnailBaseDir(ThumbnailGroup::Enum group)
 void ThumbnailProvider::deleteImageThumbnail(const QUrl &url)
 {
     QString uri = generateOriginalUri(url);
-    QFile::remove(generateThumbnailPath(uri, ThumbnailGroup::Normal));
-    QFile::remove(generateThumbnailPath(uri, ThumbnailGroup::Large));
+    for (int group = ThumbnailGroup::FirstGroup; group <= ThumbnailGroup::LastGroup; ++group) {
+        QFile::remove(generateThumbnailPath(uri, ThumbnailGroup::Enum(group)));
+    }
 }
 
 static void moveThumbnailHelper(const QString& oldUri, const QString& newUri, ThumbnailGroup::Enum group)
@@ -142,8 +169,9 @@ void ThumbnailProvider::moveThumbnail(const QUrl &oldUrl, const QUrl& newUrl)
 {
     QString oldUri = generateOriginalUri(oldUrl);
     QString newUri = generateOriginalUri(newUrl);
-    moveThumbnailHelper(oldUri, newUri, ThumbnailGroup::Normal);
-    moveThumbnailHelper(oldUri, newUri, ThumbnailGroup::Large);
+    for (int group = ThumbnailGroup::FirstGroup; group <= ThumbnailGroup::LastGroup; ++group) {
+        moveThumbnailHelper(oldUri, newUri, ThumbnailGroup::Enum(group));
+    }
 }
 
 //------------------------------------------------------------------------
@@ -155,16 +183,15 @@ ThumbnailProvider::ThumbnailProvider()
 : KIO::Job()
 , mState(STATE_NEXTTHUMB)
 , mOriginalTime(0)
+, mTempPathIsHead(false)
+, mDownloadFile(nullptr)
+, mImageHeadBusy(false)
 {
     LOG(this);
 
-    // Make sure we have a place to store our thumbnails
-    QString thumbnailDirNormal = ThumbnailProvider::thumbnailBaseDir(ThumbnailGroup::Normal);
-    QString thumbnailDirLarge = ThumbnailProvider::thumbnailBaseDir(ThumbnailGroup::Large);
-    QDir().mkpath(thumbnailDirNormal);
-    QDir().mkpath(thumbnailDirLarge);
-    QFile::setPermissions(thumbnailDirNormal, QFileDevice::WriteOwner | QFileDevice::ReadOwner | QFileDevice::ExeOwner);
-    QFile::setPermissions(thumbnailDirLarge, QFileDevice::WriteOwner | QFileDevice::ReadOwner | QFileDevice::ExeOwner);
+    // Thumbnail dirs are created by the ThumbnailWriter thread before storing
+    // the first thumbnail, so that constructing a provider does not touch the
+    // disk
 
     // Look for images and store the items in our todo list
     mCurrentItem = KFileItem();
@@ -288,10 +315,16 @@ void ThumbnailProvider::abortSubjob()
         removeSubjob(job);
         mCurrentItem = KFileItem();
     }
+    if (mDownloadFile) {
+        closeDownloadFile();
+        QFile::remove(mTempPath);
+        mTempPath.clear();
+    }
 }
 
 void ThumbnailProvider::determineNextIcon()
 {
+    GV_TRACE_COUNTER("ThumbnailProvider pending items", mItems.count());
     LOG(this);
     mState = STATE_NEXTTHUMB;
 
@@ -353,6 +386,7 @@ void ThumbnailProvider::slotResult(KJob * job)
     }
 
     case STATE_DOWNLOADORIG:
+        closeDownloadFile();
         if (job->error()) {
             emitThumbnailLoadingFailed();
             LOG("Delete temp file" << mTempPath);
@@ -374,6 +408,13 @@ void ThumbnailProvider::thumbnailReady(const QImage& _img, const QSize& _size)
 {
     QImage img = _img;
     QSize size = _size;
+    if (img.isNull() && mTempPathIsHead && !mCurrentItem.isNull()) {
+        LOG("Could not use head of" << mCurrentUrl << ", downloading the whole file");
+        QFile::remove(mTempPath);
+        mTempPath.clear();
+        startDownloadingOriginal(false);
+        return;
+    }
     if (!img.isNull()) {
         emitThumbnailLoaded(img, size);
     } else {
@@ -384,35 +425,51 @@ void ThumbnailProvider::thumbnailReady(const QImage& _img, const QSize& _size)
         QFile::remove(mTempPath);
         mTempPath.clear();
     }
+    mTempPathIsHead = false;
     determineNextIcon();
 }
 
 QImage ThumbnailProvider::loadThumbnailFromCache() const
 {
-    if (mThumbnailGroup > ThumbnailGroup::Large) {
-        return QImage();
-    }
-
+    GV_TRACE_SPAN("ThumbnailProvider::loadThumbnailFromCache");
     QImage image = sThumbnailWriter->value(mThumbnailPath);
     if (!image.isNull()) {
         return image;
     }
 
     image = QImage(mThumbnailPath);
-    if (image.isNull() && mThumbnailGroup == ThumbnailGroup::Normal) {
-        // If there is a large-sized thumbnail, generate the normal-sized version from it
-        QString largeThumbnailPath = generateThumbnailPath(mOriginalUri, ThumbnailGroup::Large);
-        QImage largeImage(largeThumbnailPath);
-        if (largeImage.isNull()) {
-            return image;
+    if (!image.isNull()) {
+        return image;
+    }
+
+    // If there is a larger thumbnail, generate the current-sized version from
+    // it. Try the closest size first: it is the cheapest to scale down.
+    for (int group = mThumbnailGroup + 1; group <= ThumbnailGroup::LastGroup; ++group) {
+        const QString largerThumbnailPath = generateThumbnailPath(mOriginalUri, ThumbnailGroup::Enum(group));
+        QImage largerImage = sThumbnailWriter->value(largerThumbnailPath);
+        if (largerImage.isNull()) {
+            largerImage = QImage(largerThumbnailPath);
+        }
+        // Do not derive a thumbnail from an outdated one: it would be cached
+        // with a valid name and never be regenerated
+        if (largerImage.isNull()
+                || largerImage.text(QStringLiteral("Thumb::URI")) != mOriginalUri
+                || largerImage.text(QStringLiteral("Thumb::MTime")).toInt() != mOriginalTime) {
+            continue;
+        }
+        int size = ThumbnailGroup::pixelSize(mThumbnailGroup);
+        if (qMax(largerImage.width(), largerImage.height()) <= size) {
+            // Original is smaller than the thumbnail size, do not upscale it
+            image = largerImage;
+        } else {
+            image = largerImage.scaled(size, size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
         }
-        int size = ThumbnailGroup::pixelSize(ThumbnailGroup::Normal);
-        image = largeImage.scaled(size, size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
-        Q_FOREACH(const QString& key, largeImage.textKeys()) {
-            QString text = largeImage.text(key);
+        Q_FOREACH(const QString& key, largerImage.textKeys()) {
+            QString text = largerImage.text(key);
             image.setText(key, text);
         }
         sThumbnailWriter->queueThumbnail(mThumbnailPath, image);
+        break;
     }
 
     return image;
@@ -476,24 +533,9 @@ void ThumbnailProvider::checkThumbnail()
             // Original is a local file, create the thumbnail
             startCreatingThumbnail(mCurrentUrl.toLocalFile());
         } else {
-            // Original is remote, download it
-            mState = STATE_DOWNLOADORIG;
-
-            QTemporaryFile tempFile;
-            tempFile.setAutoRemove(false);
-            if (!tempFile.open()) {
-                qWarning() << "Couldn't create temp file to download " << mCurrentUrl.toDisplayString();
-                emitThumbnailLoadingFailed();
-                determineNextIcon();
-                return;
-            }
-            mTempPath = tempFile.fileName();
-
-            QUrl url = QUrl::fromLocalFile(mTempPath);
-            KIO::Job* job = KIO::file_copy(mCurrentUrl, url, -1, KIO::Overwrite | KIO::HideProgressInfo);
-            KJobWidgets::setWindow(job, qApp->activeWindow());
-            LOG("Download remote file" << mCurrentUrl.toDisplayString() << "to" << url.toDisplayString());
-            addSubjob(job);
+            // Original is remote, download its head, or the whole file if
+            // the head is not enough
+            startDownloadingOriginal(true);
         }
     } else {
         // Not a raster image, use a KPreviewJob
@@ -515,7 +557,7 @@ void ThumbnailProvider::checkThumbnail()
     }
 }
 
-void ThumbnailProvider::startCreatingThumbnail(const QString& pixPath)
+void ThumbnailProvider::startCreatingThumbnail(const QString& pixPath, const QSize& originalSize)
 {
     LOG("Creating thumbnail from" << pixPath);
     // If mPreviousThumbnailGenerator is already working on our current item
@@ -533,7 +575,132 @@ void ThumbnailProvider::startCreatingThumbnail(const QString& pixPath)
             return;
     }
     mThumbnailGenerator->load(mOriginalUri, mOriginalTime, mOriginalFileSize,
-                          mCurrentItem.mimetype(), pixPath, mThumbnailPath, mThumbnailGroup);
+                          mCurrentItem.mimetype(), pixPath, mThumbnailPath, mThumbnailGroup, originalSize);
+}
+
+void ThumbnailProvider::startDownloadingOriginal(bool useHead)
+{
+    mState = STATE_DOWNLOADORIG;
+    mTempPathIsHead = false;
+
+    mDownloadFile = createTempFile(QFileInfo(mCurrentUrl.fileName()).suffix());
+    if (!mDownloadFile) {
+        qWarning() << "Couldn't create temp file to download " << mCurrentUrl.toDisplayString();
+        emitThumbnailLoadingFailed();
+        determineNextIcon();
+        return;
+    }
+    mTempPath = mDownloadFile->fileName();
+    if (useHead) {
+        mImageHead.reset(new ImageHead(ThumbnailGroup::pixelSize(mThumbnailGroup)));
+    }
+
+    KIO::TransferJob* job = KIO::get(mCurrentUrl, KIO::NoReload, KIO::HideProgressInfo);
+    KJobWidgets::setWindow(job, qApp->activeWindow());
+    connect(job, &KIO::TransferJob::data, this, &ThumbnailProvider::slotDownloadData);
+    LOG("Download remote file" << mCurrentUrl.toDisplayString() << "to" << mTempPath << "useHead=" << useHead);
+    addSubjob(job);
+}
+
+void ThumbnailProvider::closeDownloadFile()
+{
+    delete mDownloadFile;
+    mDownloadFile = nullptr;
+    // A check may still be running, it keeps its own reference to the head
+    mImageHead.reset();
+    mImageHeadBusy = false;
+    mPendingHeadData.clear();
+}
+
+void ThumbnailProvider::slotDownloadData(KIO::Job* /*job*/, const QByteArray& data)
+{
+    if (data.isEmpty() || !mDownloadFile) {
+        return;
+    }
+    if (mDownloadFile->write(data) != data.size()) {
+        qWarning() << "Couldn't write to temp file" << mTempPath;
+        emitThumbnailLoadingFailed();
+        abortSubjob();
+        determineNextIcon();
+        return;
+    }
+    if (mImageHead) {
+        appendToImageHead(data);
+    }
+}
+
+void ThumbnailProvider::appendToImageHead(const QByteArray& data)
+{
+    if (mImageHeadBusy) {
+        mPendingHeadData += data;
+        return;
+    }
+    // Checking the head may require parsing several megabytes with Exiv2, do
+    // it in a worker thread
+    mImageHeadBusy = true;
+    const QSharedPointer<ImageHead> head = mImageHead;
+    QFutureWatcher<void>* watcher = new QFutureWatcher<void>(this);
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, head]() {
+        watcher->deleteLater();
+        if (head != mImageHead) {
+            // The download is over or has been aborted in the meantime
+            return;
+        }
+        mImageHeadBusy = false;
+        processImageHeadStatus();
+    });
+    watcher->setFuture(QtConcurrent::run([head, data]() {
+        head->append(data);
+    }));
+}
+
+void ThumbnailProvider::processImageHeadStatus()
+{
+    switch (mImageHead->status()) {
+    case ImageHead::NeedMoreData:
+        if (!mPendingHeadData.isEmpty()) {
+            const QByteArray data = mPendingHeadData;
+            mPendingHeadData.clear();
+            appendToImageHead(data);
+        }
+        return;
+    case ImageHead::Unusable:
+        LOG("Head of" << mCurrentUrl << "is not enough, downloading the whole file");
+        mImageHead.reset();
+        mPendingHeadData.clear();
+        return;
+    case ImageHead::Usable:
+        break;
+    }
+    GV_RETURN_IF_FAIL(hasSubjobs());
+
+    // The head is enough, stop downloading
+    LOG("Using head of" << mCurrentUrl);
+    const QByteArray source = mImageHead->thumbnailSource();
+    const QSize imageSize = mImageHead->imageSize();
+    KJob* job = subjobs().first();
+    disconnect(job, nullptr, this, nullptr);
+    job->kill();
+    removeSubjob(job);
+    closeDownloadFile();
+    QFile::remove(mTempPath);
+
+    // The thumbnail source is always a JPEG
+    QFile* file = createTempFile(QStringLiteral("jpg"));
+    if (!file || file->write(source) != source.size()) {
+        qWarning() << "Couldn't write head of" << mCurrentUrl.toDisplayString() << "to a temp file";
+        if (file) {
+            QFile::remove(file->fileName());
+            delete file;
+        }
+        mTempPath.clear();
+        startDownloadingOriginal(false);
+        return;
+    }
+    mTempPath = file->fileName();
+    delete file;
+    mTempPathIsHead = true;
+    startCreatingThumbnail(mTempPath, imageSize);
 }
 
 void ThumbnailProvider::slotGotPreview(const KFileItem& item, const QPixmap& pixmap)
@@ -30,6 +30,7 @@
 #include <QImage>
 #include <QPixmap>
 #include <QPointer>
+#include <QSharedPointer>
 
 // KDE
 #include <KIO/Job>
@@ -38,9 +39,12 @@
 // Local
 #include <lib/thumbnailgroup.h>
 
+class QFile;
+
 namespace Gwenview
 {
 
+class ImageHead;
 class ThumbnailGenerator;
 class ThumbnailWriter;
 
@@ -136,6 +140,7 @@ private Q_SLOTS:
     void checkThumbnail();
     void thumbnailReady(const QImage&, const QSize&);
     void emitThumbnailLoadingFailed();
+    void slotDownloadData(KIO::Job*, const QByteArray&);
 
 private:
     enum { STATE_STATORIG, STATE_DOWNLOADORIG, STATE_PREVIEWJOB, STATE_NEXTTHUMB } mState;
@@ -161,6 +166,18 @@ private:
     // The temporary path for remote urls
     QString mTempPath;
 
+    // True if mTempPath only contains data extracted from the head of the
+    // remote file
+    bool mTempPathIsHead;
+
+    // The file remote urls are downloaded to, and the head of the download.
+    // The head is checked in a worker thread: data received while a check is
+    // running waits in mPendingHeadData.
+    QFile* mDownloadFile;
+    QSharedPointer<ImageHead> mImageHead;
+    bool mImageHeadBusy;
+    QByteArray mPendingHeadData;
+
     // Thumbnail group
     ThumbnailGroup::Enum mThumbnailGroup;
 
@@ -171,7 +188,27 @@ private:
 
     void createNewThumbnailGenerator();
     void abortSubjob();
-    void startCreatingThumbnail(const QString& path);
+    /**
+     * Generates the thumbnail of @p path. @p originalSize is set if @p path
+     * is a preview extracted from the head of a remote file, whose size is
+     * not the size of the original.
+     */
+    void startCreatingThumbnail(const QString& path, const QSize& originalSize = QSize());
+
+    /**
+     * Starts downloading the remote original. If @p useHead is true, the
+     * download stops as soon as its head is enough to generate the
+     * thumbnail.
+     */
+    void startDownloadingOriginal(bool useHead);
+    void closeDownloadFile();
+    void appendToImageHead(const QByteArray& data);
+
+    /**
+     * Called once mImageHead has been checked: downloads more data, or
+     * stops the download and generates the thumbnail from the head
+     */
+    void processImageHeadStatus();
 
     void emitThumbnailLoaded(const QImage& img, const QSize& size);
 
@@ -22,8 +22,11 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #include "thumbnailwriter.h"
 
 // Local
+#include "trace.h"
 
 // Qt
+#include <QDir>
+#include <QFileInfo>
 #include <QImage>
 #include <QDebug>
 #include <QTemporaryFile>
@@ -57,6 +60,17 @@ static void storeThumbnailToDiskCache(const QString& path, const QImage& image)
     QFile::rename(tmp.fileName(), path);
 }
 
+void ThumbnailWriter::createDirIfNeeded(const QString& dir)
+{
+    if (mCreatedDirs.contains(dir)) {
+        return;
+    }
+    LOG(dir);
+    QDir().mkpath(dir);
+    QFile::setPermissions(dir, QFileDevice::WriteOwner | QFileDevice::ReadOwner | QFileDevice::ExeOwner);
+    mCreatedDirs.insert(dir);
+}
+
 void ThumbnailWriter::queueThumbnail(const QString& path, const QImage& image)
 {
     LOG(path);
@@ -77,10 +91,12 @@ void ThumbnailWriter::run()
         // depend on mCache so we can unlock here. This way other thumbnails
         // can be added or queried
         locker.unlock();
+        createDirIfNeeded(QFileInfo(path).absolutePath());
         storeThumbnailToDiskCache(path, image);
         locker.relock();
 
         mCache.remove(path);
+        GV_TRACE_COUNTER("ThumbnailWriter queue", mCache.count());
     }
 }
 
@@ -28,6 +28,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 // Qt
 #include <QHash>
 #include <QMutex>
+#include <QSet>
 #include <QThread>
 
 class QImage;
@@ -57,6 +58,11 @@ private:
     typedef QHash<QString, QImage> Cache;
     Cache mCache;
     mutable QMutex mMutex;
+
+    // Dirs known to exist, only used from run()
+    QSet<QString> mCreatedDirs;
+
+    void createDirIfNeeded(const QString& dir);
 };
 
 } // namespace
@@ -26,6 +26,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <QApplication>
 #include <QDragEnterEvent>
 #include <QDropEvent>
+#include <QImage>
 #include <QPainter>
 #include <QPointer>
 #include <QQueue>
@@ -36,6 +37,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <QMimeData>
 #include <QDebug>
 #include <QDateTime>
+#include <QFutureWatcher>
+#include <QtConcurrentMap>
 
 // KDE
 #include <KDirModel>
@@ -68,6 +71,9 @@ namespace Gwenview
 /** How many msec to wait before starting to smooth thumbnails */
 const int SMOOTH_DELAY = 500;
 
+/** How many thumbnails are sent at once to the worker threads for smoothing */
+const int SMOOTH_BATCH_SIZE = 32;
+
 const int WHEEL_ZOOM_MULTIPLIER = 4;
 
 static KFileItem fileItemForIndex(const QModelIndex& index)
@@ -86,6 +92,133 @@ static QUrl urlForIndex(const QModelIndex& index)
     return item.isNull() ? QUrl() : item.url();
 }
 
+/**
+ * Scales pix to size according to mode. Works with QPixmap in the GUI thread
+ * and with QImage in worker threads.
+ */
+template <class T>
+static T scaleThumbnail(const T& pix, ThumbnailView::ThumbnailScaleMode mode, const QSize& size, Qt::TransformationMode transformationMode)
+{
+    switch (mode) {
+    case ThumbnailView::ScaleToFit:
+        return pix.scaled(size.width(), size.height(), Qt::KeepAspectRatio, transformationMode);
+    case ThumbnailView::ScaleToSquare: {
+        int minSize = qMin(pix.width(), pix.height());
+        T pix2 = pix.copy((pix.width() - minSize) / 2, (pix.height() - minSize) / 2, minSize, minSize);
+        return pix2.scaled(size.width(), size.height(), Qt::KeepAspectRatio, transformationMode);
+    }
+    case ThumbnailView::ScaleToHeight:
+        return pix.scaledToHeight(size.height(), transformationMode);
+    case ThumbnailView::ScaleToWidth:
+        return pix.scaledToWidth(size.width(), transformationMode);
+    }
+    // Keep compiler happy
+    Q_ASSERT(0);
+    return T();
+}
+
+/**
+ * Returns the factor scaleThumbnail() applies to an image of size srcSize
+ */
+static qreal thumbnailScaleFactor(ThumbnailView::ThumbnailScaleMode mode, const QSize& srcSize, const QSize& size)
+{
+    if (srcSize.isEmpty()) {
+        return 1;
+    }
+    switch (mode) {
+    case ThumbnailView::ScaleToFit:
+        return qMin(qreal(size.width()) / srcSize.width(), qreal(size.height()) / srcSize.height());
+    case ThumbnailView::ScaleToSquare:
+        return qreal(qMin(size.width(), size.height())) / qMin(srcSize.width(), srcSize.height());
+    case ThumbnailView::ScaleToHeight:
+        return qreal(size.height()) / srcSize.height();
+    case ThumbnailView::ScaleToWidth:
+        return qreal(size.width()) / srcSize.width();
+    }
+    return 1;
+}
+
+/**
+ * Level 0 is the full image, level n is half the size of level n - 1.
+ * Returns the smallest level which is still larger than what a scale of
+ * factor requires, limited to levelCount.
+ */
+static int mipLevelForScaleFactor(qreal factor, int levelCount)
+{
+    if (factor >= 1) {
+        return 0;
+    }
+    const int level = int(floor(log2(1 / factor) + 1e-6));
+    return qBound(0, level, levelCount);
+}
+
+/**
+ * Smooth-scaled versions of image, each half the size of the previous one,
+ * down to the minimum thumbnail size
+ */
+static QList<QImage> createMipSet(const QImage& image)
+{
+    QList<QImage> list;
+    QImage level = image;
+    while (qMax(level.width(), level.height()) / 2 >= ThumbnailView::MinThumbnailSize) {
+        level = level.scaled(level.width() / 2, level.height() / 2, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+        list << level;
+    }
+    return list;
+}
+
+struct SmoothJob
+{
+    QUrl mUrl;
+    /// cacheKey() of the group pix the job has been created from
+    qint64 mGroupKey;
+    /// The group pix, or the level of the mip set to scale from
+    QImage mSource;
+    /// If true, mSource is the group pix and the mip set must be created
+    bool mCreateMipSet;
+    QSize mThumbnailSize;
+    ThumbnailView::ThumbnailScaleMode mScaleMode;
+};
+
+struct SmoothResult
+{
+    QUrl mUrl;
+    qint64 mGroupKey;
+    QSize mThumbnailSize;
+    ThumbnailView::ThumbnailScaleMode mScaleMode;
+    QImage mAdjustedImage;
+    QList<QImage> mMipSet;
+};
+
+/**
+ * Runs in worker threads
+ */
+struct ThumbnailSmoother
+{
+    typedef SmoothResult result_type;
+
+    SmoothResult operator()(const SmoothJob& job) const
+    {
+        SmoothResult result;
+        result.mUrl = job.mUrl;
+        result.mGroupKey = job.mGroupKey;
+        result.mThumbnailSize = job.mThumbnailSize;
+        result.mScaleMode = job.mScaleMode;
+
+        QImage source = job.mSource;
+        if (job.mCreateMipSet) {
+            result.mMipSet = createMipSet(job.mSource);
+            const qreal factor = thumbnailScaleFactor(job.mScaleMode, source.size(), job.mThumbnailSize);
+            const int level = mipLevelForScaleFactor(factor, result.mMipSet.count());
+            if (level > 0) {
+                source = result.mMipSet.at(level - 1);
+            }
+        }
+        result.mAdjustedImage = scaleThumbnail(source, job.mScaleMode, job.mThumbnailSize, Qt::SmoothTransformation);
+        return result;
+    }
+};
+
 struct Thumbnail
 {
     Thumbnail(const QPersistentModelIndex& index_, const QDateTime& mtime)
@@ -106,6 +239,7 @@ struct Thumbnail
     void initAsIcon(const QPixmap& pix)
     {
         mGroupPix = pix;
+        mMipSet.clear();
         int largeGroupSize = ThumbnailGroup::pixelSize(ThumbnailGroup::Large);
         mFullSize = QSize(largeGroupSize, largeGroupSize);
     }
@@ -133,6 +267,7 @@ struct Thumbnail
         mModificationTime = mtime;
         mFileSize = 0;
         mGroupPix = QPixmap();
+        mMipSet.clear();
         mAdjustedPix = QPixmap();
         mFullSize = QSize();
         mRealFullSize = QSize();
@@ -144,6 +279,10 @@ struct Thumbnail
     QDateTime mModificationTime;
     /// The pix loaded from .thumbnails/{large,normal}
     QPixmap mGroupPix;
+    /// Smooth-scaled versions of mGroupPix, each half the size of the
+    /// previous one. Created in worker threads, used to quickly create
+    /// mAdjustedPix when the thumbnail size changes.
+    QList<QPixmap> mMipSet;
     /// Scaled version of mGroupPix, adjusted to ThumbnailView::thumbnailSize
     QPixmap mAdjustedPix;
     /// Size of the full image
@@ -173,10 +312,12 @@ struct ThumbnailViewPrivate
     AbstractDocumentInfoProvider* mDocumentInfoProvider;
     AbstractThumbnailViewHelper* mThumbnailViewHelper;
     ThumbnailForUrl mThumbnailForUrl;
+    MimeTypeUtils::KindCache mKindCache;
     QTimer mScheduledThumbnailGenerationTimer;
 
     UrlQueue mSmoothThumbnailQueue;
     QTimer mSmoothThumbnailTimer;
+    QFutureWatcher<SmoothResult> mSmoothThumbnailWatcher;
 
     QPixmap mWaitingThumbnail;
     QPointer<ThumbnailProvider> mThumbnailProvider;
@@ -237,11 +378,62 @@ struct ThumbnailViewPrivate
             thumbnail->mAdjustedPix = mGroupPix;
             thumbnail->mRough = false;
         } else {
-            thumbnail->mAdjustedPix = scale(mGroupPix, Qt::FastTransformation);
+            thumbnail->mAdjustedPix = scaleThumbnail(mipSource(*thumbnail), mScaleMode, mThumbnailSize, Qt::FastTransformation);
             thumbnail->mRough = true;
         }
     }
 
+    /**
+     * Returns the smallest level of the mip set of thumbnail which can be
+     * scaled to mThumbnailSize without losing details
+     */
+    const QPixmap& mipSource(const Thumbnail& thumbnail) const
+    {
+        const qreal factor = thumbnailScaleFactor(mScaleMode, thumbnail.mGroupPix.size(), mThumbnailSize);
+        const int level = mipLevelForScaleFactor(factor, thumbnail.mMipSet.count());
+        return level == 0 ? thumbnail.mGroupPix : thumbnail.mMipSet.at(level - 1);
+    }
+
+    SmoothJob createSmoothJob(const QUrl& url, const Thumbnail& thumbnail) const
+    {
+        SmoothJob job;
+        job.mUrl = url;
+        job.mGroupKey = thumbnail.mGroupPix.cacheKey();
+        job.mCreateMipSet = thumbnail.mMipSet.isEmpty();
+        job.mSource = job.mCreateMipSet ? thumbnail.mGroupPix.toImage() : mipSource(thumbnail).toImage();
+        job.mThumbnailSize = mThumbnailSize;
+        job.mScaleMode = mScaleMode;
+        return job;
+    }
+
+    void applySmoothResult(const SmoothResult& result)
+    {
+        ThumbnailForUrl::Iterator it = mThumbnailForUrl.find(result.mUrl);
+        if (it == mThumbnailForUrl.end()) {
+            return;
+        }
+        Thumbnail& thumbnail = it.value();
+        if (thumbnail.mGroupPix.cacheKey() != result.mGroupKey) {
+            // A new thumbnail arrived in the meantime
+            return;
+        }
+        if (thumbnail.mMipSet.isEmpty()) {
+            Q_FOREACH(const QImage& image, result.mMipSet) {
+                thumbnail.mMipSet << QPixmap::fromImage(image);
+            }
+        }
+        if (result.mThumbnailSize != mThumbnailSize || result.mScaleMode != mScaleMode) {
+            // Thumbnail size changed in the meantime. The thumbnail is still
+            // rough, so it will be queued again next time it is painted.
+            return;
+        }
+        thumbnail.mAdjustedPix = QPixmap::fromImage(result.mAdjustedImage);
+        thumbnail.mRough = false;
+
+        GV_RETURN_IF_FAIL2(thumbnail.mIndex.isValid(), "index for" << result.mUrl << "is invalid.");
+        q->update(thumbnail.mIndex);
+    }
+
     void initDragPixmap(QDrag* drag, const QModelIndexList& indexes)
     {
         const int thumbCount = qMin(indexes.count(), int(DragPixmapGenerator::MaxCount));
@@ -254,26 +446,6 @@ struct ThumbnailViewPrivate
         drag->setPixmap(dragPixmap.pix);
         drag->setHotSpot(dragPixmap.hotSpot);
     }
-
-    QPixmap scale(const QPixmap& pix, Qt::TransformationMode transformationMode)
-    {
-        switch (mScaleMode) {
-        case ThumbnailView::ScaleToFit:
-            return pix.scaled(mThumbnailSize.width(), mThumbnailSize.height(), Qt::KeepAspectRatio, transformationMode);
-        case ThumbnailView::ScaleToSquare: {
-            int minSize = qMin(pix.width(), pix.height());
-            QPixmap pix2 = pix.copy((pix.width() - minSize) / 2, (pix.height() - minSize) / 2, minSize, minSize);
-            return pix2.scaled(mThumbnailSize.width(), mThumbnailSize.height(), Qt::KeepAspectRatio, transformationMode);
-        }
-        case ThumbnailView::ScaleToHeight:
-            return pix.scaledToHeight(mThumbnailSize.height(), transformationMode);
-        case ThumbnailView::ScaleToWidth:
-            return pix.scaledToWidth(mThumbnailSize.width(), transformationMode);
-        }
-        // Keep compiler happy
-        Q_ASSERT(0);
-        return QPixmap();
-    }
 };
 
 ThumbnailView::ThumbnailView(QWidget* parent)
@@ -312,6 +484,14 @@ ThumbnailView::ThumbnailView(QWidget* parent)
 
     d->mSmoothThumbnailTimer.setSingleShot(true);
     connect(&d->mSmoothThumbnailTimer, &QTimer::timeout, this, &ThumbnailView::smoothNextThumbnail);
+    connect(&d->mSmoothThumbnailWatcher, &QFutureWatcherBase::resultReadyAt, this, [this](int index) {
+        d->applySmoothResult(d->mSmoothThumbnailWatcher.resultAt(index));
+    });
+    connect(&d->mSmoothThumbnailWatcher, &QFutureWatcherBase::finished, this, [this]() {
+        if (!d->mSmoothThumbnailQueue.isEmpty()) {
+            d->mSmoothThumbnailTimer.start(0);
+        }
+    });
 
     setContextMenuPolicy(Qt::CustomContextMenu);
     connect(this, &ThumbnailView::customContextMenuRequested, this, &ThumbnailView::showContextMenu);
@@ -321,6 +501,7 @@ ThumbnailView::ThumbnailView(QWidget* parent)
 
 ThumbnailView::~ThumbnailView()
 {
+    d->mSmoothThumbnailWatcher.cancel();
     delete d;
 }
 
@@ -340,9 +521,13 @@ void ThumbnailView::setModel(QAbstractItemModel* newModel)
     if (model()) {
         disconnect(model(), nullptr, this, nullptr);
     }
+    d->mKindCache.clear();
     QListView::setModel(newModel);
     connect(model(), &QAbstractItemModel::rowsRemoved,
             this, &ThumbnailView::rowsRemovedSignal);
+    connect(model(), &QAbstractItemModel::modelReset, this, [this]() {
+        d->mKindCache.clear();
+    });
 }
 
 void ThumbnailView::setThumbnailProvider(ThumbnailProvider* thumbnailProvider)
@@ -382,7 +567,8 @@ void ThumbnailView::updateThumbnailSize()
     d->mSmoothThumbnailTimer.stop();
     d->mSmoothThumbnailQueue.clear();
 
-    // Clear adjustedPixes
+    // Clear adjustedPixes. They are quickly recreated from the closest level
+    // of the mip sets, then smoothed in the background.
     ThumbnailForUrl::iterator
     it = d->mThumbnailForUrl.begin(),
     end = d->mThumbnailForUrl.end();
@@ -472,6 +658,7 @@ void ThumbnailView::rowsAboutToBeRemoved(const QModelIndex& parent, int start, i
 
         QUrl url = item.url();
         d->mThumbnailForUrl.remove(url);
+        d->mKindCache.invalidate(url);
         d->mSmoothThumbnailQueue.removeAll(url);
 
         itemList.append(item);
@@ -506,6 +693,7 @@ void ThumbnailView::dataChanged(const QModelIndex& topLeft, const QModelIndex& b
             continue;
         }
 
+        d->mKindCache.invalidate(item.url());
         ThumbnailForUrl::Iterator it = d->mThumbnailForUrl.find(item.url());
         if (it != d->mThumbnailForUrl.end()) {
             // All thumbnail views are connected to the model, so
@@ -549,6 +737,7 @@ void ThumbnailView::setThumbnail(const KFileItem& item, const QPixmap& pixmap, c
     }
     Thumbnail& thumbnail = it.value();
     thumbnail.mGroupPix = pixmap;
+    thumbnail.mMipSet.clear();
     thumbnail.mAdjustedPix = QPixmap();
     int largeGroupSize = ThumbnailGroup::pixelSize(ThumbnailGroup::Large2x);
     thumbnail.mFullSize = size.isValid() ? size : QSize(largeGroupSize, largeGroupSize);
@@ -569,7 +758,7 @@ void ThumbnailView::setBrokenThumbnail(const KFileItem& item)
         return;
     }
     Thumbnail& thumbnail = it.value();
-    MimeTypeUtils::Kind kind = MimeTypeUtils::fileItemKind(item);
+    MimeTypeUtils::Kind kind = d->mKindCache.kind(item);
     if (kind == MimeTypeUtils::KIND_VIDEO) {
         // Special case for videos because our kde install may come without
         // support for video thumbnails so we show the mimetype icon instead of
@@ -609,7 +798,7 @@ QPixmap ThumbnailView::thumbnailForIndex(const QModelIndex& index, QSize* fullSi
     Thumbnail& thumbnail = it.value();
 
     // If dir or archive, generate a thumbnail from fileitem pixmap
-    MimeTypeUtils::Kind kind = MimeTypeUtils::fileItemKind(item);
+    MimeTypeUtils::Kind kind = d->mKindCache.kind(item);
     if (kind == MimeTypeUtils::KIND_ARCHIVE || kind == MimeTypeUtils::KIND_DIR) {
         int groupSize = ThumbnailGroup::pixelSize(ThumbnailGroup::fromPixelSize(d->mThumbnailSize.height()));
         if (thumbnail.mGroupPix.isNull() || thumbnail.mGroupPix.height() < groupSize) {
@@ -825,7 +1014,7 @@ void ThumbnailView::generateThumbnailsForItems()
         }
 
         // Filter out archives
-        MimeTypeUtils::Kind kind = MimeTypeUtils::fileItemKind(item);
+        MimeTypeUtils::Kind kind = d->mKindCache.kind(item);
         if (kind == MimeTypeUtils::KIND_ARCHIVE) {
             continue;
         }
@@ -944,19 +1133,26 @@ void ThumbnailView::smoothNextThumbnail()
         return;
     }
 
-    QUrl url = d->mSmoothThumbnailQueue.dequeue();
-    ThumbnailForUrl::Iterator it = d->mThumbnailForUrl.find(url);
-    GV_RETURN_IF_FAIL2(it != d->mThumbnailForUrl.end(), url << "not in mThumbnailForUrl.");
-
-    Thumbnail& thumbnail = it.value();
-    thumbnail.mAdjustedPix = d->scale(thumbnail.mGroupPix, Qt::SmoothTransformation);
-    thumbnail.mRough = false;
-
-    GV_RETURN_IF_FAIL2(thumbnail.mIndex.isValid(), "index for" << url << "is invalid.");
-    update(thumbnail.mIndex);
+    if (d->mSmoothThumbnailWatcher.isRunning()) {
+        // The finished() handler will call us again
+        return;
+    }
 
-    if (!d->mSmoothThumbnailQueue.isEmpty()) {
-        d->mSmoothThumbnailTimer.start(0);
+    QList<SmoothJob> jobs;
+    while (!d->mSmoothThumbnailQueue.isEmpty() && jobs.count() < SMOOTH_BATCH_SIZE) {
+        const QUrl url = d->mSmoothThumbnailQueue.dequeue();
+        ThumbnailForUrl::ConstIterator it = d->mThumbnailForUrl.constFind(url);
+        if (it == d->mThumbnailForUrl.constEnd()) {
+            qWarning() << url << "not in mThumbnailForUrl.";
+            continue;
+        }
+        if (!it->mRough || it->mGroupPix.isNull()) {
+            continue;
+        }
+        jobs << d->createSmoothJob(url, it.value());
+    }
+    if (!jobs.isEmpty()) {
+        d->mSmoothThumbnailWatcher.setFuture(QtConcurrent::mapped(jobs, ThumbnailSmoother()));
     }
 }
 
@@ -25,6 +25,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #include <memory>
 
 // Qt
+#include <QByteArray>
 #include <QFile>
 #include <QDateTime>
 #include <QDebug>
@@ -64,6 +65,37 @@ static Exiv2::ExifData::const_iterator findDateTimeKey(const Exiv2::ExifData& ex
     return end;
 }
 
+static bool readDateTime(std::unique_ptr<Exiv2::Image> img, const QString& name, QDateTime* dateTime)
+{
+    try {
+        Exiv2::ExifData exifData = img->exifData();
+        if (exifData.empty()) {
+            return false;
+        }
+        Exiv2::ExifData::const_iterator it = findDateTimeKey(exifData);
+        if (it == exifData.end()) {
+            qWarning() << "No date in exif header of" << name;
+            return false;
+        }
+
+        std::ostringstream stream;
+        stream << *it;
+        QString value = QString::fromLocal8Bit(stream.str().c_str());
+
+        QDateTime dt = QDateTime::fromString(value, QStringLiteral("yyyy:MM:dd hh:mm:ss"));
+        if (!dt.isValid()) {
+            qWarning() << "Invalid date in exif header of" << name;
+            return false;
+        }
+
+        *dateTime = dt;
+        return true;
+    } catch (const Exiv2::Error& error) {
+        qWarning() << "Failed to read date from exif header of" << name << ". Error:" << error.what();
+        return false;
+    }
+}
+
 struct CacheItem
 {
     QDateTime fileMTime;
@@ -94,34 +126,7 @@ struct CacheItem
         if (!loader.load(path)) {
             return false;
         }
-        std::unique_ptr<Exiv2::Image> img(loader.popImage().release());
-        try {
-            Exiv2::ExifData exifData = img->exifData();
-            if (exifData.empty()) {
-                return false;
-            }
-            Exiv2::ExifData::const_iterator it = findDateTimeKey(exifData);
-            if (it == exifData.end()) {
-                qWarning() << "No date in exif header of" << path;
-                return false;
-            }
-
-            std::ostringstream stream;
-            stream << *it;
-            QString value = QString::fromLocal8Bit(stream.str().c_str());
-
-            QDateTime dt = QDateTime::fromString(value, QStringLiteral("yyyy:MM:dd hh:mm:ss"));
-            if (!dt.isValid()) {
-                qWarning() << "Invalid date in exif header of" << path;
-                return false;
-            }
-
-            realTime = dt;
-            return true;
-        } catch (const Exiv2::Error& error) {
-            qWarning() << "Failed to read date from exif header of" << path << ". Error:" << error.what();
-            return false;
-        }
+        return readDateTime(loader.popImage(), path, &realTime);
     }
 };
 
@@ -147,6 +152,16 @@ QDateTime dateTimeForFileItem(const KFileItem& fileItem, CachePolicy cachePolicy
     return it.value().realTime;
 }
 
+QDateTime dateTimeFromExifData(const QByteArray& data)
+{
+    QDateTime dateTime;
+    Exiv2ImageLoader loader;
+    if (loader.load(data)) {
+        readDateTime(loader.popImage(), QStringLiteral("<buffer>"), &dateTime);
+    }
+    return dateTime;
+}
+
 } // namespace
 
 } // namespace
@@ -25,6 +25,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #include <lib/gwenviewlib_export.h>
 
 class KFileItem;
+class QByteArray;
 class QDateTime;
 
 namespace Gwenview
@@ -41,6 +42,13 @@ enum CachePolicy
 
 QDateTime GWENVIEWLIB_EXPORT dateTimeForFileItem(const KFileItem& fileItem, Gwenview::TimeUtils::CachePolicy cachePolicy = UseCache);
 
+/**
+ * Returns the date stored in the Exif header of the image contained in
+ * @p data, or an invalid QDateTime if there is none. @p data does not need to
+ * contain the whole image: for JPEG files the first few hundred KB are enough.
+ */
+QDateTime GWENVIEWLIB_EXPORT dateTimeFromExifData(const QByteArray& data);
+
 } // namespace
 
 } // namespace
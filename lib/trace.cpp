@@ -0,0 +1,262 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2019 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "trace.h"
+
+// Qt
+#include <QAtomicInt>
+#include <QAtomicPointer>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMutex>
+#include <QSaveFile>
+#include <QThread>
+#include <QVector>
+#include <QDebug>
+
+// KDE
+
+// Local
+
+namespace Gwenview
+{
+
+namespace Trace
+{
+
+namespace
+{
+
+struct Event
+{
+    const char* mName;
+    char mPhase;
+    qint64 mTimestamp;
+    // Duration for complete events, value for counters, unused for instant
+    // events
+    qint64 mValue;
+};
+
+// Events are stored in chunks which are never reallocated nor freed, so
+// that the thread writing events never has to synchronize with the thread
+// dumping them.
+static const int CHUNK_SIZE = 4096;
+
+struct Chunk
+{
+    Chunk()
+    : mCount(0)
+    , mNext(nullptr)
+    {}
+
+    QAtomicInt mCount;
+    QAtomicPointer<Chunk> mNext;
+    Event mEvents[CHUNK_SIZE];
+};
+
+struct ThreadBuffer
+{
+    ThreadBuffer(int threadId, const QString& threadName)
+    : mThreadId(threadId)
+    , mThreadName(threadName)
+    , mFirstChunk(new Chunk)
+    , mLastChunk(mFirstChunk)
+    {}
+
+    // Must only be called from the thread owning the buffer
+    void add(const Event& event)
+    {
+        int count = mLastChunk->mCount.loadAcquire();
+        if (count == CHUNK_SIZE) {
+            Chunk* chunk = new Chunk;
+            mLastChunk->mNext.storeRelease(chunk);
+            mLastChunk = chunk;
+            count = 0;
+        }
+        mLastChunk->mEvents[count] = event;
+        mLastChunk->mCount.storeRelease(count + 1);
+    }
+
+    const int mThreadId;
+    const QString mThreadName;
+    Chunk* const mFirstChunk;
+    Chunk* mLastChunk;
+};
+
+struct TraceState
+{
+    TraceState()
+    {
+        mTimer.start();
+    }
+
+    QElapsedTimer mTimer;
+    QMutex mMutex;
+    // Protected by mMutex, only modified when a thread records its first
+    // event
+    QVector<ThreadBuffer*> mBuffers;
+};
+
+Q_GLOBAL_STATIC(TraceState, traceState)
+
+static thread_local ThreadBuffer* tBuffer = nullptr;
+
+static ThreadBuffer* threadBuffer()
+{
+    if (!tBuffer) {
+        TraceState* state = traceState();
+        QMutexLocker locker(&state->mMutex);
+        QString name = QThread::currentThread()->objectName();
+        if (name.isEmpty()) {
+            name = QCoreApplication::instance() && QThread::currentThread() == QCoreApplication::instance()->thread()
+                ? QStringLiteral("Main")
+                : QStringLiteral("Thread %1").arg(state->mBuffers.count());
+        }
+        tBuffer = new ThreadBuffer(state->mBuffers.count(), name);
+        state->mBuffers << tBuffer;
+    }
+    return tBuffer;
+}
+
+static QByteArray jsonString(const QString& string)
+{
+    QByteArray out = "\"";
+    for (const QChar ch : string) {
+        if (ch == QLatin1Char('"') || ch == QLatin1Char('\\')) {
+            out += '\\';
+            out += char(ch.unicode());
+        } else if (ch.unicode() < 0x20) {
+            out += QStringLiteral("\\u%1").arg(ch.unicode(), 4, 16, QLatin1Char('0')).toLatin1();
+        } else {
+            out += QString(ch).toUtf8();
+        }
+    }
+    out += '"';
+    return out;
+}
+
+static void writeTraceAtExit()
+{
+    const QString fileName = QFile::decodeName(qgetenv("GV_TRACE_FILE"));
+    if (writeTrace(fileName)) {
+        qInfo() << "Trace written to" << fileName;
+    }
+}
+
+static bool initTrace()
+{
+    if (qEnvironmentVariableIsEmpty("GV_TRACE_FILE")) {
+        return false;
+    }
+    // Start the clock now
+    traceState();
+    qAddPostRoutine(writeTraceAtExit);
+    return true;
+}
+
+} // namespace
+
+namespace Private
+{
+
+bool sEnabled = initTrace();
+
+qint64 now()
+{
+    return traceState()->mTimer.nsecsElapsed() / 1000;
+}
+
+void addComplete(const char* name, qint64 start)
+{
+    const Event event = { name, 'X', start, now() - start };
+    threadBuffer()->add(event);
+}
+
+void addCounter(const char* name, qint64 value)
+{
+    const Event event = { name, 'C', now(), value };
+    threadBuffer()->add(event);
+}
+
+void addInstant(const char* name)
+{
+    const Event event = { name, 'i', now(), 0 };
+    threadBuffer()->add(event);
+}
+
+} // namespace
+
+bool writeTrace(const QString& fileName)
+{
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Could not write trace to" << fileName << ":" << file.errorString();
+        return false;
+    }
+
+    TraceState* state = traceState();
+    QVector<ThreadBuffer*> buffers;
+    {
+        QMutexLocker locker(&state->mMutex);
+        buffers = state->mBuffers;
+    }
+
+    const QByteArray pid = QByteArray::number(QCoreApplication::applicationPid());
+    file.write("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    for (const ThreadBuffer* buffer : buffers) {
+        const QByteArray tid = QByteArray::number(buffer->mThreadId);
+        if (!first) {
+            file.write(",\n");
+        }
+        first = false;
+        file.write("{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" + pid + ",\"tid\":" + tid
+            + ",\"args\":{\"name\":" + jsonString(buffer->mThreadName) + "}}");
+
+        for (const Chunk* chunk = buffer->mFirstChunk; chunk; chunk = chunk->mNext.loadAcquire()) {
+            const int count = chunk->mCount.loadAcquire();
+            for (int idx = 0; idx < count; ++idx) {
+                const Event& event = chunk->mEvents[idx];
+                QByteArray line = ",\n{\"ph\":\"";
+                line += event.mPhase;
+                line += "\",\"name\":" + jsonString(QString::fromUtf8(event.mName))
+                    + ",\"pid\":" + pid + ",\"tid\":" + tid
+                    + ",\"ts\":" + QByteArray::number(event.mTimestamp);
+                if (event.mPhase == 'X') {
+                    line += ",\"dur\":" + QByteArray::number(event.mValue);
+                } else if (event.mPhase == 'i') {
+                    line += ",\"s\":\"g\"";
+                } else {
+                    line += ",\"args\":{\"value\":" + QByteArray::number(event.mValue) + '}';
+                }
+                line += '}';
+                file.write(line);
+            }
+        }
+    }
+    file.write("\n]}\n");
+    return file.commit();
+}
+
+} // namespace
+
+} // namespace
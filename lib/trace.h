@@ -0,0 +1,137 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2019 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <lib/gwenviewlib_export.h>
+
+// Qt
+#include <QtGlobal>
+
+// KDE
+
+// Local
+
+class QString;
+
+namespace Gwenview
+{
+
+/**
+ * Lightweight tracing of hot paths.
+ *
+ * Tracing is enabled by setting the GV_TRACE_FILE environment variable to
+ * the path of a file. Events are then recorded in per-thread buffers and
+ * written to this file, in the Chrome trace event format, when the
+ * application quits. The file can be opened with chrome://tracing or
+ * https://ui.perfetto.dev.
+ *
+ * When tracing is disabled, spans and counters only cost a test of a
+ * global boolean.
+ */
+namespace Trace
+{
+
+namespace Private
+{
+GWENVIEWLIB_EXPORT extern bool sEnabled;
+GWENVIEWLIB_EXPORT qint64 now();
+GWENVIEWLIB_EXPORT void addComplete(const char* name, qint64 start);
+GWENVIEWLIB_EXPORT void addCounter(const char* name, qint64 value);
+GWENVIEWLIB_EXPORT void addInstant(const char* name);
+} // namespace
+
+inline bool isEnabled()
+{
+    return Private::sEnabled;
+}
+
+/**
+ * Records the time spent between its construction and its destruction.
+ * @p name must outlive the application, in practice it must be a string
+ * literal.
+ */
+class Span
+{
+public:
+    explicit Span(const char* name)
+    : mName(isEnabled() ? name : nullptr)
+    , mStart(mName ? Private::now() : 0)
+    {}
+
+    ~Span()
+    {
+        if (mName) {
+            Private::addComplete(mName, mStart);
+        }
+    }
+
+private:
+    Q_DISABLE_COPY(Span)
+    const char* const mName;
+    const qint64 mStart;
+};
+
+/**
+ * Records the current value of a counter. Same constraint on @p name as
+ * for Span.
+ */
+inline void counter(const char* name, qint64 value)
+{
+    if (isEnabled()) {
+        Private::addCounter(name, value);
+    }
+}
+
+/**
+ * Records a point in time, such as a startup milestone. Same constraint on
+ * @p name as for Span.
+ */
+inline void instant(const char* name)
+{
+    if (isEnabled()) {
+        Private::addInstant(name);
+    }
+}
+
+/**
+ * Writes all events recorded so far to @p fileName. This is done
+ * automatically when the application quits.
+ */
+GWENVIEWLIB_EXPORT bool writeTrace(const QString& fileName);
+
+} // namespace
+
+} // namespace
+
+#define GV_TRACE_CONCAT_(a, b) a##b
+#define GV_TRACE_CONCAT(a, b) GV_TRACE_CONCAT_(a, b)
+
+/**
+ * Traces the rest of the current scope
+ */
+#define GV_TRACE_SPAN(name) Gwenview::Trace::Span GV_TRACE_CONCAT(gvTraceSpan, __LINE__)(name)
+
+#define GV_TRACE_COUNTER(name, value) Gwenview::Trace::counter(name, value)
+
+#define GV_TRACE_INSTANT(name) Gwenview::Trace::instant(name)
+
+#endif /* TRACE_H */
@@ -259,6 +259,61 @@ void DocumentTest::testLoadDownSampledPng()
     QCOMPARE(stateSpy.mState, Document::Loaded);
 }
 
+/**
+ * Down sampling an already loaded image builds all the intermediate levels in
+ * one job
+ */
+void DocumentTest::testDownSampleLoadedImage()
+{
+    QUrl url = urlForTestFile("test.png");
+    Document::Ptr doc = DocumentFactory::instance()->load(url);
+    doc->waitUntilLoaded();
+    const QImage image = doc->image();
+    QVERIFY(!image.isNull());
+
+    const int usageBeforeDownSampling = doc->memoryUsage();
+
+    QSignalSpy downSampledImageReadySpy(doc.data(), SIGNAL(downSampledImageReady()));
+    // invertedZoom == 4
+    QVERIFY(!doc->prepareDownSampledImageForZoom(0.1));
+    QVERIFY(downSampledImageReadySpy.wait());
+
+    // invertedZoom == 2 has been built by the same job
+    QVERIFY(doc->prepareDownSampledImageForZoom(0.2));
+    const QImage level2 = doc->downSampledImageForZoom(0.2);
+    const QImage level4 = doc->downSampledImageForZoom(0.1);
+    QCOMPARE(level2.size(), QSize(image.width() / 2, image.height() / 2));
+    // Sizes are rounded up: level2 is 75 pixels wide, the last column of
+    // level4 is made of its last column only
+    QCOMPARE(level4.size(), QSize((level2.width() + 1) / 2, (level2.height() + 1) / 2));
+    for (int y = 0; y < level4.height(); ++y) {
+        const QRgb p1 = level2.pixel(level2.width() - 1, 2 * y);
+        const QRgb p2 = level2.pixel(level2.width() - 1, qMin(2 * y + 1, level2.height() - 1));
+        const QRgb pixel = level4.pixel(level4.width() - 1, y);
+        QVERIFY(qAbs(qRed(pixel) - (qRed(p1) + qRed(p2)) / 2) <= 1);
+        QVERIFY(qAbs(qGreen(pixel) - (qGreen(p1) + qGreen(p2)) / 2) <= 1);
+        QVERIFY(qAbs(qBlue(pixel) - (qBlue(p1) + qBlue(p2)) / 2) <= 1);
+    }
+
+    // Levels are accounted for in the memory usage
+    QCOMPARE(doc->memoryUsage() - usageBeforeDownSampling, level2.byteCount() + level4.byteCount());
+
+    // Each pixel is the average of a 2x2 block
+    const QImage reference = image.convertToFormat(level2.format());
+    for (int y = 0; y < level2.height(); y += 7) {
+        for (int x = 0; x < level2.width(); x += 7) {
+            const QRgb p1 = reference.pixel(2 * x, 2 * y);
+            const QRgb p2 = reference.pixel(2 * x + 1, 2 * y);
+            const QRgb p3 = reference.pixel(2 * x, 2 * y + 1);
+            const QRgb p4 = reference.pixel(2 * x + 1, 2 * y + 1);
+            const QRgb pixel = level2.pixel(x, y);
+            QVERIFY(qAbs(qRed(pixel) - (qRed(p1) + qRed(p2) + qRed(p3) + qRed(p4)) / 4) <= 1);
+            QVERIFY(qAbs(qGreen(pixel) - (qGreen(p1) + qGreen(p2) + qGreen(p3) + qGreen(p4)) / 4) <= 1);
+            QVERIFY(qAbs(qBlue(pixel) - (qBlue(p1) + qBlue(p2) + qBlue(p3) + qBlue(p4)) / 4) <= 1);
+        }
+    }
+}
+
 void DocumentTest::testLoadRemote()
 {
     QUrl url = setUpRemoteTestDir("test.png");
@@ -109,6 +109,7 @@ private Q_SLOTS:
     void testLoadDownSampled();
     void testLoadDownSampled_data();
     void testLoadDownSampledPng();
+    void testDownSampleLoadedImage();
     void testLoadRemote();
     void testLoadAnimated();
     void testPrepareDownSampledAfterFailure();
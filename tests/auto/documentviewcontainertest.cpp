@@ -0,0 +1,57 @@
+/*
+Gwenview: an image viewer
+Copyright 2019 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#include <qtest.h>
+
+// Qt
+#include <QVector>
+
+// Local
+#include "../lib/documentview/documentviewcontainer.h"
+
+#include "documentviewcontainertest.h"
+
+QTEST_MAIN(DocumentViewContainerTest)
+
+using namespace Gwenview;
+
+static const qint64 MB = 1024 * 1024;
+
+void DocumentViewContainerTest::testRecycledViewCountToKeep_data()
+{
+    QTest::addColumn<QVector<qint64> >("memoryUsages");
+    QTest::addColumn<int>("expected");
+
+    QTest::newRow("none") << QVector<qint64>() << 0;
+    QTest::newRow("one") << (QVector<qint64>() << 10 * MB) << 1;
+    QTest::newRow("count-limit") << (QVector<qint64>() << MB << MB << MB << MB << MB) << 3;
+    // A document decoded in full counts, not only the scaled image
+    QTest::newRow("memory-limit") << (QVector<qint64>() << 100 * MB << 40 * MB << MB) << 1;
+    QTest::newRow("exactly-at-limit") << (QVector<qint64>() << 64 * MB << 64 * MB) << 2;
+    QTest::newRow("first-too-big") << (QVector<qint64>() << 200 * MB << MB) << 0;
+    // Older views are dropped first, even if a smaller one would still fit
+    QTest::newRow("drop-older") << (QVector<qint64>() << 20 * MB << 120 * MB << MB) << 1;
+}
+
+void DocumentViewContainerTest::testRecycledViewCountToKeep()
+{
+    QFETCH(QVector<qint64>, memoryUsages);
+    QFETCH(int, expected);
+    QCOMPARE(DocumentViewContainer::recycledViewCountToKeep(memoryUsages), expected);
+}
@@ -24,6 +24,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 // KDE
 #include <QDebug>
+#include <KConfig>
+#include <KConfigGroup>
 #include <KFilePlacesModel>
 #include <QTemporaryDir>
 #include <qtest.h>
@@ -109,11 +111,64 @@ void HistoryModelTest::testRemoveRows()
     QDateTime d2 = QDateTime::fromString("2009-01-29T23:01:47", Qt::ISODate);
 
     QTemporaryDir dir;
+    {
+        HistoryModel model(0, dir.path(), 2);
+        model.addUrl(u1, d1);
+        model.addUrl(u2, d2);
+        model.removeRows(0, 1);
+        QCOMPARE(model.rowCount(), 1);
+    }
+
+    // Removal must be persisted
     HistoryModel model(0, dir.path(), 2);
-    model.addUrl(u1, d1);
-    model.addUrl(u2, d2);
-    model.removeRows(0, 1);
     QCOMPARE(model.rowCount(), 1);
     QDir qDir(dir.path());
     QCOMPARE(qDir.entryList(QDir::Files | QDir::NoDotAndDotDot).count(), 1);
 }
+
+void HistoryModelTest::testLoadLegacyFiles()
+{
+    QUrl u1 = QUrl::fromLocalFile("/home");
+    QDateTime d1 = QDateTime::fromString("2008-02-03T12:34:56", Qt::ISODate);
+    QUrl u2 = QUrl::fromLocalFile("/root");
+    QDateTime d2 = QDateTime::fromString("2009-01-29T23:01:47", Qt::ISODate);
+
+    QTemporaryDir dir;
+    {
+        HistoryModel model(0, dir.path());
+        model.addUrl(u1, d1);
+    }
+    {
+        KConfig config(dir.path() + "/gvhistory123456rc", KConfig::SimpleConfig);
+        KConfigGroup group(&config, "general");
+        group.writeEntry("url", u2.toString());
+        group.writeEntry("dateTime", d2.toString(Qt::ISODate));
+    }
+
+    HistoryModel model(0, dir.path());
+    testModel(model, u2, u1);
+    QDir qDir(dir.path());
+    QCOMPARE(qDir.entryList(QStringList() << "gvhistory*rc").count(), 0);
+}
+
+void HistoryModelTest::testRemoveMissingUrls()
+{
+    QTemporaryDir dir;
+    QTemporaryDir existingDir;
+    QUrl u1 = QUrl::fromLocalFile(existingDir.path());
+    QDateTime d1 = QDateTime::fromString("2008-02-03T12:34:56", Qt::ISODate);
+    QUrl u2 = QUrl::fromLocalFile(dir.path() + "/does-not-exist");
+    QDateTime d2 = QDateTime::fromString("2009-01-29T23:01:47", Qt::ISODate);
+    {
+        HistoryModel model(0, dir.path());
+        model.addUrl(u1, d1);
+        model.addUrl(u2, d2);
+    }
+
+    // Missing urls are kept until removeMissingUrls() is called
+    HistoryModel model(0, dir.path());
+    QCOMPARE(model.rowCount(), 2);
+    model.removeMissingUrls();
+    QCOMPARE(model.rowCount(), 1);
+    QCOMPARE(model.data(model.index(0, 0), KFilePlacesModel::UrlRole).toUrl(), u1);
+}
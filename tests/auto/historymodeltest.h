@@ -31,6 +31,8 @@ private Q_SLOTS:
     void testAddUrl();
     void testGarbageCollect();
     void testRemoveRows();
+    void testLoadLegacyFiles();
+    void testRemoveMissingUrls();
 };
 
 #endif /* HISTORYMODELTEST_H */
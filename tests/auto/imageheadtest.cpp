@@ -0,0 +1,227 @@
+/*
+Gwenview: an image viewer
+Copyright 2019 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#include <qtest.h>
+
+// Qt
+#include <QBuffer>
+#include <QDataStream>
+#include <QFile>
+#include <QImage>
+#include <QImageWriter>
+#include <QPainter>
+
+// Local
+#include "../lib/thumbnailprovider/imagehead.h"
+#include "testutils.h"
+
+#include "imageheadtest.h"
+
+QTEST_MAIN(ImageHeadTest)
+
+using namespace Gwenview;
+
+static const int CHUNK_SIZE = 4096;
+
+// Head size at which ImageHead first looks for previews
+static const int FIRST_PREVIEW_CHECK_SIZE = 256 * 1024;
+
+static const quint16 TIFF_SHORT = 3;
+static const quint16 TIFF_LONG = 4;
+
+static QByteArray createJpeg(int width, int height, bool progressive)
+{
+    QImage image(width, height, QImage::Format_RGB32);
+    QPainter painter(&image);
+    QLinearGradient gradient(0, 0, width, height);
+    gradient.setColorAt(0, Qt::red);
+    gradient.setColorAt(0.5, Qt::green);
+    gradient.setColorAt(1, Qt::blue);
+    painter.fillRect(image.rect(), gradient);
+    painter.end();
+
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    QImageWriter writer(&buffer, "jpeg");
+    writer.setProgressiveScanWrite(progressive);
+    writer.setQuality(95);
+    writer.write(image);
+    return data;
+}
+
+static void writeTiffEntry(QDataStream& stream, quint16 tag, quint16 type, quint32 value)
+{
+    stream << tag << type << quint32(1);
+    if (type == TIFF_SHORT) {
+        stream << quint16(value) << quint16(0);
+    } else {
+        stream << value;
+    }
+}
+
+/**
+ * Returns a TIFF file, like most RAW files, describing an image of
+ * @p imageSize. The image pixels are not stored, only @p preview, as the
+ * JPEG thumbnail of IFD1 at @p previewOffset. The file is padded with zeros
+ * up to @p fileSize.
+ */
+static QByteArray createTiffWithPreview(const QSize& imageSize, const QByteArray& preview, int previewOffset, int fileSize)
+{
+    QByteArray data;
+    {
+        QDataStream stream(&data, QIODevice::WriteOnly);
+        stream.setByteOrder(QDataStream::LittleEndian);
+        stream << quint8('I') << quint8('I') << quint16(42) << quint32(8);
+
+        // IFD0: the image
+        stream << quint16(2);
+        writeTiffEntry(stream, 0x0100, TIFF_LONG, imageSize.width());  // ImageWidth
+        writeTiffEntry(stream, 0x0101, TIFF_LONG, imageSize.height()); // ImageLength
+        stream << quint32(8 + 2 + 2 * 12 + 4);
+
+        // IFD1: the preview
+        stream << quint16(3);
+        writeTiffEntry(stream, 0x0103, TIFF_SHORT, 6);              // Compression: JPEG
+        writeTiffEntry(stream, 0x0201, TIFF_LONG, previewOffset);   // JPEGInterchangeFormat
+        writeTiffEntry(stream, 0x0202, TIFF_LONG, preview.size());  // JPEGInterchangeFormatLength
+        stream << quint32(0);
+    }
+    Q_ASSERT(data.size() <= previewOffset);
+    data += QByteArray(previewOffset - data.size(), '\0');
+    data += preview;
+    data += QByteArray(qMax(0, fileSize - data.size()), '\0');
+    return data;
+}
+
+/**
+ * Appends @p data to @p head one chunk at a time, until the status changes.
+ * Returns the number of bytes appended.
+ */
+static int feed(ImageHead* head, const QByteArray& data)
+{
+    int pos = 0;
+    while (pos < data.size() && head->status() == ImageHead::NeedMoreData) {
+        head->append(data.mid(pos, CHUNK_SIZE));
+        pos += CHUNK_SIZE;
+    }
+    return qMin(pos, data.size());
+}
+
+void ImageHeadTest::testProgressiveJpeg()
+{
+    const QByteArray data = createJpeg(2400, 1600, true);
+    ImageHead head(256);
+    const int fedSize = feed(&head, data);
+    QCOMPARE(head.status(), ImageHead::Usable);
+    QVERIFY2(fedSize < data.size(), "The whole file was needed");
+
+    const QByteArray source = head.thumbnailSource();
+    QVERIFY(source.size() <= fedSize);
+    QImage image;
+    QVERIFY(image.loadFromData(source, "jpeg"));
+    QCOMPARE(image.size(), QSize(2400, 1600));
+    QCOMPARE(head.imageSize(), QSize(2400, 1600));
+}
+
+void ImageHeadTest::testBaselineJpeg()
+{
+    const QByteArray data = createJpeg(2400, 1600, false);
+    ImageHead head(256);
+    const int fedSize = feed(&head, data);
+    QCOMPARE(head.status(), ImageHead::Unusable);
+    // The headers are enough to tell
+    QVERIFY(fedSize <= CHUNK_SIZE);
+}
+
+void ImageHeadTest::testSmallProgressiveJpeg()
+{
+    // DC scans of this image are only 100x75, not enough for a 256 thumbnail
+    const QByteArray data = createJpeg(800, 600, true);
+    ImageHead head(256);
+    feed(&head, data);
+    QCOMPARE(head.status(), ImageHead::Unusable);
+}
+
+void ImageHeadTest::testExifThumbnail()
+{
+    // This image is 256x128 and contains a 128x64 thumbnail
+    QFile file(pathForTestFile("embedded-thumbnail.jpg"));
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    const QByteArray data = file.readAll();
+
+    {
+        ImageHead head(128);
+        head.append(data);
+        QCOMPARE(head.status(), ImageHead::Usable);
+    }
+    {
+        ImageHead head(256);
+        head.append(data);
+        QCOMPARE(head.status(), ImageHead::Unusable);
+    }
+}
+
+void ImageHeadTest::testNeedMoreData()
+{
+    const QByteArray data = createJpeg(2400, 1600, true);
+    ImageHead head(256);
+    QCOMPARE(head.append(data.left(10)), ImageHead::NeedMoreData);
+    QCOMPARE(head.append(data.mid(10)), ImageHead::Usable);
+    // The status does not change anymore
+    QCOMPARE(head.append(QByteArray(10, 'x')), ImageHead::Usable);
+}
+
+void ImageHeadTest::testPreview_data()
+{
+    QTest::addColumn<int>("previewOffset");
+
+    QTest::newRow("in-first-check") << 1024;
+    // Exiv2 does not list this preview when the head is first checked
+    QTest::newRow("past-first-check") << 2 * FIRST_PREVIEW_CHECK_SIZE;
+}
+
+void ImageHeadTest::testPreview()
+{
+    QFETCH(int, previewOffset);
+    const QByteArray preview = createJpeg(256, 192, false);
+    const QByteArray data = createTiffWithPreview(QSize(4000, 3000), preview, previewOffset, 4 * FIRST_PREVIEW_CHECK_SIZE + CHUNK_SIZE);
+
+    ImageHead head(128);
+    const int fedSize = feed(&head, data);
+    QCOMPARE(head.status(), ImageHead::Usable);
+    QVERIFY(fedSize >= previewOffset + preview.size());
+    if (previewOffset > FIRST_PREVIEW_CHECK_SIZE) {
+        QVERIFY(fedSize > FIRST_PREVIEW_CHECK_SIZE);
+    } else {
+        QVERIFY(fedSize <= FIRST_PREVIEW_CHECK_SIZE);
+    }
+
+    QCOMPARE(head.thumbnailSource(), preview);
+    // The size of the image, not the size of the preview
+    QCOMPARE(head.imageSize(), QSize(4000, 3000));
+}
+
+void ImageHeadTest::testNotJpeg()
+{
+    QFile file(pathForTestFile("test.png"));
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    ImageHead head(128);
+    QCOMPARE(head.append(file.readAll()), ImageHead::NeedMoreData);
+}
@@ -22,6 +22,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <memory>
 
 // Qt
+#include <QSignalSpy>
 
 // KDE
 #include <QDebug>
@@ -61,3 +62,63 @@ void ImageMetaInfoModelTest::testCatchExiv2Errors()
     ImageMetaInfoModel model;
     model.setExiv2Image(image.get());
 }
+
+void ImageMetaInfoModelTest::testLazyGroups()
+{
+    std::unique_ptr<Exiv2::Image> image;
+    {
+        Exiv2ImageLoader loader;
+        QVERIFY(loader.load(pathForTestFile("orient6.jpg")));
+        image = loader.popImage();
+    }
+
+    ImageMetaInfoModel model;
+    model.setExiv2Image(image.get());
+
+    // Exif group is not filled until it is requested, but its keys can
+    // already be read
+    QModelIndex exifIndex;
+    for (int row = 0; row < model.rowCount(); ++row) {
+        const QModelIndex index = model.index(row, 0);
+        if (index.data().toString() == QLatin1String("EXIF")) {
+            exifIndex = index;
+        }
+    }
+    QVERIFY(exifIndex.isValid());
+    QCOMPARE(model.rowCount(exifIndex), 0);
+    QVERIFY(model.hasChildren(exifIndex));
+    QVERIFY(model.canFetchMore(exifIndex));
+
+    const QString key = QStringLiteral("Exif.Image.Orientation");
+    QString lazyLabel, lazyValue;
+    model.getInfoForKey(key, &lazyLabel, &lazyValue);
+    QVERIFY(!lazyValue.isEmpty());
+
+    // Unknown keys are left untouched
+    QString label, value;
+    model.getInfoForKey(QStringLiteral("Exif.Image.DoesNotExist"), &label, &value);
+    QVERIFY(label.isEmpty());
+    QVERIFY(value.isEmpty());
+
+    model.fetchMore(exifIndex);
+    QVERIFY(!model.canFetchMore(exifIndex));
+    QVERIFY(model.rowCount(exifIndex) > 0);
+
+    model.getInfoForKey(key, &label, &value);
+    QCOMPARE(label, lazyLabel);
+    QCOMPARE(value, lazyValue);
+
+    // Setting a new image drops the filled rows, and tells views the group
+    // can be fetched again
+    QSignalSpy spy(&model, SIGNAL(dataChanged(QModelIndex,QModelIndex,QVector<int>)));
+    model.setExiv2Image(image.get());
+    QCOMPARE(model.rowCount(exifIndex), 0);
+    QVERIFY(model.canFetchMore(exifIndex));
+    bool exifChanged = false;
+    for (const QList<QVariant>& arguments : spy) {
+        if (arguments.at(0).toModelIndex() == exifIndex) {
+            exifChanged = true;
+        }
+    }
+    QVERIFY(exifChanged);
+}
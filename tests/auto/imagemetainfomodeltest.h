@@ -33,6 +33,7 @@ class ImageMetaInfoModelTest : public QObject
 
 private Q_SLOTS:
     void testCatchExiv2Errors();
+    void testLazyGroups();
 };
 
 #endif // IMAGEMETAINFOMODELTEST_H
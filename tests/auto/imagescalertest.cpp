@@ -26,6 +26,10 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 #include "testutils.h"
 
+// Qt
+#include <QAtomicInt>
+#include <QSignalSpy>
+
 QTEST_MAIN(ImageScalerTest)
 
 using namespace Gwenview;
@@ -66,6 +70,108 @@ void ImageScalerTest::testScaleFullImage()
     QVERIFY(TestUtils::imageCompare(scaledImage, expectedImage));
 }
 
+static ImageScaler::PostProcess createInvertPostProcess(QAtomicInt* callCount)
+{
+    return [callCount](QImage& image) {
+        callCount->ref();
+        image.invertPixels();
+    };
+}
+
+/**
+ * Batched scalers showing the same image at the same zoom with the same
+ * post-processing share their results, which are emitted in the same event
+ * loop iteration
+ */
+void ImageScalerTest::testBatchedScalersShareResults()
+{
+    const qreal zoom = 2;
+    QUrl url = urlForTestFile("test.png");
+    Document::Ptr doc = DocumentFactory::instance()->load(url);
+    doc->waitUntilLoaded();
+    QVERIFY(!doc->image().isNull());
+
+    QAtomicInt postProcessCount(0);
+    const ImageScaler::PostProcess postProcess = createInvertPostProcess(&postProcessCount);
+    const QRect rect(QPoint(0, 0), doc->size() * zoom);
+
+    ImageScaler scaler1;
+    ImageScaler scaler2;
+    ImageScalerClient client1(&scaler1);
+    ImageScalerClient client2(&scaler2);
+    for (ImageScaler* scaler : {&scaler1, &scaler2}) {
+        scaler->setBatched(true);
+        scaler->setDocument(doc);
+        scaler->setZoom(zoom);
+        scaler->setPostProcess(postProcess, "invert");
+    }
+    QSignalSpy spy1(&scaler1, SIGNAL(scaledRect(int,int,QImage)));
+    QSignalSpy spy2(&scaler2, SIGNAL(scaledRect(int,int,QImage)));
+
+    scaler1.setDestinationRegion(rect);
+    scaler2.setDestinationRegion(rect);
+
+    // Nothing is scaled until control goes back to the event loop
+    QCOMPARE(spy1.count(), 0);
+    QCOMPARE(spy2.count(), 0);
+
+    // Both scalers get their results at once
+    QCoreApplication::processEvents();
+    QCOMPARE(spy1.count(), 1);
+    QCOMPARE(spy2.count(), 1);
+
+    // The identical requests have been computed once
+    QCOMPARE(postProcessCount.load(), 1);
+
+    QImage expectedImage = doc->image().scaled(rect.size(), Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    expectedImage.invertPixels();
+    QVERIFY(TestUtils::imageCompare(client1.createFullImage(), expectedImage));
+    QVERIFY(TestUtils::imageCompare(client2.createFullImage(), expectedImage));
+}
+
+/**
+ * Batched scalers with different post-processing keys, like views showing
+ * the same document with different color transforms, do not share results
+ */
+void ImageScalerTest::testBatchedScalersWithDifferentPostProcess()
+{
+    const qreal zoom = 2;
+    QUrl url = urlForTestFile("test.png");
+    Document::Ptr doc = DocumentFactory::instance()->load(url);
+    doc->waitUntilLoaded();
+    QVERIFY(!doc->image().isNull());
+
+    QAtomicInt postProcessCount(0);
+    const ImageScaler::PostProcess postProcess = createInvertPostProcess(&postProcessCount);
+    const QRect rect(QPoint(0, 0), doc->size() * zoom);
+
+    ImageScaler scaler1;
+    ImageScaler scaler2;
+    ImageScalerClient client1(&scaler1);
+    ImageScalerClient client2(&scaler2);
+    for (ImageScaler* scaler : {&scaler1, &scaler2}) {
+        scaler->setBatched(true);
+        scaler->setDocument(doc);
+        scaler->setZoom(zoom);
+    }
+    scaler1.setPostProcess(postProcess, "invert-1");
+    scaler2.setPostProcess(ImageScaler::PostProcess(), QByteArray());
+
+    QSignalSpy spy1(&scaler1, SIGNAL(scaledRect(int,int,QImage)));
+    QSignalSpy spy2(&scaler2, SIGNAL(scaledRect(int,int,QImage)));
+    scaler1.setDestinationRegion(rect);
+    scaler2.setDestinationRegion(rect);
+    QCoreApplication::processEvents();
+    QCOMPARE(spy1.count(), 1);
+    QCOMPARE(spy2.count(), 1);
+    QCOMPARE(postProcessCount.load(), 1);
+
+    QImage expectedImage = doc->image().scaled(rect.size(), Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    QVERIFY(TestUtils::imageCompare(client2.createFullImage(), expectedImage));
+    expectedImage.invertPixels();
+    QVERIFY(TestUtils::imageCompare(client1.createFullImage(), expectedImage));
+}
+
 #if 0
 /**
  * Scale parts of an image
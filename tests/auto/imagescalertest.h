@@ -88,6 +88,8 @@ class ImageScalerTest : public QObject
 
 private Q_SLOTS:
     void testScaleFullImage();
+    void testBatchedScalersShareResults();
+    void testBatchedScalersWithDifferentPostProcess();
 
     // FIXME Disabled for now, does not compile since ImageScaler::setImage() has
     // been replaced with ImageScaler::setDocument()
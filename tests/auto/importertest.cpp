@@ -34,6 +34,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "../importer/fileutils.h"
 #include "../importer/importer.h"
 #include "../importer/filenameformater.h"
+#include "../importer/importhashindex.h"
 #include "testutils.h"
 
 QTEST_MAIN(ImporterTest)
@@ -174,6 +175,70 @@ void ImporterTest::testRenamedCount()
     QCOMPARE(importer.renamedCount(), 1);
 }
 
+void ImporterTest::testSkipDuplicateUnderOtherName()
+{
+    QUrl destUrl = QUrl::fromLocalFile(mTempDir->path() + "/foo");
+
+    Importer importer(nullptr);
+    importer.setAutoRenameFormat("{date}_{time}.{ext}");
+
+    QEventLoop loop;
+    connect(&importer, &Importer::importFinished, &loop, &QEventLoop::quit);
+    importer.start(mDocumentList, destUrl);
+    loop.exec();
+
+    QCOMPARE(importer.importedUrlList(), mDocumentList);
+
+    // Documents are already there under their date-based names, the hash
+    // index must recognize them
+    importer.setAutoRenameFormat(QString());
+    importer.setParallelCopyCount(1);
+    importer.start(mDocumentList, destUrl);
+    loop.exec();
+
+    QVERIFY(importer.importedUrlList().isEmpty());
+    QCOMPARE(importer.skippedUrlList(), mDocumentList);
+    QCOMPARE(importer.renamedCount(), 0);
+}
+
+void ImporterTest::testHashIndex()
+{
+    const QString dirPath = mTempDir->path();
+    const QString path1 = dirPath + "/a.jpg";
+    const QString path2 = dirPath + "/b.jpg";
+    QVERIFY(QFile::copy(mDocumentList[0].toLocalFile(), path1));
+    QVERIFY(QFile::copy(mDocumentList[1].toLocalFile(), path2));
+    const QByteArray hash1 = ImportHashIndex::hashFile(path1);
+    const QByteArray hash2 = ImportHashIndex::hashFile(path2);
+    QVERIFY(!hash1.isEmpty());
+    QVERIFY(hash1 != hash2);
+
+    {
+        ImportHashIndex index(dirPath);
+        index.load();
+        QVERIFY(index.find(hash1).isEmpty());
+        QCOMPARE(index.hashForFile(path1), hash1);
+        index.insert(hash2, path2);
+        QVERIFY(index.save());
+    }
+
+    // Reload, entries must have been persisted
+    ImportHashIndex index(dirPath);
+    index.load();
+    QCOMPARE(index.find(hash1), path1);
+    QCOMPARE(index.find(hash2), path2);
+
+    // Modified or removed files must be forgotten
+    {
+        QFile file(path1);
+        QVERIFY(file.open(QIODevice::Append));
+        file.write("foo");
+    }
+    QVERIFY(index.find(hash1).isEmpty());
+    QVERIFY(QFile::remove(path2));
+    QVERIFY(index.find(hash2).isEmpty());
+}
+
 void ImporterTest::testFileNameFormater()
 {
     QFETCH(QString, fileName);
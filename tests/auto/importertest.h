@@ -44,6 +44,8 @@ private Q_SLOTS:
     void testFileNameFormater_data();
     void testSkippedUrlList();
     void testRenamedCount();
+    void testSkipDuplicateUnderOtherName();
+    void testHashIndex();
 
 private:
     std::unique_ptr<QTemporaryDir> mTempDir;
@@ -0,0 +1,109 @@
+/*
+Gwenview: an image viewer
+Copyright 2019 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Qt
+#include <QSignalSpy>
+#include <QTest>
+
+// KDE
+#include <KFileItem>
+
+// Local
+#include "../lib/document/documentfactory.h"
+#include "../lib/gwenviewconfig.h"
+#include "../lib/imagemetainfomodel.h"
+#include "../lib/metainfoprobe.h"
+#include "testutils.h"
+
+#include "metainfoprobetest.h"
+
+QTEST_MAIN(MetaInfoProbeTest)
+
+using namespace Gwenview;
+
+static MetaInfoProbe::Ptr finishedProbe(const QString& fileName)
+{
+    KFileItem item(urlForTestFile(fileName));
+    MetaInfoProbe::Ptr probe = MetaInfoProbe::probe(item);
+    if (probe && !probe->isFinished()) {
+        QSignalSpy spy(probe.data(), SIGNAL(finished()));
+        spy.wait();
+    }
+    return probe;
+}
+
+void MetaInfoProbeTest::initTestCase()
+{
+    GwenviewConfig::setApplyExifOrientation(true);
+}
+
+void MetaInfoProbeTest::testProbe_data()
+{
+    QTest::addColumn<QString>("fileName");
+    QTest::addColumn<bool>("hasExif");
+
+    QTest::newRow("orient6.jpg") << "orient6.jpg" << true;
+    QTest::newRow("test.png") << "test.png" << false;
+    QTest::newRow("png-with-jpeg-extension.jpg") << "png-with-jpeg-extension.jpg" << false;
+}
+
+void MetaInfoProbeTest::testProbe()
+{
+    QFETCH(QString, fileName);
+    QFETCH(bool, hasExif);
+
+    MetaInfoProbe::Ptr probe = finishedProbe(fileName);
+    QVERIFY(probe);
+    QVERIFY(probe->isFinished());
+    QCOMPARE(probe->hasExif(), hasExif);
+
+    // Probing must not take a DocumentFactory slot
+    const QUrl url = urlForTestFile(fileName);
+    QVERIFY(!DocumentFactory::instance()->hasUrl(url));
+
+    // Must give the same results as loading the whole document
+    Document::Ptr doc = DocumentFactory::instance()->load(url);
+    doc->waitUntilLoaded();
+    QCOMPARE(probe->format(), doc->format());
+    QCOMPARE(probe->size(), doc->size());
+
+    QString label, probeValue, docValue;
+    probe->metaInfo()->getInfoForKey(QStringLiteral("General.ImageSize"), &label, &probeValue);
+    doc->metaInfo()->getInfoForKey(QStringLiteral("General.ImageSize"), &label, &docValue);
+    QCOMPARE(probeValue, docValue);
+    DocumentFactory::instance()->clearCache();
+}
+
+void MetaInfoProbeTest::testCache()
+{
+    MetaInfoProbe::clearCache();
+    MetaInfoProbe::Ptr probe1 = finishedProbe("orient6.jpg");
+    MetaInfoProbe::Ptr probe2 = finishedProbe("orient6.jpg");
+    QCOMPARE(probe1.data(), probe2.data());
+
+    MetaInfoProbe::clearCache();
+    MetaInfoProbe::Ptr probe3 = finishedProbe("orient6.jpg");
+    QVERIFY(probe1.data() != probe3.data());
+}
+
+void MetaInfoProbeTest::testRemoteUrl()
+{
+    KFileItem item(QUrl(QStringLiteral("http://example.com/image.jpg")));
+    QVERIFY(!MetaInfoProbe::probe(item));
+}
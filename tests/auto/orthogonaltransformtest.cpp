@@ -0,0 +1,123 @@
+/*
+Gwenview: an image viewer
+Copyright 2019 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#include <qtest.h>
+
+// Qt
+#include <QImage>
+#include <QTransform>
+#include <QtMath>
+
+// Local
+#include "../lib/imageutils.h"
+#include "../lib/orthogonaltransform.h"
+
+#include "orthogonaltransformtest.h"
+
+QTEST_MAIN(OrthogonalTransformTest)
+
+using namespace Gwenview;
+
+static QImage createTestImage(int width, int height, QImage::Format format)
+{
+    QImage image(width, height, format);
+    if (format == QImage::Format_Indexed8) {
+        QVector<QRgb> colors;
+        for (int idx = 0; idx < 256; ++idx) {
+            colors << qRgb(idx, 255 - idx, (idx * 7) & 0xFF);
+        }
+        image.setColorTable(colors);
+    } else if (format == QImage::Format_Mono) {
+        image.setColorTable(QVector<QRgb>() << qRgb(0, 0, 0) << qRgb(255, 255, 255));
+    }
+    quint32 seed = 1;
+    for (int y = 0; y < height; ++y) {
+        uchar* line = image.scanLine(y);
+        for (int x = 0; x < image.bytesPerLine(); ++x) {
+            seed = seed * 1103515245 + 12345;
+            line[x] = uchar(seed >> 16);
+        }
+    }
+    return image;
+}
+
+void OrthogonalTransformTest::testTransformed_data()
+{
+    QTest::addColumn<int>("format");
+    QTest::addColumn<QSize>("size");
+    QTest::addColumn<int>("orientation");
+
+    const QList<QImage::Format> formats = QList<QImage::Format>()
+        << QImage::Format_RGB32
+        << QImage::Format_ARGB32
+        << QImage::Format_RGB888
+        << QImage::Format_RGB16
+        << QImage::Format_Grayscale8
+        << QImage::Format_Indexed8
+        << QImage::Format_Mono;
+    const QList<QSize> sizes = QList<QSize>()
+        << QSize(1, 1)
+        << QSize(7, 3)
+        << QSize(65, 65)
+        << QSize(301, 173)
+        << QSize(600, 600);
+    for (QImage::Format format : formats) {
+        for (const QSize& size : sizes) {
+            for (int orientation = HFLIP; orientation <= ROT_270; ++orientation) {
+                const QString name = QStringLiteral("format %1 %2x%3 orientation %4")
+                    .arg(format).arg(size.width()).arg(size.height()).arg(orientation);
+                QTest::newRow(qPrintable(name)) << int(format) << size << orientation;
+            }
+        }
+    }
+}
+
+void OrthogonalTransformTest::testTransformed()
+{
+    QFETCH(int, format);
+    QFETCH(QSize, size);
+    QFETCH(int, orientation);
+
+    const QImage image = createTestImage(size.width(), size.height(), QImage::Format(format));
+    const QImage result = OrthogonalTransform::transformed(image, Orientation(orientation));
+
+    const QTransform matrix = QImage::trueMatrix(ImageUtils::transformMatrix(Orientation(orientation)), image.width(), image.height());
+    QCOMPARE(result.size(), matrix.mapRect(QRect(QPoint(0, 0), image.size())).size());
+    for (int y = 0; y < image.height(); ++y) {
+        for (int x = 0; x < image.width(); ++x) {
+            const QPointF center = matrix.map(QPointF(x + 0.5, y + 0.5));
+            const QPoint pos(qFloor(center.x()), qFloor(center.y()));
+            if (result.pixel(pos) != image.pixel(x, y)) {
+                QFAIL(qPrintable(QStringLiteral("Pixel %1,%2 is not at %3,%4")
+                    .arg(x).arg(y).arg(pos.x()).arg(pos.y())));
+            }
+        }
+    }
+}
+
+void OrthogonalTransformTest::testSharedImage()
+{
+    // Transforming a shared image must not change the other copies
+    const QImage image = createTestImage(300, 300, QImage::Format_RGB32);
+    const QImage reference = image.copy();
+    QImage copy = image;
+    copy = OrthogonalTransform::transformed(std::move(copy), ROT_90);
+    QCOMPARE(image, reference);
+    QVERIFY(copy != reference);
+}
@@ -0,0 +1,148 @@
+/*
+Gwenview: an image viewer
+Copyright 2019 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+// Qt
+#include <QBuffer>
+#include <QImage>
+#include <QPainter>
+#include <qtest.h>
+
+// Local
+#include "../lib/parallelimageencoder.h"
+
+#include "parallelimageencodertest.h"
+
+QTEST_MAIN(ParallelImageEncoderTest)
+
+using namespace Gwenview;
+
+// Tall enough to be split in several strips
+static const QSize TEST_SIZE(301, 1999);
+
+static QImage createTestImage(QImage::Format format)
+{
+    QImage image(TEST_SIZE, QImage::Format_ARGB32);
+    image.fill(Qt::transparent);
+    {
+        QPainter painter(&image);
+        QLinearGradient gradient(0, 0, 0, TEST_SIZE.height());
+        gradient.setColorAt(0, QColor(255, 0, 0, 128));
+        gradient.setColorAt(1, QColor(0, 0, 255, 255));
+        painter.fillRect(image.rect(), gradient);
+        painter.fillRect(10, 10, 100, 1500, Qt::green);
+    }
+    return image.convertToFormat(format);
+}
+
+void ParallelImageEncoderTest::initTestCase()
+{
+    // Do not depend on the number of cores of the machine running the tests
+    ParallelImageEncoder::setMaxStripCount(4);
+}
+
+static int pngChunkCount(const QByteArray& data, const QByteArray& type)
+{
+    int count = 0;
+    // Skip the signature, then walk through the chunks: length, type, data
+    // and CRC
+    int pos = 8;
+    while (pos + 8 <= data.size()) {
+        const int length = (uchar(data[pos]) << 24) | (uchar(data[pos + 1]) << 16)
+            | (uchar(data[pos + 2]) << 8) | uchar(data[pos + 3]);
+        if (data.mid(pos + 4, 4) == type) {
+            ++count;
+        }
+        pos += 12 + length;
+    }
+    return count;
+}
+
+void ParallelImageEncoderTest::testPngRoundTrip_data()
+{
+    QTest::addColumn<int>("format");
+    QTest::newRow("rgb32") << int(QImage::Format_RGB32);
+    QTest::newRow("argb32") << int(QImage::Format_ARGB32);
+    QTest::newRow("gray8") << int(QImage::Format_Grayscale8);
+}
+
+void ParallelImageEncoderTest::testPngRoundTrip()
+{
+    QFETCH(int, format);
+    const QImage image = createTestImage(QImage::Format(format));
+    QVERIFY(ParallelImageEncoder::stripCount(image, "png") > 1);
+
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    QString errorString;
+    QVERIFY2(ParallelImageEncoder::writePng(&buffer, image, &errorString), qPrintable(errorString));
+
+    // Each strip is stored in its own IDAT chunk
+    QCOMPARE(pngChunkCount(buffer.data(), "IDAT"), ParallelImageEncoder::stripCount(image, "png"));
+
+    QImage result;
+    QVERIFY(result.loadFromData(buffer.data(), "png"));
+    QCOMPARE(result.size(), image.size());
+    QCOMPARE(result.convertToFormat(QImage::Format_ARGB32), image.convertToFormat(QImage::Format_ARGB32));
+}
+
+void ParallelImageEncoderTest::testJpegRoundTrip()
+{
+    const QImage image = createTestImage(QImage::Format_RGB32);
+    QVERIFY(ParallelImageEncoder::stripCount(image, "jpeg") > 1);
+
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    QString errorString;
+    QVERIFY2(ParallelImageEncoder::writeJpeg(&buffer, image, 90, QByteArray(), &errorString), qPrintable(errorString));
+
+    QImage result;
+    QVERIFY(result.loadFromData(buffer.data(), "jpeg"));
+    QCOMPARE(result.size(), image.size());
+    result = result.convertToFormat(QImage::Format_RGB32);
+
+    // Check the strips have been correctly stitched together by comparing
+    // every row with the original, allowing for compression artifacts
+    for (int y = 0; y < image.height(); ++y) {
+        const QRgb* expectedLine = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+        const QRgb* line = reinterpret_cast<const QRgb*>(result.constScanLine(y));
+        int error = 0;
+        for (int x = 0; x < image.width(); ++x) {
+            error += qAbs(qRed(line[x]) - qRed(expectedLine[x]))
+                + qAbs(qGreen(line[x]) - qGreen(expectedLine[x]))
+                + qAbs(qBlue(line[x]) - qBlue(expectedLine[x]));
+        }
+        QVERIFY2(error / image.width() < 16, qPrintable(QStringLiteral("Too many differences on row %1").arg(y)));
+    }
+}
+
+void ParallelImageEncoderTest::testJpegIccProfile()
+{
+    // Not a real profile, but big enough to be split in several APP2 markers
+    QByteArray profile;
+    for (int idx = 0; idx < 100000; ++idx) {
+        profile.append(char(idx % 251));
+    }
+
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    QString errorString;
+    QVERIFY(ParallelImageEncoder::writeJpeg(&buffer, createTestImage(QImage::Format_RGB32), 75, profile, &errorString));
+
+    QCOMPARE(ParallelImageEncoder::iccProfileFromJpegData(buffer.data()), profile);
+}
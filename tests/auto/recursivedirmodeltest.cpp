@@ -26,6 +26,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <lib/recursivedirmodel.h>
 
 // Qt
+#include <QSignalSpy>
 
 // KDE
 #include <KDirModel>
@@ -203,3 +204,69 @@ void RecursiveDirModelTest::testSetNewUrl()
     loop.exec();
     QCOMPARE(model.rowCount(QModelIndex()), 2);
 }
+
+static void fillManyFiles(TestUtils::SandBoxDir* sandBoxDir, int dirCount, int filesPerDir)
+{
+    QStringList files;
+    for (int dirIdx = 0; dirIdx < dirCount; ++dirIdx) {
+        for (int fileIdx = 0; fileIdx < filesPerDir; ++fileIdx) {
+            files << QStringLiteral("d%1/sub/pict%2.jpg").arg(dirIdx).arg(fileIdx);
+        }
+    }
+    sandBoxDir->fill(files);
+}
+
+void RecursiveDirModelTest::testManyFiles()
+{
+    const int dirCount = 50;
+    const int filesPerDir = 200;
+    TestUtils::SandBoxDir sandBoxDir;
+    fillManyFiles(&sandBoxDir, dirCount, filesPerDir);
+
+    RecursiveDirModel model;
+    TestUtils::TimedEventLoop loop;
+    connect(&model, &RecursiveDirModel::completed, &loop, &QEventLoop::quit);
+    QSignalSpy insertedSpy(&model, &QAbstractItemModel::rowsInserted);
+
+    model.setUrl(QUrl::fromLocalFile(sandBoxDir.absolutePath()));
+    loop.exec();
+
+    const QList<QUrl> urls = listModelUrls(&model);
+    QCOMPARE(urls.count(), dirCount * filesPerDir);
+    QCOMPARE(urls.toSet().count(), urls.count());
+    // Rows must be inserted in batches, not one dir at a time
+    QVERIFY(insertedSpy.count() < dirCount);
+}
+
+void RecursiveDirModelTest::testRemoveManyFiles()
+{
+    const int dirCount = 10;
+    const int filesPerDir = 500;
+    TestUtils::SandBoxDir sandBoxDir;
+    fillManyFiles(&sandBoxDir, dirCount, filesPerDir);
+
+    RecursiveDirModel model;
+    TestUtils::TimedEventLoop loop;
+    connect(&model, &RecursiveDirModel::completed, &loop, &QEventLoop::quit);
+    model.setUrl(QUrl::fromLocalFile(sandBoxDir.absolutePath()));
+    loop.exec();
+    QCOMPARE(model.rowCount(QModelIndex()), dirCount * filesPerDir);
+
+    // Files of a dir are listed together, so removing a dir must remove a
+    // few ranges of rows, not one row at a time
+    QSignalSpy removedSpy(&model, &QAbstractItemModel::rowsRemoved);
+    QVERIFY(QDir(sandBoxDir.absoluteFilePath("d3")).removeRecursively());
+    QTRY_COMPARE_WITH_TIMEOUT(model.rowCount(QModelIndex()), (dirCount - 1) * filesPerDir, 10000);
+    QVERIFY(removedSpy.count() < 10);
+
+    // Remaining rows must still be found after the removal
+    const QList<QUrl> urls = listModelUrls(&model);
+    QVERIFY(!urls.contains(QUrl::fromLocalFile(sandBoxDir.absoluteFilePath("d3/sub/pict0.jpg"))));
+    QVERIFY(urls.contains(QUrl::fromLocalFile(sandBoxDir.absoluteFilePath("d4/sub/pict0.jpg"))));
+
+    // Removing files one by one, in a single dir
+    for (int idx = 0; idx < filesPerDir; idx += 2) {
+        QVERIFY(sandBoxDir.remove(QStringLiteral("d5/sub/pict%1.jpg").arg(idx)));
+    }
+    QTRY_COMPARE_WITH_TIMEOUT(model.rowCount(QModelIndex()), (dirCount - 1) * filesPerDir - filesPerDir / 2, 10000);
+}
@@ -34,6 +34,8 @@ private Q_SLOTS:
     void testBasic_data();
     void testBasic();
     void testSetNewUrl();
+    void testManyFiles();
+    void testRemoveManyFiles();
 };
 
 #endif /* RECURSIVEDIRMODELTEST_H */
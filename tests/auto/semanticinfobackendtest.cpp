@@ -33,9 +33,10 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "testutils.h"
 #include <config-gwenview.h>
 
-#ifdef GWENVIEW_SEMANTICINFO_BACKEND_FAKE
 #include <lib/semanticinfo/fakesemanticinfobackend.h>
 
+#if defined(GWENVIEW_SEMANTICINFO_BACKEND_FAKE)
+
 #elif defined(GWENVIEW_SEMANTICINFO_BACKEND_BALOO)
 #include <lib/semanticinfo/baloosemanticinfobackend.h>
 
@@ -106,6 +107,37 @@ void SemanticInfoBackEndTest::testRating()
     mBackEnd->storeSemanticInfo(url, semanticInfo);
 }
 
+/**
+ * Retrieve the semantic info of many urls at once, using the fake backend so
+ * that the result does not depend on the files
+ */
+void SemanticInfoBackEndTest::testRetrieveSemanticInfoList()
+{
+    FakeSemanticInfoBackEnd backEnd(nullptr, FakeSemanticInfoBackEnd::InitializeRandom);
+    QList<QUrl> urls;
+    for (int idx = 0; idx < 1000; ++idx) {
+        urls << QUrl::fromLocalFile(QStringLiteral("/foo/image%1.jpg").arg(idx));
+    }
+
+    SemanticInfoForUrl semanticInfoForUrl;
+    int chunkCount = 0;
+    connect(&backEnd, &AbstractSemanticInfoBackEnd::semanticInfoListRetrieved,
+            [&semanticInfoForUrl, &chunkCount](const SemanticInfoForUrl& chunk) {
+        QVERIFY(chunk.count() <= AbstractSemanticInfoBackEnd::RetrieveChunkSize);
+        semanticInfoForUrl.unite(chunk);
+        ++chunkCount;
+    });
+    backEnd.retrieveSemanticInfoList(urls);
+
+    const int expectedChunkCount = (urls.count() + AbstractSemanticInfoBackEnd::RetrieveChunkSize - 1) / AbstractSemanticInfoBackEnd::RetrieveChunkSize;
+    QTRY_COMPARE(chunkCount, expectedChunkCount);
+    QCOMPARE(semanticInfoForUrl.count(), urls.count());
+    Q_FOREACH(const QUrl& url, urls) {
+        QCOMPARE(semanticInfoForUrl.value(url).mRating, url.url().length() % 6);
+        QCOMPARE(semanticInfoForUrl.value(url).mDescription, url.fileName());
+    }
+}
+
 #if 0
 // Disabled because Baloo does not work like Nepomuk: it does not create tags
 // independently of files.
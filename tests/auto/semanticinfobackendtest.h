@@ -65,6 +65,7 @@ private Q_SLOTS:
     void init();
     void cleanup();
     void testRating();
+    void testRetrieveSemanticInfoList();
     #if 0
     void testTagForLabel();
     #endif
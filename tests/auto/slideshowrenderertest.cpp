@@ -0,0 +1,106 @@
+/*
+Gwenview: an image viewer
+Copyright 2019 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#include <qtest.h>
+
+// Qt
+#include <QImage>
+#include <QSignalSpy>
+
+// Local
+#include "../lib/slideshowrenderer.h"
+#include "testutils.h"
+
+#include "slideshowrenderertest.h"
+
+QTEST_MAIN(SlideShowRendererTest)
+
+using namespace Gwenview;
+
+void SlideShowRendererTest::testRenderFrame_data()
+{
+    QTest::addColumn<QSizeF>("viewSize");
+    QTest::addColumn<QSize>("expectedSize");
+
+    // test.png is 150x100
+    QTest::newRow("full-image") << QSizeF(75, 75) << QSize(75, 50);
+    QTest::newRow("down-sampled") << QSizeF(30, 40) << QSize(30, 20);
+    QTest::newRow("smaller-image") << QSizeF(800, 600) << QSize(150, 100);
+}
+
+void SlideShowRendererTest::testRenderFrame()
+{
+    QFETCH(QSizeF, viewSize);
+    QFETCH(QSize, expectedSize);
+
+    const QUrl url = urlForTestFile("test.png");
+    SlideShowRenderer renderer;
+    QSignalSpy spy(&renderer, SIGNAL(frameReady(QUrl)));
+    renderer.setViewSize(viewSize);
+    renderer.setQueue(QVector<QUrl>() << url);
+    if (spy.isEmpty()) {
+        QVERIFY(renderer.isPending(url));
+        QVERIFY(spy.wait());
+    }
+
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(spy.at(0).at(0).toUrl(), url);
+    QVERIFY(!renderer.isPending(url));
+    const QImage frame = renderer.frame(url);
+    QCOMPARE(frame.size(), expectedSize);
+}
+
+void SlideShowRendererTest::testQueueChange()
+{
+    const QUrl url = urlForTestFile("test.png");
+    SlideShowRenderer renderer;
+    QSignalSpy spy(&renderer, SIGNAL(frameReady(QUrl)));
+    renderer.setViewSize(QSizeF(75, 75));
+    renderer.setQueue(QVector<QUrl>() << url);
+    if (spy.isEmpty()) {
+        QVERIFY(spy.wait());
+    }
+    QVERIFY(!renderer.frame(url).isNull());
+
+    // Frames of urls which are not queued anymore are dropped
+    renderer.setQueue(QVector<QUrl>());
+    QVERIFY(renderer.frame(url).isNull());
+    QVERIFY(!renderer.isPending(url));
+}
+
+void SlideShowRendererTest::testViewSizeChange()
+{
+    const QUrl url = urlForTestFile("test.png");
+    SlideShowRenderer renderer;
+    QSignalSpy spy(&renderer, SIGNAL(frameReady(QUrl)));
+    renderer.setQueue(QVector<QUrl>() << url);
+    // Nothing can be rendered until the view size is known
+    QVERIFY(!renderer.isPending(url));
+
+    renderer.setViewSize(QSizeF(75, 75));
+    if (spy.isEmpty()) {
+        QVERIFY(spy.wait());
+    }
+    QCOMPARE(renderer.frame(url).size(), QSize(75, 50));
+
+    renderer.setViewSize(QSizeF(60, 60));
+    QVERIFY(renderer.isPending(url));
+    QVERIFY(spy.wait());
+    QCOMPARE(renderer.frame(url).size(), QSize(60, 40));
+}
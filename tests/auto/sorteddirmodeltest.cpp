@@ -23,13 +23,16 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 // Local
 #include <testutils.h>
+#include <lib/namesearchindex.h>
 #include <lib/semanticinfo/sorteddirmodel.h>
 
 // Qt
+#include <QStringListModel>
 
 // KDE
 #include <qtest.h>
 #include <KDirLister>
+#include <KDirModel>
 #include <QTemporaryDir>
 
 using namespace Gwenview;
@@ -47,6 +50,11 @@ void SortedDirModelTest::initTestCase()
     createEmptyFile(mSandBoxDir.absoluteFilePath("dirs_and_docs/file.png"));
     mSandBoxDir.mkdir("docs_only");
     createEmptyFile(mSandBoxDir.absoluteFilePath("docs_only/file.png"));
+    mSandBoxDir.mkdir("sort");
+    mSandBoxDir.mkdir("sort/z_dir");
+    createEmptyFile(mSandBoxDir.absoluteFilePath("sort/b.png"));
+    createEmptyFile(mSandBoxDir.absoluteFilePath("sort/a10.png"));
+    createEmptyFile(mSandBoxDir.absoluteFilePath("sort/a2.png"));
 }
 
 void SortedDirModelTest::testHasDocuments_data()
@@ -75,3 +83,108 @@ void SortedDirModelTest::testHasDocuments()
     loop.exec();
     QCOMPARE(model.hasDocuments(), hasDocuments);
 }
+
+void SortedDirModelTest::testSortByName()
+{
+    SortedDirModel model;
+    model.sort(KDirModel::Name, Qt::AscendingOrder);
+    QEventLoop loop;
+    connect(model.dirLister(), SIGNAL(completed()), &loop, SLOT(quit()));
+    model.dirLister()->openUrl(QUrl::fromLocalFile(mSandBoxDir.absoluteFilePath("sort")));
+    loop.exec();
+
+    QStringList names;
+    for (int row = 0; row < model.rowCount(); ++row) {
+        names << model.itemForIndex(model.index(row, 0)).name();
+    }
+    QCOMPARE(names, QStringList() << "z_dir" << "a2.png" << "a10.png" << "b.png");
+
+    model.sort(KDirModel::Name, Qt::DescendingOrder);
+    names.clear();
+    for (int row = 0; row < model.rowCount(); ++row) {
+        names << model.itemForIndex(model.index(row, 0)).name();
+    }
+    QCOMPARE(names, QStringList() << "z_dir" << "b.png" << "a10.png" << "a2.png");
+}
+
+void SortedDirModelTest::testNameSearchIndex()
+{
+    const QStringList names = QStringList()
+        << "IMG_0001.JPG" << "img_0002.jpg" << "Holiday.png" << "Beach.PNG";
+    NameSearchIndex index;
+    Q_FOREACH(const QString& name, names) {
+        QVERIFY(index.contains(name));
+    }
+
+    // Narrowing
+    index.setText("IMG");
+    QVERIFY(index.contains("IMG_0001.JPG"));
+    QVERIFY(index.contains("img_0002.jpg"));
+    QVERIFY(!index.contains("Holiday.png"));
+    index.setText("img_0001");
+    QVERIFY(index.contains("IMG_0001.JPG"));
+    QVERIFY(!index.contains("img_0002.jpg"));
+
+    // Broadening
+    index.setText("img_000");
+    QVERIFY(index.contains("IMG_0001.JPG"));
+    QVERIFY(index.contains("img_0002.jpg"));
+    QVERIFY(!index.contains("Holiday.png"));
+
+    // Unrelated text
+    index.setText("png");
+    QVERIFY(!index.contains("IMG_0001.JPG"));
+    QVERIFY(index.contains("Holiday.png"));
+    QVERIFY(index.contains("Beach.PNG"));
+
+    // Case of the text does not matter either
+    index.setText("BEACH");
+    QVERIFY(index.contains("Beach.PNG"));
+    QVERIFY(!index.contains("Holiday.png"));
+
+    // Names added after the text has been set
+    QVERIFY(index.contains("new_beach.png"));
+    QVERIFY(!index.contains("new.png"));
+    QCOMPARE(index.count(), names.count() + 2);
+
+    index.clear();
+    QCOMPARE(index.count(), 0);
+}
+
+void SortedDirModelTest::benchmarkNameFilter_data()
+{
+    QTest::addColumn<bool>("useIndex");
+    QTest::newRow("contains") << false;
+    QTest::newRow("index") << true;
+}
+
+/**
+ * Simulates typing a search text in the name filter of a 100k entries folder
+ */
+void SortedDirModelTest::benchmarkNameFilter()
+{
+    QFETCH(bool, useIndex);
+    QStringList names;
+    for (int idx = 0; idx < 100000; ++idx) {
+        names << (idx % 10 ? QStringLiteral("IMG_%1.JPG") : QStringLiteral("holiday_%1.png")).arg(idx, 6, 10, QLatin1Char('0'));
+    }
+    QStringListModel model(names);
+    const QStringList keyStrokes = QStringList() << "i" << "im" << "img" << "img_" << "img_01" << "img_012";
+
+    NameSearchIndex index;
+    int matchCount = 0;
+    QBENCHMARK {
+        Q_FOREACH(const QString& text, keyStrokes) {
+            index.setText(text);
+            matchCount = 0;
+            for (int row = 0; row < model.rowCount(); ++row) {
+                const QString name = model.index(row, 0).data().toString();
+                if (useIndex ? index.contains(name) : name.contains(text, Qt::CaseInsensitive)) {
+                    ++matchCount;
+                }
+            }
+        }
+    }
+    // IMG_012000 to IMG_012999, except every tenth one
+    QCOMPARE(matchCount, 900);
+}
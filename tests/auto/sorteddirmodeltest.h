@@ -37,6 +37,10 @@ private Q_SLOTS:
     void initTestCase();
     void testHasDocuments_data();
     void testHasDocuments();
+    void testSortByName();
+    void testNameSearchIndex();
+    void benchmarkNameFilter_data();
+    void benchmarkNameFilter();
 
 private:
     TestUtils::SandBoxDir mSandBoxDir;
@@ -227,6 +227,84 @@ void ThumbnailProviderTest::testUseEmbeddedOrNot()
     }
 }
 
+void ThumbnailProviderTest::testLoadLarge2xFromCache()
+{
+    SandBox sandBox;
+    sandBox.initDir();
+    sandBox.createTestImage("big.png", 1200, 800, Qt::red);
+
+    KFileItemList list;
+    QUrl url("file://" + QDir(sandBox.mPath).absoluteFilePath("big.png"));
+    list << KFileItem(url);
+
+    // Large2x thumbnails must end up in the freedesktop x-large dir
+    {
+        ThumbnailProvider provider;
+        provider.setThumbnailGroup(ThumbnailGroup::Large2x);
+        provider.appendItems(list);
+        syncRun(&provider);
+        while (!ThumbnailProvider::isThumbnailWriterEmpty()) {
+            QTest::qWait(100);
+        }
+    }
+    QDir thumbnailDir = ThumbnailProvider::thumbnailBaseDir(ThumbnailGroup::Large2x);
+    QVERIFY(thumbnailDir.path().endsWith(QStringLiteral("/x-large")));
+    QStringList entryList = thumbnailDir.entryList(QStringList("*.png"));
+    QCOMPARE(entryList.count(), 1);
+
+    // Paint the cached thumbnail in another color, so that we can tell whether
+    // the normal thumbnail is derived from it or generated from the original
+    const QString largePath = thumbnailDir.filePath(entryList.first());
+    QImage largeThumb(largePath);
+    QCOMPARE(largeThumb.size(), QSize(512, 341));
+    QImage paintedThumb = createColoredImage(largeThumb.width(), largeThumb.height(), Qt::green);
+    Q_FOREACH(const QString& key, largeThumb.textKeys()) {
+        paintedThumb.setText(key, largeThumb.text(key));
+    }
+    QVERIFY(paintedThumb.save(largePath, "png"));
+
+    {
+        ThumbnailProvider provider;
+        provider.setThumbnailGroup(ThumbnailGroup::Normal);
+        provider.appendItems(list);
+        QSignalSpy spy(&provider, SIGNAL(thumbnailLoaded(KFileItem,QPixmap,QSize,qulonglong)));
+        syncRun(&provider);
+        while (!ThumbnailProvider::isThumbnailWriterEmpty()) {
+            QTest::qWait(100);
+        }
+
+        QCOMPARE(spy.count(), 1);
+        const QImage thumb = qvariant_cast<QPixmap>(spy.at(0).at(1)).toImage();
+        QCOMPARE(thumb.size(), QSize(128, 85));
+        QCOMPARE(QColor(thumb.pixel(64, 42)), QColor(Qt::green));
+        QCOMPARE(spy.at(0).at(2).toSize(), QSize(1200, 800));
+    }
+
+    // The derived thumbnail must have been cached too
+    thumbnailDir = ThumbnailProvider::thumbnailBaseDir(ThumbnailGroup::Normal);
+    entryList = thumbnailDir.entryList(QStringList("*.png"));
+    QCOMPARE(entryList.count(), 1);
+
+    // An outdated larger thumbnail must not be used
+    QVERIFY(QFile::remove(thumbnailDir.filePath(entryList.first())));
+    paintedThumb.setText(QStringLiteral("Thumb::MTime"), QStringLiteral("1"));
+    QVERIFY(paintedThumb.save(largePath, "png"));
+    {
+        ThumbnailProvider provider;
+        provider.setThumbnailGroup(ThumbnailGroup::Normal);
+        provider.appendItems(list);
+        QSignalSpy spy(&provider, SIGNAL(thumbnailLoaded(KFileItem,QPixmap,QSize,qulonglong)));
+        syncRun(&provider);
+        while (!ThumbnailProvider::isThumbnailWriterEmpty()) {
+            QTest::qWait(100);
+        }
+
+        QCOMPARE(spy.count(), 1);
+        const QImage thumb = qvariant_cast<QPixmap>(spy.at(0).at(1)).toImage();
+        QCOMPARE(QColor(thumb.pixel(64, 42)), QColor(Qt::red));
+    }
+}
+
 void ThumbnailProviderTest::testLoadRemote()
 {
     QUrl url = setUpRemoteTestDir("test.png");
@@ -253,6 +331,33 @@ void ThumbnailProviderTest::testLoadRemote()
     QCOMPARE(entryList.count(), 1);
 }
 
+void ThumbnailProviderTest::testLoadRemoteHead()
+{
+    QUrl url = setUpRemoteTestDir("embedded-thumbnail.jpg");
+    if (!url.isValid()) {
+        QSKIP("Not running this test: failed to setup remote test dir.");
+    }
+    url = url.adjusted(QUrl::StripTrailingSlash);
+    url.setPath(url.path() + '/' + "embedded-thumbnail.jpg");
+
+    KFileItemList list;
+    list << KFileItem(url);
+
+    // The Exif thumbnail is enough for a normal thumbnail, it must be the one
+    // we get
+    ThumbnailProvider provider;
+    provider.setThumbnailGroup(ThumbnailGroup::Normal);
+    provider.appendItems(list);
+    QSignalSpy spy(&provider, SIGNAL(thumbnailLoaded(KFileItem,QPixmap,QSize,qulonglong)));
+    syncRun(&provider);
+
+    QCOMPARE(spy.count(), 1);
+    const QImage expectedThumbnail = createColoredImage(128, 64, Qt::white);
+    const QPixmap thumbnailPix = qvariant_cast<QPixmap>(spy.at(0).at(1));
+    QVERIFY(TestUtils::imageCompare(expectedThumbnail, thumbnailPix.toImage()));
+    QCOMPARE(spy.at(0).at(2).toSize(), QSize(256, 128));
+}
+
 void ThumbnailProviderTest::testRemoveItemsWhileGenerating()
 {
     QDir dir(mSandBox.mPath);
@@ -48,7 +48,9 @@ private Q_SLOTS:
     void initTestCase();
     void testLoadLocal();
     void testLoadRemote();
+    void testLoadRemoteHead();
     void testUseEmbeddedOrNot();
+    void testLoadLarge2xFromCache();
     void testRemoveItemsWhileGenerating();
 
 private:
@@ -19,15 +19,20 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 */
 // Qt
 #include <QEventLoop>
+#include <QFile>
 #include <QImage>
+#include <QSignalSpy>
+#include <QTemporaryDir>
 
 // KDE
 #include <QDebug>
 #include <qtest.h>
 
 // Local
+#include "../lib/batchtransformjob.h"
 #include "../lib/document/documentfactory.h"
 #include "../lib/imageutils.h"
+#include "../lib/jpegcontent.h"
 #include "../lib/transformimageoperation.h"
 #include "testutils.h"
 
@@ -67,3 +72,36 @@ void TransformImageOperationTest::testRotate90()
 
     QCOMPARE(image, doc->image());
 }
+
+void TransformImageOperationTest::testBatchTransform()
+{
+    QTemporaryDir dir;
+    const QString jpegPath = dir.path() + QStringLiteral("/orient6.jpg");
+    const QString pngPath = dir.path() + QStringLiteral("/test.png");
+    QVERIFY(QFile::copy(pathForTestFile("orient6.jpg"), jpegPath));
+    QVERIFY(QFile::copy(pathForTestFile("test.png"), pngPath));
+
+    QSize sizeBefore;
+    {
+        JpegContent content;
+        QVERIFY(content.load(jpegPath));
+        QCOMPARE(content.orientation(), ROT_90);
+        sizeBefore = content.size();
+    }
+
+    QList<QUrl> urls;
+    urls << QUrl::fromLocalFile(jpegPath) << QUrl::fromLocalFile(pngPath);
+    BatchTransformJob* job = new BatchTransformJob(urls, ROT_90);
+    QSignalSpy spy(job, SIGNAL(urlTransformed(QUrl)));
+    QVERIFY(!job->exec());
+
+    // The JPEG has been transformed, the PNG has been reported as an error
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(spy.at(0).at(0).toUrl(), QUrl::fromLocalFile(jpegPath));
+    QCOMPARE(job->errorList().count(), 1);
+
+    JpegContent content;
+    QVERIFY(content.load(jpegPath));
+    QCOMPARE(content.orientation(), NORMAL);
+    QCOMPARE(content.size(), sizeBefore.transposed());
+}
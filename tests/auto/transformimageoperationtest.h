@@ -32,6 +32,7 @@ class TransformImageOperationTest : public QObject
 
 private Q_SLOTS:
     void testRotate90();
+    void testBatchTransform();
     void initTestCase();
     void init();
 };
@@ -0,0 +1,190 @@
+/*
+Gwenview: an image viewer
+Copyright 2019 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "dirmodelbench.h"
+
+// Qt
+#include <QDir>
+#include <QFile>
+#include <QTest>
+
+// KDE
+#include <KDirLister>
+#include <KDirModel>
+
+// Local
+#include <lib/namesearchindex.h>
+#include <lib/semanticinfo/sorteddirmodel.h>
+
+QTEST_MAIN(DirModelBench)
+
+using namespace Gwenview;
+
+static const int FILE_COUNTS[] = { 10000, 100000 };
+
+/**
+ * Same as the name filter of the filter bar
+ */
+class NameFilter : public AbstractSortedDirModelFilter
+{
+public:
+    explicit NameFilter(SortedDirModel* model)
+    : AbstractSortedDirModelFilter(model)
+    {}
+
+    bool needsSemanticInfo() const override
+    {
+        return false;
+    }
+
+    bool acceptsIndex(const QModelIndex& index) const override
+    {
+        return mIndex.text().isEmpty() || mIndex.contains(index.data().toString());
+    }
+
+    void setText(const QString& text)
+    {
+        mIndex.setText(text);
+    }
+
+private:
+    mutable NameSearchIndex mIndex;
+};
+
+// SortedDirModel applies filters from a timer, do it right away instead
+static void applyFiltersNow(SortedDirModel* model)
+{
+    QMetaObject::invokeMethod(model, "doApplyFilters");
+}
+
+static void openDir(SortedDirModel* model, const QString& path)
+{
+    QEventLoop loop;
+    QObject::connect(model->dirLister(), SIGNAL(completed()), &loop, SLOT(quit()));
+    model->dirLister()->openUrl(QUrl::fromLocalFile(path));
+    loop.exec();
+}
+
+QString DirModelBench::dirPath(int fileCount) const
+{
+    return mTempDir.filePath(QString::number(fileCount));
+}
+
+void DirModelBench::initTestCase()
+{
+    QVERIFY(mTempDir.isValid());
+    const char* extensions[] = { "jpg", "png", "txt", "mp4" };
+    for (int fileCount : FILE_COUNTS) {
+        QDir dir(dirPath(fileCount));
+        QVERIFY(dir.mkpath(QStringLiteral(".")));
+        for (int idx = 0; idx < fileCount; ++idx) {
+            // Sizes vary so that sorting by size is meaningful
+            QFile file(dir.filePath(QStringLiteral("IMG_%1.%2").arg(idx * 7919 % fileCount).arg(QLatin1String(extensions[idx % 4]))));
+            QVERIFY(file.open(QIODevice::WriteOnly));
+            file.write(QByteArray(idx % 97, 'x'));
+        }
+    }
+}
+
+void DirModelBench::addCountRows()
+{
+    QTest::addColumn<int>("fileCount");
+    for (int fileCount : FILE_COUNTS) {
+        QTest::newRow(QByteArray::number(fileCount).constData()) << fileCount;
+    }
+}
+
+void DirModelBench::benchmarkSort_data()
+{
+    QTest::addColumn<int>("fileCount");
+    QTest::addColumn<int>("column");
+    const QList<QPair<int, QByteArray>> columns = {
+        { KDirModel::Name, "name" },
+        { KDirModel::Size, "size" },
+        { KDirModel::ModifiedTime, "date" }
+    };
+    for (int fileCount : FILE_COUNTS) {
+        for (const auto& column : columns) {
+            QTest::newRow(QByteArray(QByteArray::number(fileCount) + ' ' + column.second).constData()) << fileCount << column.first;
+        }
+    }
+}
+
+void DirModelBench::benchmarkSort()
+{
+    QFETCH(int, fileCount);
+    QFETCH(int, column);
+    SortedDirModel model;
+    openDir(&model, dirPath(fileCount));
+    QCOMPARE(model.rowCount(), fileCount);
+
+    Qt::SortOrder order = Qt::AscendingOrder;
+    QBENCHMARK {
+        order = order == Qt::AscendingOrder ? Qt::DescendingOrder : Qt::AscendingOrder;
+        model.sort(column, order);
+    }
+}
+
+void DirModelBench::benchmarkKindFilter_data()
+{
+    addCountRows();
+}
+
+void DirModelBench::benchmarkKindFilter()
+{
+    QFETCH(int, fileCount);
+    SortedDirModel model;
+    openDir(&model, dirPath(fileCount));
+
+    QBENCHMARK {
+        model.setKindFilter(MimeTypeUtils::KIND_RASTER_IMAGE);
+        applyFiltersNow(&model);
+        QCOMPARE(model.rowCount(), fileCount / 2);
+        model.setKindFilter(MimeTypeUtils::Kinds());
+        applyFiltersNow(&model);
+    }
+}
+
+void DirModelBench::benchmarkNameFilter_data()
+{
+    addCountRows();
+}
+
+void DirModelBench::benchmarkNameFilter()
+{
+    QFETCH(int, fileCount);
+    SortedDirModel model;
+    openDir(&model, dirPath(fileCount));
+    NameFilter* filter = new NameFilter(&model);
+
+    // Simulates typing and erasing a pattern in the filter bar
+    const QString pattern = QStringLiteral("IMG_12");
+    QBENCHMARK {
+        for (int length = 1; length <= pattern.length(); ++length) {
+            filter->setText(pattern.left(length));
+            applyFiltersNow(&model);
+        }
+        for (int length = pattern.length() - 1; length >= 0; --length) {
+            filter->setText(pattern.left(length));
+            applyFiltersNow(&model);
+        }
+    }
+    QCOMPARE(model.rowCount(), fileCount);
+}
@@ -0,0 +1,292 @@
+/*
+Gwenview: an image viewer
+Copyright 2019 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "imagebench.h"
+
+// Qt
+#include <QBuffer>
+#include <QImage>
+#include <QImageWriter>
+#include <QLinearGradient>
+#include <QPainter>
+#include <QSignalSpy>
+#include <QTest>
+
+// KDE
+
+// Local
+#include <lib/cms/cmsprofile.h>
+#include <lib/document/document.h>
+#include <lib/document/documentfactory.h>
+#include <lib/imagescaler.h>
+#include <lib/jpegcontent.h>
+#include <lib/orientation.h>
+#include <lib/thumbnailgroup.h>
+#include <lib/thumbnailprovider/thumbnailgenerator.h>
+
+// lcms
+#include <lcms2.h>
+
+QTEST_MAIN(ImageBench)
+
+using namespace Gwenview;
+
+static const QSize SMALL_SIZE(1024, 768);
+static const QSize LARGE_SIZE(6000, 4000);
+
+/**
+ * Creates an image with gradients and noise, so that it does not compress
+ * unrealistically well
+ */
+static QImage createImage(const QSize& size)
+{
+    QImage image(size, QImage::Format_RGB32);
+    QPainter painter(&image);
+    QLinearGradient gradient(0, 0, size.width(), size.height());
+    gradient.setColorAt(0, Qt::red);
+    gradient.setColorAt(0.5, Qt::green);
+    gradient.setColorAt(1, Qt::blue);
+    painter.fillRect(image.rect(), gradient);
+    painter.end();
+
+    quint32 seed = 1;
+    for (int y = 0; y < size.height(); ++y) {
+        QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(y));
+        for (int x = 0; x < size.width(); ++x) {
+            seed = seed * 1103515245 + 12345;
+            const int noise = int((seed >> 16) & 0x1f) - 16;
+            const QRgb rgb = line[x];
+            line[x] = qRgb(qBound(0, qRed(rgb) + noise, 255),
+                           qBound(0, qGreen(rgb) + noise, 255),
+                           qBound(0, qBlue(rgb) + noise, 255));
+        }
+    }
+    return image;
+}
+
+static Document::Ptr loadDocument(const QString& path)
+{
+    Document::Ptr doc = DocumentFactory::instance()->load(QUrl::fromLocalFile(path));
+    doc->waitUntilLoaded();
+    return doc;
+}
+
+static QString sizeName(const QSize& size)
+{
+    return QStringLiteral("%1x%2").arg(size.width()).arg(size.height());
+}
+
+QString ImageBench::imagePath(const QByteArray& format, const QSize& size) const
+{
+    return mTempDir.filePath(sizeName(size) + QLatin1Char('.') + QString::fromLatin1(format));
+}
+
+void ImageBench::initTestCase()
+{
+    QVERIFY(mTempDir.isValid());
+    for (const QSize& size : { SMALL_SIZE, LARGE_SIZE }) {
+        const QImage image = createImage(size);
+        for (const QByteArray& format : { QByteArray("jpeg"), QByteArray("png"), QByteArray("bmp") }) {
+            QImageWriter writer(imagePath(format, size), format);
+            QVERIFY2(writer.write(image), qPrintable(writer.errorString()));
+        }
+    }
+}
+
+void ImageBench::cleanup()
+{
+    DocumentFactory::instance()->clearCache();
+}
+
+static void addFormatAndSizeRows()
+{
+    QTest::addColumn<QByteArray>("format");
+    QTest::addColumn<QSize>("size");
+    for (const QSize& size : { SMALL_SIZE, LARGE_SIZE }) {
+        for (const QByteArray& format : { QByteArray("jpeg"), QByteArray("png"), QByteArray("bmp") }) {
+            QTest::newRow(QByteArray(format + ' ' + sizeName(size).toLatin1()).constData()) << format << size;
+        }
+    }
+}
+
+void ImageBench::benchmarkDocumentLoad_data()
+{
+    addFormatAndSizeRows();
+}
+
+void ImageBench::benchmarkDocumentLoad()
+{
+    QFETCH(QByteArray, format);
+    QFETCH(QSize, size);
+    const QString path = imagePath(format, size);
+
+    QBENCHMARK {
+        DocumentFactory::instance()->clearCache();
+        Document::Ptr doc = loadDocument(path);
+        QCOMPARE(doc->loadingState(), Document::Loaded);
+    }
+}
+
+void ImageBench::benchmarkDownSampling_data()
+{
+    QTest::addColumn<QByteArray>("format");
+    QTest::addColumn<qreal>("zoom");
+    for (const QByteArray& format : { QByteArray("jpeg"), QByteArray("png") }) {
+        for (qreal zoom : { 0.125, 0.25, 0.5 }) {
+            QTest::newRow(QByteArray(format + " zoom " + QByteArray::number(zoom)).constData()) << format << zoom;
+        }
+    }
+}
+
+void ImageBench::benchmarkDownSampling()
+{
+    QFETCH(QByteArray, format);
+    QFETCH(qreal, zoom);
+    const QUrl url = QUrl::fromLocalFile(imagePath(format, LARGE_SIZE));
+
+    QBENCHMARK {
+        DocumentFactory::instance()->clearCache();
+        Document::Ptr doc = DocumentFactory::instance()->load(url);
+        QSignalSpy spy(doc.data(), SIGNAL(downSampledImageReady()));
+        if (!doc->prepareDownSampledImageForZoom(zoom)) {
+            QVERIFY(spy.wait(30000));
+        }
+        QVERIFY(!doc->downSampledImageForZoom(zoom).isNull());
+    }
+}
+
+void ImageBench::benchmarkImageScaler_data()
+{
+    QTest::addColumn<qreal>("zoom");
+    QTest::newRow("25%") << 0.25;
+    QTest::newRow("50%") << 0.5;
+    QTest::newRow("100%") << 1.0;
+    QTest::newRow("200%") << 2.0;
+    QTest::newRow("400%") << 4.0;
+}
+
+void ImageBench::benchmarkImageScaler()
+{
+    QFETCH(qreal, zoom);
+    Document::Ptr doc = loadDocument(imagePath("jpeg", LARGE_SIZE));
+    if (zoom < Document::maxDownSampledZoom()) {
+        QSignalSpy spy(doc.data(), SIGNAL(downSampledImageReady()));
+        if (!doc->prepareDownSampledImageForZoom(zoom)) {
+            QVERIFY(spy.wait(30000));
+        }
+    }
+
+    ImageScaler scaler;
+    scaler.setDocument(doc);
+    scaler.setZoom(zoom);
+    int scaledRectCount = 0;
+    connect(&scaler, &ImageScaler::scaledRect, this, [&scaledRectCount]() {
+        ++scaledRectCount;
+    });
+
+    // A typical view, centered on the image
+    const QSize zoomedSize = doc->size() * zoom;
+    QRect region(QPoint(0, 0), QSize(1920, 1080).boundedTo(zoomedSize));
+    region.moveCenter(QRect(QPoint(0, 0), zoomedSize).center());
+    QBENCHMARK {
+        scaler.setDestinationRegion(region);
+    }
+    QVERIFY(scaledRectCount > 0);
+}
+
+void ImageBench::benchmarkCmsTransform()
+{
+    QImage image = createImage(LARGE_SIZE);
+
+    // sRGB to Adobe RGB (1998)
+    const cmsCIExyY whitePoint = { 0.3127, 0.3290, 1.0 };
+    const cmsCIExyYTRIPLE primaries = {
+        { 0.6400, 0.3300, 1.0 },
+        { 0.2100, 0.7100, 1.0 },
+        { 0.1500, 0.0600, 1.0 }
+    };
+    cmsToneCurve* curve = cmsBuildGamma(nullptr, 2.19921875);
+    cmsToneCurve* curves[3] = { curve, curve, curve };
+    cmsHPROFILE adobeRgbProfile = cmsCreateRGBProfile(&whitePoint, &primaries, curves);
+    cmsFreeToneCurve(curve);
+    QVERIFY(adobeRgbProfile);
+
+    Cms::Profile::Ptr srgbProfile = Cms::Profile::getSRgbProfile();
+    cmsHTRANSFORM transform = cmsCreateTransform(srgbProfile->handle(), TYPE_BGRA_8,
+                                                 adobeRgbProfile, TYPE_BGRA_8,
+                                                 INTENT_PERCEPTUAL, cmsFLAGS_BLACKPOINTCOMPENSATION);
+    QVERIFY(transform);
+
+    QBENCHMARK {
+        uchar* bytes = image.bits();
+        cmsDoTransform(transform, bytes, bytes, image.width() * image.height());
+    }
+
+    cmsDeleteTransform(transform);
+    cmsCloseProfile(adobeRgbProfile);
+}
+
+void ImageBench::benchmarkThumbnailContextLoad_data()
+{
+    QTest::addColumn<QByteArray>("format");
+    QTest::addColumn<int>("group");
+    for (const QByteArray& format : { QByteArray("jpeg"), QByteArray("png") }) {
+        QTest::newRow(QByteArray(format + " normal").constData()) << format << int(ThumbnailGroup::Normal);
+        QTest::newRow(QByteArray(format + " large").constData()) << format << int(ThumbnailGroup::Large);
+    }
+}
+
+void ImageBench::benchmarkThumbnailContextLoad()
+{
+    QFETCH(QByteArray, format);
+    QFETCH(int, group);
+    const QString path = imagePath(format, LARGE_SIZE);
+    const int pixelSize = ThumbnailGroup::pixelSize(ThumbnailGroup::Enum(group));
+
+    QBENCHMARK {
+        ThumbnailContext context;
+        QVERIFY(context.load(path, pixelSize));
+    }
+}
+
+void ImageBench::benchmarkJpegContentTransform_data()
+{
+    QTest::addColumn<int>("orientation");
+    QTest::newRow("rot 90") << int(ROT_90);
+    QTest::newRow("rot 180") << int(ROT_180);
+    QTest::newRow("hflip") << int(HFLIP);
+}
+
+void ImageBench::benchmarkJpegContentTransform()
+{
+    QFETCH(int, orientation);
+    QFile file(imagePath("jpeg", LARGE_SIZE));
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    const QByteArray data = file.readAll();
+
+    QBENCHMARK {
+        JpegContent content;
+        QVERIFY(content.loadFromData(data));
+        content.transform(Orientation(orientation));
+        QBuffer buffer;
+        buffer.open(QIODevice::WriteOnly);
+        QVERIFY(content.save(&buffer));
+    }
+}
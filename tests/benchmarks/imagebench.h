@@ -0,0 +1,53 @@
+/*
+Gwenview: an image viewer
+Copyright 2019 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef IMAGEBENCH_H
+#define IMAGEBENCH_H
+
+// Qt
+#include <QObject>
+#include <QTemporaryDir>
+
+class ImageBench : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void cleanup();
+
+    void benchmarkDocumentLoad_data();
+    void benchmarkDocumentLoad();
+    void benchmarkDownSampling_data();
+    void benchmarkDownSampling();
+    void benchmarkImageScaler_data();
+    void benchmarkImageScaler();
+    void benchmarkCmsTransform();
+    void benchmarkThumbnailContextLoad_data();
+    void benchmarkThumbnailContextLoad();
+    void benchmarkJpegContentTransform_data();
+    void benchmarkJpegContentTransform();
+
+private:
+    QTemporaryDir mTempDir;
+
+    QString imagePath(const QByteArray& format, const QSize& size) const;
+};
+
+#endif /* IMAGEBENCH_H */
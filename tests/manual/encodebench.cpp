@@ -0,0 +1,107 @@
+/*
+Gwenview: an image viewer
+Copyright 2019 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Qt
+#include <QBuffer>
+#include <QDebug>
+#include <QGuiApplication>
+#include <QImage>
+#include <QImageWriter>
+#include <QLinearGradient>
+#include <QPainter>
+#include <QTime>
+
+// Local
+#include <lib/parallelimageencoder.h>
+
+using namespace Gwenview;
+
+const int ITERATIONS = 3;
+
+static QImage createImage(const QSize& size)
+{
+    QImage image(size, QImage::Format_RGB32);
+    QPainter painter(&image);
+    QLinearGradient gradient(0, 0, size.width(), size.height());
+    gradient.setColorAt(0, Qt::red);
+    gradient.setColorAt(0.5, Qt::green);
+    gradient.setColorAt(1, Qt::blue);
+    painter.fillRect(image.rect(), gradient);
+    for (int y = 0; y < size.height(); y += 97) {
+        painter.drawText(0, y, QStringLiteral("Gwenview encoding benchmark"));
+    }
+    return image;
+}
+
+static void bench(const QImage& image, const QByteArray& format)
+{
+    int qtTime = 0;
+    int parallelTime = 0;
+    qint64 qtSize = 0;
+    qint64 parallelSize = 0;
+    for (int iteration = 0; iteration < ITERATIONS; ++iteration) {
+        QTime chrono;
+
+        QBuffer qtBuffer;
+        qtBuffer.open(QIODevice::WriteOnly);
+        chrono.start();
+        QImageWriter writer(&qtBuffer, format);
+        writer.write(image);
+        qtTime += chrono.elapsed();
+        qtSize = qtBuffer.size();
+
+        QBuffer parallelBuffer;
+        parallelBuffer.open(QIODevice::WriteOnly);
+        QString errorString;
+        chrono.start();
+        if (!ParallelImageEncoder::write(&parallelBuffer, image, format, &errorString)) {
+            qWarning() << "Parallel encoding failed:" << errorString;
+            return;
+        }
+        parallelTime += chrono.elapsed();
+        parallelSize = parallelBuffer.size();
+    }
+    qDebug() << format
+        << "QImageWriter:" << qtTime / ITERATIONS << "ms" << qtSize << "bytes"
+        << "ParallelImageEncoder:" << parallelTime / ITERATIONS << "ms" << parallelSize << "bytes";
+}
+
+int main(int argc, char** argv)
+{
+    // QGuiApplication is needed by QPainter::drawText() in createImage()
+    QGuiApplication app(argc, argv);
+    QImage image;
+    if (argc == 2) {
+        if (!image.load(QString::fromUtf8(argv[1]))) {
+            qDebug() << QStringLiteral("Could not load '%1'").arg(QString::fromUtf8(argv[1]));
+            return 2;
+        }
+    } else if (argc == 1) {
+        image = createImage(QSize(12000, 8000));
+    } else {
+        qDebug() << "Usage: encodebench [image]";
+        return 1;
+    }
+
+    qDebug() << "Image size:" << image.size();
+    bench(image, "jpeg");
+    bench(image, "png");
+
+    return 0;
+}
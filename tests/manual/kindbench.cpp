@@ -0,0 +1,120 @@
+/*
+Gwenview: an image viewer
+Copyright 2019 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Qt
+#include <QCoreApplication>
+#include <QDebug>
+#include <QStringList>
+#include <QTime>
+#include <QUrl>
+
+// KDE
+#include <KFileItem>
+
+// Local
+#include <lib/mimetypeutils.h>
+
+// System
+#include <sys/stat.h>
+
+using namespace Gwenview;
+
+const int ITEM_COUNT = 50000;
+
+// Number of times each item is painted, for example while scrolling
+const int PAINT_PASSES = 10;
+
+// What mimeTypeKind() used to do for each call
+static MimeTypeUtils::Kind uncachedKind(const KFileItem& item)
+{
+    const QString mimeType = item.mimetype();
+    if (MimeTypeUtils::rasterImageMimeTypes().contains(mimeType)) {
+        return MimeTypeUtils::KIND_RASTER_IMAGE;
+    }
+    if (MimeTypeUtils::svgImageMimeTypes().contains(mimeType)) {
+        return MimeTypeUtils::KIND_SVG_IMAGE;
+    }
+    if (mimeType.startsWith(QLatin1String("video/"))) {
+        return MimeTypeUtils::KIND_VIDEO;
+    }
+    return MimeTypeUtils::KIND_FILE;
+}
+
+static KFileItemList createItems()
+{
+    const QStringList mimeTypes = QStringList()
+        << QStringLiteral("image/jpeg")
+        << QStringLiteral("image/png")
+        << QStringLiteral("image/x-canon-cr2")
+        << QStringLiteral("video/mp4")
+        << QStringLiteral("text/plain");
+    KFileItemList items;
+    items.reserve(ITEM_COUNT);
+    for (int idx = 0; idx < ITEM_COUNT; ++idx) {
+        const QUrl url = QUrl::fromLocalFile(QStringLiteral("/photos/%1/img%2.jpg").arg(idx / 1000).arg(idx));
+        items << KFileItem(url, mimeTypes.at(idx % mimeTypes.count()), S_IFREG);
+    }
+    return items;
+}
+
+template <class Function>
+static int bench(const KFileItemList& items, int passes, Function kindForItem)
+{
+    QTime chrono;
+    chrono.start();
+    int imageCount = 0;
+    for (int pass = 0; pass < passes; ++pass) {
+        for (const KFileItem& item : items) {
+            if (kindForItem(item) == MimeTypeUtils::KIND_RASTER_IMAGE) {
+                ++imageCount;
+            }
+        }
+    }
+    Q_UNUSED(imageCount);
+    return chrono.elapsed();
+}
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+    const KFileItemList items = createItems();
+    // Make sure the mime type lists are initialized
+    MimeTypeUtils::imageMimeTypes();
+
+    // Filtering: each item is classified once
+    int uncachedTime = bench(items, 1, uncachedKind);
+    int hashedTime = bench(items, 1, MimeTypeUtils::fileItemKind);
+    qDebug() << "Filtering" << ITEM_COUNT << "items:"
+        << "uncached:" << uncachedTime << "ms"
+        << "mimeTypeKind():" << hashedTime << "ms";
+
+    // Painting: each item is classified several times
+    MimeTypeUtils::KindCache cache;
+    uncachedTime = bench(items, PAINT_PASSES, uncachedKind);
+    hashedTime = bench(items, PAINT_PASSES, MimeTypeUtils::fileItemKind);
+    const int cachedTime = bench(items, PAINT_PASSES, [&cache](const KFileItem& item) {
+        return cache.kind(item);
+    });
+    qDebug() << "Painting" << ITEM_COUNT << "items" << PAINT_PASSES << "times:"
+        << "uncached:" << uncachedTime << "ms"
+        << "mimeTypeKind():" << hashedTime << "ms"
+        << "KindCache:" << cachedTime << "ms";
+
+    return 0;
+}